@@ -0,0 +1,173 @@
+//
+// File: BootstrapTools.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 16:05 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BootstrapTools.h"
+#include "OptimizationTools.h"
+#include "ParallelTools.h"
+
+#include <Bpp/App/ApplicationTools.h>
+
+// From the STL:
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+vector<unsigned int> BootstrapTools::getBootstrapWeights(const vector<unsigned int>& weights, mt19937& generator)
+{
+  // Cumulative weights, so that each original site is drawn with the same probability:
+  vector<unsigned int> cumWeights(weights.size());
+  unsigned int nbSites = 0;
+  for (size_t i = 0; i < weights.size(); i++)
+  {
+    nbSites += weights[i];
+    cumWeights[i] = nbSites;
+  }
+  vector<unsigned int> newWeights(weights.size(), 0);
+  if (nbSites == 0)
+    return newWeights;
+  uniform_int_distribution<unsigned int> distribution(0, nbSites - 1);
+  for (unsigned int i = 0; i < nbSites; i++)
+  {
+    unsigned int site = distribution(generator);
+    size_t pos = static_cast<size_t>(upper_bound(cumWeights.begin(), cumWeights.end(), site) - cumWeights.begin());
+    newWeights[pos]++;
+  }
+  return newWeights;
+}
+
+/******************************************************************************/
+
+vector<Tree*> BootstrapTools::bootstrapParsimony(
+  const DRTreeParsimonyScore& tp,
+  unsigned int nbReplicates,
+  const string& algorithm,
+  unsigned int maxDistance,
+  unsigned int nbThreads,
+  unsigned int seed,
+  unsigned int verbose) throw (Exception)
+{
+  vector<Tree*> trees(nbReplicates, 0);
+  try
+  {
+    runReplicates_(nbReplicates, nbThreads, verbose, [&](unsigned int r)
+    {
+      seed_seq seq = { seed, r };
+      mt19937 generator(seq);
+      unique_ptr<DRTreeParsimonyScore> replicate(tp.clone());
+      replicate->setWeights(getBootstrapWeights(tp.getWeights(), generator));
+      SPRTopologySearch topoSearch(*replicate, algorithm, maxDistance, 0);
+      topoSearch.search();
+      trees[r] = replicate->getTree().clone();
+    });
+  }
+  catch (...)
+  {
+    for (size_t r = 0; r < trees.size(); r++)
+    {
+      delete trees[r];
+    }
+    throw;
+  }
+  return trees;
+}
+
+/******************************************************************************/
+
+vector<Tree*> BootstrapTools::bootstrapLikelihood(
+  const NNIHomogeneousTreeLikelihood& tl,
+  const ParameterList& parameters,
+  unsigned int nbReplicates,
+  bool optimizeNumFirst,
+  double tolBefore,
+  double tolDuring,
+  unsigned int tlEvalMax,
+  unsigned int nbThreads,
+  unsigned int seed,
+  unsigned int verbose) throw (Exception)
+{
+  vector<Tree*> trees(nbReplicates, 0);
+  try
+  {
+    runReplicates_(nbReplicates, nbThreads, verbose, [&](unsigned int r)
+    {
+      seed_seq seq = { seed, r };
+      mt19937 generator(seq);
+      unique_ptr<NNIHomogeneousTreeLikelihood> replicate(tl.clone());
+      replicate->setWeights(getBootstrapWeights(tl.getLikelihoodData()->getWeights(), generator));
+      OptimizationTools::optimizeTreeNNI2(replicate.get(), parameters, optimizeNumFirst, tolBefore, tolDuring, tlEvalMax, 1, 0, 0, false, 0);
+      trees[r] = replicate->getTree().clone();
+    });
+  }
+  catch (...)
+  {
+    for (size_t r = 0; r < trees.size(); r++)
+    {
+      delete trees[r];
+    }
+    throw;
+  }
+  return trees;
+}
+
+/******************************************************************************/
+
+void BootstrapTools::runReplicates_(unsigned int nbReplicates, unsigned int nbThreads, unsigned int verbose, const function<void (unsigned int)>& replicate)
+{
+  unsigned int done = 0;
+  mutex displayMutex;
+  ParallelTools::parallelFor(nbReplicates, nbThreads, [&](size_t r, size_t)
+  {
+    replicate(static_cast<unsigned int>(r));
+    if (verbose > 0)
+    {
+      lock_guard<mutex> lock(displayMutex);
+      ApplicationTools::displayGauge(done++, nbReplicates - 1, '=');
+    }
+  });
+  if (verbose > 0)
+    ApplicationTools::displayTaskDone();
+}
+
+/******************************************************************************/
+
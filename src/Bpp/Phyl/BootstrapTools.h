@@ -0,0 +1,151 @@
+//
+// File: BootstrapTools.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 16:05 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BOOTSTRAPTOOLS_H_
+#define _BOOTSTRAPTOOLS_H_
+
+#include "Tree.h"
+#include "SPRTopologySearch.h"
+#include "Parsimony/DRTreeParsimonyScore.h"
+#include "Likelihood/NNIHomogeneousTreeLikelihood.h"
+
+#include <Bpp/Numeric/ParameterList.h>
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <random>
+#include <functional>
+
+namespace bpp
+{
+/**
+ * @brief Nonparametric bootstrap by reweighting site patterns.
+ *
+ * The distinct site patterns of a data set do not change between bootstrap replicates, only their counts do.
+ * Replicates are hence obtained by drawing new weights for the patterns of an already initialized
+ * DRTreeParsimonyScore or NNIHomogeneousTreeLikelihood object, instead of resampling a new alignment,
+ * compressing it and building a new object.
+ *
+ * Replicates are run on a pool of threads. Each replicate works on a clone of the input object,
+ * and uses its own random number generator seeded with (seed, replicate index),
+ * so that results do not depend on the number of threads.
+ *
+ * The resulting trees can be passed to TreeTools::computeBootstrapValues().
+ */
+class BootstrapTools
+{
+public:
+  /**
+   * @brief Draw bootstrap weights.
+   *
+   * As many sites as in the original data set are drawn with replacement,
+   * and the weight of each pattern is the number of times it has been drawn.
+   *
+   * @param weights   The original weight of each pattern.
+   * @param generator The random number generator to use.
+   * @return The new weights.
+   */
+  static std::vector<unsigned int> getBootstrapWeights(const std::vector<unsigned int>& weights, std::mt19937& generator);
+
+  /**
+   * @brief Bootstrap under parsimony.
+   *
+   * For each replicate, the topology is optimized using SPR (or TBR) movements, starting from the tree of 'tp'.
+   *
+   * @param tp           The parsimony score object, initialized with the original data set.
+   * @param nbReplicates The number of replicates.
+   * @param algorithm    The type of movements to use (SPRTopologySearch::SPR or SPRTopologySearch::TBR).
+   * @param maxDistance  The maximum distance of the movements (0 for no limit, 1 for NNI-like movements).
+   * @param nbThreads    The number of threads to use (0 to use the number of available cores).
+   * @param seed         The global seed.
+   * @param verbose      The verbose level.
+   * @return The replicate trees, in the order of the replicates. Trees are owned by the caller.
+   */
+  static std::vector<Tree*> bootstrapParsimony(
+    const DRTreeParsimonyScore& tp,
+    unsigned int nbReplicates,
+    const std::string& algorithm = SPRTopologySearch::SPR,
+    unsigned int maxDistance     = 0,
+    unsigned int nbThreads       = 0,
+    unsigned int seed            = 0,
+    unsigned int verbose         = 1) throw (Exception);
+
+  /**
+   * @brief Bootstrap under maximum likelihood.
+   *
+   * For each replicate, the topology and the parameters are optimized using
+   * OptimizationTools::optimizeTreeNNI2(), starting from the tree and the parameter values of 'tl'.
+   *
+   * @param tl               The likelihood object, initialized with the original data set.
+   * @param parameters       The list of parameters to optimize.
+   * @param nbReplicates     The number of replicates.
+   * @param optimizeNumFirst Tell if numerical parameters should be optimized before the topology search.
+   * @param tolBefore        The tolerance to use when estimating numerical parameters before the topology search.
+   * @param tolDuring        The tolerance to use when estimating numerical parameters during the topology search.
+   * @param tlEvalMax        The maximum number of function evaluations.
+   * @param nbThreads        The number of threads to use (0 to use the number of available cores).
+   * @param seed             The global seed.
+   * @param verbose          The verbose level.
+   * @return The replicate trees, in the order of the replicates. Trees are owned by the caller.
+   */
+  static std::vector<Tree*> bootstrapLikelihood(
+    const NNIHomogeneousTreeLikelihood& tl,
+    const ParameterList& parameters,
+    unsigned int nbReplicates,
+    bool optimizeNumFirst  = true,
+    double tolBefore       = 100,
+    double tolDuring       = 100,
+    unsigned int tlEvalMax = 1000000,
+    unsigned int nbThreads = 0,
+    unsigned int seed      = 0,
+    unsigned int verbose   = 1) throw (Exception);
+
+private:
+  /**
+   * @brief Run replicates on a pool of threads.
+   *
+   * Replicates are distributed dynamically, see ParallelTools::parallelFor.
+   */
+  static void runReplicates_(unsigned int nbReplicates, unsigned int nbThreads, unsigned int verbose, const std::function<void (unsigned int)>& replicate);
+};
+} // end of namespace bpp.
+
+#endif // _BOOTSTRAPTOOLS_H_
+
@@ -40,6 +40,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "AbstractAgglomerativeDistanceMethod.h"
 #include "../Node.h"
+#include "../Io/MappedDistanceMatrix.h"
 
 #include <Bpp/App/ApplicationTools.h>
 
@@ -47,6 +48,8 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 
@@ -54,9 +57,29 @@ void AbstractAgglomerativeDistanceMethod::setDistanceMatrix(const DistanceMatrix
 {
   if (matrix.size() <= 3)
     throw Exception("AbstractAgglomerativeDistanceMethod::setDistanceMatrix(): matrix must be at least of dimension 3.");
-  matrix_ = matrix;
+  if (&matrix != &matrix_)
+    matrix_ = matrix;
   currentNodes_.clear();
   if (tree_) delete tree_;
+  tree_ = 0;
+}
+
+void AbstractAgglomerativeDistanceMethod::setMappedDistanceMatrix(const MappedDistanceMatrix& matrix) throw (Exception)
+{
+  size_t n = matrix.size();
+  if (n <= 3)
+    throw Exception("AbstractAgglomerativeDistanceMethod::setMappedDistanceMatrix(): matrix must be at least of dimension 3.");
+  matrix_.resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    matrix_.setName(i, matrix.getName(i));
+    matrix_(i, i) = 0.;
+    for (size_t j = 0; j < i; ++j)
+    {
+      matrix_(i, j) = matrix_(j, i) = matrix(i, j);
+    }
+  }
+  setDistanceMatrix(matrix_);
 }
     
 void AbstractAgglomerativeDistanceMethod::computeTree() throw (Exception)
@@ -75,39 +98,121 @@ void AbstractAgglomerativeDistanceMethod::computeTree() throw (Exception)
     if (verbose_)
       ApplicationTools::displayGauge(matrix_.size() - currentNodes_.size(), matrix_.size() - (rootTree_ ? 2 : 3) - 1);
     vector<size_t> bestPair = getBestPair();
-    vector<double> distances = computeBranchLengthsForPair(bestPair);
-    Node* best1 = currentNodes_[bestPair[0]];
-    Node* best2 = currentNodes_[bestPair[1]];
-    // Distances may be used by getParentNodes (PGMA for instance).
-    best1->setDistanceToFather(distances[0]);
-    best2->setDistanceToFather(distances[1]);
-    Node* parent = getParentNode(idNextNode, best1, best2);
+    agglomerate_(bestPair, idNextNode, newDist);
     idNextNode++;
-    for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  }
+  finalStep(idNextNode);
+}
+
+void AbstractAgglomerativeDistanceMethod::computeTreeFromNearestNeighborChain() throw (Exception)
+{
+  if (!rootTree_)
+    throw Exception("AbstractAgglomerativeDistanceMethod::computeTreeFromNearestNeighborChain(). Only rooted trees can be built with this algorithm.");
+  // Initialization:
+  size_t n = matrix_.size();
+  for (size_t i = 0; i < n; ++i)
+  {
+    currentNodes_[i] = getLeafNode(static_cast<int>(i), matrix_.getName(i));
+  }
+  int idNextNode = static_cast<int>(n);
+  vector<double> newDist(n);
+  // Remaining nodes, and their position in this vector:
+  vector<size_t> active(n);
+  vector<size_t> positions(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    active[i] = i;
+    positions[i] = i;
+  }
+  vector<size_t> chain;
+  chain.reserve(n);
+
+  // Build tree:
+  while (currentNodes_.size() > 2)
+  {
+    if (chain.empty())
+      chain.push_back(active[0]);
+    size_t a = chain.back();
+    // In case of ties, the previous node in the chain is preferred, so that the chain always ends:
+    size_t b = a;
+    double distMin = -std::log(0.);
+    if (chain.size() > 1)
     {
-      size_t id = i->first;
-      if (id != bestPair[0] && id != bestPair[1])
-      {
-        assert (id < newDist.size()); //DEBUG
-        newDist[id] = computeDistancesFromPair(bestPair, distances, id);
-      }
-      else
+      b = chain[chain.size() - 2];
+      distMin = matrix_(a, b);
+    }
+    for (size_t k = 0; k < active.size(); ++k)
+    {
+      size_t id = active[k];
+      if (id == a)
+        continue;
+      double dist = matrix_(a, id);
+      if (dist < distMin)
       {
-        newDist[id] = 0;
+        distMin = dist;
+        b = id;
       }
     }
-    // Actualize currentNodes_:
-    currentNodes_[bestPair[0]] = parent;
-    currentNodes_.erase(bestPair[1]);
-    for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+    if (b == a)
+      throw Exception("AbstractAgglomerativeDistanceMethod::computeTreeFromNearestNeighborChain(). Unexpected error: no nearest neighbor found in the distance matrix.");
+
+    if (chain.size() > 1 && b == chain[chain.size() - 2])
+    {
+      // a and b are reciprocal nearest neighbors:
+      chain.pop_back();
+      chain.pop_back();
+      if (verbose_)
+        ApplicationTools::displayGauge(n - currentNodes_.size(), n - 3);
+      vector<size_t> pair(2);
+      pair[0] = min(a, b);
+      pair[1] = max(a, b);
+      agglomerate_(pair, idNextNode, newDist);
+      idNextNode++;
+      size_t pos = positions[pair[1]];
+      active[pos] = active.back();
+      positions[active[pos]] = pos;
+      active.pop_back();
+    }
+    else
     {
-      size_t id = i->first;
-      matrix_(bestPair[0], id) = matrix_(id, bestPair[0]) = newDist[id];
-    }  
+      chain.push_back(b);
+    }
   }
   finalStep(idNextNode);
 }
 
+void AbstractAgglomerativeDistanceMethod::agglomerate_(const vector<size_t>& pair, int idParent, vector<double>& newDist)
+{
+  vector<double> distances = computeBranchLengthsForPair(pair);
+  Node* best1 = currentNodes_[pair[0]];
+  Node* best2 = currentNodes_[pair[1]];
+  // Distances may be used by getParentNodes (PGMA for instance).
+  best1->setDistanceToFather(distances[0]);
+  best2->setDistanceToFather(distances[1]);
+  Node* parent = getParentNode(idParent, best1, best2);
+  for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  {
+    size_t id = i->first;
+    if (id != pair[0] && id != pair[1])
+    {
+      assert (id < newDist.size()); //DEBUG
+      newDist[id] = computeDistancesFromPair(pair, distances, id);
+    }
+    else
+    {
+      newDist[id] = 0;
+    }
+  }
+  // Actualize currentNodes_:
+  currentNodes_[pair[0]] = parent;
+  currentNodes_.erase(pair[1]);
+  for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  {
+    size_t id = i->first;
+    matrix_(pair[0], id) = matrix_(id, pair[0]) = newDist[id];
+  }  
+}
+
 Node* AbstractAgglomerativeDistanceMethod::getLeafNode(int id, const std::string& name)
 {
   return new Node(id, name);
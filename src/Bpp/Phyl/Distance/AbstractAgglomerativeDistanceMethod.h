@@ -51,6 +51,8 @@ knowledge of the CeCILL license and that you accept its terms.
 namespace bpp
 {
 
+class MappedDistanceMatrix;
+
 /**
  * @brief Partial implementation of the AgglomerativeDistanceMethod interface.
  *
@@ -113,6 +115,20 @@ class AbstractAgglomerativeDistanceMethod:
 	public:
 		virtual void setDistanceMatrix(const DistanceMatrix& matrix) throw (Exception);
 
+    /**
+     * @brief Set the distance matrix from a file in binary format.
+     *
+     * The distances are copied: agglomeration overwrites the distances of the working matrix,
+     * so that it must be held in memory, and the mapped file is never modified.
+     * The working matrix is filled from the file in a single sequential pass,
+     * without building an intermediate DistanceMatrix object, so that only one dense matrix is allocated.
+     * setDistanceMatrix() is then called on it, so that derived classes are initialized as usual.
+     *
+     * @param matrix The mapped distance matrix.
+     * @throw Exception If the matrix is too small.
+     */
+    void setMappedDistanceMatrix(const MappedDistanceMatrix& matrix) throw (Exception);
+
     /**
      * @brief Get the computed tree, if there is one.
      *
@@ -145,6 +161,24 @@ class AbstractAgglomerativeDistanceMethod:
     bool isVerbose() const { return verbose_; }
 
 	protected:
+    /**
+     * @brief Compute the tree using the nearest-neighbor chain algorithm.
+     *
+     * Instead of looking for the closest pair of nodes at each step, a chain of nearest neighbors is grown
+     * until two nodes are reciprocal nearest neighbors, which are then agglomerated.
+     * The next nearest neighbor search starts from the remaining chain.
+     * This needs @f$O(n^2)@f$ operations in total, and @f$O(n)@f$ additional memory.
+     *
+     * This algorithm can only be used for methods agglomerating the closest pair of nodes (the getBestPair() method is not used),
+     * with a reducible linkage, that is, when the distance of an agglomerated node to any other node
+     * is never smaller than the minimum of the distances of the two agglomerated nodes.
+     * The hierarchy is then the same as the one obtained with computeTree() (up to ties),
+     * but agglomerations may be performed in a different order, so that only rooted trees can be built in this way.
+     *
+     * @throw Exception If the tree is not rooted, or if no nearest neighbor can be found.
+     */
+    void computeTreeFromNearestNeighborChain() throw (Exception);
+
     /**
      * @name Specific methods.
      *
@@ -217,6 +251,16 @@ class AbstractAgglomerativeDistanceMethod:
      */
 		virtual Node* getParentNode(int id, Node * son1, Node * son2);
     /** @} */
+
+  private:
+    /**
+     * @brief Agglomerate a pair of nodes, and actualize the distance matrix and currentNodes_.
+     *
+     * @param pair The indices of the nodes to be agglomerated.
+     * @param idParent The id of the new node.
+     * @param newDist A working vector, with a size equal to the one of the distance matrix.
+     */
+    void agglomerate_(const std::vector<size_t>& pair, int idParent, std::vector<double>& newDist);
 		
 };
 
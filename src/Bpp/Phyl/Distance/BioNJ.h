@@ -103,8 +103,13 @@ public:
     NeighborJoining::setDistanceMatrix(matrix);
     variance_ = matrix;
   }
-  void computeTree() throw (Exception);
   double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos);
+
+protected:
+  /**
+   * @brief Compute the lambda parameter, and update the distance and variance matrices.
+   */
+  void updateDistances(const std::vector<size_t>& pair, const std::vector<double>& branchLengths);
 };
 } // end of namespace bpp.
 
@@ -41,7 +41,7 @@
 #include "DistanceEstimation.h"
 #include "../Tree.h"
 #include "../PatternTools.h"
-#include "../SitePatterns.h"
+#include "../ParallelTools.h"
 
 // From bpp-core:
 #include <Bpp/App/ApplicationTools.h>
@@ -50,7 +50,6 @@
 // From bpp-seq:
 #include <Bpp/Seq/SiteTools.h>
 #include <Bpp/Seq/Sequence.h>
-#include <Bpp/Seq/Container/AlignedSequenceContainer.h>
 #include <Bpp/Seq/DistanceMatrix.h>
 
 using namespace bpp;
@@ -60,6 +59,9 @@ using namespace bpp;
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
 
 using namespace std;
 
@@ -72,8 +74,8 @@ TwoTreeLikelihood::TwoTreeLikelihood(
     DiscreteDistribution* rDist,
     bool verbose) throw (Exception) :
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(rDist, verbose),
-  shrunkData_(0), seqnames_(2), model_(model), brLenParameters_(), pxy_(), dpxy_(), d2pxy_(),
-  rootPatternLinks_(), rootWeights_(), nbSites_(0), nbClasses_(0), nbStates_(0), nbDistinctSites_(0),
+  seqnames_(2), model_(model), brLenParameters_(), pxy_(), dpxy_(), d2pxy_(),
+  rootPatternLinks_(), rootWeights_(), pureStates1_(), pureStates2_(), nbSites_(0), nbClasses_(0), nbStates_(0), nbDistinctSites_(0),
   rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(), dLikelihoods_(), d2Likelihoods_(),
   leafLikelihoods1_(), leafLikelihoods2_(),
   minimumBrLen_(0.000001), brLenConstraint_(0), brLen_(0)
@@ -93,21 +95,35 @@ TwoTreeLikelihood::TwoTreeLikelihood(
   if (verbose)
     ApplicationTools::displayMessage("Double-Recursive Homogeneous Tree Likelihood");
 
-  // Initialize root patterns:
-  SitePatterns pattern(data_);
-  shrunkData_       = pattern.getSites();
-  rootWeights_      = pattern.getWeights();
-  rootPatternLinks_ = pattern.getIndices();
-  nbDistinctSites_  = shrunkData_->getNumberOfSites();
+  // Initialize root patterns.
+  // With only two sequences, a site pattern is a pair of states,
+  // so that the counts can be computed directly in one pass:
+  const Sequence& seq1 = data_->getSequence(seqnames_[0]);
+  const Sequence& seq2 = data_->getSequence(seqnames_[1]);
+  vector<int> states1, states2;
+  map<pair<int, int>, size_t> patterns;
+  rootPatternLinks_.resize(nbSites_);
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    pair<int, int> pxy(seq1.getValue(i), seq2.getValue(i));
+    map<pair<int, int>, size_t>::iterator it = patterns.find(pxy);
+    if (it == patterns.end())
+    {
+      it = patterns.insert(make_pair(pxy, states1.size())).first;
+      states1.push_back(pxy.first);
+      states2.push_back(pxy.second);
+      rootWeights_.push_back(0);
+    }
+    rootPatternLinks_[i] = it->second;
+    rootWeights_[it->second]++;
+  }
+  nbDistinctSites_ = states1.size();
   if (verbose)
     ApplicationTools::displayResult("Number of distinct sites", TextTools::toString(nbDistinctSites_));
 
   // Init _likelihoods:
   if (verbose) ApplicationTools::displayTask("Init likelihoods arrays recursively");
-  // Clone data for more efficiency on sequences access:
-  const SiteContainer* sequences = new AlignedSequenceContainer(*shrunkData_);
-  initTreeLikelihoods(*sequences);
-  delete sequences;
+  initTreeLikelihoods(states1, states2);
 
   brLen_ = minimumBrLen_;
   brLenConstraint_ = new IntervalConstraint(1, minimumBrLen_, true);
@@ -119,7 +135,6 @@ TwoTreeLikelihood::TwoTreeLikelihood(
 
 TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(lik),
-  shrunkData_        (dynamic_cast<SiteContainer*>(lik.shrunkData_->clone())),
   seqnames_          (lik.seqnames_),
   model_             (lik.model_),
   brLenParameters_   (lik.brLenParameters_),
@@ -128,6 +143,8 @@ TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
   d2pxy_             (lik.d2pxy_),
   rootPatternLinks_  (lik.rootPatternLinks_),
   rootWeights_       (lik.rootWeights_),
+  pureStates1_       (lik.pureStates1_),
+  pureStates2_       (lik.pureStates2_),
   nbSites_           (lik.nbSites_),
   nbClasses_         (lik.nbClasses_),
   nbStates_          (lik.nbStates_),
@@ -149,7 +166,6 @@ TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
 TwoTreeLikelihood& TwoTreeLikelihood::operator=(const TwoTreeLikelihood& lik)
 {
   AbstractDiscreteRatesAcrossSitesTreeLikelihood::operator=(lik);
-  shrunkData_        = dynamic_cast<SiteContainer*>(lik.shrunkData_->clone());
   seqnames_          = lik.seqnames_;
   model_             = lik.model_;
   brLenParameters_   = lik.brLenParameters_;
@@ -158,6 +174,8 @@ TwoTreeLikelihood& TwoTreeLikelihood::operator=(const TwoTreeLikelihood& lik)
   d2pxy_             = lik.d2pxy_;
   rootPatternLinks_  = lik.rootPatternLinks_;
   rootWeights_       = lik.rootWeights_;
+  pureStates1_       = lik.pureStates1_;
+  pureStates2_       = lik.pureStates2_;
   nbSites_           = lik.nbSites_;
   nbClasses_         = lik.nbClasses_;
   nbStates_          = lik.nbStates_;
@@ -179,7 +197,6 @@ TwoTreeLikelihood& TwoTreeLikelihood::operator=(const TwoTreeLikelihood& lik)
 
 TwoTreeLikelihood::~TwoTreeLikelihood()
 {
-  delete shrunkData_;
   if (brLenConstraint_) delete brLenConstraint_;
 }
 
@@ -416,34 +433,42 @@ throw (Exception)
 
 /******************************************************************************/
 
-void TwoTreeLikelihood::initTreeLikelihoods(const SequenceContainer& sequences) throw (Exception)
+void TwoTreeLikelihood::initTreeLikelihoods(const std::vector<int>& states1, const std::vector<int>& states2) throw (Exception)
 {
-  const Sequence* seq1 = &sequences.getSequence(seqnames_[0]);
-  const Sequence* seq2 = &sequences.getSequence(seqnames_[1]);
   leafLikelihoods1_.resize(nbDistinctSites_);
   leafLikelihoods2_.resize(nbDistinctSites_);
+  pureStates1_.resize(nbDistinctSites_);
+  pureStates2_.resize(nbDistinctSites_);
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-   Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
-   Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
-   leafLikelihoods1_i->resize(nbStates_);
-   leafLikelihoods2_i->resize(nbStates_);
-   int state1 = seq1->getValue(i);
-   int state2 = seq2->getValue(i);
+    Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
+    Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
+    leafLikelihoods1_i->resize(nbStates_);
+    leafLikelihoods2_i->resize(nbStates_);
+    size_t nbNonNull1 = 0, nbNonNull2 = 0;
     for (size_t s = 0; s < nbStates_; s++)
     {
       // Leaves likelihood are set to 1 if the char correspond to the site in the sequence,
       // otherwise value set to 0:
-      try
+      (*leafLikelihoods1_i)[s] = model_->getInitValue(s, states1[i]);
+      (*leafLikelihoods2_i)[s] = model_->getInitValue(s, states2[i]);
+      if ((*leafLikelihoods1_i)[s] != 0)
       {
-        (*leafLikelihoods1_i)[s] = model_->getInitValue(s, state1);
-        (*leafLikelihoods2_i)[s] = model_->getInitValue(s, state2);
+        nbNonNull1++;
+        pureStates1_[i] = static_cast<int>(s);
       }
-      catch (SequenceNotFoundException& snfe)
+      if ((*leafLikelihoods2_i)[s] != 0)
       {
-        throw SequenceNotFoundException("TwoTreeLikelihood::initTreelikelihoods. Leaf name in tree not found in site conainer: ", snfe.getSequenceId());
+        nbNonNull2++;
+        pureStates2_[i] = static_cast<int>(s);
       }
     }
+    // Ambiguous patterns are computed the general way:
+    if (nbNonNull1 != 1 || nbNonNull2 != 1)
+    {
+      pureStates1_[i] = -1;
+      pureStates2_[i] = -1;
+    }
   }
 
   // Initialize likelihood vector:
@@ -462,7 +487,9 @@ void TwoTreeLikelihood::initTreeLikelihoods(const SequenceContainer& sequences)
       rootLikelihoods_i_c->resize(nbStates_);
       for (size_t s = 0; s < nbStates_; s++)
       {
-        (*rootLikelihoods_i_c)[s] = 1.; // All likelihoods are initialized to 1.
+        // All likelihoods are initialized to 1,
+        // but for unambiguous patterns, for which only one state will ever be non-null:
+        (*rootLikelihoods_i_c)[s] = (pureStates1_[i] >= 0 ? 0. : 1.);
       }
     }
   }
@@ -476,17 +503,42 @@ void TwoTreeLikelihood::initTreeLikelihoods(const SequenceContainer& sequences)
 
 void TwoTreeLikelihood::computeTreeLikelihood()
 {
+  const Vdouble& fr = model_->getFrequencies();
+  Vdouble p = rateDistribution_->getProbabilities();
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
+    // For each site in the sequence,
     VVdouble* rootLikelihoods_i = &rootLikelihoods_[i];
+    Vdouble* rootLikelihoodsS_i = &rootLikelihoodsS_[i];
+    rootLikelihoodsSR_[i] = 0;
+    if (pureStates1_[i] >= 0)
+    {
+      // The pattern is a pair of states (x, y),
+      // and its likelihood only depends on the corresponding transition probabilities:
+      size_t x = static_cast<size_t>(pureStates1_[i]);
+      size_t y = static_cast<size_t>(pureStates2_[i]);
+      double l12 = leafLikelihoods1_[i][x] * leafLikelihoods2_[i][y];
+      for (size_t c = 0; c < nbClasses_; c++)
+      {
+        double l = l12 * pxy_[c][x][y];
+        (*rootLikelihoods_i)[c][x] = l;
+        (*rootLikelihoodsS_i)[c] = fr[x] * l;
+        rootLikelihoodsSR_[i] += p[c] * (*rootLikelihoodsS_i)[c];
+      }
+      continue;
+    }
+
     Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
     Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
     for (size_t c = 0; c < nbClasses_; c++)
     {
+      // For each rate classe,
       Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
       VVdouble* pxy_c = &pxy_[c];
+      (*rootLikelihoodsS_i)[c] = 0;
       for (size_t x = 0; x < nbStates_; x++)
       {
+        // For each initial state,
         Vdouble* pxy_c_x = &(*pxy_c)[x];
         double l = 0;
         double l1 = (*leafLikelihoods1_i)[x];
@@ -496,27 +548,7 @@ void TwoTreeLikelihood::computeTreeLikelihood()
           l += l1 * l2 * (*pxy_c_x)[y];
         }
         (*rootLikelihoods_i_c)[x] = l;
-      }
-    }
-  }
-
-  Vdouble fr = model_->getFrequencies();
-  Vdouble p = rateDistribution_->getProbabilities();
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    // For each site in the sequence,
-    VVdouble* rootLikelihoods_i = &rootLikelihoods_[i];
-    Vdouble* rootLikelihoodsS_i = &rootLikelihoodsS_[i];
-    rootLikelihoodsSR_[i] = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      (*rootLikelihoodsS_i)[c] = 0;
-      // For each rate classe,
-      Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        // For each initial state,
-        (*rootLikelihoodsS_i)[c] += fr[x] * (*rootLikelihoods_i_c)[x];
+        (*rootLikelihoodsS_i)[c] += fr[x] * l;
       }
       rootLikelihoodsSR_[i] += p[c] * (*rootLikelihoodsS_i)[c];
     }
@@ -527,61 +559,59 @@ void TwoTreeLikelihood::computeTreeLikelihood()
 
 void TwoTreeLikelihood::computeTreeDLikelihood()
 {
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
-    Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
-    double dli = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      VVdouble* dpxy_c = &dpxy_[c];
-      double dlic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        Vdouble* dpxy_c_x = &(*dpxy_c)[x];
-        double l1 = (*leafLikelihoods1_i)[x];
-        double dlicx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
-        {
-          double l2 = (*leafLikelihoods2_i)[y];
-          dlicx += l1 * l2 * (*dpxy_c_x)[y];
-        }
-        dlic += dlicx * model_->freq(x);
-      }
-      dli += dlic * rateDistribution_->getProbability(c);
-    }
-    dLikelihoods_[i] = dli / rootLikelihoodsSR_[i];
-  }
+  computeDerivativeFromArrays_(dpxy_, dLikelihoods_);
 }
 
 /******************************************************************************/
 
 void TwoTreeLikelihood::computeTreeD2Likelihood()
 {
+  computeDerivativeFromArrays_(d2pxy_, d2Likelihoods_);
+}
+
+/******************************************************************************/
+
+void TwoTreeLikelihood::computeDerivativeFromArrays_(const VVVdouble& dnpxy, Vdouble& dnLikelihoods) const
+{
+  const Vdouble& fr = model_->getFrequencies();
+  Vdouble p = rateDistribution_->getProbabilities();
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
-    Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
-    double d2li = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    double dli = 0;
+    if (pureStates1_[i] >= 0)
     {
-      VVdouble* d2pxy_c = &d2pxy_[c];
-      double d2lic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+      size_t x = static_cast<size_t>(pureStates1_[i]);
+      size_t y = static_cast<size_t>(pureStates2_[i]);
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* d2pxy_c_x = &(*d2pxy_c)[x];
-        double l1 = (*leafLikelihoods1_i)[x];
-        double d2licx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        dli += p[c] * dnpxy[c][x][y];
+      }
+      dli *= fr[x] * leafLikelihoods1_[i][x] * leafLikelihoods2_[i][y];
+    }
+    else
+    {
+      const Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
+      const Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
+      for (size_t c = 0; c < nbClasses_; c++)
+      {
+        const VVdouble* dnpxy_c = &dnpxy[c];
+        double dlic = 0;
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          double l2 = (*leafLikelihoods2_i)[y];
-          d2licx += l1 * l2 * (*d2pxy_c_x)[y];
+          const Vdouble* dnpxy_c_x = &(*dnpxy_c)[x];
+          double l1 = (*leafLikelihoods1_i)[x];
+          double dlicx = 0;
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            double l2 = (*leafLikelihoods2_i)[y];
+            dlicx += l1 * l2 * (*dnpxy_c_x)[y];
+          }
+          dlic += dlicx * fr[x];
         }
-        d2lic += d2licx * model_->freq(x);
+        dli += dlic * p[c];
       }
-      d2li += d2lic * rateDistribution_->getProbability(c);
     }
-    d2Likelihoods_[i] = d2li / rootLikelihoodsSR_[i];
+    dnLikelihoods[i] = dli / rootLikelihoodsSR_[i];
   }
 }
 
@@ -653,42 +683,89 @@ void DistanceEstimation::computeMatrix() throw (NullPointerException)
 {
   size_t n = sites_->getNumberOfSequences();
   vector<string> names = sites_->getSequencesNames();
-  if (dist_ != 0) delete dist_;
+  // Keep the previous matrix as a starting point if requested:
+  unique_ptr<DistanceMatrix> previous(dist_);
+  bool samePairs = previous.get() && previous->size() == n;
+  for (size_t i = 0; samePairs && i < n; ++i)
+  {
+    samePairs = (previous->getName(i) == names[i]);
+  }
+  if (!warmStart_ || !samePairs)
+    previous.reset();
   dist_ = new DistanceMatrix(names);
   optimizer_->setVerbose(static_cast<unsigned int>(max(static_cast<int>(verbose_) - 2, 0)));
   for (size_t i = 0; i < n; ++i)
   {
     (*dist_)(i, i) = 0;
-    if (verbose_ == 1)
+  }
+
+  size_t nbWorkers = ParallelTools::getNumberOfWorkers(n, nbThreads_);
+
+  // Rows are distributed dynamically, first rows being the longest ones.
+  // Each worker uses its own copies of the optimizer, model and rate distribution:
+  vector< unique_ptr<Optimizer> > optimizers(nbWorkers);
+  vector< unique_ptr<TransitionModel> > models(nbWorkers);
+  vector< unique_ptr<DiscreteDistribution> > rateDists(nbWorkers);
+  size_t nbRowsDone = 0;
+  mutex displayMutex;
+  ParallelTools::parallelFor(n, nbThreads_, [&](size_t i, size_t t)
+  {
+    if (!optimizers[t])
     {
-      ApplicationTools::displayGauge(i, n - 1, '=');
+      optimizers[t].reset(dynamic_cast<Optimizer*>(optimizer_->clone()));
+      models[t].reset(model_->clone());
+      rateDists[t].reset(rateDist_->clone());
     }
     for (size_t j = i + 1; j < n; j++)
     {
-      if (verbose_ > 1)
+      if (verbose_ > 1 && nbWorkers == 1)
       {
         ApplicationTools::displayGauge(j - i - 1, n - i - 2, '=');
       }
-      TwoTreeLikelihood* lik =
-        new TwoTreeLikelihood(names[i], names[j], *sites_, model_.get(), rateDist_.get(), verbose_ > 3);
-      lik->initialize();
-      lik->enableDerivatives(true);
-      size_t d = SymbolListTools::getNumberOfDistinctPositions(sites_->getSequence(i), sites_->getSequence(j));
-      size_t g = SymbolListTools::getNumberOfPositionsWithoutGap(sites_->getSequence(i), sites_->getSequence(j));
-      lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
-      // Optimization:
-      optimizer_->setFunction(lik);
-      optimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
-      ParameterList params = lik->getBranchLengthsParameters();
-      params.addParameters(parameters_);
-      optimizer_->init(params);
-      optimizer_->optimize();
-      // Store results:
-      (*dist_)(i, j) = (*dist_)(j, i) = lik->getParameterValue("BrLen");
-      delete lik;
+      double start = (previous.get() ? (*previous)(i, j) : -1.);
+      (*dist_)(i, j) = (*dist_)(j, i) = computeDistance_(i, j, names, start, *optimizers[t], *models[t], *rateDists[t]);
     }
-    if (verbose_ > 1 && ApplicationTools::message) ApplicationTools::message->endLine();
+    // With several threads, the gauge of rows is also displayed instead of the gauge of columns:
+    if (verbose_ == 1 || (verbose_ > 1 && nbWorkers > 1))
+    {
+      lock_guard<mutex> lock(displayMutex);
+      ApplicationTools::displayGauge(nbRowsDone++, n - 1, '=');
+    }
+    if (verbose_ > 1 && nbWorkers == 1 && ApplicationTools::message) ApplicationTools::message->endLine();
+  });
+}
+
+/******************************************************************************/
+
+double DistanceEstimation::computeDistance_(
+  size_t i, size_t j,
+  const vector<string>& names,
+  double start,
+  Optimizer& optimizer,
+  TransitionModel& model,
+  DiscreteDistribution& rateDist) const
+{
+  // Start from the same values for each pair:
+  model.matchParametersValues(model_->getParameters());
+  rateDist.matchParametersValues(rateDist_->getParameters());
+  TwoTreeLikelihood lik(names[i], names[j], *sites_, &model, &rateDist, verbose_ > 3);
+  lik.initialize();
+  lik.enableDerivatives(true);
+  if (start < 0)
+  {
+    size_t d = SymbolListTools::getNumberOfDistinctPositions(sites_->getSequence(i), sites_->getSequence(j));
+    size_t g = SymbolListTools::getNumberOfPositionsWithoutGap(sites_->getSequence(i), sites_->getSequence(j));
+    start = (g == 0 ? 0. : static_cast<double>(d) / static_cast<double>(g));
   }
+  lik.setParameterValue("BrLen", std::max(lik.getMinimumBranchLength(), start));
+  // Optimization:
+  optimizer.setFunction(&lik);
+  optimizer.setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
+  ParameterList params = lik.getBranchLengthsParameters();
+  params.addParameters(parameters_);
+  optimizer.init(params);
+  optimizer.optimize();
+  return lik.getParameterValue("BrLen");
 }
 
 /******************************************************************************/
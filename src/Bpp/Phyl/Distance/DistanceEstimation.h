@@ -64,12 +64,18 @@ namespace bpp
 
 /**
  * @brief This class is a simplified version of DRHomogeneousTreeLikelihood for 2-Trees.
+ *
+ * With two sequences, a site pattern is a pair of states: the alignment is summarized once
+ * as a table of pair counts when the object is built, so that the cost of each likelihood
+ * evaluation does not depend on the length of the alignment.
+ * The likelihood of a pair of unambiguous states @f$(x, y)@f$ is computed directly as
+ * @f$\sum_c p_c \pi_x P_c(x, y)@f$, while pairs involving gaps or ambiguous characters
+ * are computed by summing over all compatible states.
  */
 class TwoTreeLikelihood:
   public AbstractDiscreteRatesAcrossSitesTreeLikelihood  
 {
   private:
-    SiteContainer* shrunkData_;
     std::vector<std::string> seqnames_;
     TransitionModel* model_;
     ParameterList brLenParameters_;
@@ -98,6 +104,11 @@ class TwoTreeLikelihood:
      */
     std::vector<unsigned int> rootWeights_;
 
+    /**
+     * @brief The model state of each sequence for each distinct site, or -1 if the pattern is ambiguous.
+     */
+    std::vector<int> pureStates1_, pureStates2_;
+
     //some values we'll need:
     size_t nbSites_,         //the number of sites in the container
            nbClasses_,       //the number of rate classes
@@ -259,20 +270,20 @@ class TwoTreeLikelihood:
   protected:
     
     /**
-     * @brief This method initializes the leaves according to a sequence container.
+     * @brief This method initializes the leaves according to the distinct site patterns.
      *
-     * Here the container shrunkData_ is used.
      * Likelihood is set to 1 for the state corresponding to the sequence site,
      * otherwise it is set to 0.
+     * Patterns where both leaves have a single possible state are flagged
+     * in order to be computed directly from the transition probabilities.
      *
      * The two likelihood arrays are initialized according to alphabet
-     * size and sequences length, and filled with 1.
-     *
-     * NB: This method is recursive.
+     * size and number of distinct patterns.
      *
-     * @param sequences The sequence container to use.
+     * @param states1 The state of the first sequence for each distinct pattern.
+     * @param states2 The state of the second sequence for each distinct pattern.
      */
-    virtual void initTreeLikelihoods(const SequenceContainer & sequences) throw (Exception);
+    virtual void initTreeLikelihoods(const std::vector<int>& states1, const std::vector<int>& states2) throw (Exception);
 
     void fireParameterChanged(const ParameterList & params);
     virtual void computeTreeLikelihood();
@@ -292,6 +303,15 @@ class TwoTreeLikelihood:
      */
     virtual void applyParameters() throw (Exception);  
 
+  private:
+    /**
+     * @brief Compute the derivative of the likelihood of each distinct site divided by its likelihood.
+     *
+     * @param dnpxy         The derivatives of the transition probabilities, for each rate class.
+     * @param dnLikelihoods [out] The resulting values for each distinct site.
+     */
+    void computeDerivativeFromArrays_(const VVVdouble& dnpxy, Vdouble& dnLikelihoods) const;
+
 };
 
 /**
@@ -305,6 +325,18 @@ class TwoTreeLikelihood:
  * For now it is not possible to retrieve estimated values.
  * You'll have to specify a 'profiler' to the optimizer and then look at the file
  * if you want to do so.
+ *
+ * Pairs can be computed in parallel (see setNumberOfThreads()).
+ * Each thread works with its own clones of the optimizer, substitution model and rate distribution,
+ * and rows of the matrix are distributed dynamically among threads.
+ * Each pair starts from the parameter values of the model and rate distribution of this instance,
+ * so that the results do not depend on the order of computation nor on the number of threads.
+ * When additional parameters are estimated, each pair is therefore optimized from their initial values,
+ * and not from the values estimated for the previous pair.
+ * With several threads, only the progress of rows is displayed, whatever the verbose level.
+ *
+ * When the matrix is computed several times, for instance after updating the model parameters,
+ * the previous matrix can be used as a starting point for the branch length of each pair (see setWarmStart()).
  */
 class DistanceEstimation:
   public virtual Clonable
@@ -318,6 +350,8 @@ class DistanceEstimation:
     MetaOptimizer* defaultOptimizer_;
     size_t verbose_;
     ParameterList parameters_;
+    unsigned int nbThreads_;
+    bool warmStart_;
 
   public:
   
@@ -346,7 +380,9 @@ class DistanceEstimation:
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1),
+      warmStart_(false)
     {
       init_();
     }
@@ -381,7 +417,9 @@ class DistanceEstimation:
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1),
+      warmStart_(false)
     {
       init_();
       if(computeMat) computeMatrix();
@@ -402,7 +440,9 @@ class DistanceEstimation:
       optimizer_(dynamic_cast<Optimizer *>(distanceEstimation.optimizer_->clone())),
       defaultOptimizer_(dynamic_cast<MetaOptimizer *>(distanceEstimation.defaultOptimizer_->clone())),
       verbose_(distanceEstimation.verbose_),
-      parameters_(distanceEstimation.parameters_)
+      parameters_(distanceEstimation.parameters_),
+      nbThreads_(distanceEstimation.nbThreads_),
+      warmStart_(distanceEstimation.warmStart_)
     {
       if(distanceEstimation.dist_ != 0)
         dist_ = new DistanceMatrix(*distanceEstimation.dist_);
@@ -431,6 +471,8 @@ class DistanceEstimation:
       // _defaultOptimizer has already been initialized since the default constructor has been called.
       verbose_    = distanceEstimation.verbose_;
       parameters_ = distanceEstimation.parameters_;
+      nbThreads_  = distanceEstimation.nbThreads_;
+      warmStart_  = distanceEstimation.warmStart_;
       return *this;
     }
 
@@ -471,6 +513,28 @@ class DistanceEstimation:
      * rate distribution or data are not initialized.
      */
     void computeMatrix() throw (NullPointerException);
+
+  private:
+    /**
+     * @brief Estimate the distance between two sequences.
+     *
+     * @param i, j      The indices of the two sequences.
+     * @param names     The names of all sequences.
+     * @param start     The initial distance, or a negative value to start from the proportion of differences.
+     * @param optimizer The optimizer to use.
+     * @param model     The substitution model to use, reset to the parameter values of this instance.
+     * @param rateDist  The rate distribution to use, reset to the parameter values of this instance.
+     * @return The estimated distance.
+     */
+    double computeDistance_(
+        size_t i, size_t j,
+        const std::vector<std::string>& names,
+        double start,
+        Optimizer& optimizer,
+        TransitionModel& model,
+        DiscreteDistribution& rateDist) const;
+
+  public:
     
     /**
      * @brief Get the distance matrix.
@@ -501,6 +565,19 @@ class DistanceEstimation:
 
     void resetRateDistribution(DiscreteDistribution* rateDist = 0) { rateDist_.reset(rateDist); }
 
+    /**
+     * @brief Update the parameter values of the substitution model and rate distribution.
+     *
+     * Parameters which are not found in the model or rate distribution are ignored.
+     *
+     * @param parameters The new parameter values, for instance estimated on a tree.
+     */
+    void matchParametersValues(const ParameterList& parameters)
+    {
+      if (hasModel()) model_->matchParametersValues(parameters);
+      if (hasRateDistribution()) rateDist_->matchParametersValues(parameters);
+    }
+
     void setData(const SiteContainer* sites) { sites_ = sites; }
     const SiteContainer* getData() const { return sites_; }
     void resetData() { sites_ = 0; }
@@ -542,6 +619,27 @@ class DistanceEstimation:
      * @return Verbose level.
      */
     size_t getVerbose() const { return verbose_; }
+
+    /**
+     * @param nbThreads The number of threads to use when computing the matrix (0 to use the number of available cores).
+     * The optimizer is cloned for each thread: user-defined message handlers and profilers must support concurrent output.
+     */
+    void setNumberOfThreads(unsigned int nbThreads) { nbThreads_ = nbThreads; }
+    /**
+     * @return The number of threads to use when computing the matrix.
+     */
+    unsigned int getNumberOfThreads() const { return nbThreads_; }
+
+    /**
+     * @param yn If true, the optimization of each distance starts from the value in the previously computed matrix,
+     * if any, instead of the proportion of differences between the two sequences.
+     * This speeds up computations when the matrix is estimated again with slightly different parameters.
+     */
+    void setWarmStart(bool yn) { warmStart_ = yn; }
+    /**
+     * @return True if distances are optimized starting from the previous matrix.
+     */
+    bool isWarmStart() const { return warmStart_; }
 };
 
 } //end of namespace bpp.
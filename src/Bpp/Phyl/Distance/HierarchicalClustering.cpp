@@ -57,6 +57,14 @@ TreeTemplate<Node>* HierarchicalClustering::getTree() const
   return new TreeTemplate<Node>(root);
 }
 
+void HierarchicalClustering::computeTree() throw (Exception)
+{
+  if (method_ == MEDIAN || method_ == CENTROID)
+    AbstractAgglomerativeDistanceMethod::computeTree();
+  else
+    computeTreeFromNearestNeighborChain();
+}
+
 vector<size_t> HierarchicalClustering::getBestPair() throw (Exception)
 {
   vector<size_t> bestPair(2);
@@ -60,6 +60,10 @@ public:
  * @brief Hierarchical clustering.
  *
  * This class implements the complete, single, average (= UPGMA), median, ward and centroid linkage methods.
+ *
+ * The complete, single, average and ward linkages are reducible, and trees are built with the
+ * nearest-neighbor chain algorithm, in @f$O(n^2)@f$ (see AbstractAgglomerativeDistanceMethod::computeTreeFromNearestNeighborChain()).
+ * The median and centroid linkages use the generic algorithm, in @f$O(n^3)@f$.
  */
 class HierarchicalClustering :
   public AbstractAgglomerativeDistanceMethod
@@ -83,7 +87,7 @@ public:
    * @param verbose Tell if some progress information should be displayed.
    */
   HierarchicalClustering(const std::string& method, bool verbose = false) :
-    AbstractAgglomerativeDistanceMethod(verbose),
+    AbstractAgglomerativeDistanceMethod(verbose, true),
     method_(method) {}
   HierarchicalClustering(const std::string& method, const DistanceMatrix& matrix, bool verbose = false) throw (Exception) :
     AbstractAgglomerativeDistanceMethod(matrix, verbose, true),
@@ -101,6 +105,8 @@ public:
 
   TreeTemplate<Node>* getTree() const;
 
+  void computeTree() throw (Exception);
+
 protected:
   std::vector<size_t> getBestPair() throw (Exception);
   std::vector<double> computeBranchLengthsForPair(const std::vector<size_t>& pair);
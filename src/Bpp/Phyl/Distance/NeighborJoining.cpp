@@ -41,92 +41,117 @@
 #include "NeighborJoining.h"
 #include "../Tree.h"
 
+#include <Bpp/App/ApplicationTools.h>
+
 using namespace bpp;
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
 using namespace std;
 
-std::vector<size_t> NeighborJoining::getBestPair() throw (Exception)
+void NeighborJoining::computeTree() throw (Exception)
 {
-  for (std::map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  // Initialization:
+  size_t n = matrix_.size();
+  activeNodes_.resize(n);
+  for (size_t i = 0; i < n; ++i)
   {
-    size_t id = i->first;
-    sumDist_[id] = 0;
-    for (map<size_t, Node*>::iterator j = currentNodes_.begin(); j != currentNodes_.end(); j++)
-    {
-      size_t jd = j->first;
-      sumDist_[id] += matrix_(id, jd);
-    }
+    activeNodes_[i] = getLeafNode(static_cast<int>(i), matrix_.getName(i));
   }
+  // The working matrix uses the distances of matrix_ in place:
+  workMatrix_ = NeighborJoiningMatrix(matrix_);
+  int idNextNode = static_cast<int>(n);
 
-  vector<size_t> bestPair(2);
-  double critMax = std::log(0.);
-  for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  // Build tree:
+  while (workMatrix_.size() > (rootTree_ ? 2 : 3))
   {
-    size_t id = i->first;
-    map<size_t, Node*>::iterator j = i;
-    j++;
-    for ( ; j != currentNodes_.end(); j++)
-    {
-      size_t jd = j->first;
-      double crit = sumDist_[id] + sumDist_[jd] - static_cast<double>(currentNodes_.size() - 2) * matrix_(id, jd);
-      // cout << "\t" << id << "\t" << jd << "\t" << crit << endl;
-      if (crit > critMax)
-      {
-        critMax = crit;
-        bestPair[0] = id;
-        bestPair[1] = jd;
-      }
-    }
+    if (verbose_)
+      ApplicationTools::displayGauge(n - workMatrix_.size(), n - (rootTree_ ? 2 : 3) - 1);
+    vector<size_t> bestPair = getBestPair();
+    vector<double> distances = computeBranchLengthsForPair(bestPair);
+    Node* best1 = activeNodes_[bestPair[0]];
+    Node* best2 = activeNodes_[bestPair[1]];
+    best1->setDistanceToFather(distances[0]);
+    best2->setDistanceToFather(distances[1]);
+    Node* parent = getParentNode(idNextNode++, best1, best2);
+    updateDistances(bestPair, distances);
+    // Actualize the current nodes:
+    activeNodes_[bestPair[0]] = parent;
+    activeNodes_[bestPair[1]] = 0;
   }
+  finalStep(idNextNode);
+  // Free memory:
+  workMatrix_ = NeighborJoiningMatrix();
+  vector<Node*>().swap(activeNodes_);
+}
 
-  if (critMax == std::log(0.))
+std::vector<size_t> NeighborJoining::getBestPair() throw (Exception)
+{
+  vector<size_t> bestPair = workMatrix_.getBestPair();
+  for (size_t k = 0; k < workMatrix_.size(); k++)
   {
-    throw Exception("Unexpected error: no maximum criterium found.");
+    size_t id = workMatrix_.getId(k);
+    sumDist_[id] = workMatrix_.getSum(id);
   }
   return bestPair;
 }
 
+void NeighborJoining::updateDistances(const std::vector<size_t>& pair, const std::vector<double>& branchLengths)
+{
+  vector<double> newDist(matrix_.size(), 0.);
+  for (size_t k = 0; k < workMatrix_.size(); k++)
+  {
+    size_t id = workMatrix_.getId(k);
+    if (id != pair[0] && id != pair[1])
+      newDist[id] = computeDistancesFromPair(pair, branchLengths, id);
+  }
+  workMatrix_.agglomerate(pair, newDist);
+}
+
 std::vector<double> NeighborJoining::computeBranchLengthsForPair(const std::vector<size_t>& pair)
 {
-  double ratio = (sumDist_[pair[0]] - sumDist_[pair[1]]) / static_cast<double>(currentNodes_.size() - 2);
+  double ratio = (sumDist_[pair[0]] - sumDist_[pair[1]]) / static_cast<double>(workMatrix_.size() - 2);
+  double d01 = workMatrix_.getDistance(pair[0], pair[1]);
   vector<double> d(2);
   if (positiveLengths_)
   {
-    d[0] = std::max(.5 * (matrix_(pair[0], pair[1]) + ratio), 0.);
-    d[1] = std::max(.5 * (matrix_(pair[0], pair[1]) - ratio), 0.);
+    d[0] = std::max(.5 * (d01 + ratio), 0.);
+    d[1] = std::max(.5 * (d01 - ratio), 0.);
   }
   else
   {
-    d[0] = .5 * (matrix_(pair[0], pair[1]) + ratio);
-    d[1] = .5 * (matrix_(pair[0], pair[1]) - ratio);
+    d[0] = .5 * (d01 + ratio);
+    d[1] = .5 * (d01 - ratio);
   }
   return d;
 }
 
 double NeighborJoining::computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos)
 {
-  return
-    positiveLengths_ ?
-    std::max(.5 * (matrix_(pair[0], pos) - branchLengths[0] + matrix_(pair[1], pos) - branchLengths[1]), 0.)
-    :          .5 * (matrix_(pair[0], pos) - branchLengths[0] + matrix_(pair[1], pos) - branchLengths[1]);
+  double d = .5 * (workMatrix_.getDistance(pair[0], pos) - branchLengths[0] + workMatrix_.getDistance(pair[1], pos) - branchLengths[1]);
+  return positiveLengths_ ? std::max(d, 0.) : d;
 }
 
 void NeighborJoining::finalStep(int idRoot)
 {
   Node* root = new Node(idRoot);
-  map<size_t, Node* >::iterator it = currentNodes_.begin();
-  size_t i1 = it->first;
-  Node* n1       = it->second;
-  it++;
-  size_t i2 = it->first;
-  Node* n2       = it->second;
-  if (currentNodes_.size() == 2)
+  // Remaining nodes, in the order of their ids:
+  vector<size_t> ids(workMatrix_.size());
+  for (size_t k = 0; k < ids.size(); ++k)
+  {
+    ids[k] = workMatrix_.getId(k);
+  }
+  sort(ids.begin(), ids.end());
+  size_t i1 = ids[0];
+  Node* n1  = activeNodes_[i1];
+  size_t i2 = ids[1];
+  Node* n2  = activeNodes_[i2];
+  if (ids.size() == 2)
   {
     // Rooted
-    double d = matrix_(i1, i2) / 2;
+    double d = workMatrix_.getDistance(i1, i2) / 2;
     root->addSon(n1);
     root->addSon(n2);
     n1->setDistanceToFather(d);
@@ -135,18 +160,14 @@ void NeighborJoining::finalStep(int idRoot)
   else
   {
     // Unrooted
-    it++;
-    size_t i3 = it->first;
-    Node* n3       = it->second;
-    double d1 = positiveLengths_ ?
-                std::max(matrix_(i1, i2) + matrix_(i1, i3) - matrix_(i2, i3), 0.)
-                :          matrix_(i1, i2) + matrix_(i1, i3) - matrix_(i2, i3);
-    double d2 = positiveLengths_ ?
-                std::max(matrix_(i2, i1) + matrix_(i2, i3) - matrix_(i1, i3), 0.)
-                :          matrix_(i2, i1) + matrix_(i2, i3) - matrix_(i1, i3);
-    double d3 = positiveLengths_ ?
-                std::max(matrix_(i3, i1) + matrix_(i3, i2) - matrix_(i1, i2), 0.)
-                :          matrix_(i3, i1) + matrix_(i3, i2) - matrix_(i1, i2);
+    size_t i3 = ids[2];
+    Node* n3  = activeNodes_[i3];
+    double d12 = workMatrix_.getDistance(i1, i2);
+    double d13 = workMatrix_.getDistance(i1, i3);
+    double d23 = workMatrix_.getDistance(i2, i3);
+    double d1 = positiveLengths_ ? std::max(d12 + d13 - d23, 0.) : d12 + d13 - d23;
+    double d2 = positiveLengths_ ? std::max(d12 + d23 - d13, 0.) : d12 + d23 - d13;
+    double d3 = positiveLengths_ ? std::max(d13 + d23 - d12, 0.) : d13 + d23 - d12;
     root->addSon(n1);
     root->addSon(n2);
     root->addSon(n3);
@@ -156,4 +177,3 @@ void NeighborJoining::finalStep(int idRoot)
   }
   tree_ = new TreeTemplate<Node>(root);
 }
-
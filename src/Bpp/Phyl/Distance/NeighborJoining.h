@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _NEIGHBORJOINING_H_
 
 #include "AbstractAgglomerativeDistanceMethod.h"
+#include "NeighborJoiningMatrix.h"
 
 namespace bpp
 {
@@ -49,6 +50,10 @@ namespace bpp
 /**
  * @brief The neighbor joining distance method.
  *
+ * The search for the best pair and the update of row sums are performed on a
+ * NeighborJoiningMatrix object, which avoids a full scan of the matrix at each step
+ * in most cases. This object works in place on the distance matrix, which is overwritten by computeTree().
+ *
  * Reference:
  * N Saitou and M Nei (1987), _Molecular Biology and Evolution_ 4(4) 406-25.
  */ 
@@ -58,6 +63,13 @@ class NeighborJoining :
 	protected:
     std::vector<double> sumDist_;
     bool positiveLengths_;
+    NeighborJoiningMatrix workMatrix_;
+    /**
+     * @brief The current nodes, indexed by id, or null once agglomerated.
+     *
+     * The ids of the remaining nodes are given by the working matrix.
+     */
+    std::vector<Node*> activeNodes_;
 		
 	public:
     /**
@@ -70,7 +82,9 @@ class NeighborJoining :
     NeighborJoining(bool rooted = false, bool positiveLengths = false, bool verbose = true) :
       AbstractAgglomerativeDistanceMethod(verbose, rooted),
       sumDist_(),
-      positiveLengths_(false)
+      positiveLengths_(false),
+      workMatrix_(),
+      activeNodes_()
     {}
 
     /**
@@ -84,7 +98,9 @@ class NeighborJoining :
 		NeighborJoining(const DistanceMatrix& matrix, bool rooted = false, bool positiveLengths = false, bool verbose = true) throw (Exception) :
       AbstractAgglomerativeDistanceMethod(matrix, verbose, rooted),
       sumDist_(),
-      positiveLengths_(positiveLengths) 
+      positiveLengths_(positiveLengths),
+      workMatrix_(),
+      activeNodes_()
 		{
 			sumDist_.resize(matrix.size());
 			computeTree();
@@ -104,6 +120,14 @@ class NeighborJoining :
 		}
 
     virtual void outputPositiveLengths(bool yn) { positiveLengths_ = yn; }
+
+    /**
+     * @brief Compute the tree corresponding to the distance matrix.
+     *
+     * Same algorithm as AbstractAgglomerativeDistanceMethod::computeTree(),
+     * with distances being updated by the updateDistances() method.
+     */
+    virtual void computeTree() throw (Exception);
 	
 	protected:
 		std::vector<size_t> getBestPair() throw (Exception);
@@ -111,6 +135,18 @@ class NeighborJoining :
 		double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos);
 		void finalStep(int idRoot);	
 
+    /**
+     * @brief Actualizes the distance matrices after the agglomeration of a pair of nodes.
+     *
+     * The distances from the new node are computed using the computeDistancesFromPair() method.
+     * This method is called before the pair is replaced by the new node in activeNodes_,
+     * and the second node of the pair is removed from the working matrix.
+     *
+     * @param pair The indices of the nodes to be agglomerated.
+     * @param branchLengths The corresponding branch lengths.
+     */
+    virtual void updateDistances(const std::vector<size_t>& pair, const std::vector<double>& branchLengths);
+
 };
 
 } //end of namespace bpp.
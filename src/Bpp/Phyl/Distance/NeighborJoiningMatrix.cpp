@@ -0,0 +1,195 @@
+//
+// File: NeighborJoiningMatrix.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 16:05 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "NeighborJoiningMatrix.h"
+
+// From the STL:
+#include <algorithm>
+#include <limits>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+NeighborJoiningMatrix::NeighborJoiningMatrix(DistanceMatrix& matrix) :
+  size_(matrix.size()),
+  rows_(matrix.size()),
+  sums_(matrix.size()),
+  minDistances_(matrix.size()),
+  ids_(matrix.size()),
+  slots_(matrix.size()),
+  bounds_(matrix.size()),
+  order_(matrix.size()),
+  criteria_(matrix.size())
+{
+  for (size_t i = 0; i < size_; i++)
+  {
+    ids_[i] = i;
+    slots_[i] = i;
+    // Each row of the matrix is contiguous:
+    double* row = &matrix(i, 0);
+    rows_[i] = row;
+    double sum = 0.;
+    double minDist = numeric_limits<double>::infinity();
+    for (size_t j = 0; j < size_; j++)
+    {
+      if (i == j)
+        row[j] = numeric_limits<double>::infinity();
+      else
+        sum += row[j];
+      minDist = min(minDist, row[j]);
+    }
+    sums_[i] = sum;
+    minDistances_[i] = minDist;
+  }
+}
+
+/******************************************************************************/
+
+vector<size_t> NeighborJoiningMatrix::getBestPair() throw (Exception)
+{
+  if (size_ < 3)
+    throw Exception("NeighborJoiningMatrix::getBestPair. At least three nodes are required.");
+  double factor = static_cast<double>(size_ - 2);
+
+  // Upper bound of the criterion for each row:
+  double maxSum = *max_element(sums_.begin(), sums_.begin() + static_cast<ptrdiff_t>(size_));
+  for (size_t i = 0; i < size_; i++)
+  {
+    bounds_[i] = sums_[i] + maxSum - factor * minDistances_[i];
+    order_[i] = i;
+  }
+  const vector<double>& bounds = bounds_;
+  sort(order_.begin(), order_.begin() + static_cast<ptrdiff_t>(size_),
+       [&bounds](size_t a, size_t b) { return bounds[a] > bounds[b]; });
+
+  double critMax = -numeric_limits<double>::infinity();
+  vector<size_t> bestPair(2);
+  for (size_t k = 0; k < size_; k++)
+  {
+    size_t i = order_[k];
+    if (bounds_[i] < critMax)
+      break; // No better pair can be found in the remaining rows.
+
+    // Plain loops on contiguous arrays, which the compiler can vectorize:
+    const double* row = rows_[i];
+    double sumI = sums_[i];
+    double rowMax = -numeric_limits<double>::infinity();
+    double rowMin = numeric_limits<double>::infinity();
+    for (size_t j = 0; j < size_; j++)
+    {
+      double crit = (sumI + sums_[j]) - factor * row[j];
+      criteria_[j] = crit;
+      rowMax = (crit > rowMax ? crit : rowMax);
+      rowMin = (row[j] < rowMin ? row[j] : rowMin);
+    }
+    // Refresh the bound for the next steps:
+    minDistances_[i] = rowMin;
+
+    if (rowMax < critMax)
+      continue;
+    for (size_t j = 0; j < size_; j++)
+    {
+      if (criteria_[j] == rowMax)
+      {
+        size_t id1 = min(ids_[i], ids_[j]);
+        size_t id2 = max(ids_[i], ids_[j]);
+        if (rowMax > critMax || id1 < bestPair[0] || (id1 == bestPair[0] && id2 < bestPair[1]))
+        {
+          critMax = rowMax;
+          bestPair[0] = id1;
+          bestPair[1] = id2;
+        }
+      }
+    }
+  }
+
+  if (critMax == -numeric_limits<double>::infinity())
+    throw Exception("NeighborJoiningMatrix::getBestPair. Unexpected error: no maximum criterium found.");
+  return bestPair;
+}
+
+/******************************************************************************/
+
+void NeighborJoiningMatrix::agglomerate(const vector<size_t>& pair, const vector<double>& newDistances)
+{
+  size_t s1 = slots_[pair[0]];
+  size_t s2 = slots_[pair[1]];
+  double* row1 = rows_[s1];
+  const double* row2 = rows_[s2];
+
+  // Update distances and sums:
+  double sum = 0.;
+  double minDist = numeric_limits<double>::infinity();
+  for (size_t k = 0; k < size_; k++)
+  {
+    if (k == s1 || k == s2)
+      continue;
+    double d = newDistances[ids_[k]];
+    sums_[k] += d - row1[k] - row2[k];
+    sum += d;
+    minDist = min(minDist, d);
+    minDistances_[k] = min(minDistances_[k], d);
+    row1[k] = d;
+    rows_[k][s1] = d;
+  }
+  sums_[s1] = sum;
+  minDistances_[s1] = minDist;
+
+  // Remove the second node, and move the last one at its position:
+  // the row is moved by pointer, and only the column is copied.
+  size_t last = size_ - 1;
+  if (s2 != last)
+  {
+    rows_[s2] = rows_[last];
+    for (size_t k = 0; k < last; k++)
+    {
+      rows_[k][s2] = rows_[k][last];
+    }
+    sums_[s2] = sums_[last];
+    minDistances_[s2] = minDistances_[last];
+    ids_[s2] = ids_[last];
+    slots_[ids_[s2]] = s2;
+  }
+  size_--;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,159 @@
+//
+// File: NeighborJoiningMatrix.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 16:05 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _NEIGHBORJOININGMATRIX_H_
+#define _NEIGHBORJOININGMATRIX_H_
+
+#include <Bpp/Exceptions.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/DistanceMatrix.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Working distance matrix for neighbor joining methods.
+ *
+ * Nodes are referred to by their index in the original distance matrix (their id),
+ * and are stored internally at a position (slot).
+ * The distances are not copied: the rows of the original matrix are used in place, and are overwritten.
+ * Positions are kept compact: when a node is removed, the last node is moved at its position,
+ * so that the distances from one node to all the remaining ones are always contiguous in memory.
+ *
+ * The sum of the distances from each node to all the others is updated incrementally
+ * after each agglomeration, instead of being recomputed.
+ * The search for the pair maximizing the neighbor joining criterion
+ * @f[
+ * Q(i, j) = S_i + S_j - (r - 2) d(i, j),
+ * @f]
+ * where @f$r@f$ is the number of remaining nodes, uses an upper bound for each row,
+ * @f$S_i + \max_k S_k - (r - 2) \min_j d(i, j)@f$: rows are examined in decreasing order of
+ * their bound, and the search stops as soon as the bound of a row is lower than the best criterion found.
+ * In case of ties, the pair with the smallest ids is chosen, as in a full scan in the order of ids.
+ */
+class NeighborJoiningMatrix
+{
+private:
+  size_t size_;
+  /**
+   * @brief The rows of the distance matrix, by slot, with distances also stored by slot.
+   *
+   * The diagonal is set to infinity so that a node is never paired with itself.
+   */
+  std::vector<double*> rows_;
+  std::vector<double> sums_;
+  /**
+   * @brief A lower bound of the minimum distance in each row, by slot.
+   */
+  std::vector<double> minDistances_;
+  std::vector<size_t> ids_;
+  std::vector<size_t> slots_;
+  // Working arrays:
+  std::vector<double> bounds_;
+  std::vector<size_t> order_;
+  std::vector<double> criteria_;
+
+public:
+  /**
+   * @brief Build a new working matrix on a distance matrix.
+   *
+   * @param matrix The input distance matrix. Its distances are overwritten,
+   * and it must not be resized nor destroyed while this object is in use.
+   */
+  NeighborJoiningMatrix(DistanceMatrix& matrix);
+
+  NeighborJoiningMatrix() :
+    size_(0), rows_(), sums_(), minDistances_(),
+    ids_(), slots_(), bounds_(), order_(), criteria_() {}
+
+  virtual ~NeighborJoiningMatrix() {}
+
+public:
+  /**
+   * @return The number of remaining nodes.
+   */
+  size_t size() const { return size_; }
+
+  /**
+   * @return The id of the node at a given position, from 0 to size() - 1.
+   * @param slot The position of the node.
+   */
+  size_t getId(size_t slot) const { return ids_[slot]; }
+
+  /**
+   * @return The distance between two remaining nodes.
+   * @param id1 The id of the first node.
+   * @param id2 The id of the second node.
+   */
+  double getDistance(size_t id1, size_t id2) const
+  {
+    return id1 == id2 ? 0. : rows_[slots_[id1]][slots_[id2]];
+  }
+
+  /**
+   * @return The sum of the distances from a given node to all the other remaining nodes.
+   * @param id The id of the node.
+   */
+  double getSum(size_t id) const { return sums_[slots_[id]]; }
+
+  /**
+   * @brief Get the pair of nodes which maximizes the neighbor joining criterion.
+   *
+   * @return A size 2 vector with the ids of the nodes, the smallest one first.
+   * @throw Exception If less than three nodes remain.
+   */
+  std::vector<size_t> getBestPair() throw (Exception);
+
+  /**
+   * @brief Agglomerate two nodes.
+   *
+   * The first node of the pair is replaced by the new node, and the second one is removed.
+   *
+   * @param pair         The ids of the nodes to agglomerate.
+   * @param newDistances The distances from the new node to all remaining nodes, indexed by id.
+   */
+  void agglomerate(const std::vector<size_t>& pair, const std::vector<double>& newDistances);
+};
+} // end of namespace bpp.
+
+#endif // _NEIGHBORJOININGMATRIX_H_
+
@@ -62,6 +62,9 @@ struct PGMAInfos
  * is equivalent to the average linkage hierarchical clustering method.
  * The distance between two taxa is the average distance between all individuals in each taxa.
  * The unweighted version (named UPGMA), uses a weighted average, with the number of individuals in a group as a weight.
+ *
+ * Both linkages are reducible, and trees are built with the nearest-neighbor chain algorithm, in @f$O(n^2)@f$
+ * (see AbstractAgglomerativeDistanceMethod::computeTreeFromNearestNeighborChain()).
  */
 class PGMA :
   public AbstractAgglomerativeDistanceMethod
@@ -101,6 +104,8 @@ public:
 
   TreeTemplate<Node>* getTree() const;
 
+  void computeTree() throw (Exception) { computeTreeFromNearestNeighborChain(); }
+
   void setWeighted(bool weighted) { weighted_ = weighted; }
   bool isWeighted() const { return weighted_; }
 
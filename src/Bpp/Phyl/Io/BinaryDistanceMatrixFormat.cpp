@@ -0,0 +1,220 @@
+//
+// File: BinaryDistanceMatrixFormat.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 17:10 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BinaryDistanceMatrixFormat.h"
+
+#include <Bpp/Text/TextTools.h>
+
+// From SeqLib:
+#include <Bpp/Seq/DistanceMatrix.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+
+static const char BINARY_DISTANCE_TAG[8] = { 'B', 'P', 'P', 'D', 'I', 'S', 'T', 1 };
+static const uint32_t BINARY_DISTANCE_BYTE_ORDER = 0x01020304;
+
+/******************************************************************************/
+
+size_t BinaryDistanceMatrixFormat::writeHeader(ostream& out, const vector<string>& names, bool useFloat) throw (Exception)
+{
+  uint32_t byteOrder = BINARY_DISTANCE_BYTE_ORDER;
+  uint32_t valueSize = static_cast<uint32_t>(useFloat ? sizeof(float) : sizeof(double));
+  uint64_t n = static_cast<uint64_t>(names.size());
+  out.write(BINARY_DISTANCE_TAG, 8);
+  out.write(reinterpret_cast<const char*>(&byteOrder), sizeof(byteOrder));
+  out.write(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
+  out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+  size_t size = 8 + sizeof(byteOrder) + sizeof(valueSize) + sizeof(n);
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    uint32_t length = static_cast<uint32_t>(names[i].size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(names[i].data(), static_cast<streamsize>(length));
+    size += sizeof(length) + length;
+  }
+  // Align distances:
+  char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  size_t nbPad = (8 - size % 8) % 8;
+  out.write(padding, static_cast<streamsize>(nbPad));
+  size += nbPad;
+  if (!out)
+    throw Exception("BinaryDistanceMatrixFormat::writeHeader. Error while writing matrix.");
+  return size;
+}
+
+/******************************************************************************/
+
+size_t BinaryDistanceMatrixFormat::readHeader(istream& in, vector<string>& names, bool& useFloat) throw (Exception)
+{
+  char tag[8];
+  uint32_t byteOrder, valueSize;
+  uint64_t n;
+  in.read(tag, 8);
+  if (!in || memcmp(tag, BINARY_DISTANCE_TAG, 8) != 0)
+    throw Exception("BinaryDistanceMatrixFormat::readHeader. Not a binary distance matrix.");
+  in.read(reinterpret_cast<char*>(&byteOrder), sizeof(byteOrder));
+  in.read(reinterpret_cast<char*>(&valueSize), sizeof(valueSize));
+  in.read(reinterpret_cast<char*>(&n), sizeof(n));
+  if (!in)
+    throw Exception("BinaryDistanceMatrixFormat::readHeader. Unexpected end of file.");
+  if (byteOrder != BINARY_DISTANCE_BYTE_ORDER)
+    throw Exception("BinaryDistanceMatrixFormat::readHeader. The matrix was written with a different byte order.");
+  if (valueSize != sizeof(float) && valueSize != sizeof(double))
+    throw Exception("BinaryDistanceMatrixFormat::readHeader. Unsupported size of distances: " + TextTools::toString(valueSize) + ".");
+  useFloat = (valueSize == sizeof(float));
+  size_t size = 8 + sizeof(byteOrder) + sizeof(valueSize) + sizeof(n);
+  names.resize(static_cast<size_t>(n));
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    uint32_t length;
+    in.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (!in)
+      throw Exception("BinaryDistanceMatrixFormat::readHeader. Unexpected end of file.");
+    names[i].resize(length);
+    if (length > 0)
+      in.read(&names[i][0], static_cast<streamsize>(length));
+    size += sizeof(length) + length;
+  }
+  size_t nbPad = (8 - size % 8) % 8;
+  in.ignore(static_cast<streamsize>(nbPad));
+  if (!in)
+    throw Exception("BinaryDistanceMatrixFormat::readHeader. Unexpected end of file.");
+  return size + nbPad;
+}
+
+/******************************************************************************/
+
+DistanceMatrix* BinaryDistanceMatrixFormat::read(const string& path) const throw (Exception)
+{
+  ifstream input(path.c_str(), ios::in | ios::binary);
+  if (!input)
+    throw IOException("BinaryDistanceMatrixFormat::read. Could not open file: " + path);
+  DistanceMatrix* mat = read(input);
+  input.close();
+  return mat;
+}
+
+/******************************************************************************/
+
+DistanceMatrix* BinaryDistanceMatrixFormat::read(istream& in) const throw (Exception)
+{
+  vector<string> names;
+  bool useFloat;
+  readHeader(in, names, useFloat);
+  size_t n = names.size();
+  DistanceMatrix* dist = new DistanceMatrix(names);
+  // Rows are read one at a time:
+  vector<float> rowF(useFloat ? n : 0);
+  vector<double> rowD(useFloat ? 0 : n);
+  for (size_t i = 1; i < n; ++i)
+  {
+    if (useFloat)
+      in.read(reinterpret_cast<char*>(&rowF[0]), static_cast<streamsize>(i * sizeof(float)));
+    else
+      in.read(reinterpret_cast<char*>(&rowD[0]), static_cast<streamsize>(i * sizeof(double)));
+    if (!in)
+    {
+      delete dist;
+      throw Exception("BinaryDistanceMatrixFormat::read. Unexpected end of file.");
+    }
+    for (size_t j = 0; j < i; ++j)
+    {
+      double d = useFloat ? static_cast<double>(rowF[j]) : rowD[j];
+      (*dist)(i, j) = d;
+      (*dist)(j, i) = d;
+    }
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    (*dist)(i, i) = 0.;
+  }
+  return dist;
+}
+
+/******************************************************************************/
+
+void BinaryDistanceMatrixFormat::write(const DistanceMatrix& dist, const string& path, bool overwrite) const throw (Exception)
+{
+  ofstream output(path.c_str(), overwrite ? (ios::out | ios::binary) : (ios::out | ios::app | ios::binary));
+  if (!output)
+    throw IOException("BinaryDistanceMatrixFormat::write. Could not open file: " + path);
+  write(dist, output);
+  output.close();
+}
+
+/******************************************************************************/
+
+void BinaryDistanceMatrixFormat::write(const DistanceMatrix& dist, ostream& out) const throw (Exception)
+{
+  size_t n = dist.size();
+  vector<string> names(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    names[i] = dist.getName(i);
+  }
+  writeHeader(out, names, useFloat_);
+  vector<float> rowF(useFloat_ ? n : 0);
+  vector<double> rowD(useFloat_ ? 0 : n);
+  for (size_t i = 1; i < n; ++i)
+  {
+    if (useFloat_)
+    {
+      for (size_t j = 0; j < i; ++j)
+        rowF[j] = static_cast<float>(dist(i, j));
+      out.write(reinterpret_cast<const char*>(&rowF[0]), static_cast<streamsize>(i * sizeof(float)));
+    }
+    else
+    {
+      for (size_t j = 0; j < i; ++j)
+        rowD[j] = dist(i, j);
+      out.write(reinterpret_cast<const char*>(&rowD[0]), static_cast<streamsize>(i * sizeof(double)));
+    }
+  }
+  if (!out)
+    throw Exception("BinaryDistanceMatrixFormat::write. Error while writing matrix.");
+}
+
+/******************************************************************************/
+
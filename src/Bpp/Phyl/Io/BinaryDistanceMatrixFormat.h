@@ -0,0 +1,123 @@
+//
+// File: BinaryDistanceMatrixFormat.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 17:10 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BINARYDISTANCEMATRIXFORMAT_H_
+#define _BINARYDISTANCEMATRIXFORMAT_H_
+
+#include "IoDistanceMatrix.h"
+
+// From the STL:
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Distance matrix I/O in a compact binary format.
+ *
+ * As distance matrices are symmetric with a null diagonal, only the lower triangle is stored.
+ * The format is made of:
+ * - an 8 bytes tag, "BPPDIST" followed by the version number (1),
+ * - a 32 bits integer equal to 0x01020304, used to check the byte order,
+ * - a 32 bits integer with the size in bytes of each distance (4 for float, 8 for double),
+ * - a 64 bits integer with the dimension @f$n@f$ of the matrix,
+ * - for each entry, the size of its name as a 32 bits integer, followed by the name itself,
+ * - null bytes up to the next multiple of 8,
+ * - the @f$n(n-1)/2@f$ distances @f$d(i, j)@f$, @f$j < i@f$, ordered by row.
+ *
+ * Numbers are written in the native byte order, and files can only be read on machines with the same byte order.
+ * Storing distances as floats halves the size of the file, at the cost of precision.
+ * Files in this format can also be accessed without loading them, using a MappedDistanceMatrix object.
+ */
+class BinaryDistanceMatrixFormat:
+  public AbstractIDistanceMatrix,
+  public AbstractODistanceMatrix
+{
+  private:
+    bool useFloat_;
+
+	public:
+    /**
+     * @param useFloat Tell if distances should be written as floats instead of doubles.
+     */
+		BinaryDistanceMatrixFormat(bool useFloat = false): useFloat_(useFloat) {}
+		virtual ~BinaryDistanceMatrixFormat() {}
+
+	public:
+		const std::string getFormatName() const { return "Binary"; }
+
+		const std::string getFormatDescription() const { return "Binary lower triangular matrix."; }
+
+		DistanceMatrix* read(const std::string& path) const throw (Exception);
+		DistanceMatrix* read(std::istream& in) const throw (Exception);
+		
+		void write(const DistanceMatrix& dist, const std::string& path, bool overwrite = true) const throw (Exception);
+		void write(const DistanceMatrix& dist, std::ostream& out) const throw (Exception);
+
+    void setUseFloat(bool yn) { useFloat_ = yn; }
+    bool usesFloat() const { return useFloat_; }
+
+    /**
+     * @brief Write the header of a matrix.
+     *
+     * @param out      The output stream.
+     * @param names    The names of the entries.
+     * @param useFloat Tell if distances are stored as floats.
+     * @return The size of the header in bytes, that is, the offset of the distances.
+     * @throw Exception If an error occured.
+     */
+    static size_t writeHeader(std::ostream& out, const std::vector<std::string>& names, bool useFloat) throw (Exception);
+
+    /**
+     * @brief Read the header of a matrix.
+     *
+     * @param in       The input stream.
+     * @param names    [out] The names of the entries.
+     * @param useFloat [out] Tell if distances are stored as floats.
+     * @return The size of the header in bytes, that is, the offset of the distances.
+     * @throw Exception If the stream is not in the binary format.
+     */
+    static size_t readHeader(std::istream& in, std::vector<std::string>& names, bool& useFloat) throw (Exception);
+};
+
+} //end of namespace bpp.
+
+#endif //_BINARYDISTANCEMATRIXFORMAT_H_
+
@@ -0,0 +1,200 @@
+//
+// File: MappedDistanceMatrix.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 17:35 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "MappedDistanceMatrix.h"
+#include "BinaryDistanceMatrixFormat.h"
+
+using namespace bpp;
+
+// From the STL:
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/******************************************************************************/
+
+MappedDistanceMatrix::MappedDistanceMatrix(const string& path) throw (Exception) :
+  path_(path), names_(), useFloat_(false), writable_(false),
+  offset_(0), fileSize_(0), data_(0), fd_(-1), buffer_()
+{
+  ifstream input(path.c_str(), ios::in | ios::binary);
+  if (!input)
+    throw IOException("MappedDistanceMatrix. Could not open file: " + path);
+  offset_ = BinaryDistanceMatrixFormat::readHeader(input, names_, useFloat_);
+  input.close();
+  size_t n = names_.size();
+  fileSize_ = offset_ + (n * (n - 1) / 2) * (useFloat_ ? sizeof(float) : sizeof(double));
+  map_();
+}
+
+/******************************************************************************/
+
+MappedDistanceMatrix::MappedDistanceMatrix(const string& path, const vector<string>& names, bool useFloat) throw (Exception) :
+  path_(path), names_(names), useFloat_(useFloat), writable_(true),
+  offset_(0), fileSize_(0), data_(0), fd_(-1), buffer_()
+{
+  ofstream output(path.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!output)
+    throw IOException("MappedDistanceMatrix. Could not create file: " + path);
+  offset_ = BinaryDistanceMatrixFormat::writeHeader(output, names_, useFloat_);
+  size_t n = names_.size();
+  fileSize_ = offset_ + (n * (n - 1) / 2) * (useFloat_ ? sizeof(float) : sizeof(double));
+  // Extend the file to its final size, filled with zeros:
+  if (fileSize_ > offset_)
+  {
+    output.seekp(static_cast<streamoff>(fileSize_ - 1));
+    output.put(0);
+  }
+  output.close();
+  if (!output)
+    throw IOException("MappedDistanceMatrix. Could not write file: " + path);
+  map_();
+}
+
+/******************************************************************************/
+
+MappedDistanceMatrix::~MappedDistanceMatrix()
+{
+  try
+  {
+    flush();
+  }
+  catch (Exception&) {}
+  unmap_();
+}
+
+/******************************************************************************/
+
+void MappedDistanceMatrix::setDistance(size_t i, size_t j, double d) throw (Exception)
+{
+  if (!writable_)
+    throw Exception("MappedDistanceMatrix::setDistance. Matrix is read only.");
+  if (i == j)
+    throw Exception("MappedDistanceMatrix::setDistance. Diagonal elements can't be set.");
+  size_t k = (i > j ? i * (i - 1) / 2 + j : j * (j - 1) / 2 + i);
+  if (useFloat_)
+    reinterpret_cast<float*>(data_)[k] = static_cast<float>(d);
+  else
+    reinterpret_cast<double*>(data_)[k] = d;
+}
+
+/******************************************************************************/
+
+#ifndef _WIN32
+
+void MappedDistanceMatrix::map_() throw (Exception)
+{
+  if (fileSize_ == offset_)
+    return; // No distance to map.
+  fd_ = open(path_.c_str(), writable_ ? O_RDWR : O_RDONLY);
+  if (fd_ < 0)
+    throw IOException("MappedDistanceMatrix. Could not open file: " + path_);
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < fileSize_)
+  {
+    unmap_();
+    throw IOException("MappedDistanceMatrix. File is truncated: " + path_);
+  }
+  void* addr = mmap(0, fileSize_, writable_ ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED)
+  {
+    unmap_();
+    throw IOException("MappedDistanceMatrix. Could not map file: " + path_);
+  }
+  data_ = static_cast<char*>(addr) + offset_;
+}
+
+void MappedDistanceMatrix::unmap_()
+{
+  if (data_)
+    munmap(data_ - offset_, fileSize_);
+  data_ = 0;
+  if (fd_ >= 0)
+    close(fd_);
+  fd_ = -1;
+}
+
+void MappedDistanceMatrix::flush() throw (Exception)
+{
+  if (writable_ && data_ && msync(data_ - offset_, fileSize_, MS_SYNC) != 0)
+    throw IOException("MappedDistanceMatrix::flush. Could not write file: " + path_);
+}
+
+#else
+
+void MappedDistanceMatrix::map_() throw (Exception)
+{
+  // No memory mapping: distances are loaded in memory.
+  ifstream input(path_.c_str(), ios::in | ios::binary);
+  buffer_.resize(fileSize_ - offset_ + 1);
+  input.seekg(static_cast<streamoff>(offset_));
+  input.read(&buffer_[0], static_cast<streamsize>(fileSize_ - offset_));
+  if (!input)
+    throw IOException("MappedDistanceMatrix. File is truncated: " + path_);
+  data_ = &buffer_[0];
+}
+
+void MappedDistanceMatrix::unmap_()
+{
+  buffer_.clear();
+  data_ = 0;
+}
+
+void MappedDistanceMatrix::flush() throw (Exception)
+{
+  if (!writable_ || !data_)
+    return;
+  fstream output(path_.c_str(), ios::in | ios::out | ios::binary);
+  output.seekp(static_cast<streamoff>(offset_));
+  output.write(data_, static_cast<streamsize>(fileSize_ - offset_));
+  if (!output)
+    throw IOException("MappedDistanceMatrix::flush. Could not write file: " + path_);
+}
+
+#endif
+
+/******************************************************************************/
+
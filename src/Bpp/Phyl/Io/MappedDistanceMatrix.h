@@ -0,0 +1,155 @@
+//
+// File: MappedDistanceMatrix.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 17:35 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _MAPPEDDISTANCEMATRIX_H_
+#define _MAPPEDDISTANCEMATRIX_H_
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Access to a distance matrix file in binary format, without loading it in memory.
+ *
+ * The file (see BinaryDistanceMatrixFormat) is mapped in memory, so that distances are read from,
+ * or written to, the file on demand by the operating system.
+ * This allows to share very large matrices between programs, or to fill a matrix
+ * as distances are computed, without storing the full matrix in memory.
+ *
+ * On systems without memory mapping support, the distances are loaded in memory,
+ * and written back to the file when the object is destroyed.
+ */
+class MappedDistanceMatrix
+{
+  private:
+    std::string path_;
+    std::vector<std::string> names_;
+    bool useFloat_;
+    bool writable_;
+    size_t offset_;
+    size_t fileSize_;
+    char* data_;
+    int fd_;
+    std::vector<char> buffer_;
+
+  public:
+    /**
+     * @brief Open an existing matrix for reading.
+     *
+     * @param path The path of the file.
+     * @throw Exception If the file cannot be opened or is not in the binary format.
+     */
+    MappedDistanceMatrix(const std::string& path) throw (Exception);
+
+    /**
+     * @brief Create a new matrix file, with all distances set to 0.
+     *
+     * Existing files are overwritten.
+     *
+     * @param path     The path of the file.
+     * @param names    The names of the entries.
+     * @param useFloat Tell if distances should be stored as floats instead of doubles.
+     * @throw Exception If the file cannot be created.
+     */
+    MappedDistanceMatrix(const std::string& path, const std::vector<std::string>& names, bool useFloat = false) throw (Exception);
+
+    virtual ~MappedDistanceMatrix();
+
+  private:
+    MappedDistanceMatrix(const MappedDistanceMatrix&);
+    MappedDistanceMatrix& operator=(const MappedDistanceMatrix&);
+
+  public:
+    /**
+     * @return The dimension of the matrix.
+     */
+    size_t size() const { return names_.size(); }
+
+    const std::vector<std::string>& getNames() const { return names_; }
+
+    const std::string& getName(size_t i) const { return names_[i]; }
+
+    bool usesFloat() const { return useFloat_; }
+
+    bool isWritable() const { return writable_; }
+
+    /**
+     * @return The distance between two entries.
+     * @param i The index of the first entry.
+     * @param j The index of the second entry.
+     */
+    double operator()(size_t i, size_t j) const
+    {
+      if (i == j) return 0.;
+      size_t k = (i > j ? i * (i - 1) / 2 + j : j * (j - 1) / 2 + i);
+      if (useFloat_)
+        return static_cast<double>(reinterpret_cast<const float*>(data_)[k]);
+      else
+        return reinterpret_cast<const double*>(data_)[k];
+    }
+
+    /**
+     * @brief Set the distance between two entries.
+     *
+     * @param i The index of the first entry.
+     * @param j The index of the second entry.
+     * @param d The distance.
+     * @throw Exception If the matrix is not writable, or if i == j.
+     */
+    void setDistance(size_t i, size_t j, double d) throw (Exception);
+
+    /**
+     * @brief Ensure that all modifications are written to the file.
+     */
+    void flush() throw (Exception);
+
+  private:
+    void map_() throw (Exception);
+    void unmap_();
+};
+
+} //end of namespace bpp.
+
+#endif //_MAPPEDDISTANCEMATRIX_H_
+
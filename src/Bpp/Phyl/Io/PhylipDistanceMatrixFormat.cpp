@@ -39,9 +39,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "PhylipDistanceMatrixFormat.h"
 
-#include <Bpp/Io/FileTools.h>
 #include <Bpp/Text/TextTools.h>
-#include <Bpp/Text/StringTokenizer.h>
 
 // From SeqLib:
 #include <Bpp/Seq/DistanceMatrix.h>
@@ -55,42 +53,52 @@ using namespace std;
 
 DistanceMatrix * PhylipDistanceMatrixFormat::read(istream& in) const throw (Exception)
 {
-	string s = FileTools::getNextLine(in);
-	// the size of the matrix:
-	unsigned int n = TextTools::fromString<unsigned int>(s);
-	DistanceMatrix * dist = new DistanceMatrix(n);
-	unsigned int rowNumber = 0;
-	unsigned int colNumber = 0;
-	s = FileTools::getNextLine(in);
-	while (in)
+  // The matrix is parsed directly from the stream, values of a row may span several lines.
+  // the size of the matrix:
+  size_t n;
+  in >> n;
+  if (!in)
+    throw Exception("PhylipDistanceMatrixFormat::read. Could not read the size of the matrix.");
+  DistanceMatrix * dist = new DistanceMatrix(n);
+  string name;
+  for (size_t rowNumber = 0; rowNumber < n; rowNumber++)
   {
-		if (colNumber == 0)
-    { // New row
-      if (extended_) {
-        size_t pos = s.find("  ");
-        if (pos == string::npos)
-          throw Exception("PhylipDistanceMatrixFormat::read. Bad format, probably not 'extended' Phylip.");
-        dist->setName(rowNumber, s.substr(0, pos));
-        s = s.substr(pos + 2);
-      } else {
-        dist->setName(rowNumber, s.substr(0, 10));
-        s = s.substr(11);
+    // Skip the end of the previous line:
+    in >> ws;
+    name.clear();
+    if (extended_)
+    {
+      // The name ends with two consecutive spaces:
+      char c;
+      while (in.get(c) && c != '\n' && !(c == ' ' && name.size() > 0 && name[name.size() - 1] == ' '))
+        name += c;
+      if (!in || c == '\n')
+      {
+        delete dist;
+        throw Exception("PhylipDistanceMatrixFormat::read. Bad format, probably not 'extended' Phylip.");
       }
+      name.erase(name.size() - 1);
     }
-		StringTokenizer st(s, "\t ");
-		for (; colNumber < n && st.hasMoreToken(); colNumber++)
+    else
     {
-			double d = TextTools::fromString<double>(st.nextToken());
-			(* dist)(rowNumber, colNumber) = d;
-		}
-		if (colNumber == n)
+      char buffer[10];
+      in.read(buffer, 10);
+      name.assign(buffer, static_cast<size_t>(in.gcount()));
+    }
+    dist->setName(rowNumber, name);
+    for (size_t colNumber = 0; colNumber < n; colNumber++)
     {
-			colNumber = 0;
-			rowNumber++;
-		}
-		s = FileTools::getNextLine(in);
-	}
-	return dist;
+      double d;
+      in >> d;
+      if (!in)
+      {
+        delete dist;
+        throw Exception("PhylipDistanceMatrixFormat::read. Bad format: could not read distance (" + TextTools::toString(rowNumber) + ", " + TextTools::toString(colNumber) + ").");
+      }
+      (* dist)(rowNumber, colNumber) = d;
+    }
+  }
+  return dist;
 }
 
 void PhylipDistanceMatrixFormat::write(const DistanceMatrix& dist, ostream& out) const throw (Exception)
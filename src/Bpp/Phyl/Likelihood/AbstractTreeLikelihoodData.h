@@ -43,6 +43,9 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "TreeLikelihoodData.h"
 
+#include <Bpp/Exceptions.h>
+#include <Bpp/Text/TextTools.h>
+
 //From the STL:
 #include <vector>
 #include <map>
@@ -133,6 +136,21 @@ class AbstractTreeLikelihoodData :
 			return rootWeights_;
 		}
 
+    /**
+     * @brief Set the weights of the array positions.
+     *
+     * This can be used to reweight sites without recompressing the data set, e.g. for bootstrap.
+     *
+     * @param weights The new weights, one per array position.
+     * @throw Exception If the number of weights does not match the number of array positions.
+     */
+    void setWeights(const std::vector<unsigned int>& weights) throw (Exception)
+    {
+      if (weights.size() != rootWeights_.size())
+        throw Exception("AbstractTreeLikelihoodData::setWeights. Wrong number of weights: " + TextTools::toString(weights.size()) + ", expected " + TextTools::toString(rootWeights_.size()) + ".");
+      rootWeights_ = weights;
+    }
+
 		const Alphabet* getAlphabet() const { return alphabet_; }
 
 		const TreeTemplate<Node>* getTree() const { return tree_; }  
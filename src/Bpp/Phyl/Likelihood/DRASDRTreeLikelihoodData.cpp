@@ -41,9 +41,14 @@
 #include "DRASDRTreeLikelihoodData.h"
 #include "../PatternTools.h"
 
+#include <Bpp/Text/TextTools.h>
+
 // From SeqLib:
 #include <Bpp/Seq/SiteTools.h>
 
+// From the STL:
+#include <set>
+
 using namespace bpp;
 
 /******************************************************************************/
@@ -222,7 +227,21 @@ void DRASDRTreeLikelihoodData::reInit(const Node* node) throw (Exception)
 
   DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[node->getId()];
   nodeData->setNode(node);
-  nodeData->eraseNeighborArrays();
+
+  // Only the arrays of former neighbors are erased, the others are reused:
+  std::map<int, VVVdouble>& arrays = nodeData->getLikelihoodArrays();
+  for (std::map<int, VVVdouble>::iterator it = arrays.begin(); it != arrays.end(); )
+  {
+    bool isNeighbor = node->hasFather() && node->getFather()->getId() == it->first;
+    for (size_t l = 0; !isNeighbor && l < node->getNumberOfSons(); l++)
+    {
+      isNeighbor = node->getSon(l)->getId() == it->first;
+    }
+    if (isNeighbor)
+      it++;
+    else
+      arrays.erase(it++);
+  }
 
   int nbSons = static_cast<int>(node->getNumberOfSons());
 
@@ -262,3 +281,28 @@ void DRASDRTreeLikelihoodData::reInit(const Node* node) throw (Exception)
 
 /******************************************************************************/
 
+void DRASDRTreeLikelihoodData::setTopology(const TreeTemplate<Node>* tree) throw (Exception)
+{
+  std::vector<const Node*> leaves = tree->getLeaves();
+  for (size_t i = 0; i < leaves.size(); i++)
+  {
+    if (leafData_.find(leaves[i]->getId()) == leafData_.end())
+      throw Exception("DRASDRTreeLikelihoodData::setTopology. No likelihood array for leaf " + TextTools::toString(leaves[i]->getId()) + ".");
+  }
+  tree_ = tree;
+
+  // Remove the data of nodes which are not in the new tree:
+  std::vector<int> ids = tree_->getNodesId();
+  std::set<int> idSet(ids.begin(), ids.end());
+  for (std::map<int, DRASDRTreeLikelihoodNodeData>::iterator it = nodeData_.begin(); it != nodeData_.end(); )
+  {
+    if (idSet.count(it->first))
+      it++;
+    else
+      nodeData_.erase(it++);
+  }
+  reInit();
+}
+
+/******************************************************************************/
+
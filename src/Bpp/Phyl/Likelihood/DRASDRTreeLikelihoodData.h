@@ -417,6 +417,19 @@ class DRASDRTreeLikelihoodData :
     
     void reInit(const Node* node) throw (Exception);
 
+    /**
+     * @brief Associate the data to a tree with a different topology.
+     *
+     * Compressed sites, leaves likelihoods and the arrays of branches found in both trees are kept,
+     * only the arrays of new branches are allocated.
+     * The new tree must have the same leaves as the current one, with the same ids.
+     * All inner arrays are reset, so that likelihoods have to be computed again.
+     *
+     * @param tree The new tree to associate to this data.
+     * @throw Exception If a leaf of the new tree has no likelihood array.
+     */
+    void setTopology(const TreeTemplate<Node>* tree) throw (Exception);
+
   protected:
     /**
      * @brief This method initializes the leaves according to a sequence container.
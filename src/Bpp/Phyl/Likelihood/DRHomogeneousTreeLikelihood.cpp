@@ -39,6 +39,7 @@
 
 #include "DRHomogeneousTreeLikelihood.h"
 #include "../PatternTools.h"
+#include "../TreeTools.h"
 
 // From SeqLib:
 #include <Bpp/Seq/SiteTools.h>
@@ -277,6 +278,49 @@ void DRHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& para
 
 /******************************************************************************/
 
+void DRHomogeneousTreeLikelihood::setWeights(const vector<unsigned int>& weights) throw (Exception)
+{
+  likelihoodData_->setWeights(weights);
+  if (isInitialized())
+    minusLogLik_ = -getLogLikelihood();
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::setTree(const Tree& tree) throw (Exception)
+{
+  if (!data_)
+    throw Exception("DRHomogeneousTreeLikelihood::setTree(). Data are not set.");
+  TreeTools::checkIds(tree, true);
+  unique_ptr< TreeTemplate<Node> > newTree(new TreeTemplate<Node>(tree));
+  if (newTree->isRooted())
+    newTree->unroot();
+
+  // Leaves arrays are stored by node id:
+  vector<const Node*> leaves = const_cast<const TreeTemplate<Node>*>(newTree.get())->getLeaves();
+  if (leaves.size() != tree_->getNumberOfLeaves())
+    throw Exception("DRHomogeneousTreeLikelihood::setTree(). The new tree does not have the same number of leaves.");
+  for (size_t i = 0; i < leaves.size(); i++)
+  {
+    int id = leaves[i]->getId();
+    if (!tree_->hasNode(id) || !tree_->getNode(id)->isLeaf() || tree_->getNode(id)->getName() != leaves[i]->getName())
+      throw Exception("DRHomogeneousTreeLikelihood::setTree(). Leaf " + leaves[i]->getName() + " does not have the same id in the two trees.");
+  }
+
+  delete tree_;
+  tree_ = newTree.release();
+  nodes_ = tree_->getNodes();
+  nodes_.pop_back(); // Remove the root node (the last added!).
+  nbNodes_ = nodes_.size();
+  setSubstitutionModel(model_); // Allocate transition probabilities for new branches.
+  likelihoodData_->setTopology(tree_);
+
+  initialized_ = false;
+  initialize();
+}
+
+/******************************************************************************/
+
 double DRHomogeneousTreeLikelihood::getValue() const
 throw (Exception)
 {
@@ -205,11 +205,43 @@ class DRHomogeneousTreeLikelihood:
 
     DRASDRTreeLikelihoodData* getLikelihoodData() { return likelihoodData_; }
     const DRASDRTreeLikelihoodData* getLikelihoodData() const { return likelihoodData_; }
+
+    /**
+     * @brief Set the weight of each distinct site pattern.
+     *
+     * Conditional likelihoods do not depend on weights, so that only the likelihood value is updated.
+     * This allows to resample sites (e.g. for bootstrap) without compressing the data again.
+     *
+     * @param weights The new weights, one per distinct site pattern.
+     * @throw Exception If the number of weights does not match the number of distinct sites.
+     */
+    virtual void setWeights(const std::vector<unsigned int>& weights) throw (Exception);
+
+    /**
+     * @brief Change the tree, keeping the data.
+     *
+     * Compressed sites and leaves likelihoods are kept, together with the arrays of the branches
+     * shared by the two trees, so that this is much cheaper than building a new object.
+     * Branch lengths are taken from the new tree, other parameters keep their current values,
+     * and the likelihood is computed again.
+     *
+     * @param tree The new tree. Its leaves must be the same as the current tree ones, with the same ids.
+     * @throw Exception If the leaves of the two trees do not match, or if no data are set.
+     */
+    virtual void setTree(const Tree& tree) throw (Exception);
   
     virtual void computeLikelihoodAtNode(int nodeId, VVVdouble& likelihoodArray) const
     {
       computeLikelihoodAtNode_(tree_->getNode(nodeId), likelihoodArray);
     }
+
+    const VVVdouble& getTransitionProbabilitiesArray(int nodeId) const throw (NodeNotFoundException)
+    {
+      std::map<int, VVVdouble>::const_iterator it = pxy_.find(nodeId);
+      if (it == pxy_.end())
+        throw NodeNotFoundException("DRHomogeneousTreeLikelihood::getTransitionProbabilitiesArray().", nodeId);
+      return it->second;
+    }
       
   protected:
     virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
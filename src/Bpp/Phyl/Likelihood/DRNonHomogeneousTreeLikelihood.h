@@ -212,6 +212,14 @@ class DRNonHomogeneousTreeLikelihood:
     {
       computeLikelihoodAtNode_(tree_->getNode(nodeId), likelihoodArray);
     }
+
+    const VVVdouble& getTransitionProbabilitiesArray(int nodeId) const throw (NodeNotFoundException)
+    {
+      std::map<int, VVVdouble>::const_iterator it = pxy_.find(nodeId);
+      if (it == pxy_.end())
+        throw NodeNotFoundException("DRNonHomogeneousTreeLikelihood::getTransitionProbabilitiesArray().", nodeId);
+      return it->second;
+    }
       
   protected:
     virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray) const;
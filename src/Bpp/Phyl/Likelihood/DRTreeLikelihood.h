@@ -101,6 +101,18 @@ class DRTreeLikelihood:
      */
     virtual void computeLikelihoodAtNode(int nodeId, VVVdouble& likelihoodArray) const = 0;
 
+    /**
+     * @brief Get the transition probabilities of a branch, as used in the likelihood arrays.
+     *
+     * Contrary to getTransitionProbabilitiesPerRateClass, the array is not copied:
+     * the reference remains valid until the likelihood object is modified.
+     *
+     * @param nodeId The id of the node at the end of the branch.
+     * @return The transition probabilities for each rate class, as pxy[c][x][y].
+     * @throw NodeNotFoundException If no branch leads to this node.
+     */
+    virtual const VVVdouble& getTransitionProbabilitiesArray(int nodeId) const throw (NodeNotFoundException) = 0;
+
 };
 
 } //end of namespace bpp.
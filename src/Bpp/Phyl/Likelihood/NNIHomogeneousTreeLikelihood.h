@@ -240,6 +240,13 @@ public:
     brLikFunction_ = new BranchLikelihood(getLikelihoodData()->getWeights());
   }
 
+  void setWeights(const std::vector<unsigned int>& weights) throw (Exception)
+  {
+    DRHomogeneousTreeLikelihood::setWeights(weights);
+    if (brLikFunction_) delete brLikFunction_;
+    brLikFunction_ = new BranchLikelihood(weights);
+  }
+
   /**
    * @name The NNISearchable interface.
    *
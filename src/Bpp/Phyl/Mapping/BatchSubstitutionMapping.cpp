@@ -0,0 +1,213 @@
+//
+// File: BatchSubstitutionMapping.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 23:50 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BatchSubstitutionMapping.h"
+#include "BranchJointLikelihoods.h"
+#include "../Likelihood/DRHomogeneousTreeLikelihood.h"
+#include "../ParallelTools.h"
+
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <mutex>
+
+using namespace std;
+
+/******************************************************************************/
+
+BatchSubstitutionMapping::BatchSubstitutionMapping(
+  const Tree& tree,
+  const SubstitutionModel& model,
+  const DiscreteDistribution& rDist,
+  const SubstitutionCount& substitutionCount,
+  bool verbose) throw (Exception) :
+  tree_(new TreeTemplate<Node>(tree)),
+  model_(model.clone()),
+  rDist_(rDist.clone()),
+  substitutionCount_(substitutionCount.clone()),
+  nodeIds_(),
+  counts_()
+{
+  substitutionCount_->setSubstitutionModel(model_.get());
+
+  // Branches are in the same order as in the likelihood objects built on this tree:
+  vector<const Node*> nodes = const_cast<const TreeTemplate<Node>*>(tree_.get())->getNodes();
+  nodes.pop_back(); // Remove root node.
+  size_t nbNodes   = nodes.size();
+  size_t nbClasses = rDist_->getNumberOfCategories();
+  vector<double> rates = rDist_->getCategories();
+
+  if (verbose)
+    ApplicationTools::displayTask("Compute substitution counts of all branches", true);
+  nodeIds_.resize(nbNodes);
+  counts_.resize(nbNodes);
+  for (size_t l = 0; l < nbNodes; ++l)
+  {
+    nodeIds_[l] = nodes[l]->getId();
+    double d = nodes[l]->getDistanceToFather();
+    vector<double> lengths(nbClasses);
+    for (size_t c = 0; c < nbClasses; ++c)
+    {
+      lengths[c] = d * rates[c];
+    }
+    substitutionCount_->getAllNumbersOfSubstitutionsForEachLength(lengths, counts_[l]);
+    if (verbose)
+      ApplicationTools::displayGauge(l, nbNodes - 1);
+  }
+  if (verbose)
+  {
+    if (ApplicationTools::message)
+      *ApplicationTools::message << " ";
+    ApplicationTools::displayTaskDone();
+  }
+}
+
+/******************************************************************************/
+
+void BatchSubstitutionMapping::mapAlignments(
+  size_t nbAlignments,
+  const AlignmentLoader& loader,
+  const MappingSink& sink,
+  unsigned int nbThreads,
+  bool verbose) const throw (Exception)
+{
+  size_t nbWorkers = ParallelTools::getNumberOfWorkers(nbAlignments, nbThreads);
+
+  if (verbose)
+    ApplicationTools::displayTask("Map alignments", true);
+
+  // Each worker reuses its own likelihood object, whose model is modified when parameters are applied:
+  vector< unique_ptr<SubstitutionModel> > models(nbWorkers);
+  vector< unique_ptr<DiscreteDistribution> > rDists(nbWorkers);
+  vector< unique_ptr<DRHomogeneousTreeLikelihood> > likelihoods(nbWorkers);
+  size_t done = 0;
+  mutex sinkMutex;
+  ParallelTools::parallelFor(nbAlignments, nbThreads, [&](size_t k, size_t w)
+  {
+    if (!likelihoods[w])
+    {
+      models[w].reset(model_->clone());
+      rDists[w].reset(rDist_->clone());
+      likelihoods[w].reset(new DRHomogeneousTreeLikelihood(*tree_, models[w].get(), rDists[w].get(), false, false));
+    }
+    DRHomogeneousTreeLikelihood& drtl = *likelihoods[w];
+    {
+      shared_ptr<const SiteContainer> alignment = loader(k);
+      if (!alignment)
+        throw Exception("BatchSubstitutionMapping::mapAlignments(). No alignment was given for index " + TextTools::toString(k) + ".");
+      drtl.setData(*alignment);
+    }
+    drtl.initialize();
+    unique_ptr<ProbabilisticSubstitutionMapping> mapping(map_(drtl));
+
+    lock_guard<mutex> lock(sinkMutex);
+    sink(k, drtl, *mapping);
+    if (verbose)
+      ApplicationTools::displayGauge(done++, nbAlignments - 1);
+  });
+  if (verbose)
+  {
+    if (ApplicationTools::message)
+      *ApplicationTools::message << " ";
+    ApplicationTools::displayTaskDone();
+  }
+}
+
+/******************************************************************************/
+
+void BatchSubstitutionMapping::mapAlignments(
+  const vector<const SiteContainer*>& alignments,
+  const MappingSink& sink,
+  unsigned int nbThreads,
+  bool verbose) const throw (Exception)
+{
+  // Alignments are not owned by the loader:
+  mapAlignments(alignments.size(), [&](size_t k)
+  {
+    return shared_ptr<const SiteContainer>(alignments[k], [](const SiteContainer*) {});
+  }, sink, nbThreads, verbose);
+}
+
+/******************************************************************************/
+
+ProbabilisticSubstitutionMapping* BatchSubstitutionMapping::map_(const DRTreeLikelihood& drtl) const throw (Exception)
+{
+  BranchJointLikelihoods joint(drtl, vector<int>());
+  size_t nbDistinctSites = joint.getNumberOfPatterns();
+  size_t nbClasses       = joint.getNumberOfClasses();
+  size_t nbTypes         = substitutionCount_->getNumberOfSubstitutionTypes();
+  if (joint.getNumberOfBranches() != nodeIds_.size())
+    throw Exception("BatchSubstitutionMapping::map_(). The tree of the likelihood object does not match.");
+
+  unique_ptr<ProbabilisticSubstitutionMapping> substitutions(
+    new ProbabilisticSubstitutionMapping(drtl.getTree(), substitutionCount_.get(), drtl.getLikelihoodData()->getRootArrayPositions(), nbDistinctSites));
+
+  VVdouble substitutionsForCurrentNode(nbDistinctSites);
+  vector< vector<const Matrix<double>*> > values(nbClasses, vector<const Matrix<double>*>(nbTypes));
+  for (size_t l = 0; l < nodeIds_.size(); ++l)
+  {
+    if (joint.getNodeId(l) != nodeIds_[l])
+      throw Exception("BatchSubstitutionMapping::map_(). The tree of the likelihood object does not match.");
+    for (size_t c = 0; c < nbClasses; ++c)
+    {
+      for (size_t t = 0; t < nbTypes; ++t)
+      {
+        values[c][t] = &counts_[l][c][t];
+      }
+    }
+    for (size_t p = 0; p < joint.getPartitions(l).size(); ++p)
+    {
+      joint.computeExpectations(l, p, values, substitutionsForCurrentNode);
+    }
+    for (size_t i = 0; i < nbDistinctSites; ++i)
+    {
+      for (size_t t = 0; t < nbTypes; ++t)
+      {
+        substitutions->getPatternNumberOfSubstitutions(l, i, t) = substitutionsForCurrentNode[i][t];
+      }
+    }
+  }
+  return substitutions.release();
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,173 @@
+//
+// File: BatchSubstitutionMapping.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 23:50 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BATCHSUBSTITUTIONMAPPING_H_
+#define _BATCHSUBSTITUTIONMAPPING_H_
+
+#include "SubstitutionCount.h"
+#include "ProbabilisticSubstitutionMapping.h"
+#include "../TreeTemplate.h"
+#include "../Likelihood/DRTreeLikelihood.h"
+
+#include <Bpp/Numeric/Prob/DiscreteDistribution.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From the STL:
+#include <vector>
+#include <memory>
+#include <functional>
+
+namespace bpp
+{
+
+/**
+ * @brief Substitution mapping of many alignments sharing the same tree, model and rate distribution.
+ *
+ * The numbers of substitutions for each pair of states only depend on the model and on the length
+ * of each branch times the rate of each class. They are computed once for all branches when this object is built,
+ * and used for all alignments, which then only require their likelihood arrays to be mapped.
+ *
+ * Alignments are mapped on a pool of threads. Each thread maps one alignment at a time,
+ * with its own copy of the model and of the rate distribution,
+ * and each mapping is given to a sink and discarded as soon as it is done.
+ * Alignments may be loaded on demand, so that at most one alignment per thread is held in memory.
+ *
+ * Parameters of the model, rate distribution and branch lengths are not estimated for each alignment.
+ */
+class BatchSubstitutionMapping
+{
+  public:
+    /**
+     * @brief Function giving an alignment, from its index.
+     */
+    typedef std::function<std::shared_ptr<const SiteContainer> (size_t)> AlignmentLoader;
+
+    /**
+     * @brief Function receiving the mapping of an alignment.
+     *
+     * It is called with the index of the alignment, its likelihood and its mapping, which are only valid during the call.
+     * Calls are serialized, but their order does not follow the indices of the alignments when several threads are used.
+     */
+    typedef std::function<void (size_t, const DRTreeLikelihood&, const ProbabilisticSubstitutionMapping&)> MappingSink;
+
+  private:
+    std::unique_ptr< TreeTemplate<Node> > tree_;
+    std::unique_ptr<SubstitutionModel> model_;
+    std::unique_ptr<DiscreteDistribution> rDist_;
+    std::unique_ptr<SubstitutionCount> substitutionCount_;
+    std::vector<int> nodeIds_;
+    /**
+     * @brief The numbers of substitutions as counts_[l][c][t](x, y), for branch l, rate class c and type t.
+     */
+    std::vector< std::vector< std::vector< RowMatrix<double> > > > counts_;
+
+  public:
+    /**
+     * @brief Compute the numbers of substitutions on all branches.
+     *
+     * @param tree              The tree, with branch lengths. It is copied.
+     * @param model             The substitution model. It is copied.
+     * @param rDist             The rate distribution. It is copied.
+     * @param substitutionCount The SubstitutionCount to use. It is copied.
+     * @param verbose           Display a progress gauge.
+     * @throw Exception If a branch has no length.
+     */
+    BatchSubstitutionMapping(
+      const Tree& tree,
+      const SubstitutionModel& model,
+      const DiscreteDistribution& rDist,
+      const SubstitutionCount& substitutionCount,
+      bool verbose = true) throw (Exception);
+
+    virtual ~BatchSubstitutionMapping() {}
+
+  private:
+    BatchSubstitutionMapping(const BatchSubstitutionMapping&);
+    BatchSubstitutionMapping& operator=(const BatchSubstitutionMapping&);
+
+  public:
+    const Tree& getTree() const { return *tree_; }
+    const SubstitutionCount& getSubstitutionCount() const { return *substitutionCount_; }
+    size_t getNumberOfBranches() const { return nodeIds_.size(); }
+    size_t getNumberOfSubstitutionTypes() const { return substitutionCount_->getNumberOfSubstitutionTypes(); }
+
+    /**
+     * @brief Map a set of alignments, loaded on demand.
+     *
+     * @param nbAlignments The number of alignments.
+     * @param loader       The function giving each alignment. It is called once for each alignment, possibly concurrently.
+     *                     The alignment is released as soon as the likelihood object has read it.
+     * @param sink         The function receiving each mapping.
+     * @param nbThreads    The number of threads to use (0 to use the number of available cores).
+     * @param verbose      Display a progress gauge.
+     * @throw Exception If an alignment can not be mapped, for instance because its sequences do not match the tree.
+     * Remaining alignments are then not mapped.
+     */
+    void mapAlignments(
+      size_t nbAlignments,
+      const AlignmentLoader& loader,
+      const MappingSink& sink,
+      unsigned int nbThreads = 1,
+      bool verbose = true) const throw (Exception);
+
+    /**
+     * @brief Map a set of alignments already in memory.
+     *
+     * @param alignments The alignments.
+     * @param sink       The function receiving each mapping.
+     * @param nbThreads  The number of threads to use (0 to use the number of available cores).
+     * @param verbose    Display a progress gauge.
+     * @throw Exception If an alignment can not be mapped.
+     */
+    void mapAlignments(
+      const std::vector<const SiteContainer*>& alignments,
+      const MappingSink& sink,
+      unsigned int nbThreads = 1,
+      bool verbose = true) const throw (Exception);
+
+  private:
+    /**
+     * @brief Compute the mapping of the data of an initialized likelihood object.
+     */
+    ProbabilisticSubstitutionMapping* map_(const DRTreeLikelihood& drtl) const throw (Exception);
+};
+
+} // end of namespace bpp.
+
+#endif // _BATCHSUBSTITUTIONMAPPING_H_
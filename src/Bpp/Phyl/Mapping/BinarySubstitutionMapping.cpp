@@ -0,0 +1,509 @@
+//
+// File: BinarySubstitutionMapping.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 21:10 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BinarySubstitutionMapping.h"
+
+#include "../TreeTemplate.h"
+
+#include <Bpp/Text/TextTools.h>
+
+// From the STL:
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <stdint.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BPP_BINARYMAPPING_USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+// Little-endian encoding, independent of the platform:
+namespace
+{
+  void putUInt32(string& s, uint32_t x)
+  {
+    for (size_t k = 0; k < 4; ++k)
+      s.push_back(static_cast<char>((x >> (8 * k)) & 0xFF));
+  }
+
+  void putUInt64(string& s, uint64_t x)
+  {
+    for (size_t k = 0; k < 8; ++k)
+      s.push_back(static_cast<char>((x >> (8 * k)) & 0xFF));
+  }
+
+  void putInt32(string& s, int x)
+  {
+    putUInt32(s, static_cast<uint32_t>(static_cast<int32_t>(x)));
+  }
+
+  void putDouble(string& s, double x)
+  {
+    uint64_t u;
+    memcpy(&u, &x, sizeof(u));
+    putUInt64(s, u);
+  }
+
+  void putFloat(string& s, float x)
+  {
+    uint32_t u;
+    memcpy(&u, &x, sizeof(u));
+    putUInt32(s, u);
+  }
+
+  uint32_t getUInt32(const unsigned char* p)
+  {
+    uint32_t x = 0;
+    for (size_t k = 0; k < 4; ++k)
+      x |= static_cast<uint32_t>(p[k]) << (8 * k);
+    return x;
+  }
+
+  uint64_t getUInt64(const unsigned char* p)
+  {
+    uint64_t x = 0;
+    for (size_t k = 0; k < 8; ++k)
+      x |= static_cast<uint64_t>(p[k]) << (8 * k);
+    return x;
+  }
+
+  int getInt32(const unsigned char* p)
+  {
+    return static_cast<int>(static_cast<int32_t>(getUInt32(p)));
+  }
+
+  double getDouble(const unsigned char* p)
+  {
+    uint64_t u = getUInt64(p);
+    double x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+  }
+
+  float getFloat(const unsigned char* p)
+  {
+    uint32_t u = getUInt32(p);
+    float x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+  }
+}
+
+/******************************************************************************/
+
+const string BinarySubstitutionMappingFormat::MAGIC = "BPPSMAP1";
+
+size_t BinarySubstitutionMappingFormat::getHeaderSize(size_t nbBranches, size_t nbSites)
+{
+  size_t size = 8 + 4 + 4 + 3 * 8 + nbBranches * (4 + 8) + nbSites * 4;
+  return (size + 7) / 8 * 8;
+}
+
+/******************************************************************************/
+
+BinarySubstitutionMappingWriter::BinarySubstitutionMappingWriter(
+  ostream& out,
+  const vector<int>& nodeIds,
+  const vector<double>& branchLengths,
+  const vector<int>& sitePositions,
+  size_t nbTypes,
+  bool doublePrecision)
+throw (Exception) :
+  out_(&out),
+  nbBranches_(nodeIds.size()),
+  nbSites_(sitePositions.size()),
+  nbTypes_(nbTypes),
+  doublePrecision_(doublePrecision),
+  nextBranch_(0),
+  pending_(),
+  mutex_()
+{
+  if (branchLengths.size() != nbBranches_)
+    throw Exception("BinarySubstitutionMappingWriter (constructor). There should be one length per branch.");
+  writeHeader_(nodeIds, branchLengths, sitePositions);
+}
+
+BinarySubstitutionMappingWriter::BinarySubstitutionMappingWriter(
+  ostream& out,
+  const Tree& tree,
+  const SiteContainer& sites,
+  size_t nbTypes,
+  bool doublePrecision)
+throw (Exception) :
+  out_(&out),
+  nbBranches_(0),
+  nbSites_(sites.getNumberOfSites()),
+  nbTypes_(nbTypes),
+  doublePrecision_(doublePrecision),
+  nextBranch_(0),
+  pending_(),
+  mutex_()
+{
+  TreeTemplate<Node> ttree(tree);
+  vector<Node*> nodes = ttree.getNodes();
+  nodes.pop_back(); // Remove root node, as in AbstractMapping.
+  nbBranches_ = nodes.size();
+  vector<int> nodeIds(nbBranches_);
+  vector<double> branchLengths(nbBranches_);
+  for (size_t j = 0; j < nbBranches_; ++j)
+  {
+    nodeIds[j] = nodes[j]->getId();
+    branchLengths[j] = nodes[j]->hasDistanceToFather() ? nodes[j]->getDistanceToFather() : 0.;
+  }
+  vector<int> sitePositions(nbSites_);
+  for (size_t i = 0; i < nbSites_; ++i)
+  {
+    sitePositions[i] = sites.getSite(i).getPosition();
+  }
+  writeHeader_(nodeIds, branchLengths, sitePositions);
+}
+
+BinarySubstitutionMappingWriter::BinarySubstitutionMappingWriter(
+  ostream& out,
+  const ProbabilisticSubstitutionMapping& mapping,
+  bool doublePrecision)
+throw (Exception) :
+  out_(&out),
+  nbBranches_(mapping.getNumberOfBranches()),
+  nbSites_(mapping.getNumberOfSites()),
+  nbTypes_(mapping.getNumberOfSubstitutionTypes()),
+  doublePrecision_(doublePrecision),
+  nextBranch_(0),
+  pending_(),
+  mutex_()
+{
+  vector<int> nodeIds(nbBranches_);
+  vector<double> branchLengths(nbBranches_);
+  for (size_t j = 0; j < nbBranches_; ++j)
+  {
+    const Node* node = mapping.getNode(j);
+    nodeIds[j] = node->getId();
+    branchLengths[j] = node->hasDistanceToFather() ? node->getDistanceToFather() : 0.;
+  }
+  vector<int> sitePositions(nbSites_);
+  for (size_t i = 0; i < nbSites_; ++i)
+  {
+    sitePositions[i] = mapping.getSitePosition(i);
+  }
+  writeHeader_(nodeIds, branchLengths, sitePositions);
+}
+
+/******************************************************************************/
+
+void BinarySubstitutionMappingWriter::writeHeader_(
+  const vector<int>& nodeIds,
+  const vector<double>& branchLengths,
+  const vector<int>& sitePositions)
+throw (IOException)
+{
+  if (!*out_)
+    throw IOException("BinarySubstitutionMappingWriter::writeHeader_. Can't write to stream.");
+  string header = BinarySubstitutionMappingFormat::MAGIC;
+  putUInt32(header, doublePrecision_ ? 8 : 4);
+  putUInt32(header, 0);
+  putUInt64(header, static_cast<uint64_t>(nbBranches_));
+  putUInt64(header, static_cast<uint64_t>(nbSites_));
+  putUInt64(header, static_cast<uint64_t>(nbTypes_));
+  for (size_t j = 0; j < nbBranches_; ++j)
+  {
+    putInt32(header, nodeIds[j]);
+  }
+  for (size_t j = 0; j < nbBranches_; ++j)
+  {
+    putDouble(header, branchLengths[j]);
+  }
+  for (size_t i = 0; i < nbSites_; ++i)
+  {
+    putInt32(header, sitePositions[i]);
+  }
+  header.resize(BinarySubstitutionMappingFormat::getHeaderSize(nbBranches_, nbSites_), 0);
+  out_->write(header.data(), static_cast<streamsize>(header.size()));
+  out_->flush();
+  if (!*out_)
+    throw IOException("BinarySubstitutionMappingWriter::writeHeader_. Error while writing the header.");
+}
+
+/******************************************************************************/
+
+void BinarySubstitutionMappingWriter::writeBranch(size_t branchIndex, const vector< vector<double> >& values) throw (Exception)
+{
+  if (values.size() != nbTypes_)
+    throw Exception("BinarySubstitutionMappingWriter::writeBranch. There should be one vector of values per substitution type.");
+  string block;
+  block.reserve(nbTypes_ * nbSites_ * (doublePrecision_ ? 8 : 4));
+  for (size_t t = 0; t < nbTypes_; ++t)
+  {
+    if (values[t].size() != nbSites_)
+      throw Exception("BinarySubstitutionMappingWriter::writeBranch. There should be one value per site.");
+    for (size_t i = 0; i < nbSites_; ++i)
+    {
+      if (doublePrecision_)
+        putDouble(block, values[t][i]);
+      else
+        putFloat(block, static_cast<float>(values[t][i]));
+    }
+  }
+  commitBranch_(branchIndex, block);
+}
+
+void BinarySubstitutionMappingWriter::writeBranch(size_t branchIndex, const ProbabilisticSubstitutionMapping& mapping) throw (Exception)
+{
+  if (mapping.getNumberOfSites() != nbSites_ || mapping.getNumberOfSubstitutionTypes() != nbTypes_)
+    throw Exception("BinarySubstitutionMappingWriter::writeBranch. The mapping does not match the header.");
+  if (branchIndex >= mapping.getNumberOfBranches())
+    throw IndexOutOfBoundsException("BinarySubstitutionMappingWriter::writeBranch.", branchIndex, 0, mapping.getNumberOfBranches() - 1);
+  string block;
+  block.reserve(nbTypes_ * nbSites_ * (doublePrecision_ ? 8 : 4));
+  for (size_t t = 0; t < nbTypes_; ++t)
+  {
+    for (size_t i = 0; i < nbSites_; ++i)
+    {
+      if (doublePrecision_)
+        putDouble(block, mapping(branchIndex, i, t));
+      else
+        putFloat(block, static_cast<float>(mapping(branchIndex, i, t)));
+    }
+  }
+  commitBranch_(branchIndex, block);
+}
+
+/******************************************************************************/
+
+void BinarySubstitutionMappingWriter::commitBranch_(size_t branchIndex, string& block) throw (Exception)
+{
+  if (branchIndex >= nbBranches_)
+    throw IndexOutOfBoundsException("BinarySubstitutionMappingWriter::writeBranch.", branchIndex, 0, nbBranches_ - 1);
+  lock_guard<mutex> lock(mutex_);
+  if (branchIndex < nextBranch_ || pending_.find(branchIndex) != pending_.end())
+    throw Exception("BinarySubstitutionMappingWriter::writeBranch. Branch " + TextTools::toString(branchIndex) + " has already been written.");
+  if (branchIndex != nextBranch_)
+  {
+    // Keep this branch until all previous ones are written:
+    pending_[branchIndex].swap(block);
+    return;
+  }
+  out_->write(block.data(), static_cast<streamsize>(block.size()));
+  nextBranch_++;
+  map<size_t, string>::iterator it;
+  while ((it = pending_.find(nextBranch_)) != pending_.end())
+  {
+    out_->write(it->second.data(), static_cast<streamsize>(it->second.size()));
+    pending_.erase(it);
+    nextBranch_++;
+  }
+  out_->flush();
+  if (!*out_)
+    throw IOException("BinarySubstitutionMappingWriter::writeBranch. Error while writing branch " + TextTools::toString(branchIndex) + ".");
+}
+
+/******************************************************************************/
+
+BinarySubstitutionMappingReader::BinarySubstitutionMappingReader(const string& path) throw (IOException) :
+  data_(0),
+  size_(0),
+  mappedData_(0),
+  buffer_(),
+  valueSize_(0),
+  nbBranches_(0),
+  nbSites_(0),
+  nbTypes_(0),
+  dataOffset_(0),
+  nodeIds_(),
+  branchLengths_(),
+  sitePositions_()
+{
+#ifdef BPP_BINARYMAPPING_USE_MMAP
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw IOException("BinarySubstitutionMappingReader. Can't open file " + path + ".");
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    close(fd);
+    throw IOException("BinarySubstitutionMappingReader. Can't read file " + path + ".");
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ > 0)
+  {
+    void* p = mmap(0, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (p != MAP_FAILED)
+    {
+      mappedData_ = p;
+      data_ = static_cast<const unsigned char*>(p);
+    }
+  }
+  close(fd);
+#endif
+  if (!data_)
+  {
+    // No memory mapping, the file is loaded at once:
+    ifstream in(path.c_str(), ios::in | ios::binary);
+    if (!in)
+      throw IOException("BinarySubstitutionMappingReader. Can't open file " + path + ".");
+    buffer_.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    size_ = buffer_.size();
+    data_ = buffer_.size() > 0 ? &buffer_[0] : 0;
+  }
+
+  try
+  {
+    size_t magicSize = BinarySubstitutionMappingFormat::MAGIC.size();
+    if (size_ < magicSize + 32 || memcmp(data_, BinarySubstitutionMappingFormat::MAGIC.data(), magicSize) != 0)
+      throw IOException("BinarySubstitutionMappingReader. File " + path + " is not a binary substitution mapping.");
+    const unsigned char* p = data_ + magicSize;
+    valueSize_  = getUInt32(p);
+    nbBranches_ = static_cast<size_t>(getUInt64(p + 8));
+    nbSites_    = static_cast<size_t>(getUInt64(p + 16));
+    nbTypes_    = static_cast<size_t>(getUInt64(p + 24));
+    if (valueSize_ != 4 && valueSize_ != 8)
+      throw IOException("BinarySubstitutionMappingReader. Unsupported value size in file " + path + ".");
+    // Counts are checked against the size of the file before anything is allocated,
+    // and without products that could overflow:
+    size_t remaining = size_ - (magicSize + 32);
+    if (nbBranches_ > remaining / (4 + 8))
+      throw IOException("BinarySubstitutionMappingReader. File " + path + " is truncated.");
+    remaining -= nbBranches_ * (4 + 8);
+    if (nbSites_ > remaining / 4)
+      throw IOException("BinarySubstitutionMappingReader. File " + path + " is truncated.");
+    dataOffset_ = BinarySubstitutionMappingFormat::getHeaderSize(nbBranches_, nbSites_);
+    if (size_ < dataOffset_)
+      throw IOException("BinarySubstitutionMappingReader. File " + path + " is truncated.");
+    if (nbBranches_ > 0 && nbSites_ > 0 && (size_ - dataOffset_) / valueSize_ / nbSites_ / nbBranches_ < nbTypes_)
+      throw IOException("BinarySubstitutionMappingReader. File " + path + " is truncated.");
+
+    p += 32;
+    nodeIds_.resize(nbBranches_);
+    for (size_t j = 0; j < nbBranches_; ++j, p += 4)
+    {
+      nodeIds_[j] = getInt32(p);
+    }
+    branchLengths_.resize(nbBranches_);
+    for (size_t j = 0; j < nbBranches_; ++j, p += 8)
+    {
+      branchLengths_[j] = getDouble(p);
+    }
+    sitePositions_.resize(nbSites_);
+    for (size_t i = 0; i < nbSites_; ++i, p += 4)
+    {
+      sitePositions_[i] = getInt32(p);
+    }
+  }
+  catch (IOException& e)
+  {
+#ifdef BPP_BINARYMAPPING_USE_MMAP
+    if (mappedData_)
+      munmap(mappedData_, size_);
+#endif
+    throw;
+  }
+}
+
+BinarySubstitutionMappingReader::~BinarySubstitutionMappingReader()
+{
+#ifdef BPP_BINARYMAPPING_USE_MMAP
+  if (mappedData_)
+    munmap(mappedData_, size_);
+#endif
+}
+
+/******************************************************************************/
+
+double BinarySubstitutionMappingReader::readValue_(const unsigned char* p) const
+{
+  if (valueSize_ == 8)
+    return getDouble(p);
+  else
+    return static_cast<double>(getFloat(p));
+}
+
+/******************************************************************************/
+
+void BinarySubstitutionMappingReader::getValues(size_t branchIndex, size_t type, vector<double>& values) const throw (IndexOutOfBoundsException)
+{
+  if (branchIndex >= nbBranches_)
+    throw IndexOutOfBoundsException("BinarySubstitutionMappingReader::getValues. Bad branch index.", branchIndex, 0, nbBranches_ - 1);
+  if (type >= nbTypes_)
+    throw IndexOutOfBoundsException("BinarySubstitutionMappingReader::getValues. Bad substitution type.", type, 0, nbTypes_ - 1);
+  values.resize(nbSites_);
+  const unsigned char* p = getBlock_(branchIndex, type);
+  for (size_t i = 0; i < nbSites_; ++i, p += valueSize_)
+  {
+    values[i] = readValue_(p);
+  }
+}
+
+/******************************************************************************/
+
+void BinarySubstitutionMappingReader::fillMapping(ProbabilisticSubstitutionMapping& mapping) const throw (Exception)
+{
+  if (mapping.getNumberOfBranches() != nbBranches_)
+    throw Exception("BinarySubstitutionMappingReader::fillMapping. The number of branches does not match the file.");
+  if (mapping.getNumberOfSubstitutionTypes() != nbTypes_)
+    throw Exception("BinarySubstitutionMappingReader::fillMapping. The number of substitution types does not match the file.");
+  for (size_t j = 0; j < nbBranches_; ++j)
+  {
+    if (mapping.getNode(j)->getId() != nodeIds_[j])
+      throw Exception("BinarySubstitutionMappingReader::fillMapping. Branch " + TextTools::toString(j) + " does not match the file.");
+  }
+  mapping.setNumberOfSites(nbSites_);
+  for (size_t i = 0; i < nbSites_; ++i)
+  {
+    mapping.setSitePosition(i, sitePositions_[i]);
+  }
+  for (size_t j = 0; j < nbBranches_; ++j)
+  {
+    for (size_t t = 0; t < nbTypes_; ++t)
+    {
+      const unsigned char* p = getBlock_(j, t);
+      for (size_t i = 0; i < nbSites_; ++i, p += valueSize_)
+      {
+        mapping(j, i, t) = readValue_(p);
+      }
+    }
+  }
+}
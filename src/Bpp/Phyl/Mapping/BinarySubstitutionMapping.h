@@ -0,0 +1,304 @@
+//
+// File: BinarySubstitutionMapping.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 21:10 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BINARYSUBSTITUTIONMAPPING_H_
+#define _BINARYSUBSTITUTIONMAPPING_H_
+
+#include "ProbabilisticSubstitutionMapping.h"
+
+#include <Bpp/Exceptions.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From the STL:
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+namespace bpp
+{
+
+/**
+ * @brief Binary, column-oriented file format for substitution mappings.
+ *
+ * All numbers are stored in little-endian order, whatever the platform.
+ * A file starts with a header:
+ * - the magic string "BPPSMAP1" (8 bytes),
+ * - the size of the stored values, 4 (float) or 8 (double), as a 32 bits integer,
+ * - 4 bytes of padding,
+ * - the number of branches, sites and substitution types, as 64 bits integers,
+ * - the id of the node of each branch, as 32 bits integers,
+ * - the length of each branch, as doubles,
+ * - the position of each site, as 32 bits integers,
+ * - padding to a multiple of 8 bytes.
+ *
+ * Values then follow branch by branch, and for each branch type by type, as one block with the value of each site.
+ * The block of branch b and type t hence starts at offset header + (b * nbTypes + t) * nbSites * valueSize.
+ */
+class BinarySubstitutionMappingFormat
+{
+  public:
+    static const std::string MAGIC;
+
+  public:
+    /**
+     * @return The size in bytes of the header of a file with the given dimensions.
+     */
+    static size_t getHeaderSize(size_t nbBranches, size_t nbSites);
+};
+
+/**
+ * @brief Write a substitution mapping in the binary format, branch by branch.
+ *
+ * The header is written at construction, and each branch is written to the stream as soon as it is given,
+ * so that the whole mapping never has to be stored.
+ * Branches may be given in any order and from several threads:
+ * a branch given before the previous ones is kept until they are written.
+ *
+ * @see BinarySubstitutionMappingFormat
+ */
+class BinarySubstitutionMappingWriter
+{
+  private:
+    std::ostream* out_;
+    size_t nbBranches_;
+    size_t nbSites_;
+    size_t nbTypes_;
+    bool doublePrecision_;
+    size_t nextBranch_;
+    std::map<size_t, std::string> pending_;
+    std::mutex mutex_;
+
+  public:
+    /**
+     * @param out             The output stream, which must remain valid until all branches are written.
+     * @param nodeIds         The id of the node of each branch.
+     * @param branchLengths   The length of each branch.
+     * @param sitePositions   The position of each site.
+     * @param nbTypes         The number of substitution types.
+     * @param doublePrecision Store values as doubles instead of floats.
+     * @throw IOException If an output error happens.
+     */
+    BinarySubstitutionMappingWriter(
+      std::ostream& out,
+      const std::vector<int>& nodeIds,
+      const std::vector<double>& branchLengths,
+      const std::vector<int>& sitePositions,
+      size_t nbTypes,
+      bool doublePrecision = false)
+    throw (Exception);
+
+    /**
+     * @brief Write the header for the branches of a tree and the sites of a dataset.
+     *
+     * Branches are taken in the same order as in the mappings built on this tree,
+     * so that this writer can be given to SubstitutionMappingTools::computeSubstitutionVectors.
+     *
+     * @param out             The output stream, which must remain valid until all branches are written.
+     * @param tree            The tree to take the branches from.
+     * @param sites           The dataset to take the site positions from.
+     * @param nbTypes         The number of substitution types.
+     * @param doublePrecision Store values as doubles instead of floats.
+     * @throw IOException If an output error happens.
+     */
+    BinarySubstitutionMappingWriter(
+      std::ostream& out,
+      const Tree& tree,
+      const SiteContainer& sites,
+      size_t nbTypes,
+      bool doublePrecision = false)
+    throw (Exception);
+
+    /**
+     * @brief Write the header for the branches and sites of a mapping.
+     *
+     * @param out             The output stream, which must remain valid until all branches are written.
+     * @param mapping         The mapping to take the branches and sites from.
+     * @param doublePrecision Store values as doubles instead of floats.
+     * @throw IOException If an output error happens.
+     */
+    BinarySubstitutionMappingWriter(
+      std::ostream& out,
+      const ProbabilisticSubstitutionMapping& mapping,
+      bool doublePrecision = false)
+    throw (Exception);
+
+    virtual ~BinarySubstitutionMappingWriter() {}
+
+  private:
+    BinarySubstitutionMappingWriter(const BinarySubstitutionMappingWriter&);
+    BinarySubstitutionMappingWriter& operator=(const BinarySubstitutionMappingWriter&);
+
+  public:
+    size_t getNumberOfBranches() const { return nbBranches_; }
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfSubstitutionTypes() const { return nbTypes_; }
+
+    /**
+     * @brief Write the values of one branch.
+     *
+     * @param branchIndex The index of the branch, as in the header.
+     * @param values      The values of the branch, as values[type][site].
+     * @throw IOException If an output error happens.
+     */
+    void writeBranch(size_t branchIndex, const std::vector< std::vector<double> >& values) throw (Exception);
+
+    /**
+     * @brief Write the values of one branch of a mapping.
+     *
+     * Compressed mappings are read by site pattern, without being expanded.
+     *
+     * @param branchIndex The index of the branch, in the mapping and in the header.
+     * @param mapping     The mapping to read the values from.
+     * @throw IOException If an output error happens.
+     */
+    void writeBranch(size_t branchIndex, const ProbabilisticSubstitutionMapping& mapping) throw (Exception);
+
+    /**
+     * @return True if all branches have been written.
+     */
+    bool isComplete() const { return nextBranch_ == nbBranches_; }
+
+  private:
+    void writeHeader_(
+      const std::vector<int>& nodeIds,
+      const std::vector<double>& branchLengths,
+      const std::vector<int>& sitePositions)
+    throw (IOException);
+
+    void commitBranch_(size_t branchIndex, std::string& block) throw (Exception);
+};
+
+/**
+ * @brief Read a substitution mapping in the binary format.
+ *
+ * The file is mapped in memory when the platform allows it, so that only the blocks which are accessed are actually read.
+ * It is otherwise loaded at once.
+ *
+ * @see BinarySubstitutionMappingFormat
+ */
+class BinarySubstitutionMappingReader
+{
+  private:
+    const unsigned char* data_;
+    size_t size_;
+    void* mappedData_;
+    std::vector<unsigned char> buffer_;
+    size_t valueSize_;
+    size_t nbBranches_;
+    size_t nbSites_;
+    size_t nbTypes_;
+    size_t dataOffset_;
+    std::vector<int> nodeIds_;
+    std::vector<double> branchLengths_;
+    std::vector<int> sitePositions_;
+
+  public:
+    /**
+     * @param path The path of the file to read.
+     * @throw IOException If the file can't be read or is not in the binary format.
+     */
+    BinarySubstitutionMappingReader(const std::string& path) throw (IOException);
+
+    virtual ~BinarySubstitutionMappingReader();
+
+  private:
+    BinarySubstitutionMappingReader(const BinarySubstitutionMappingReader&);
+    BinarySubstitutionMappingReader& operator=(const BinarySubstitutionMappingReader&);
+
+  public:
+    size_t getNumberOfBranches() const { return nbBranches_; }
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfSubstitutionTypes() const { return nbTypes_; }
+
+    /**
+     * @return True if values are stored as doubles, false if they are stored as floats.
+     */
+    bool isDoublePrecision() const { return valueSize_ == 8; }
+
+    const std::vector<int>& getNodeIds() const { return nodeIds_; }
+    const std::vector<double>& getBranchLengths() const { return branchLengths_; }
+    const std::vector<int>& getSitePositions() const { return sitePositions_; }
+
+    /**
+     * @return The value of a site for a given branch and type.
+     *
+     * @warning No index checking is performed, use with care!
+     */
+    double getValue(size_t branchIndex, size_t siteIndex, size_t type) const
+    {
+      return readValue_(getBlock_(branchIndex, type) + siteIndex * valueSize_);
+    }
+
+    /**
+     * @brief Get the values of all sites for a given branch and type.
+     *
+     * @param branchIndex The index of the branch.
+     * @param type        The type of substitutions.
+     * @param values      [out] The value of each site.
+     * @throw IndexOutOfBoundsException If the branch or type is not in the file.
+     */
+    void getValues(size_t branchIndex, size_t type, std::vector<double>& values) const throw (IndexOutOfBoundsException);
+
+    /**
+     * @brief Copy all values to a mapping.
+     *
+     * The mapping must have the same branches and substitution types as the file.
+     * Its number of sites and site positions are set from the file.
+     *
+     * @param mapping The mapping to fill.
+     * @throw Exception If the mapping does not match the file.
+     */
+    void fillMapping(ProbabilisticSubstitutionMapping& mapping) const throw (Exception);
+
+  private:
+    const unsigned char* getBlock_(size_t branchIndex, size_t type) const
+    {
+      return data_ + dataOffset_ + (branchIndex * nbTypes_ + type) * nbSites_ * valueSize_;
+    }
+
+    double readValue_(const unsigned char* p) const;
+};
+
+} // end of namespace bpp.
+
+#endif // _BINARYSUBSTITUTIONMAPPING_H_
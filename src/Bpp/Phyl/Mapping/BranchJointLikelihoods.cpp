@@ -0,0 +1,229 @@
+//
+// File: BranchJointLikelihoods.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 23:15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BranchJointLikelihoods.h"
+#include "../TreeTemplate.h"
+
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <memory>
+
+using namespace std;
+
+/******************************************************************************/
+
+BranchJointLikelihoods::BranchJointLikelihoods(
+  const DRTreeLikelihood& drtl,
+  const vector<int>& nodeIds) throw (Exception) :
+  drtl_(&drtl),
+  nbPatterns_(0),
+  nbClasses_(0),
+  nbStates_(0),
+  rates_(),
+  probabilities_(),
+  siteLikelihoods_(),
+  branches_()
+{
+  if (!drtl.isInitialized())
+    throw Exception("BranchJointLikelihoods::BranchJointLikelihoods(). Likelihood object is not initialized.");
+
+  const TreeTemplate<Node> tree(drtl.getTree());
+  const DiscreteDistribution* rDist = drtl.getRateDistribution();
+
+  nbPatterns_    = drtl.getLikelihoodData()->getNumberOfDistinctSites();
+  nbClasses_     = rDist->getNumberOfCategories();
+  nbStates_      = drtl.getData()->getAlphabet()->getSize();
+  rates_         = rDist->getCategories();
+  probabilities_ = rDist->getProbabilities();
+  vector<const Node*> nodes = tree.getNodes();
+  nodes.pop_back(); // Remove root node.
+  size_t nbNodes = nodes.size();
+
+  // Store likelihood for each site:
+  VVVdouble lik;
+  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
+  siteLikelihoods_.resize(nbPatterns_);
+  for (size_t i = 0; i < nbPatterns_; i++)
+  {
+    VVdouble* lik_i = &lik[i];
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      Vdouble* lik_i_c = &(*lik_i)[c];
+      double rc = probabilities_[c];
+      for (size_t s = 0; s < nbStates_; s++)
+      {
+        siteLikelihoods_[i] += (*lik_i_c)[s] * rc;
+      }
+    }
+  }
+
+  branches_.resize(nbNodes);
+  for (size_t l = 0; l < nbNodes; ++l)
+  {
+    const Node* node = nodes[l];
+    Branch_& branch = branches_[l];
+    branch.nodeId = node->getId();
+    branch.length = node->getDistanceToFather();
+    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, node->getId()))
+      continue;
+
+    // The double-recursive arrays already hold the likelihood of both sides of the branch:
+    int fatherId = node->getFather()->getId();
+    branch.fatherLikelihoods = &drtl.getLikelihoodData()->getLikelihoodArray(node->getId(), fatherId);
+    branch.sonLikelihoods    = &drtl.getLikelihoodData()->getLikelihoodArray(fatherId, node->getId());
+
+    // Iterate over all site partitions:
+    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(node->getId()));
+    while (mit->hasNext())
+    {
+      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
+      Partition partition;
+      partition.model = bmd->getSubstitutionModel();
+      partition.pxy   = &drtl.getTransitionProbabilitiesArray(node->getId());
+      unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
+      while (sit->hasNext())
+      {
+        partition.patterns.push_back(sit->next());
+      }
+      if (partition.patterns.size() > 0)
+        branch.partitions.push_back(partition);
+    }
+    branch.computed = true;
+  }
+}
+
+/******************************************************************************/
+
+size_t BranchJointLikelihoods::getBranchIndex(int nodeId) const throw (NodeNotFoundException)
+{
+  for (size_t b = 0; b < branches_.size(); ++b)
+  {
+    if (branches_[b].nodeId == nodeId)
+      return b;
+  }
+  throw NodeNotFoundException("BranchJointLikelihoods::getBranchIndex.", TextTools::toString(nodeId));
+}
+
+/******************************************************************************/
+
+void BranchJointLikelihoods::computeExpectations(
+  size_t branchIndex,
+  size_t partitionIndex,
+  const vector< vector<const Matrix<double>*> >& values,
+  VVdouble& expectations) const
+{
+  const Branch_& branch = branches_[branchIndex];
+  const Partition& partition = branch.partitions[partitionIndex];
+  size_t nbValues = values.size() > 0 ? values[0].size() : 0;
+  const VVVdouble* pxy = partition.pxy;
+  vector<double> sums(nbValues);
+
+  // Values are copied once, so that they are read contiguously for all patterns:
+  size_t nbPairs = nbStates_ * nbStates_;
+  vector<double> flatValues(nbClasses_ * nbPairs * nbValues);
+  for (size_t c = 0; c < nbClasses_; ++c)
+  {
+    for (size_t t = 0; t < nbValues; ++t)
+    {
+      const Matrix<double>* values_c_t = values[c][t];
+      for (size_t x = 0; x < nbStates_; ++x)
+      {
+        for (size_t y = 0; y < nbStates_; ++y)
+        {
+          flatValues[(c * nbPairs + x * nbStates_ + y) * nbValues + t] = (*values_c_t)(x, y);
+        }
+      }
+    }
+  }
+
+  // We first average upon 'y' to save computations, and then upon 'x'.
+  // ('y' is the state at 'node' and 'x' the state at 'father'.)
+  for (size_t k = 0; k < partition.patterns.size(); ++k)
+  {
+    size_t i = partition.patterns[k];
+    sums.assign(nbValues, 0.);
+    const VVdouble* likelihoodsFather_node_i = &(*branch.sonLikelihoods)[i];
+    const VVdouble* likelihoodsFatherConstantPart_i = &(*branch.fatherLikelihoods)[i];
+    for (size_t c = 0; c < nbClasses_; ++c)
+    {
+      const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
+      const Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+      double rc = probabilities_[c];
+      const VVdouble* pxy_c = &(*pxy)[c];
+      const double* values_c = &flatValues[c * nbPairs * nbValues];
+      for (size_t x = 0; x < nbStates_; ++x)
+      {
+        double likelihoodsFatherConstantPart_i_c_x = rc * (*likelihoodsFatherConstantPart_i_c)[x];
+        const Vdouble* pxy_c_x = &(*pxy_c)[x];
+        for (size_t y = 0; y < nbStates_; ++y)
+        {
+          double likelihood_cxy = likelihoodsFatherConstantPart_i_c_x
+                                  * (*pxy_c_x)[y]
+                                  * (*likelihoodsFather_node_i_c)[y];
+
+          const double* values_c_xy = values_c + (x * nbStates_ + y) * nbValues;
+          for (size_t t = 0; t < nbValues; ++t)
+          {
+            // Now the vector computation:
+            sums[t] += likelihood_cxy * values_c_xy[t];
+            //         <------------>   <------------>
+            // Posterior probability         |               |
+            // for site i and rate class c * |               |
+            // likelihood for this site------+               |
+            //                                               |
+            // Function value for rate class c---------------+
+          }
+        }
+      }
+    }
+
+    // Now we just have to average over the site likelihood:
+    vector<double>& expectations_i = expectations[i];
+    expectations_i.resize(nbValues);
+    for (size_t t = 0; t < nbValues; ++t)
+    {
+      expectations_i[t] = sums[t] / siteLikelihoods_[i];
+    }
+  }
+}
+
+/******************************************************************************/
@@ -0,0 +1,208 @@
+//
+// File: BranchJointLikelihoods.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 23:15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BRANCHJOINTLIKELIHOODS_H_
+#define _BRANCHJOINTLIKELIHOODS_H_
+
+#include "../Likelihood/DRTreeLikelihood.h"
+#include "../TreeExceptions.h"
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Joint likelihoods of the states at both ends of the branches of a tree.
+ *
+ * For a site pattern @f$i@f$, a rate class @f$c@f$ and a branch from node 'father' to node 'son',
+ * the likelihood of the data with state @f$x@f$ at 'father' and state @f$y@f$ at 'son' is
+ * @f$p_c F_{i,c}(x) P_c(x,y) L_{i,c}(y)@f$, where @f$p_c@f$ is the probability of the rate class,
+ * @f$F@f$ the likelihood of the rest of the tree (including the root frequencies),
+ * @f$P@f$ the transition probabilities on the branch,
+ * and @f$L@f$ the likelihood of the subtree defined by 'son'.
+ * Probabilistic mappings average functions of @f$(x,y)@f$ over these joint likelihoods.
+ *
+ * All these arrays are already stored by the double-recursive likelihood object:
+ * @f$F@f$ is the array stored at 'son' for its father, and @f$L@f$ the array stored at 'father' for 'son'.
+ * This class gathers them for a set of branches, together with the likelihood of each site,
+ * so that several mappings (substitution counts with various registers, rewards...) can share them:
+ * see SubstitutionMappingTools::computeSubstitutionVectors and RewardMappingTools::computeRewardVectors.
+ *
+ * Branches are indexed as in the mappings built on the tree of the likelihood object.
+ *
+ * @warning The arrays of the likelihood object are used directly, without being copied:
+ * it must not be modified while this object is in use.
+ */
+class BranchJointLikelihoods
+{
+  public:
+    /**
+     * @brief A set of sites sharing the same model on a branch.
+     */
+    struct Partition
+    {
+      const SubstitutionModel* model;
+      /**
+       * @brief Transition probabilities on the branch, as pxy[c][x][y].
+       */
+      const VVVdouble* pxy;
+      std::vector<size_t> patterns;
+
+      Partition() : model(0), pxy(0), patterns() {}
+    };
+
+  private:
+    struct Branch_
+    {
+      int nodeId;
+      double length;
+      bool computed;
+      const VVVdouble* fatherLikelihoods;
+      const VVVdouble* sonLikelihoods;
+      std::vector<Partition> partitions;
+
+      Branch_() : nodeId(0), length(0), computed(false), fatherLikelihoods(0), sonLikelihoods(0), partitions() {}
+    };
+
+    const DRTreeLikelihood* drtl_;
+    size_t nbPatterns_;
+    size_t nbClasses_;
+    size_t nbStates_;
+    std::vector<double> rates_;
+    std::vector<double> probabilities_;
+    std::vector<double> siteLikelihoods_;
+    std::vector<Branch_> branches_;
+
+  public:
+    /**
+     * @param drtl      A DRTreeLikelihood object, which must be initialized.
+     * @param nodeIds   The ids of the nodes of the branches to compute. If empty, all branches are computed.
+     * @throw Exception If the likelihood object is not initialized.
+     */
+    BranchJointLikelihoods(
+      const DRTreeLikelihood& drtl,
+      const std::vector<int>& nodeIds) throw (Exception);
+
+    virtual ~BranchJointLikelihoods() {}
+
+  private:
+    BranchJointLikelihoods(const BranchJointLikelihoods&);
+    BranchJointLikelihoods& operator=(const BranchJointLikelihoods&);
+
+  public:
+    const DRTreeLikelihood& getLikelihood() const { return *drtl_; }
+
+    size_t getNumberOfBranches() const { return branches_.size(); }
+    size_t getNumberOfPatterns() const { return nbPatterns_; }
+    size_t getNumberOfClasses() const { return nbClasses_; }
+    size_t getNumberOfStates() const { return nbStates_; }
+
+    /**
+     * @return The rate of each rate class.
+     */
+    const std::vector<double>& getRates() const { return rates_; }
+
+    /**
+     * @return The probability of each rate class.
+     */
+    const std::vector<double>& getProbabilities() const { return probabilities_; }
+
+    /**
+     * @return The likelihood of each site pattern.
+     */
+    const std::vector<double>& getSiteLikelihoods() const { return siteLikelihoods_; }
+
+    int getNodeId(size_t branchIndex) const { return branches_[branchIndex].nodeId; }
+    double getBranchLength(size_t branchIndex) const { return branches_[branchIndex].length; }
+
+    /**
+     * @return The index of the branch leading to a node.
+     * @throw NodeNotFoundException If no branch leads to this node.
+     */
+    size_t getBranchIndex(int nodeId) const throw (NodeNotFoundException);
+
+    /**
+     * @return True if the joint likelihoods of this branch have been computed.
+     */
+    bool isComputed(size_t branchIndex) const { return branches_[branchIndex].computed; }
+
+    /**
+     * @return The site partitions of a computed branch.
+     */
+    const std::vector<Partition>& getPartitions(size_t branchIndex) const { return branches_[branchIndex].partitions; }
+
+    /**
+     * @return The likelihood of the rest of the tree for each state of the father node,
+     * as array[i][c][x] for site pattern i and rate class c, for a computed branch.
+     */
+    const VVVdouble& getFatherLikelihoods(size_t branchIndex) const { return *branches_[branchIndex].fatherLikelihoods; }
+
+    /**
+     * @return The likelihood of the subtree defined by the son node for each of its states,
+     * as array[i][c][y] for site pattern i and rate class c, for a computed branch.
+     */
+    const VVVdouble& getSonLikelihoods(size_t branchIndex) const { return *branches_[branchIndex].sonLikelihoods; }
+
+    /**
+     * @brief Compute the posterior expectations of functions of the states at both ends of a branch,
+     * for all site patterns of a partition.
+     *
+     * @param branchIndex    The index of a computed branch.
+     * @param partitionIndex The index of a partition of this branch.
+     * @param values         The functions to average, as values[c][t](x, y) for rate class c and function t,
+     *                       with x the state at the father node and y the state at the son node.
+     * @param expectations   [out] The expectation of each function t for each site pattern i of the partition,
+     *                       as expectations[i][t]. Other site patterns are left unchanged.
+     *                       This array must have one row for each site pattern.
+     */
+    void computeExpectations(
+      size_t branchIndex,
+      size_t partitionIndex,
+      const std::vector< std::vector<const Matrix<double>*> >& values,
+      VVdouble& expectations) const;
+};
+
+} // end of namespace bpp.
+
+#endif // _BRANCHJOINTLIKELIHOODS_H_
@@ -51,8 +51,7 @@ using namespace std;
 DecompositionReward::DecompositionReward(const SubstitutionModel* model, AlphabetIndex1* alphIndex) :
   AbstractReward(alphIndex),
   DecompositionMethods(model),
-  rewards_(nbStates_, nbStates_),
-  currentLength_(-1.)
+  rewards_()
 {
   //Check compatiblity between model and alphabet Index:
   if (typeid(model->getAlphabet()) != typeid(alphIndex_->getAlphabet()))
@@ -62,7 +61,6 @@ DecompositionReward::DecompositionReward(const SubstitutionModel* model, Alphabe
   //unless the number of states changes:
 
   initBMatrices_();
-  initRewards_();
   
   fillBMatrice_();
   computeProducts_();
@@ -70,13 +68,6 @@ DecompositionReward::DecompositionReward(const SubstitutionModel* model, Alphabe
 
 /******************************************************************************/
 
-void DecompositionReward::initRewards_()
-{
-  rewards_.resize(nbStates_, nbStates_);
-}
-
-/******************************************************************************/
-
 void DecompositionReward::fillBMatrice_()
 {
   vector<int> supportedStates = model_->getAlphabetStates();
@@ -86,33 +77,40 @@ void DecompositionReward::fillBMatrice_()
 
 /******************************************************************************/
 
-void DecompositionReward::computeRewards_(double length) const
+void DecompositionReward::computeRewards_(double length, RowMatrix<double>& rewards) const
 {
-  computeExpectations(rewards_, length);
+  rewards.resize(nbStates_, nbStates_);
+  computeExpectations(rewards, length);
 
   // Now we must divide by pijt:
-  RowMatrix<double> P = model_->getPij_t(length);
+  const Matrix<double>& P = model_->getPij_t(length);
   for (size_t j = 0; j < nbStates_; j++) {
     for (size_t k = 0; k < nbStates_; k++) {
-      rewards_(j, k) /= P(j, k);
-      if (std::isnan(rewards_(j, k)))
-        rewards_(j, k) = 0.;
+      rewards(j, k) /= P(j, k);
+      if (std::isnan(rewards(j, k)))
+        rewards(j, k) = 0.;
     }
   }
 }
 
 /******************************************************************************/
 
+const RowMatrix<double>& DecompositionReward::getRewards_(double length) const
+{
+  const RowMatrix<double>* rewards = rewards_.find(length);
+  if (rewards)
+    return *rewards;
+  computeRewards_(length, rewards_.getFreeEntry());
+  return rewards_.commit(length);
+}
+
+/******************************************************************************/
+
 Matrix<double>* DecompositionReward::getAllRewards(double length) const
 {
   if (length < 0)
     throw Exception("DecompositionReward::getAllRewards. Negative branch length: " + TextTools::toString(length) + ".");
-  if (length != currentLength_)
-  {
-    computeRewards_(length);
-    currentLength_ = length;
-  }
-  return new RowMatrix<double>(rewards_);
+  return new RowMatrix<double>(getRewards_(length));
 }
 
 /******************************************************************************/
@@ -121,12 +119,7 @@ double DecompositionReward::getReward(size_t initialState, size_t finalState, do
 {
   if (length < 0)
     throw Exception("DecompositionReward::getRewards. Negative branch length: " + TextTools::toString(length) + ".");
-  if (length != currentLength_)
-  {
-    computeRewards_(length);
-    currentLength_ = length;
-  }
-  return rewards_(initialState, finalState);
+  return getRewards_(length)(initialState, finalState);
 }
 
 /******************************************************************************/
@@ -139,14 +132,11 @@ void DecompositionReward::setSubstitutionModel(const SubstitutionModel* model)
 
   DecompositionMethods::setSubstitutionModel(model);
 
-  initRewards_();
-  
   fillBMatrice_();  
   computeProducts_();
 
-  //Recompute rewards:
-
-  computeRewards_(currentLength_);
+  //Rewards will be recomputed when needed:
+  rewards_.clear();
 }
 
 /******************************************************************************/
@@ -160,9 +150,8 @@ void DecompositionReward::alphabetIndexHasChanged()
   fillBMatrice_();
   computeProducts_();
 
-  //Recompute rewards:
-  if (currentLength_ > 0)
-   computeRewards_(currentLength_);
+  //Rewards will be recomputed when needed:
+  rewards_.clear();
 }
 
 
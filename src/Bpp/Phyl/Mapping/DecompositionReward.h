@@ -43,6 +43,7 @@
 #include "Reward.h"
 
 #include "DecompositionMethods.h"
+#include "LengthCache.h"
 
 namespace bpp
 {
@@ -59,6 +60,8 @@ namespace bpp
  *
  * Only reversible models are supported for now.
  *
+ * Rewards are cached for the last branch lengths used (see LengthCache).
+ *
  * @author Laurent Guéguen
  */
   
@@ -67,8 +70,10 @@ namespace bpp
     public DecompositionMethods
   {
   private:
-    mutable RowMatrix<double> rewards_;
-    mutable double currentLength_;
+    /**
+     * @brief Rewards for the last branch lengths used.
+     */
+    mutable LengthCache< RowMatrix<double> > rewards_;
 	
   public:
     DecompositionReward(const SubstitutionModel* model, AlphabetIndex1* alphIndex);
@@ -76,8 +81,7 @@ namespace bpp
     DecompositionReward(const DecompositionReward& dr) :
       AbstractReward(dr),
       DecompositionMethods(dr),
-      rewards_(dr.rewards_),
-      currentLength_(dr.currentLength_)
+      rewards_(dr.rewards_)
     {}
     
     DecompositionReward& operator=(const DecompositionReward& dr)
@@ -86,7 +90,6 @@ namespace bpp
       DecompositionMethods::operator=(dr);
 
       rewards_        = dr.rewards_;
-      currentLength_  = dr.currentLength_;
       return *this;
     }				
 		
@@ -110,9 +113,12 @@ namespace bpp
     void setSubstitutionModel(const SubstitutionModel* model);
 
   protected:
-    void initRewards_();
-    
-    void computeRewards_(double length) const;
+    /**
+     * @return The rewards for a given length, computed if they are not in the cache.
+     */
+    const RowMatrix<double>& getRewards_(double length) const;
+
+    void computeRewards_(double length, RowMatrix<double>& rewards) const;
 
     void alphabetIndexHasChanged();
 
@@ -52,29 +52,18 @@ DecompositionSubstitutionCount::DecompositionSubstitutionCount(const Substitutio
   AbstractSubstitutionCount(reg),
   AbstractWeightedSubstitutionCount(weights, true),
   DecompositionMethods(model, reg),
-  counts_(reg->getNumberOfSubstitutionTypes()),
-  currentLength_(0)
+  counts_()
 {
   //Check compatiblity between model and substitution register:
   if (typeid(model->getAlphabet())!=typeid(reg->getAlphabet()))
     throw Exception("DecompositionSubstitutionCount (constructor): alphabets do not match between register and model.");
 
   initBMatrices_();
-  initCounts_();
 
   fillBMatrices_();
   computeProducts_();
 }
 
-void DecompositionSubstitutionCount::initCounts_()
-{
-  counts_.resize(register_->getNumberOfSubstitutionTypes());
-  //Re-initialize all count matrices according to substitution register.
-  for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i) {
-    counts_[i].resize(nbStates_, nbStates_);
-  }
-}
-
 /*************************************************/
 
 void DecompositionSubstitutionCount::fillBMatrices_()
@@ -93,23 +82,26 @@ void DecompositionSubstitutionCount::fillBMatrices_()
 
 /******************************************************************************/
 
-void DecompositionSubstitutionCount::computeCounts_(double length) const
+void DecompositionSubstitutionCount::computeCounts_(double length, vector< RowMatrix<double> >& counts) const
 {
-  computeExpectations(counts_, length);
+  counts.resize(nbTypes_);
+  for (size_t i = 0; i < nbTypes_; ++i) {
+    counts[i].resize(nbStates_, nbStates_);
+  }
+  computeExpectations(counts, length);
 
   // Now we must divide by pijt and account for putative weights:
   vector<int> supportedStates = model_->getAlphabetStates();
-  RowMatrix<double> P = model_->getPij_t(length);
+  const Matrix<double>& P = model_->getPij_t(length);
   for (size_t i = 0; i < nbTypes_; i++) {
     for (size_t j = 0; j < nbStates_; j++) {
       for (size_t k = 0; k < nbStates_; k++) {
-        counts_[i](j, k) /= P(j, k);
-        if (std::isnan(counts_[i](j, k)) || counts_[i](j, k) < 0.) {
-          counts_[i](j, k) = 0.;
-          //Weights:
-          if (weights_)
-            counts_[i](j, k) *= weights_->getIndex(supportedStates[j], supportedStates[k]);
-        }
+        counts[i](j, k) /= P(j, k);
+        if (std::isnan(counts[i](j, k)) || counts[i](j, k) < 0.)
+          counts[i](j, k) = 0.;
+        //Weights:
+        if (weights_)
+          counts[i](j, k) *= weights_->getIndex(supportedStates[j], supportedStates[k]);
       }
     }
   }
@@ -117,16 +109,34 @@ void DecompositionSubstitutionCount::computeCounts_(double length) const
 
 /******************************************************************************/
 
+const vector< RowMatrix<double> >& DecompositionSubstitutionCount::getCounts_(double length) const
+{
+  const vector< RowMatrix<double> >* counts = counts_.find(length);
+  if (counts)
+    return *counts;
+  computeCounts_(length, counts_.getFreeEntry());
+  return counts_.commit(length);
+}
+
+/******************************************************************************/
+
 Matrix<double>* DecompositionSubstitutionCount::getAllNumbersOfSubstitutions(double length, size_t type) const
 {
   if (length < 0)
     throw Exception("DecompositionSubstitutionCount::getAllNumbersOfSubstitutions. Negative branch length: " + TextTools::toString(length) + ".");
-  if (length != currentLength_)
-  {
-    computeCounts_(length);
-    currentLength_ = length;
+  return new RowMatrix<double>(getCounts_(length)[type - 1]);
+}
+
+/******************************************************************************/
+
+void DecompositionSubstitutionCount::getAllNumbersOfSubstitutionsForEachLength(const vector<double>& lengths, vector< vector< RowMatrix<double> > >& counts) const
+{
+  counts.resize(lengths.size());
+  for (size_t l = 0; l < lengths.size(); ++l) {
+    if (lengths[l] < 0)
+      throw Exception("DecompositionSubstitutionCount::getAllNumbersOfSubstitutionsForEachLength. Negative branch length: " + TextTools::toString(lengths[l]) + ".");
+    counts[l] = getCounts_(lengths[l]);
   }
-  return new RowMatrix<double>(counts_[type - 1]);
 }
 
 /******************************************************************************/
@@ -135,12 +145,7 @@ double DecompositionSubstitutionCount::getNumberOfSubstitutions(size_t initialSt
 {
   if (length < 0)
     throw Exception("DecompositionSubstitutionCount::getNumbersOfSubstitutions. Negative branch length: " + TextTools::toString(length) + ".");
-  if (length != currentLength_)
-  {
-    computeCounts_(length);
-    currentLength_ = length;
-  }
-  return counts_[type - 1](initialState, finalState);
+  return getCounts_(length)[type - 1](initialState, finalState);
 }
 
 /******************************************************************************/
@@ -149,14 +154,10 @@ std::vector<double> DecompositionSubstitutionCount::getNumberOfSubstitutionsForE
 {
   if (length < 0)
     throw Exception("DecompositionSubstitutionCount::getNumbersOfSubstitutions. Negative branch length: " + TextTools::toString(length) + ".");
-  if (length != currentLength_)
-  {
-    computeCounts_(length);
-    currentLength_ = length;
-  }
+  const vector< RowMatrix<double> >& counts = getCounts_(length);
   std::vector<double> v(getNumberOfSubstitutionTypes());
   for (size_t t = 0; t < getNumberOfSubstitutionTypes(); ++t) {
-    v[t] = counts_[t](initialState, finalState);
+    v[t] = counts[t](initialState, finalState);
   }
   return v;
 }
@@ -171,13 +172,11 @@ void DecompositionSubstitutionCount::setSubstitutionModel(const SubstitutionMode
 
   DecompositionMethods::setSubstitutionModel(model);
 
-  initCounts_();
-  
   fillBMatrices_();
   computeProducts_();
   
-  //Recompute counts:
-  computeCounts_(currentLength_);
+  //Counts will be recomputed when needed:
+  counts_.clear();
 }
 
 /******************************************************************************/
@@ -190,15 +189,12 @@ void DecompositionSubstitutionCount::substitutionRegisterHasChanged() throw (Exc
 
   initBMatrices_();
   initStates_();
-  
-  initCounts_();
 
   fillBMatrices_();
   computeProducts_();
   
-  //Recompute counts:
-  if (currentLength_ > 0)
-    computeCounts_(currentLength_);
+  //Counts will be recomputed when needed:
+  counts_.clear();
 }
 
 /******************************************************************************/
@@ -208,9 +204,8 @@ void DecompositionSubstitutionCount::weightsHaveChanged() throw (Exception)
   if (typeid(weights_->getAlphabet()) != typeid(register_->getAlphabet()))
     throw Exception("DecompositionSubstitutionCount::weightsHaveChanged. Incorrect alphabet type.");
 
-  //Recompute counts:
-  if (currentLength_ > 0)
-    computeCounts_(currentLength_);
+  //Counts will be recomputed when needed:
+  counts_.clear();
 }
 
 /******************************************************************************/
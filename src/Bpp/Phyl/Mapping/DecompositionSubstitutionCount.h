@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "WeightedSubstitutionCount.h"
 #include "DecompositionMethods.h"
+#include "LengthCache.h"
 
 #include <Bpp/Numeric/Matrix/Matrix.h>
 
@@ -54,6 +55,9 @@ namespace bpp
  * The codes is adapted from the original R code by Paula Tataru and Asger Hobolth.
  * Only reversible models are supported for now.
  *
+ * Counts are cached for the last branch lengths used (see LengthCache),
+ * so that all rate classes of a branch are computed only once.
+ *
  * @author Julien Dutheil
  */
   class DecompositionSubstitutionCount:
@@ -62,8 +66,10 @@ namespace bpp
     public DecompositionMethods
   {
   private:
-    mutable std::vector< RowMatrix<double> > counts_;
-    mutable double currentLength_;
+    /**
+     * @brief Counts for each type, for the last branch lengths used.
+     */
+    mutable LengthCache< std::vector< RowMatrix<double> > > counts_;
 
   public:
     DecompositionSubstitutionCount(const SubstitutionModel* model, SubstitutionRegister* reg, const AlphabetIndex2* weights = 0);
@@ -72,8 +78,7 @@ namespace bpp
       AbstractSubstitutionCount(dsc),
       AbstractWeightedSubstitutionCount(dsc),
       DecompositionMethods(dsc),
-      counts_(dsc.counts_),
-      currentLength_(dsc.currentLength_)
+      counts_(dsc.counts_)
     {}				
     
     DecompositionSubstitutionCount& operator=(const DecompositionSubstitutionCount& dsc)
@@ -82,7 +87,6 @@ namespace bpp
       AbstractWeightedSubstitutionCount::operator=(dsc);
       DecompositionMethods::operator=(dsc);
       counts_         = dsc.counts_;
-      currentLength_  = dsc.currentLength_;
       return *this;
     }				
 		
@@ -96,6 +100,15 @@ namespace bpp
     Matrix<double>* getAllNumbersOfSubstitutions(double length, size_t type = 1) const;
     
     std::vector<double> getNumberOfSubstitutionsForEachType(size_t initialState, size_t finalState, double length) const;
+
+    /**
+     * @brief Get the counts of all types for several lengths.
+     *
+     * The products of the eigenvectors with the substitution matrices do not depend on the length,
+     * and are computed once for each model. The length enters through the J matrix, inside the change of basis,
+     * so that each length not in the cache still requires its own two matrix products.
+     */
+    void getAllNumbersOfSubstitutionsForEachLength(const std::vector<double>& lengths, std::vector< std::vector< RowMatrix<double> > >& counts) const;
    
     /**
      * @brief Set the substitution model.
@@ -107,9 +120,12 @@ namespace bpp
 
   protected:
 
-    void initCounts_();
+    /**
+     * @return The counts for each type for a given length, computed if they are not in the cache.
+     */
+    const std::vector< RowMatrix<double> >& getCounts_(double length) const;
 
-    void computeCounts_(double length) const;
+    void computeCounts_(double length, std::vector< RowMatrix<double> >& counts) const;
 
     void substitutionRegisterHasChanged() throw (Exception);
 
@@ -0,0 +1,149 @@
+//
+// File: LengthCache.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 19:05 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _LENGTHCACHE_H_
+#define _LENGTHCACHE_H_
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief A bounded cache of values computed for given branch lengths.
+ *
+ * Substitution counts and rewards are typically requested for the same branch
+ * with one length per rate class, so that a cache with a single entry is always missed.
+ * This cache stores the values of the last lengths used, and replaces the oldest entry when it is full.
+ *
+ * References returned by the cache remain valid until their entry is replaced or the cache is cleared.
+ */
+template<class T>
+class LengthCache
+{
+  private:
+    std::vector<double> lengths_;
+    std::vector<T> values_;
+    size_t size_;
+    size_t next_;
+
+  public:
+    /**
+     * @param capacity The maximum number of lengths to store (at least 1).
+     */
+    LengthCache(size_t capacity = 16) :
+      lengths_(capacity > 0 ? capacity : 1),
+      values_(capacity > 0 ? capacity : 1),
+      size_(0),
+      next_(0)
+    {}
+
+  public:
+    size_t getCapacity() const { return lengths_.size(); }
+
+    /**
+     * @brief Change the capacity of the cache, and clear it.
+     *
+     * @param capacity The maximum number of lengths to store (at least 1).
+     */
+    void setCapacity(size_t capacity)
+    {
+      if (capacity == 0)
+        throw Exception("LengthCache::setCapacity. Capacity must be at least 1.");
+      lengths_.resize(capacity);
+      values_.resize(capacity);
+      clear();
+    }
+
+    void clear()
+    {
+      size_ = 0;
+      next_ = 0;
+    }
+
+    /**
+     * @return A pointer toward the values computed for this length, or 0 if they are not in the cache.
+     */
+    const T* find(double length) const
+    {
+      for (size_t i = 0; i < size_; ++i)
+      {
+        if (lengths_[i] == length)
+          return &values_[i];
+      }
+      return 0;
+    }
+
+    /**
+     * @brief Get an entry to store the values computed for a new length.
+     *
+     * The entry is only looked up by find once the values are committed,
+     * so that values are never returned if their computation fails.
+     *
+     * @return A reference toward the entry to fill, which may hold the values of an older length.
+     */
+    T& getFreeEntry()
+    {
+      // Lengths are never negative, so that the previous values of this entry can not be found anymore:
+      lengths_[next_] = -1.;
+      return values_[next_];
+    }
+
+    /**
+     * @brief Register the values stored in the free entry for a given length.
+     *
+     * @return A reference toward the stored values.
+     */
+    const T& commit(double length)
+    {
+      size_t i = next_;
+      lengths_[i] = length;
+      next_ = (next_ + 1) % lengths_.size();
+      if (size_ < lengths_.size())
+        size_++;
+      return values_[i];
+    }
+};
+
+} // end of namespace bpp.
+
+#endif // _LENGTHCACHE_H_
@@ -0,0 +1,156 @@
+//
+// File: MappingWorker.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 21:40 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _MAPPINGWORKER_H_
+#define _MAPPINGWORKER_H_
+
+#include "../Model/SubstitutionModel.h"
+#include "../ParallelTools.h"
+
+#include <Bpp/App/ApplicationTools.h>
+
+// From the STL:
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief The objects used by one thread to map branches.
+ *
+ * A worker holds a substitution count or a reward (any class with clone() and setSubstitutionModel() methods),
+ * either the one given or a copy private to the worker, together with copies of the models it is used with.
+ * The model of the object is only updated when it changes from one branch to the next,
+ * so that length-independent terms and cached values are kept as long as possible.
+ */
+template<class T>
+class MappingWorker
+{
+  private:
+    T* object_;
+    std::unique_ptr<T> copy_;
+    std::map<const SubstitutionModel*, std::shared_ptr<SubstitutionModel> > models_;
+    const SubstitutionModel* currentModel_;
+
+  public:
+    /**
+     * @param object The object to use.
+     * @param copy   Tell if the object and the models should be copied, which is required when several threads are used.
+     */
+    MappingWorker(T& object, bool copy) :
+      object_(&object),
+      copy_(copy ? object.clone() : 0),
+      models_(),
+      currentModel_(0)
+    {
+      if (copy)
+        object_ = copy_.get();
+    }
+
+  private:
+    MappingWorker(const MappingWorker&);
+    MappingWorker& operator=(const MappingWorker&);
+
+  public:
+    T& getObject() { return *object_; }
+
+    /**
+     * @brief Set the model of the object, or a copy of it private to this worker.
+     *
+     * The object is only updated when the model changes.
+     */
+    void setSubstitutionModel(const SubstitutionModel* model)
+    {
+      if (copy_.get())
+      {
+        std::shared_ptr<SubstitutionModel>& modelCopy = models_[model];
+        if (!modelCopy)
+          modelCopy.reset(model->clone());
+        model = modelCopy.get();
+      }
+      if (model != currentModel_)
+      {
+        object_->setSubstitutionModel(model);
+        currentModel_ = model;
+      }
+    }
+
+    /**
+     * @brief Map branches on a pool of threads.
+     *
+     * Branches are distributed dynamically, see ParallelTools::parallelFor.
+     *
+     * @param nbBranches The number of branches to map.
+     * @param object     The object to use. It is used directly with a single thread, and copied otherwise.
+     * @param nbThreads  The number of threads to use (0 to use the number of available cores).
+     * @param verbose    Display a progress gauge.
+     * @param mapBranch  The function mapping a branch, given its index and the worker of the current thread.
+     */
+    static void mapBranches(
+      size_t nbBranches,
+      T& object,
+      unsigned int nbThreads,
+      bool verbose,
+      const std::function<void (size_t, MappingWorker<T>&)>& mapBranch)
+    {
+      size_t nbWorkers = ParallelTools::getNumberOfWorkers(nbBranches, nbThreads);
+      std::vector< std::unique_ptr< MappingWorker<T> > > workers(nbWorkers);
+      size_t done = 0;
+      std::mutex displayMutex;
+      ParallelTools::parallelFor(nbBranches, nbThreads, [&](size_t l, size_t w)
+      {
+        if (!workers[w])
+          workers[w].reset(new MappingWorker<T>(object, nbWorkers > 1));
+        mapBranch(l, *workers[w]);
+        if (verbose)
+        {
+          std::lock_guard<std::mutex> lock(displayMutex);
+          ApplicationTools::displayGauge(done++, nbBranches - 1);
+        }
+      });
+    }
+};
+
+} // end of namespace bpp.
+
+#endif // _MAPPINGWORKER_H_
@@ -40,9 +40,62 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "ProbabilisticSubstitutionMapping.h"
 
 using namespace bpp;
+using namespace std;
+
+ProbabilisticSubstitutionMapping::ProbabilisticSubstitutionMapping(
+  const Tree& tree,
+  const SubstitutionCount* sc,
+  const vector<size_t>& patternLinks,
+  size_t numberOfPatterns) :
+  AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(sc), mapping_(0),
+  patternMapping_(), patternLinks_(patternLinks), nbPatterns_(numberOfPatterns), compressed_(true)
+{
+  for (size_t i = 0; i < patternLinks_.size(); i++) {
+    if (patternLinks_[i] >= nbPatterns_)
+      throw IndexOutOfBoundsException("ProbabilisticSubstitutionMapping (constructor). Bad pattern index.", patternLinks_[i], 0, nbPatterns_ - 1);
+  }
+  AbstractSubstitutionMapping::setNumberOfSites(patternLinks_.size());
+  patternMapping_.resize(nbPatterns_ * getNumberOfBranches() * getNumberOfSubstitutionTypes());
+}
+
+vector< vector<double> > ProbabilisticSubstitutionMapping::operator[](size_t siteIndex) const
+{
+  if (!compressed_)
+    return mapping_[siteIndex];
+  size_t nbBranches = getNumberOfBranches();
+  size_t nbTypes = getNumberOfSubstitutionTypes();
+  vector< vector<double> > site(nbBranches);
+  for (size_t j = 0; j < nbBranches; j++) {
+    vector<double>::const_iterator it = patternMapping_.begin()
+      + static_cast<ptrdiff_t>(getPatternPosition_(j, patternLinks_[siteIndex], 0));
+    site[j].assign(it, it + static_cast<ptrdiff_t>(nbTypes));
+  }
+  return site;
+}
+
+void ProbabilisticSubstitutionMapping::expand_()
+{
+  if (!compressed_) return;
+  size_t nbBranches = getNumberOfBranches();
+  size_t nbTypes = getNumberOfSubstitutionTypes();
+  mapping_.resize(patternLinks_.size());
+  for (size_t i = 0; i < patternLinks_.size(); i++) {
+    mapping_[i].resize(nbBranches);
+    for (size_t j = 0; j < nbBranches; j++) {
+      vector<double>::const_iterator it = patternMapping_.begin()
+        + static_cast<ptrdiff_t>(getPatternPosition_(j, patternLinks_[i], 0));
+      mapping_[i][j].assign(it, it + static_cast<ptrdiff_t>(nbTypes));
+    }
+  }
+  compressed_ = false;
+  nbPatterns_ = 0;
+  vector<double>().swap(patternMapping_);
+  vector<size_t>().swap(patternLinks_);
+}
 
 void ProbabilisticSubstitutionMapping::setTree(const Tree& tree)
 {
+  expand_();
   AbstractSubstitutionMapping::setTree(tree);
   for (size_t i = 0; i < getNumberOfSites(); i++) {
     mapping_[i].resize(getNumberOfBranches());
@@ -54,6 +107,7 @@ void ProbabilisticSubstitutionMapping::setTree(const Tree& tree)
 
 void ProbabilisticSubstitutionMapping::setNumberOfSites(size_t numberOfSites)
 {
+  expand_();
   AbstractSubstitutionMapping::setNumberOfSites(numberOfSites);
   mapping_.resize(numberOfSites);
   for (size_t i = 0; i < numberOfSites; i++) {
@@ -59,6 +59,11 @@ namespace bpp
  * This number can be an average number of substitutions, optionally waited, or a probability of observing a certain number of substitutions.
  * Probabilistic was coined there by opposition to the'stochastic' mapping, where a path (number of susbstitutions + there position along the branch)
  * is available for each branch and site. The probabilistic mapping can however be extended to contain a matrix will all types of substitutions, instead of their total number.
+ *
+ * Numbers can also be stored by distinct site pattern, in a single contiguous array together with the index of the pattern of each site.
+ * Such a 'compressed' mapping is expanded to all sites on the first non-constant access to the numbers of a site
+ * (operator[] or the non-constant operator()), or when the number of sites is changed.
+ * Constant accessors read the numbers of the pattern of the site directly.
  */
 class ProbabilisticSubstitutionMapping:
   public AbstractSubstitutionMapping
@@ -68,9 +73,22 @@ class ProbabilisticSubstitutionMapping:
     /**
      * @brief Substitution numbers storage.
      *
-     * Numbers are stored by sites.
+     * Numbers are stored by sites. This storage is empty while the mapping is compressed.
      */
     std::vector< std::vector< std::vector<double> > > mapping_;
+
+    /**
+     * @brief Compressed storage, with numbers stored by pattern, then branch, then type.
+     */
+    std::vector<double> patternMapping_;
+
+    /**
+     * @brief The index of the pattern of each site, in compressed mode.
+     */
+    std::vector<size_t> patternLinks_;
+
+    size_t nbPatterns_;
+    bool compressed_;
   
   public:
     
@@ -84,25 +102,38 @@ class ProbabilisticSubstitutionMapping:
      * @param numberOfSites The number of sites to map.
      */
     ProbabilisticSubstitutionMapping(const Tree& tree, const SubstitutionCount* sc, size_t numberOfSites) :
-      AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(sc), mapping_(0)
+      AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(sc), mapping_(0),
+      patternMapping_(), patternLinks_(), nbPatterns_(0), compressed_(false)
     {
       setNumberOfSites(numberOfSites);
     }
 
+    /**
+     * @brief Build a new compressed ProbabilisticSubstitutionMapping object.
+     *
+     * @param tree The tree object to use. It will be cloned for internal use.
+     * @param sc A pointer toward the substitution count object that has been used for the mapping, if any.
+     * @param patternLinks The index of the pattern of each site, as given by DRASDRTreeLikelihoodData::getRootArrayPositions().
+     * @param numberOfPatterns The number of distinct site patterns.
+     */
+    ProbabilisticSubstitutionMapping(const Tree& tree, const SubstitutionCount* sc, const std::vector<size_t>& patternLinks, size_t numberOfPatterns);
+
     /**
      * @brief Build a new ProbabilisticSubstitutionMapping object.
      *
      * @param tree The tree object to use. It will be cloned for internal use.
      */
     ProbabilisticSubstitutionMapping(const Tree& tree) :
-    AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(0), mapping_(0)
+    AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(0), mapping_(0),
+    patternMapping_(), patternLinks_(), nbPatterns_(0), compressed_(false)
     {}
     
 
     ProbabilisticSubstitutionMapping* clone() const { return new ProbabilisticSubstitutionMapping(*this); }
 
     ProbabilisticSubstitutionMapping(const ProbabilisticSubstitutionMapping& psm):
-    AbstractMapping(psm), AbstractSubstitutionMapping(psm), substitutionCount_(psm.substitutionCount_), mapping_(psm.mapping_)
+    AbstractMapping(psm), AbstractSubstitutionMapping(psm), substitutionCount_(psm.substitutionCount_), mapping_(psm.mapping_),
+    patternMapping_(psm.patternMapping_), patternLinks_(psm.patternLinks_), nbPatterns_(psm.nbPatterns_), compressed_(psm.compressed_)
     {}
 
     ProbabilisticSubstitutionMapping& operator=(const ProbabilisticSubstitutionMapping& psm)
@@ -110,6 +141,10 @@ class ProbabilisticSubstitutionMapping:
       AbstractSubstitutionMapping::operator=(psm);
       substitutionCount_ = psm.substitutionCount_;
       mapping_           = psm.mapping_;
+      patternMapping_    = psm.patternMapping_;
+      patternLinks_      = psm.patternLinks_;
+      nbPatterns_        = psm.nbPatterns_;
+      compressed_        = psm.compressed_;
       return *this;
     }
 
@@ -125,12 +160,52 @@ class ProbabilisticSubstitutionMapping:
      
     virtual double getNumberOfSubstitutions(int nodeId, size_t siteIndex, size_t type) const
     {
-      return mapping_[siteIndex][getNodeIndex(nodeId)][type];
+      return (*this)(getNodeIndex(nodeId), siteIndex, type);
     }
     
     virtual std::vector<double> getNumberOfSubstitutions(int nodeId, size_t siteIndex) const
     {
-      return mapping_[siteIndex][getNodeIndex(nodeId)];
+      if (!compressed_)
+        return mapping_[siteIndex][getNodeIndex(nodeId)];
+      size_t nbTypes = getNumberOfSubstitutionTypes();
+      std::vector<double>::const_iterator it = patternMapping_.begin()
+        + static_cast<std::ptrdiff_t>(getPatternPosition_(getNodeIndex(nodeId), patternLinks_[siteIndex], 0));
+      return std::vector<double>(it, it + static_cast<std::ptrdiff_t>(nbTypes));
+    }
+
+    /**
+     * @return True if numbers are stored by site pattern.
+     */
+    bool isCompressed() const { return compressed_; }
+
+    /**
+     * @return The number of distinct site patterns, in compressed mode.
+     */
+    size_t getNumberOfPatterns() const { return nbPatterns_; }
+
+    /**
+     * @return The index of the pattern of each site, in compressed mode.
+     */
+    const std::vector<size_t>& getPatternLinks() const { return patternLinks_; }
+
+    /**
+     * @brief Direct access to the substitution numbers of a site pattern, in compressed mode.
+     *
+     * @warning No index checking is performed, use with care!
+     */
+    double& getPatternNumberOfSubstitutions(size_t nodeIndex, size_t patternIndex, size_t type)
+    {
+      return patternMapping_[getPatternPosition_(nodeIndex, patternIndex, type)];
+    }
+
+    /**
+     * @brief Direct access to the substitution numbers of a site pattern, in compressed mode.
+     *
+     * @warning No index checking is performed, use with care!
+     */
+    const double& getPatternNumberOfSubstitutions(size_t nodeIndex, size_t patternIndex, size_t type) const
+    {
+      return patternMapping_[getPatternPosition_(nodeIndex, patternIndex, type)];
     }
     
     /**
@@ -149,6 +224,7 @@ class ProbabilisticSubstitutionMapping:
      */
     virtual double& operator()(size_t nodeIndex, size_t siteIndex, size_t type)
     {
+      expand_();
       return mapping_[siteIndex][nodeIndex][type];
     }
 
@@ -159,6 +235,8 @@ class ProbabilisticSubstitutionMapping:
      */
     virtual const double& operator()(size_t nodeIndex, size_t siteIndex, size_t type) const
     {
+      if (compressed_)
+        return patternMapping_[getPatternPosition_(nodeIndex, patternLinks_[siteIndex], type)];
       return mapping_[siteIndex][nodeIndex][type];
     }
      
@@ -169,18 +247,31 @@ class ProbabilisticSubstitutionMapping:
      */
     std::vector< std::vector<double> >& operator[](size_t siteIndex)
     {
+      expand_();
       return mapping_[siteIndex];
     }
 
     /**
-     * @brief Direct access to substitution numbers.
+     * @brief Access to the substitution numbers of a site, for all branches and types.
+     *
+     * In compressed mode, the numbers are copied from the pattern of the site, and the mapping is not expanded.
      *
      * @warning No index checking is performed, use with care!
      */
-    const std::vector< std::vector<double> >& operator[](size_t siteIndex) const
+    std::vector< std::vector<double> > operator[](size_t siteIndex) const;
+
+  private:
+    size_t getPatternPosition_(size_t nodeIndex, size_t patternIndex, size_t type) const
     {
-      return mapping_[siteIndex];
+      return (patternIndex * getNumberOfBranches() + nodeIndex) * getNumberOfSubstitutionTypes() + type;
     }
+
+    /**
+     * @brief Copy the numbers of each pattern to all its sites, and release the compressed storage.
+     *
+     * Does nothing if the mapping is not compressed.
+     */
+    void expand_();
 };
 
 } //end of namespace bpp.
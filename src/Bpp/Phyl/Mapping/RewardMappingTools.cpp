@@ -40,6 +40,7 @@
 #include "RewardMappingTools.h"
 #include "../Likelihood/DRTreeLikelihoodTools.h"
 #include "../Likelihood/MarginalAncestralStateReconstruction.h"
+#include "MappingWorker.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/App/ApplicationTools.h>
@@ -50,6 +51,7 @@ using namespace bpp;
 
 // From the STL:
 #include <iomanip>
+#include <memory>
 
 using namespace std;
 
@@ -59,290 +61,86 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
   const DRTreeLikelihood& drtl,
   const vector<int>& nodeIds,
   Reward& reward,
-  bool verbose) throw (Exception)
+  bool verbose,
+  unsigned int nbThreads) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
     throw Exception("RewardMappingTools::computeRewardVectors(). Likelihood object is not initialized.");
 
-  // A few variables we'll need:
+  BranchJointLikelihoods joint(drtl, nodeIds);
+  return computeRewardVectors(joint, nodeIds, reward, verbose, nbThreads);
+}
 
-  const TreeTemplate<Node> tree(drtl.getTree());
-  const SiteContainer*    sequences = drtl.getData();
-  const DiscreteDistribution* rDist = drtl.getRateDistribution();
+/******************************************************************************/
 
-  size_t nbSites         = sequences->getNumberOfSites();
-  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
-  size_t nbStates        = sequences->getAlphabet()->getSize();
-  size_t nbClasses       = rDist->getNumberOfCategories();
-  vector<const Node*> nodes    = tree.getNodes();
+ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
+  const BranchJointLikelihoods& joint,
+  const vector<int>& nodeIds,
+  Reward& reward,
+  bool verbose,
+  unsigned int nbThreads) throw (Exception)
+{
+  // A few variables we'll need:
+  const DRTreeLikelihood& drtl = joint.getLikelihood();
+  size_t nbSites         = drtl.getData()->getNumberOfSites();
+  size_t nbDistinctSites = joint.getNumberOfPatterns();
+  size_t nbClasses       = joint.getNumberOfClasses();
+  size_t nbNodes         = joint.getNumberOfBranches();
   const vector<size_t>* rootPatternLinks
     = &drtl.getLikelihoodData()->getRootArrayPositions();
-  nodes.pop_back(); // Remove root node.
-  size_t nbNodes         = nodes.size();
+  const Vdouble& rcRates = joint.getRates();
 
   // We create a new ProbabilisticRewardMapping object:
-  ProbabilisticRewardMapping* rewards = new ProbabilisticRewardMapping(tree, &reward, nbSites);
-
-  // Store likelihood for each rate for each site:
-  VVVdouble lik;
-  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
-  Vdouble Lr(nbDistinctSites, 0);
-  Vdouble rcProbs = rDist->getProbabilities();
-  Vdouble rcRates = rDist->getCategories();
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    VVdouble* lik_i = &lik[i];
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      Vdouble* lik_i_c = &(*lik_i)[c];
-      double rc = rDist->getProbability(c);
-      for (size_t s = 0; s < nbStates; s++)
-      {
-        Lr[i] += (*lik_i_c)[s] * rc;
-      }
-    }
-  }
+  unique_ptr<ProbabilisticRewardMapping> rewards(new ProbabilisticRewardMapping(drtl.getTree(), &reward, nbSites));
 
   // Compute the reward for each class and each branch in the tree:
   if (verbose)
-    ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
+    ApplicationTools::displayTask("Compute reward vectors", true);
 
-  for (size_t l = 0; l < nbNodes; ++l)
+  // Branches are distributed dynamically on the threads,
+  // each of them using its own copy of the reward and of the models when there are several:
+  MappingWorker<Reward>::mapBranches(nbNodes, reward, nbThreads, verbose, [&](size_t l, MappingWorker<Reward>& worker)
   {
-    // For each node,
-    const Node* currentNode = nodes[l];
-    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, currentNode->getId()))
-      continue;
-
-    const Node* father = currentNode->getFather();
-
-    double d = currentNode->getDistanceToFather();
-
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
-    Vdouble rewardsForCurrentNode(nbDistinctSites);
-
-    // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; i++)
+    if (joint.isComputed(l) && (nodeIds.size() == 0 || VectorTools::contains(nodeIds, joint.getNodeId(l))))
     {
-      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-      likelihoodsFatherConstantPart_i->resize(nbClasses);
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; s++)
-        {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
-        }
-      }
-    }
+      double d = joint.getBranchLength(l);
+      VVdouble rewardsForCurrentNode(nbDistinctSites, Vdouble(1, 0.));
 
-    // First, what will remain constant:
-    size_t nbSons =  father->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; n++)
-    {
-      const Node* currentSon = father->getSon(n);
-      if (currentSon->getId() != currentNode->getId())
+      // Iterate over all site partitions:
+      const vector<BranchJointLikelihoods::Partition>& partitions = joint.getPartitions(l);
+      for (size_t p = 0; p < partitions.size(); ++p)
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+        worker.setSubstitutionModel(partitions[p].model);
 
-        // Now iterate over all site partitions:
-        unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
-        while (mit->hasNext())
-        {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
-          {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; c++)
-            {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; x++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; y++)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
-            }
-          }
-        }
-      }
-    }
-    if (father->hasFather())
-    {
-      const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-      // Now iterate over all site partitions:
-      unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
-      VVVdouble pxy;
-      bool first;
-      while (mit->hasNext())
-      {
-        TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-        unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-        first = true;
-        while (sit->hasNext())
-        {
-          size_t i = sit->next();
-          // We retrieve the transition probabilities for this site partition:
-          if (first)
-          {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
-            first = false;
-          }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-          for (size_t c = 0; c < nbClasses; c++)
-          {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-            VVdouble* pxy_c = &pxy[c];
-            for (size_t x = 0; x < nbStates; x++)
-            {
-              double likelihood = 0.;
-              for (size_t y = 0; y < nbStates; y++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
-              }
-              (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-            }
-          }
-        }
-      }
-    }
-    else
-    {
-      // Account for root frequencies:
-      for (size_t i = 0; i < nbDistinctSites; i++)
-      {
-        vector<double> freqs = drtl.getRootFrequencies(i);
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; c++)
+        // compute all nxy first:
+        vector< unique_ptr< Matrix<double> > > nxy(nbClasses);
+        vector< vector<const Matrix<double>*> > values(nbClasses, vector<const Matrix<double>*>(1));
+        for (size_t c = 0; c < nbClasses; ++c)
         {
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          for (size_t x = 0; x < nbStates; x++)
-          {
-            (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
-          }
+          nxy[c].reset(worker.getObject().getAllRewards(d * rcRates[c]));
+          values[c][0] = nxy[c].get();
         }
-      }
-    }
 
-    // Then, we deal with the node of interest.
-    // We first average upon 'y' to save computations, and then upon 'x'.
-    // ('y' is the state at 'node' and 'x' the state at 'father'.)
-
-    // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
-    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
-    VVVdouble pxy;
-    bool first;
-    while (mit->hasNext())
-    {
-      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      reward.setSubstitutionModel(bmd->getSubstitutionModel());
-      // compute all nxy first:
-      VVVdouble nxy(nbClasses);
-      for (size_t c = 0; c < nbClasses; ++c)
-      {
-        VVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        Matrix<double>* nij = reward.getAllRewards(d * rc);
-        nxy_c->resize(nbStates);
-        for (size_t x = 0; x < nbStates; ++x)
-        {
-          Vdouble* nxy_c_x = &(*nxy_c)[x];
-          nxy_c_x->resize(nbStates);
-          for (size_t y = 0; y < nbStates; ++y)
-          {
-            (*nxy_c_x)[y] = (*nij)(x, y);
-          }
-        }
-        delete nij;
+        // Then average them over the joint likelihoods of all sites:
+        joint.computeExpectations(l, p, values, rewardsForCurrentNode);
       }
 
-      // Now loop over sites:
-      unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      first = true;
-      while (sit->hasNext())
+      // Now we just have to copy the rewards into the result vector:
+      for (size_t i = 0; i < nbSites; ++i)
       {
-        size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
-        if (first)
-        {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
-          first = false;
-        }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; ++c)
-        {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVdouble* nxy_c = &nxy[c];
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
-            const Vdouble* pxy_c_x = &(*pxy_c)[x];
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
-                                      * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
-
-              // Now the vector computation:
-              rewardsForCurrentNode[i] += likelihood_cxy * (*nxy_c)[x][y];
-              //                       <------------>   <--------------->
-              // Posterior probability         |                 |
-              // for site i and rate class c * |                 |
-              // likelihood for this site------+                 |
-              //                                                 |
-              // Reward function for site i and rate class c------+
-            }
-          }
-        }
+        (*rewards)(l, i) = rewardsForCurrentNode[(*rootPatternLinks)[i]][0];
       }
     }
+  });
 
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
-    {
-      (*rewards)(l, i) = rewardsForCurrentNode[(*rootPatternLinks)[i]] / Lr[(*rootPatternLinks)[i]];
-    }
-  }
   if (verbose)
   {
     if (ApplicationTools::message)
       *ApplicationTools::message << " ";
     ApplicationTools::displayTaskDone();
   }
-  return rewards;
+  return rewards.release();
 }
 
 /**************************************************************************************************/
@@ -42,6 +42,7 @@
 
 #include "ProbabilisticRewardMapping.h"
 #include "Reward.h"
+#include "BranchJointLikelihoods.h"
 
 #include "../Likelihood/DRTreeLikelihood.h"
 
@@ -57,6 +58,11 @@ namespace bpp
  * Fast, accurate and simulation-free stochastic mapping
  * Philosophical Transactions of the Royal Society B 2008 363:3985-95.
  *
+ * Branches are mapped independently, and may be distributed on several threads.
+ * Each thread then uses its own copy of the Reward object and of the substitution models.
+ * The joint likelihoods of the states at both ends of each branch may be gathered once
+ * with a BranchJointLikelihoods object, and shared with other reward or substitution mappings.
+ *
  * @author Laurent Guéguen
  */
 class RewardMappingTools
@@ -75,6 +81,7 @@ public:
    *                          are computed on.
    * @param reward            The Reward to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
    * @return A vector of reward vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
@@ -82,7 +89,28 @@ public:
     const DRTreeLikelihood& drtl,
     const std::vector<int>& nodeIds,
     Reward& reward,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    unsigned int nbThreads = 1) throw (Exception);
+
+  /**
+   * @brief Compute the reward vectors from precomputed joint likelihoods.
+   *
+   * @param joint             The joint likelihoods of the branches.
+   * @param nodeIds           The Ids of the nodes the reward vectors are computed on,
+   *                          among the branches computed in 'joint'. If empty, rewards are computed
+   *                          on all branches computed in 'joint'.
+   * @param reward            The Reward to use.
+   * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
+   * @return A vector of reward vectors (one for each site).
+   * @throw Exception If an error occured during the mapping.
+   */
+  static ProbabilisticRewardMapping* computeRewardVectors(
+    const BranchJointLikelihoods& joint,
+    const std::vector<int>& nodeIds,
+    Reward& reward,
+    bool verbose = true,
+    unsigned int nbThreads = 1) throw (Exception);
 
 
   /**
@@ -0,0 +1,488 @@
+//
+// File: StochasticMapping.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 22:30 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "StochasticMapping.h"
+#include "../Simulation/PhiloxGenerator.h"
+#include "../TreeTemplate.h"
+#include "../ParallelTools.h"
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+/******************************************************************************/
+
+namespace
+{
+  /**
+   * @return The number of jumps after which the Poisson distribution with mean lambda is truncated.
+   */
+  size_t getMaximumNumberOfJumps(double lambda)
+  {
+    return static_cast<size_t>(ceil(lambda + 10. * sqrt(lambda) + 20.));
+  }
+}
+
+/******************************************************************************/
+
+StochasticMapping::StochasticMapping(const DRTreeLikelihood& drtl, const SubstitutionRegister& reg) throw (Exception) :
+  register_(reg.clone()),
+  nbStates_(0),
+  nbClasses_(0),
+  nbTypes_(reg.getNumberOfSubstitutionTypes()),
+  types_(),
+  patternLinks_(),
+  rootProbabilities_(),
+  chains_(),
+  branches_(),
+  preorder_(),
+  nbSamples_(0),
+  counts_(),
+  dwellingTimes_()
+{
+  if (!drtl.isInitialized())
+    throw Exception("StochasticMapping (constructor). Likelihood object is not initialized.");
+
+  const TreeTemplate<Node> tree(drtl.getTree());
+  const DiscreteDistribution* rDist = drtl.getRateDistribution();
+  nbStates_  = drtl.getData()->getAlphabet()->getSize();
+  nbClasses_ = rDist->getNumberOfCategories();
+  patternLinks_ = drtl.getLikelihoodData()->getRootArrayPositions();
+  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
+
+  // Type of each substitution, 0 if it is not counted:
+  types_.resize(nbStates_ * nbStates_);
+  for (size_t x = 0; x < nbStates_; ++x)
+  {
+    for (size_t y = 0; y < nbStates_; ++y)
+    {
+      size_t type = (x == y ? 0 : register_->getType(x, y));
+      types_[x * nbStates_ + y] = (type <= nbTypes_ ? type : 0);
+    }
+  }
+
+  // Joint distribution of the rate class and root state, as cumulative probabilities:
+  VVVdouble lik;
+  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
+  rootProbabilities_.resize(nbDistinctSites);
+  for (size_t i = 0; i < nbDistinctSites; ++i)
+  {
+    Vdouble* root_i = &rootProbabilities_[i];
+    root_i->resize(nbClasses_ * nbStates_);
+    double s = 0;
+    for (size_t c = 0; c < nbClasses_; ++c)
+    {
+      double rc = rDist->getProbability(c);
+      for (size_t x = 0; x < nbStates_; ++x)
+      {
+        s += rc * lik[i][c][x];
+        (*root_i)[c * nbStates_ + x] = s;
+      }
+    }
+  }
+
+  // Branches, in the same order as in mappings:
+  vector<const Node*> nodes = tree.getNodes();
+  nodes.pop_back(); // Remove root node.
+  size_t nbBranches = nodes.size();
+  map<int, size_t> indices;
+  for (size_t b = 0; b < nbBranches; ++b)
+  {
+    indices[nodes[b]->getId()] = b;
+  }
+  indices[tree.getRootId()] = nbBranches;
+
+  // Fathers are visited before their sons:
+  vector<const Node*> stack(1, tree.getRootNode());
+  while (!stack.empty())
+  {
+    const Node* node = stack.back();
+    stack.pop_back();
+    if (node->hasFather())
+      preorder_.push_back(indices[node->getId()]);
+    for (size_t k = node->getNumberOfSons(); k > 0; --k)
+    {
+      stack.push_back(node->getSon(k - 1));
+    }
+  }
+
+  Vdouble rcRates = rDist->getCategories();
+  map<const SubstitutionModel*, size_t> chainIndices;
+  vector<size_t> maxJumps;
+  branches_.resize(nbBranches);
+  for (size_t b = 0; b < nbBranches; ++b)
+  {
+    const Node* node = nodes[b];
+    Branch_* branch = &branches_[b];
+    branch->nodeId = node->getId();
+    branch->father = indices[node->getFather()->getId()];
+    branch->length = node->getDistanceToFather();
+    branch->likelihoods = &drtl.getLikelihoodData()->getLikelihoodArray(node->getFather()->getId(), node->getId());
+    branch->patternPartitions.resize(nbDistinctSites);
+
+    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(node->getId()));
+    while (mit->hasNext())
+    {
+      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
+      const SubstitutionModel* model = bmd->getSubstitutionModel();
+      if (!model)
+        throw Exception("StochasticMapping (constructor). Histories can only be drawn with substitution models.");
+      unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
+      if (!sit->hasNext())
+        continue;
+
+      // The uniformized chain of each model is computed once:
+      map<const SubstitutionModel*, size_t>::iterator it = chainIndices.find(model);
+      if (it == chainIndices.end())
+      {
+        if (model->getNumberOfStates() != nbStates_)
+          throw Exception("StochasticMapping (constructor). The number of states of the model does not match the alphabet.");
+        JumpChain_ chain;
+        const Matrix<double>& generator = model->getGenerator();
+        double rate = model->getRate();
+        for (size_t x = 0; x < nbStates_; ++x)
+        {
+          chain.rate = max(chain.rate, -rate * generator(x, x));
+        }
+        chain.jumps.resize(nbStates_, nbStates_);
+        for (size_t x = 0; x < nbStates_; ++x)
+        {
+          for (size_t y = 0; y < nbStates_; ++y)
+          {
+            double q = (chain.rate > 0 ? rate * generator(x, y) / chain.rate : 0.);
+            chain.jumps(x, y) = max(0., (x == y ? 1. : 0.) + q);
+          }
+        }
+        it = chainIndices.insert(make_pair(model, chains_.size())).first;
+        chains_.push_back(chain);
+        maxJumps.push_back(0);
+      }
+
+      size_t p = branch->partitions.size();
+      branch->partitions.push_back(BranchPartition_());
+      BranchPartition_* partition = &branch->partitions.back();
+      partition->chain = it->second;
+      size_t i = sit->next();
+      partition->pxy = &drtl.getTransitionProbabilitiesArray(node->getId());
+      branch->patternPartitions[i] = p;
+      while (sit->hasNext())
+      {
+        branch->patternPartitions[sit->next()] = p;
+      }
+      for (size_t c = 0; c < nbClasses_; ++c)
+      {
+        double lambda = chains_[it->second].rate * branch->length * rcRates[c];
+        maxJumps[it->second] = max(maxJumps[it->second], getMaximumNumberOfJumps(lambda));
+      }
+    }
+  }
+
+  // Powers of the jump matrices:
+  for (size_t m = 0; m < chains_.size(); ++m)
+  {
+    JumpChain_* chain = &chains_[m];
+    chain->powers.resize(maxJumps[m] + 1);
+    MatrixTools::getId(nbStates_, chain->powers[0]);
+    for (size_t n = 1; n <= maxJumps[m]; ++n)
+    {
+      MatrixTools::mult(chain->powers[n - 1], chain->jumps, chain->powers[n]);
+    }
+  }
+
+  // Distribution of the number of jumps, and transition probabilities of the uniformized chain:
+  for (size_t b = 0; b < nbBranches; ++b)
+  {
+    Branch_* branch = &branches_[b];
+    for (size_t p = 0; p < branch->partitions.size(); ++p)
+    {
+      BranchPartition_* partition = &branch->partitions[p];
+      const JumpChain_* chain = &chains_[partition->chain];
+      partition->poisson.resize(nbClasses_);
+      partition->endpoints.resize(nbClasses_);
+      for (size_t c = 0; c < nbClasses_; ++c)
+      {
+        double lambda = chain->rate * branch->length * rcRates[c];
+        Vdouble* poisson = &partition->poisson[c];
+        if (lambda > 0)
+        {
+          poisson->resize(getMaximumNumberOfJumps(lambda) + 1);
+          for (size_t n = 0; n < poisson->size(); ++n)
+          {
+            double dn = static_cast<double>(n);
+            (*poisson)[n] = exp(-lambda + dn * log(lambda) - lgamma(dn + 1.));
+          }
+        }
+        else
+          poisson->assign(1, 1.);
+
+        RowMatrix<double>* endpoints = &partition->endpoints[c];
+        endpoints->resize(nbStates_, nbStates_);
+        for (size_t x = 0; x < nbStates_; ++x)
+        {
+          for (size_t y = 0; y < nbStates_; ++y)
+          {
+            double s = 0;
+            for (size_t n = 0; n < poisson->size(); ++n)
+            {
+              s += (*poisson)[n] * chain->powers[n](x, y);
+            }
+            (*endpoints)(x, y) = s;
+          }
+        }
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+size_t StochasticMapping::getBranchIndex(int nodeId) const throw (NodeNotFoundException)
+{
+  for (size_t b = 0; b < branches_.size(); ++b)
+  {
+    if (branches_[b].nodeId == nodeId)
+      return b;
+  }
+  throw NodeNotFoundException("StochasticMapping::getBranchIndex.", TextTools::toString(nodeId));
+}
+
+/******************************************************************************/
+
+vector<double> StochasticMapping::getMeanNumberOfSubstitutions(size_t branchIndex) const
+{
+  vector<double> mean(nbTypes_, 0);
+  if (nbSamples_ == 0)
+    return mean;
+  for (size_t s = 0; s < nbSamples_; ++s)
+  {
+    for (size_t t = 0; t < nbTypes_; ++t)
+    {
+      mean[t] += getNumberOfSubstitutions(s, branchIndex, t);
+    }
+  }
+  for (size_t t = 0; t < nbTypes_; ++t)
+  {
+    mean[t] /= static_cast<double>(nbSamples_);
+  }
+  return mean;
+}
+
+/******************************************************************************/
+
+void StochasticMapping::sample(size_t nbSamples, uint64_t seed, unsigned int nbThreads, bool verbose) throw (Exception)
+{
+  nbSamples_ = nbSamples;
+  counts_.assign(nbSamples * branches_.size() * nbTypes_, 0);
+  dwellingTimes_.assign(nbSamples * branches_.size() * nbStates_, 0);
+
+  if (verbose)
+    ApplicationTools::displayTask("Sample substitution histories", true);
+
+  size_t done = 0;
+  mutex displayMutex;
+  try
+  {
+    ParallelTools::parallelFor(nbSamples, nbThreads, [&](size_t s, size_t)
+    {
+      sampleHistories_(s, seed);
+      if (verbose)
+      {
+        lock_guard<mutex> lock(displayMutex);
+        ApplicationTools::displayGauge(done++, nbSamples - 1);
+      }
+    });
+  }
+  catch (...)
+  {
+    nbSamples_ = 0;
+    throw;
+  }
+
+  if (verbose)
+  {
+    if (ApplicationTools::message)
+      *ApplicationTools::message << " ";
+    ApplicationTools::displayTaskDone();
+  }
+}
+
+/******************************************************************************/
+
+void StochasticMapping::sampleHistories_(size_t sample, uint64_t seed)
+{
+  PhiloxGenerator rng(seed, sample);
+  size_t nbBranches = branches_.size();
+  double* counts = counts_.data() + sample * nbBranches * nbTypes_;
+  double* dwellingTimes = dwellingTimes_.data() + sample * nbBranches * nbStates_;
+  vector<size_t> states(nbBranches + 1);
+  vector<double> times;
+
+  for (size_t j = 0; j < patternLinks_.size(); ++j)
+  {
+    size_t i = patternLinks_[j];
+
+    // Rate class and root state:
+    const Vdouble& root_i = rootProbabilities_[i];
+    if (!(root_i.back() > 0))
+      throw Exception("StochasticMapping::sample. Null likelihood for site " + TextTools::toString(j) + ".");
+    double u = rng.nextDouble() * root_i.back();
+    size_t k = static_cast<size_t>(upper_bound(root_i.begin(), root_i.end(), u) - root_i.begin());
+    k = min(k, root_i.size() - 1);
+    size_t c = k / nbStates_;
+    states[nbBranches] = k % nbStates_;
+
+    // States of the other nodes, and histories on their branches:
+    for (size_t b : preorder_)
+    {
+      const Branch_& branch = branches_[b];
+      const BranchPartition_& partition = branch.partitions[branch.patternPartitions[i]];
+      size_t x = states[branch.father];
+      const Vdouble& pxy_c_x = (*partition.pxy)[c][x];
+      const Vdouble& lik_i_c = (*branch.likelihoods)[i][c];
+      double total = 0;
+      for (size_t y = 0; y < nbStates_; ++y)
+      {
+        total += pxy_c_x[y] * lik_i_c[y];
+      }
+      if (!(total > 0))
+        throw Exception("StochasticMapping::sample. Null conditional likelihood for site " + TextTools::toString(j) + " on branch " + TextTools::toString(branch.nodeId) + ".");
+      u = rng.nextDouble() * total;
+      double s = 0;
+      size_t y = 0, last = 0;
+      for (; y < nbStates_; ++y)
+      {
+        double w = pxy_c_x[y] * lik_i_c[y];
+        if (w > 0)
+        {
+          last = y;
+          s += w;
+          if (s >= u)
+            break;
+        }
+      }
+      if (y == nbStates_)
+        y = last;
+      states[b] = y;
+
+      samplePath_(branch, partition, c, x, y, rng, counts + b * nbTypes_, dwellingTimes + b * nbStates_, times);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void StochasticMapping::samplePath_(
+  const Branch_& branch,
+  const BranchPartition_& partition,
+  size_t rateClass,
+  size_t from,
+  size_t to,
+  PhiloxGenerator& rng,
+  double* counts,
+  double* dwellingTimes,
+  vector<double>& times) const
+{
+  const JumpChain_& chain = chains_[partition.chain];
+  const Vdouble& poisson = partition.poisson[rateClass];
+  double pab = partition.endpoints[rateClass](from, to);
+  if (!(pab > 0))
+    throw Exception("StochasticMapping::sample. Null transition probability on branch " + TextTools::toString(branch.nodeId) + ".");
+
+  // Number of jumps, including virtual ones:
+  double u = rng.nextDouble() * pab;
+  size_t n = 0;
+  double s = poisson[0] * (from == to ? 1. : 0.);
+  while (s < u && n + 1 < poisson.size())
+  {
+    n++;
+    s += poisson[n] * chain.powers[n](from, to);
+  }
+
+  // Times of the jumps, as fractions of the branch:
+  times.resize(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    times[k] = rng.nextDouble();
+  }
+  sort(times.begin(), times.end());
+
+  // States after each jump:
+  size_t x = from;
+  double t0 = 0;
+  for (size_t k = 0; k < n; ++k)
+  {
+    const RowMatrix<double>& remaining = chain.powers[n - k - 1];
+    u = rng.nextDouble() * chain.powers[n - k](x, to);
+    s = 0;
+    size_t y = 0, last = x;
+    for (; y < nbStates_; ++y)
+    {
+      double w = chain.jumps(x, y) * remaining(y, to);
+      if (w > 0)
+      {
+        last = y;
+        s += w;
+        if (s >= u)
+          break;
+      }
+    }
+    if (y == nbStates_)
+      y = last;
+    if (y != x)
+    {
+      dwellingTimes[x] += (times[k] - t0) * branch.length;
+      t0 = times[k];
+      size_t type = types_[x * nbStates_ + y];
+      if (type > 0)
+        counts[type - 1]++;
+      x = y;
+    }
+  }
+  dwellingTimes[x] += (1. - t0) * branch.length;
+}
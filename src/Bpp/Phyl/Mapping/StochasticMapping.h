@@ -0,0 +1,244 @@
+//
+// File: StochasticMapping.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 22:30 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _STOCHASTICMAPPING_H_
+#define _STOCHASTICMAPPING_H_
+
+#include "SubstitutionRegister.h"
+#include "../Likelihood/DRTreeLikelihood.h"
+#include "../TreeExceptions.h"
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+namespace bpp
+{
+
+class PhiloxGenerator;
+
+/**
+ * @brief Stochastic mapping of substitutions, by sampling full substitution histories conditioned on the data.
+ *
+ * For each sample and each site, a rate class and the states of all nodes are first drawn from their joint
+ * posterior distribution, going from the root to the leaves with the double-recursive likelihood arrays.
+ * A substitution history is then drawn on each branch conditionally on the states at both ends, by uniformization:
+ * with @f$\mu@f$ the largest exit rate of the model and @f$R = I + Q/\mu@f$ its jump matrix,
+ * the number of jumps on a branch of length @f$t@f$ between states @f$a@f$ and @f$b@f$ is drawn with probability
+ * proportional to @f$\mathrm{Poisson}(n; \mu t) (R^n)_{a,b}@f$, their times are uniform on the branch,
+ * and the intermediate states are drawn with the powers of @f$R@f$.
+ * These powers only depend on the model, and are computed once for all branches and samples.
+ *
+ * The number of substitutions of each type (according to a SubstitutionRegister) and the time spent in each state
+ * (in branch length units) are summed over all sites, for each branch and sample.
+ * Samples are independent and may be drawn on several threads.
+ * The random numbers of each sample only depend on the seed and on the index of the sample,
+ * so that results do not depend on the number of threads.
+ *
+ * The number of jumps is truncated far in the tail of the Poisson distribution,
+ * so that branches with a large rate times length require more powers of the jump matrix.
+ *
+ * Reference:
+ * - Nielsen R. Mapping mutations on phylogenies. Syst Biol. 2002 51(5):729-39.
+ * - Hobolth A, Stone EA. Simulation from endpoint-conditioned, continuous-time Markov chains on a finite state space,
+ *   with applications to molecular evolution. Ann Appl Stat. 2009 3(3):1204-31.
+ *
+ * @warning The likelihood arrays are used directly: the likelihood object must not be modified before sampling is done.
+ */
+class StochasticMapping
+{
+  private:
+    /**
+     * @brief Uniformized chain of a substitution model.
+     */
+    struct JumpChain_
+    {
+      double rate;
+      RowMatrix<double> jumps;
+      std::vector< RowMatrix<double> > powers;
+
+      JumpChain_() : rate(0), jumps(), powers() {}
+    };
+
+    /**
+     * @brief Transition probabilities and jump distributions of a set of sites sharing the same model on a branch.
+     */
+    struct BranchPartition_
+    {
+      size_t chain;
+      const VVVdouble* pxy;
+      VVdouble poisson;
+      std::vector< RowMatrix<double> > endpoints;
+
+      BranchPartition_() : chain(0), pxy(0), poisson(), endpoints() {}
+    };
+
+    struct Branch_
+    {
+      int nodeId;
+      size_t father;
+      double length;
+      const VVVdouble* likelihoods;
+      std::vector<BranchPartition_> partitions;
+      std::vector<size_t> patternPartitions;
+
+      Branch_() : nodeId(0), father(0), length(0), likelihoods(0), partitions(), patternPartitions() {}
+    };
+
+    std::unique_ptr<SubstitutionRegister> register_;
+    size_t nbStates_;
+    size_t nbClasses_;
+    size_t nbTypes_;
+    std::vector<size_t> types_;
+    std::vector<size_t> patternLinks_;
+    VVdouble rootProbabilities_;
+    std::vector<JumpChain_> chains_;
+    std::vector<Branch_> branches_;
+    std::vector<size_t> preorder_;
+    size_t nbSamples_;
+    std::vector<double> counts_;
+    std::vector<double> dwellingTimes_;
+
+  public:
+    /**
+     * @brief Prepare the sampling of substitution histories.
+     *
+     * @param drtl A DRTreeLikelihood object, which must be initialized.
+     * @param reg  The substitution register used to classify substitutions. It is copied.
+     * @throw Exception If the likelihood object is not initialized, or a model of the likelihood object is not a substitution model.
+     */
+    StochasticMapping(const DRTreeLikelihood& drtl, const SubstitutionRegister& reg) throw (Exception);
+
+    virtual ~StochasticMapping() {}
+
+  private:
+    StochasticMapping(const StochasticMapping&);
+    StochasticMapping& operator=(const StochasticMapping&);
+
+  public:
+    /**
+     * @brief Draw substitution histories.
+     *
+     * Previous samples are discarded.
+     *
+     * @param nbSamples The number of histories to draw for each site.
+     * @param seed      The seed of the random number generator.
+     * @param nbThreads The number of threads to use (0 to use the number of available cores).
+     * @param verbose   Display a progress gauge.
+     * @throw Exception If a history can not be drawn, for instance because of null likelihoods.
+     */
+    void sample(size_t nbSamples, uint64_t seed, unsigned int nbThreads = 1, bool verbose = true) throw (Exception);
+
+    size_t getNumberOfSamples() const { return nbSamples_; }
+    size_t getNumberOfBranches() const { return branches_.size(); }
+    size_t getNumberOfSubstitutionTypes() const { return nbTypes_; }
+    size_t getNumberOfStates() const { return nbStates_; }
+
+    /**
+     * @return The id of the node of a branch.
+     */
+    int getNodeId(size_t branchIndex) const { return branches_[branchIndex].nodeId; }
+
+    /**
+     * @return The index of the branch leading to a node.
+     * @throw NodeNotFoundException If no branch leads to this node.
+     */
+    size_t getBranchIndex(int nodeId) const throw (NodeNotFoundException);
+
+    /**
+     * @return The number of substitutions of a given type on a branch, summed over all sites, for one sample.
+     *
+     * @param sample      The index of the sample.
+     * @param branchIndex The index of the branch.
+     * @param type        The type of substitutions, from 0 to getNumberOfSubstitutionTypes() - 1.
+     * @warning No index checking is performed, use with care!
+     */
+    double getNumberOfSubstitutions(size_t sample, size_t branchIndex, size_t type) const
+    {
+      return counts_[(sample * branches_.size() + branchIndex) * nbTypes_ + type];
+    }
+
+    /**
+     * @return The time spent in a given state on a branch, in branch length units, summed over all sites, for one sample.
+     *
+     * @param sample      The index of the sample.
+     * @param branchIndex The index of the branch.
+     * @param state       The state.
+     * @warning No index checking is performed, use with care!
+     */
+    double getDwellingTime(size_t sample, size_t branchIndex, size_t state) const
+    {
+      return dwellingTimes_[(sample * branches_.size() + branchIndex) * nbStates_ + state];
+    }
+
+    /**
+     * @return The number of substitutions of each type on a branch, summed over all sites and averaged over all samples.
+     *
+     * @param branchIndex The index of the branch.
+     */
+    std::vector<double> getMeanNumberOfSubstitutions(size_t branchIndex) const;
+
+  private:
+    /**
+     * @brief Draw the history of all sites for one sample.
+     */
+    void sampleHistories_(size_t sample, uint64_t seed);
+
+    /**
+     * @brief Draw a path between two states on a branch, and add its substitutions and dwelling times.
+     */
+    void samplePath_(
+      const Branch_& branch,
+      const BranchPartition_& partition,
+      size_t rateClass,
+      size_t from,
+      size_t to,
+      PhiloxGenerator& rng,
+      double* counts,
+      double* dwellingTimes,
+      std::vector<double>& times) const;
+};
+
+} // end of namespace bpp.
+
+#endif // _STOCHASTICMAPPING_H_
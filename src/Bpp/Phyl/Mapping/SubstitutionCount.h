@@ -48,6 +48,7 @@
 
 //From the STL:
 #include <vector>
+#include <memory>
 
 namespace bpp
 {
@@ -141,6 +142,28 @@ namespace bpp
      */
     virtual Matrix<double>* getAllNumbersOfSubstitutions(double length, size_t type) const = 0;
 
+    /**
+     * @brief Get the numbers of susbstitutions on a branch for all types, for each initial and final states, and for several branch lengths.
+     *
+     * This is typically used to get the counts for all rate classes of a branch at once.
+     * The default implementation calls getAllNumbersOfSubstitutions(double, size_t) for each length and type.
+     *
+     * @param lengths The lengths of the branch.
+     * @param counts  [out] The numbers of substitutions, as counts[length index][type - 1].
+     */
+    virtual void getAllNumbersOfSubstitutionsForEachLength(const std::vector<double>& lengths, std::vector< std::vector< RowMatrix<double> > >& counts) const
+    {
+      size_t nbTypes = getNumberOfSubstitutionTypes();
+      counts.resize(lengths.size());
+      for (size_t l = 0; l < lengths.size(); ++l) {
+        counts[l].resize(nbTypes);
+        for (size_t t = 0; t < nbTypes; ++t) {
+          std::unique_ptr< Matrix<double> > nijt(getAllNumbersOfSubstitutions(lengths[l], t + 1));
+          counts[l][t] = RowMatrix<double>(*nijt);
+        }
+      }
+    }
+
     /**
      * @brief Get the numbers of susbstitutions on a branch for all types, for an initial and final states, given the branch length.
      *
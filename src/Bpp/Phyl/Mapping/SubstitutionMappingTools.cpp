@@ -44,6 +44,7 @@
 #include "RewardMappingTools.h"
 #include "../Likelihood/DRTreeLikelihoodTools.h"
 #include "../Likelihood/MarginalAncestralStateReconstruction.h"
+#include "MappingWorker.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/App/ApplicationTools.h>
@@ -55,629 +56,218 @@ using namespace bpp;
 
 // From the STL:
 #include <iomanip>
+#include <algorithm>
+#include <map>
+#include <memory>
 
 using namespace std;
 
 /******************************************************************************/
 
+void SubstitutionMappingTools::checkWriter_(
+  const BinarySubstitutionMappingWriter* writer,
+  size_t nbBranches,
+  size_t nbSites,
+  size_t nbTypes,
+  const string& method) throw (Exception)
+{
+  if (writer && (writer->getNumberOfBranches() != nbBranches
+                 || writer->getNumberOfSites() != nbSites
+                 || writer->getNumberOfSubstitutionTypes() != nbTypes))
+    throw Exception("SubstitutionMappingTools::" + method + "(). The writer does not match the tree, data or substitution count.");
+}
+
+/******************************************************************************/
+
 ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
   const DRTreeLikelihood& drtl,
   const vector<int>& nodeIds,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  unsigned int nbThreads,
+  BinarySubstitutionMappingWriter* writer) throw (Exception)
 {
-  // Preamble:
   if (!drtl.isInitialized())
     throw Exception("SubstitutionMappingTools::computeSubstitutionVectors(). Likelihood object is not initialized.");
 
-  // A few variables we'll need:
-
-  const TreeTemplate<Node> tree(drtl.getTree());
-  const SiteContainer*    sequences = drtl.getData();
-  const DiscreteDistribution* rDist = drtl.getRateDistribution();
-
-  size_t nbSites         = sequences->getNumberOfSites();
-  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
-  size_t nbStates        = sequences->getAlphabet()->getSize();
-  size_t nbClasses       = rDist->getNumberOfCategories();
-  size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
-  vector<const Node*> nodes    = tree.getNodes();
-  const vector<size_t>* rootPatternLinks
-    = &drtl.getLikelihoodData()->getRootArrayPositions();
-  nodes.pop_back(); // Remove root node.
-  size_t nbNodes         = nodes.size();
-
-  // We create a new ProbabilisticSubstitutionMapping object:
-  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
+  BranchJointLikelihoods joint(drtl, nodeIds);
+  return computeSubstitutionVectors(joint, nodeIds, substitutionCount, verbose, nbThreads, writer);
+}
 
-  // Store likelihood for each rate for each site:
-  VVVdouble lik;
-  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
-  Vdouble Lr(nbDistinctSites, 0);
-  Vdouble rcProbs = rDist->getProbabilities();
-  Vdouble rcRates = rDist->getCategories();
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    VVdouble* lik_i = &lik[i];
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      Vdouble* lik_i_c = &(*lik_i)[c];
-      double rc = rDist->getProbability(c);
-      for (size_t s = 0; s < nbStates; s++)
-      {
-        Lr[i] += (*lik_i_c)[s] * rc;
-      }
-    }
-  }
+/******************************************************************************/
 
-  // Compute the number of substitutions for each class and each branch in the tree:
-  if (verbose)
-    ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
+ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
+  const DRTreeLikelihood& drtl,
+  const SubstitutionModelSet& modelSet,
+  const vector<int>& nodeIds,
+  SubstitutionCount& substitutionCount,
+  bool verbose,
+  unsigned int nbThreads,
+  BinarySubstitutionMappingWriter* writer) throw (Exception)
+{
+  if (!drtl.isInitialized())
+    throw Exception("SubstitutionMappingTools::computeSubstitutionVectors(). Likelihood object is not initialized.");
 
-  for (size_t l = 0; l < nbNodes; ++l)
-  {
-    // For each node,
-    const Node* currentNode = nodes[l];
-    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, currentNode->getId()))
-      continue;
+  BranchJointLikelihoods joint(drtl, nodeIds);
+  return computeSubstitutionVectors(joint, modelSet, nodeIds, substitutionCount, verbose, nbThreads, writer);
+}
 
-    const Node* father = currentNode->getFather();
+/******************************************************************************/
 
-    double d = currentNode->getDistanceToFather();
+ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
+  const BranchJointLikelihoods& joint,
+  const vector<int>& nodeIds,
+  SubstitutionCount& substitutionCount,
+  bool verbose,
+  unsigned int nbThreads,
+  BinarySubstitutionMappingWriter* writer) throw (Exception)
+{
+  const DRTreeLikelihood& drtl = joint.getLikelihood();
+  const vector<size_t>& rootPatternLinks = drtl.getLikelihoodData()->getRootArrayPositions();
+  size_t nbDistinctSites = joint.getNumberOfPatterns();
+  size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
 
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
-    VVdouble substitutionsForCurrentNode(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; ++i)
-    {
-      substitutionsForCurrentNode[i].resize(nbTypes);
-    }
+  // We create a new ProbabilisticSubstitutionMapping object:
+  unique_ptr<ProbabilisticSubstitutionMapping> substitutions(
+    new ProbabilisticSubstitutionMapping(drtl.getTree(), &substitutionCount, rootPatternLinks, nbDistinctSites));
+  checkWriter_(writer, substitutions->getNumberOfBranches(), rootPatternLinks.size(), nbTypes, "computeSubstitutionVectors");
 
-    // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; i++)
+  mapPatterns_(joint, 0, nodeIds, substitutionCount, verbose, nbThreads, [&](size_t l, const VVdouble* counts)
+  {
+    // Copy the substitutions into the result vector, by site pattern:
+    if (counts)
     {
-      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-      likelihoodsFatherConstantPart_i->resize(nbClasses);
-      for (size_t c = 0; c < nbClasses; c++)
+      for (size_t i = 0; i < nbDistinctSites; ++i)
       {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; s++)
+        for (size_t t = 0; t < nbTypes; ++t)
         {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
+          substitutions->getPatternNumberOfSubstitutions(l, i, t) = (*counts)[i][t];
         }
       }
     }
 
-    // First, what will remain constant:
-    size_t nbSons =  father->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; n++)
-    {
-      const Node* currentSon = father->getSon(n);
-      if (currentSon->getId() != currentNode->getId())
-      {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+    // Branches are written as soon as they are mapped:
+    if (writer)
+      writer->writeBranch(l, *substitutions);
+  });
 
-        // Now iterate over all site partitions:
-        unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
-        while (mit->hasNext())
-        {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
-          {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; c++)
-            {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; x++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; y++)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
-            }
-          }
-        }
-      }
-    }
-    if (father->hasFather())
-    {
-      const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-      // Now iterate over all site partitions:
-      unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
-      VVVdouble pxy;
-      bool first;
-      while (mit->hasNext())
-      {
-        TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-        unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-        first = true;
-        while (sit->hasNext())
-        {
-          size_t i = sit->next();
-          // We retrieve the transition probabilities for this site partition:
-          if (first)
-          {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
-            first = false;
-          }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-          for (size_t c = 0; c < nbClasses; c++)
-          {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-            VVdouble* pxy_c = &pxy[c];
-            for (size_t x = 0; x < nbStates; x++)
-            {
-              double likelihood = 0.;
-              for (size_t y = 0; y < nbStates; y++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
-              }
-              (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-            }
-          }
-        }
-      }
-    }
-    else
-    {
-      // Account for root frequencies:
-      for (size_t i = 0; i < nbDistinctSites; i++)
-      {
-        vector<double> freqs = drtl.getRootFrequencies(i);
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; c++)
-        {
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          for (size_t x = 0; x < nbStates; x++)
-          {
-            (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
-          }
-        }
-      }
-    }
+  return substitutions.release();
+}
 
+/******************************************************************************/
 
-    // Then, we deal with the node of interest.
-    // We first average upon 'y' to save computations, and then upon 'x'.
-    // ('y' is the state at 'node' and 'x' the state at 'father'.)
+ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
+  const BranchJointLikelihoods& joint,
+  const SubstitutionModelSet& modelSet,
+  const vector<int>& nodeIds,
+  SubstitutionCount& substitutionCount,
+  bool verbose,
+  unsigned int nbThreads,
+  BinarySubstitutionMappingWriter* writer) throw (Exception)
+{
+  const DRTreeLikelihood& drtl = joint.getLikelihood();
+  const vector<size_t>& rootPatternLinks = drtl.getLikelihoodData()->getRootArrayPositions();
+  size_t nbDistinctSites = joint.getNumberOfPatterns();
+  size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
 
-    // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
-    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
-    VVVdouble pxy;
-    bool first;
-    while (mit->hasNext())
+  // We create a new ProbabilisticSubstitutionMapping object:
+  unique_ptr<ProbabilisticSubstitutionMapping> substitutions(
+    new ProbabilisticSubstitutionMapping(drtl.getTree(), &substitutionCount, rootPatternLinks, nbDistinctSites));
+  checkWriter_(writer, substitutions->getNumberOfBranches(), rootPatternLinks.size(), nbTypes, "computeSubstitutionVectors");
+
+  mapPatterns_(joint, &modelSet, nodeIds, substitutionCount, verbose, nbThreads, [&](size_t l, const VVdouble* counts)
+  {
+    if (counts)
     {
-      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(bmd->getSubstitutionModel());
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
-      for (size_t c = 0; c < nbClasses; ++c)
+      for (size_t i = 0; i < nbDistinctSites; ++i)
       {
-        VVVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        nxy_c->resize(nbTypes);
         for (size_t t = 0; t < nbTypes; ++t)
         {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          nxy_c_t->resize(nbStates);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
-      }
-
-      // Now loop over sites:
-      unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      first = true;
-      while (sit->hasNext())
-      {
-        size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
-        if (first)
-        {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
-          first = false;
-        }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; ++c)
-        {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVVdouble* nxy_c = &nxy[c];
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
-            const Vdouble* pxy_c_x = &(*pxy_c)[x];
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
-                                      * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
-
-              for (size_t t = 0; t < nbTypes; ++t)
-              {
-                // Now the vector computation:
-                substitutionsForCurrentNode[i][t] += likelihood_cxy * (*nxy_c)[t][x][y];
-                //                                   <------------>   <--------------->
-                // Posterior probability                   |                 |
-                // for site i and rate class c *           |                 |
-                // likelihood for this site----------------+                 |
-                //                                                           |
-                // Substitution function for site i and rate class c----------+
-              }
-            }
-          }
+          substitutions->getPatternNumberOfSubstitutions(l, i, t) = (*counts)[i][t];
         }
       }
     }
+    if (writer)
+      writer->writeBranch(l, *substitutions);
+  });
 
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
-    {
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t] / Lr[(*rootPatternLinks)[i]];
-      }
-    }
-  }
-  if (verbose)
-  {
-    if (ApplicationTools::message)
-      *ApplicationTools::message << " ";
-    ApplicationTools::displayTaskDone();
-  }
-
-  return substitutions;
+  return substitutions.release();
 }
 
 /******************************************************************************/
 
-ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
-  const DRTreeLikelihood& drtl,
-  const SubstitutionModelSet& modelSet,
+void SubstitutionMappingTools::mapPatterns_(
+  const BranchJointLikelihoods& joint,
+  const SubstitutionModelSet* modelSet,
   const vector<int>& nodeIds,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  unsigned int nbThreads,
+  const BranchSink_& sink) throw (Exception)
 {
-  // Preamble:
-  if (!drtl.isInitialized())
-    throw Exception("SubstitutionMappingTools::computeSubstitutionVectors(). Likelihood object is not initialized.");
-
   // A few variables we'll need:
-
-  const TreeTemplate<Node> tree(drtl.getTree());
-  const SiteContainer*    sequences = drtl.getData();
-  const DiscreteDistribution* rDist = drtl.getRateDistribution();
-
-  size_t nbSites         = sequences->getNumberOfSites();
-  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
-  size_t nbStates        = sequences->getAlphabet()->getSize();
-  size_t nbClasses       = rDist->getNumberOfCategories();
+  size_t nbDistinctSites = joint.getNumberOfPatterns();
+  size_t nbClasses       = joint.getNumberOfClasses();
   size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
-  vector<const Node*> nodes    = tree.getNodes();
-  const vector<size_t>* rootPatternLinks
-    = &drtl.getLikelihoodData()->getRootArrayPositions();
-  nodes.pop_back(); // Remove root node.
-  size_t nbNodes         = nodes.size();
-
-  // We create a new ProbabilisticSubstitutionMapping object:
-  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
-
-  // Store likelihood for each rate for each site:
-  VVVdouble lik;
-  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
-  Vdouble Lr(nbDistinctSites, 0);
-  Vdouble rcProbs = rDist->getProbabilities();
-  Vdouble rcRates = rDist->getCategories();
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    VVdouble* lik_i = &lik[i];
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      Vdouble* lik_i_c = &(*lik_i)[c];
-      double rc = rDist->getProbability(c);
-      for (size_t s = 0; s < nbStates; s++)
-      {
-        Lr[i] += (*lik_i_c)[s] * rc;
-      }
-    }
-  }
+  size_t nbNodes         = joint.getNumberOfBranches();
+  const Vdouble& rcRates = joint.getRates();
 
   // Compute the number of substitutions for each class and each branch in the tree:
   if (verbose)
-    ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
+    ApplicationTools::displayTask("Compute substitution vectors", true);
 
-  for (size_t l = 0; l < nbNodes; ++l)
+  MappingWorker<SubstitutionCount>::mapBranches(nbNodes, substitutionCount, nbThreads, verbose, [&](size_t l, MappingWorker<SubstitutionCount>& worker)
   {
     // For each node,
-    const Node* currentNode = nodes[l];
-    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, currentNode->getId()))
-      continue;
-
-    const Node* father = currentNode->getFather();
+    int nodeId = joint.getNodeId(l);
+    if (!joint.isComputed(l) || (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, nodeId)))
+    {
+      sink(l, 0);
+      return;
+    }
 
-    double d = currentNode->getDistanceToFather();
+    double d = joint.getBranchLength(l);
 
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
     VVdouble substitutionsForCurrentNode(nbDistinctSites);
     for (size_t i = 0; i < nbDistinctSites; ++i)
     {
       substitutionsForCurrentNode[i].resize(nbTypes);
     }
 
-    // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; i++)
-    {
-      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-      likelihoodsFatherConstantPart_i->resize(nbClasses);
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; s++)
-        {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
-        }
-      }
-    }
-
-    // First, what will remain constant:
-    size_t nbSons =  father->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; n++)
-    {
-      const Node* currentSon = father->getSon(n);
-      if (currentSon->getId() != currentNode->getId())
-      {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-
-        // Now iterate over all site partitions:
-        unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
-        while (mit->hasNext())
-        {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
-          {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; c++)
-            {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; x++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; y++)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
-            }
-          }
-        }
-      }
-    }
-    if (father->hasFather())
-    {
-      const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-      // Now iterate over all site partitions:
-      unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
-      VVVdouble pxy;
-      bool first;
-      while (mit->hasNext())
-      {
-        TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-        unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-        first = true;
-        while (sit->hasNext())
-        {
-          size_t i = sit->next();
-          // We retrieve the transition probabilities for this site partition:
-          if (first)
-          {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
-            first = false;
-          }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-          for (size_t c = 0; c < nbClasses; c++)
-          {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-            VVdouble* pxy_c = &pxy[c];
-            for (size_t x = 0; x < nbStates; x++)
-            {
-              double likelihood = 0.;
-              for (size_t y = 0; y < nbStates; y++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
-              }
-              (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-            }
-          }
-        }
-      }
-    }
-    else
-    {
-      // Account for root frequencies:
-      for (size_t i = 0; i < nbDistinctSites; i++)
-      {
-        vector<double> freqs = drtl.getRootFrequencies(i);
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; c++)
-        {
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          for (size_t x = 0; x < nbStates; x++)
-          {
-            (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
-          }
-        }
-      }
-    }
-
-
-    // Then, we deal with the node of interest.
-    // We first average upon 'y' to save computations, and then upon 'x'.
-    // ('y' is the state at 'node' and 'x' the state at 'father'.)
-
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
-    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
-    VVVdouble pxy;
-    bool first;
-    while (mit->hasNext())
+    const vector<BranchJointLikelihoods::Partition>& partitions = joint.getPartitions(l);
+    for (size_t p = 0; p < partitions.size(); ++p)
     {
-      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(modelSet.getSubstitutionModelForNode(currentNode->getId()));
-
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
+      worker.setSubstitutionModel(modelSet ? modelSet->getSubstitutionModelForNode(nodeId) : partitions[p].model);
+      // compute all nxy first, for all rate classes at once:
+      vector<double> lengths(nbClasses);
       for (size_t c = 0; c < nbClasses; ++c)
       {
-        VVVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          nxy_c_t->resize(nbStates);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
+        lengths[c] = d * rcRates[c];
       }
+      vector< vector< RowMatrix<double> > > nxy;
+      worker.getObject().getAllNumbersOfSubstitutionsForEachLength(lengths, nxy);
 
-      // Now loop over sites:
-      unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      first = true;
-      while (sit->hasNext())
+      // Then average them over the joint likelihoods of all sites:
+      vector< vector<const Matrix<double>*> > values(nbClasses, vector<const Matrix<double>*>(nbTypes));
+      for (size_t c = 0; c < nbClasses; ++c)
       {
-        size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
-        if (first)
-        {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
-          first = false;
-        }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; ++c)
+        for (size_t t = 0; t < nbTypes; ++t)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVVdouble* nxy_c = &nxy[c];
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
-            const Vdouble* pxy_c_x = &(*pxy_c)[x];
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
-                                      * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
-
-              for (size_t t = 0; t < nbTypes; ++t)
-              {
-                // Now the vector computation:
-                substitutionsForCurrentNode[i][t] += likelihood_cxy * (*nxy_c)[t][x][y];
-                //                                   <------------>   <--------------->
-                // Posterior probability                   |                 |
-                // for site i and rate class c *           |                 |
-                // likelihood for this site----------------+                 |
-                //                                                           |
-                // Substitution function for site i and rate class c----------+
-              }
-            }
-          }
+          values[c][t] = &nxy[c][t];
         }
       }
+      joint.computeExpectations(l, p, values, substitutionsForCurrentNode);
     }
 
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
-    {
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t] / Lr[(*rootPatternLinks)[i]];
-      }
-    }
-  }
+    sink(l, &substitutionsForCurrentNode);
+  });
   if (verbose)
   {
     if (ApplicationTools::message)
       *ApplicationTools::message << " ";
     ApplicationTools::displayTaskDone();
   }
-
-  return substitutions;
 }
 
 /**************************************************************************************************/
@@ -685,266 +275,108 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectorsNoAveraging(
   const DRTreeLikelihood& drtl,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  unsigned int nbThreads,
+  BinarySubstitutionMappingWriter* writer) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
     throw Exception("SubstitutionMappingTools::computeSubstitutionVectorsNoAveraging(). Likelihood object is not initialized.");
 
   // A few variables we'll need:
-  const TreeTemplate<Node> tree(drtl.getTree());
-  const SiteContainer*    sequences = drtl.getData();
-  const DiscreteDistribution* rDist = drtl.getRateDistribution();
+  BranchJointLikelihoods joint(drtl, vector<int>());
 
-  size_t nbSites         = sequences->getNumberOfSites();
-  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
-  size_t nbStates        = sequences->getAlphabet()->getSize();
-  size_t nbClasses       = rDist->getNumberOfCategories();
+  size_t nbDistinctSites = joint.getNumberOfPatterns();
+  size_t nbStates        = joint.getNumberOfStates();
+  size_t nbClasses       = joint.getNumberOfClasses();
   size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
-  vector<const Node*> nodes   = tree.getNodes();
+  size_t nbNodes         = joint.getNumberOfBranches();
   const vector<size_t>* rootPatternLinks
     = &drtl.getLikelihoodData()->getRootArrayPositions();
-  nodes.pop_back(); // Remove root node.
-  size_t nbNodes = nodes.size();
+
+  checkWriter_(writer, nbNodes, rootPatternLinks->size(), nbTypes, "computeSubstitutionVectorsNoAveraging");
 
   // We create a new ProbabilisticSubstitutionMapping object:
-  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
+  unique_ptr<ProbabilisticSubstitutionMapping> substitutions(
+    new ProbabilisticSubstitutionMapping(drtl.getTree(), &substitutionCount, *rootPatternLinks, nbDistinctSites));
 
-  Vdouble rcRates = rDist->getCategories();
+  const Vdouble& rcRates = joint.getRates();
+  const Vdouble& rcProbs = joint.getProbabilities();
 
   // Compute the number of substitutions for each class and each branch in the tree:
   if (verbose)
     ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
 
-  for (size_t l = 0; l < nbNodes; ++l)
+  MappingWorker<SubstitutionCount>::mapBranches(nbNodes, substitutionCount, nbThreads, verbose, [&](size_t l, MappingWorker<SubstitutionCount>& worker)
   {
     // For each node,
-    const Node* currentNode = nodes[l];
-
-    const Node* father = currentNode->getFather();
-
-    double d = currentNode->getDistanceToFather();
+    double d = joint.getBranchLength(l);
 
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
     VVdouble substitutionsForCurrentNode(nbDistinctSites);
     for (size_t i = 0; i < nbDistinctSites; ++i)
     {
       substitutionsForCurrentNode[i].resize(nbTypes);
     }
 
-    // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; ++i)
-    {
-      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-      likelihoodsFatherConstantPart_i->resize(nbClasses);
-      for (size_t c = 0; c < nbClasses; ++c)
-      {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; ++s)
-        {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
-        }
-      }
-    }
-
-    // First, what will remain constant:
-    size_t nbSons =  father->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; ++n)
-    {
-      const Node* currentSon = father->getSon(n);
-      if (currentSon->getId() != currentNode->getId())
-      {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-
-        // Now iterate over all site partitions:
-        unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
-        while (mit->hasNext())
-        {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
-          {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; ++c)
-            {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; ++x)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; ++y)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
-            }
-          }
-        }
-      }
-    }
-    if (father->hasFather())
-    {
-      const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-      // Now iterate over all site partitions:
-      unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
-      VVVdouble pxy;
-      bool first;
-      while (mit->hasNext())
-      {
-        TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-        unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-        first = true;
-        while (sit->hasNext())
-        {
-          size_t i = sit->next();
-          // We retrieve the transition probabilities for this site partition:
-          if (first)
-          {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
-            first = false;
-          }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-          for (size_t c = 0; c < nbClasses; ++c)
-          {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-            VVdouble* pxy_c = &pxy[c];
-            for (size_t x = 0; x < nbStates; ++x)
-            {
-              double likelihood = 0.;
-              for (size_t y = 0; y < nbStates; ++y)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
-              }
-              (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-            }
-          }
-        }
-      }
-    }
-    else
-    {
-      // Account for root frequencies:
-      for (size_t i = 0; i < nbDistinctSites; ++i)
-      {
-        vector<double> freqs = drtl.getRootFrequencies(i);
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; ++c)
-        {
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
-          }
-        }
-      }
-    }
-
-    // Then, we deal with the node of interest.
+    // The likelihood of the rest of the tree is read from the double-recursive arrays.
     // We first average uppon 'y' to save computations, and then uppon 'x'.
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
+    const VVVdouble* likelihoodsFatherConstantPart = &joint.getFatherLikelihoods(l);
+    const VVVdouble* likelihoodsFather_node = &joint.getSonLikelihoods(l);
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
-    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
-    VVVdouble pxy;
-    bool first;
-    while (mit->hasNext())
+    const vector<BranchJointLikelihoods::Partition>& partitions = joint.getPartitions(l);
+    for (size_t p = 0; p < partitions.size(); ++p)
     {
-      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(bmd->getSubstitutionModel());
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
+      const BranchJointLikelihoods::Partition& partition = partitions[p];
+      worker.setSubstitutionModel(partition.model);
+      // compute all nxy first, for all rate classes at once:
+      vector<double> lengths(nbClasses);
       for (size_t c = 0; c < nbClasses; ++c)
       {
-        double rc = rcRates[c];
-        VVVdouble* nxy_c = &nxy[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          nxy_c_t->resize(nbStates);
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
+        lengths[c] = d * rcRates[c];
       }
+      vector< vector< RowMatrix<double> > > nxy;
+      worker.getObject().getAllNumbersOfSubstitutionsForEachLength(lengths, nxy);
 
       // Now loop over sites:
-      unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      first = true;
-      while (sit->hasNext())
+      const VVVdouble* pxy = partition.pxy;
+      for (size_t k = 0; k < partition.patterns.size(); ++k)
       {
-        size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
-        if (first)
-        {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
-          first = false;
-        }
+        size_t i = partition.patterns[k];
         const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+        const VVdouble* likelihoodsFatherConstantPart_i = &(*likelihoodsFatherConstantPart)[i];
         RowMatrix<double> pairProbabilities(nbStates, nbStates);
         MatrixTools::fill(pairProbabilities, 0.);
         VVVdouble subsCounts(nbStates);
         for (size_t j = 0; j < nbStates; ++j)
         {
           subsCounts[j].resize(nbStates);
-          for (size_t k = 0; k < nbStates; ++k)
+          for (size_t m = 0; m < nbStates; ++m)
           {
-            subsCounts[j][k].resize(nbTypes);
+            subsCounts[j][m].resize(nbTypes);
           }
         }
         for (size_t c = 0; c < nbClasses; ++c)
         {
           const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVVdouble* nxy_c = &nxy[c];
+          const Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+          const VVdouble* pxy_c = &(*pxy)[c];
+          const vector< RowMatrix<double> >* nxy_c = &nxy[c];
+          double rc = rcProbs[c];
           for (size_t x = 0; x < nbStates; ++x)
           {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
+            double likelihoodsFatherConstantPart_i_c_x = rc * (*likelihoodsFatherConstantPart_i_c)[x];
             const Vdouble* pxy_c_x = &(*pxy_c)[x];
             for (size_t y = 0; y < nbStates; ++y)
             {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
+              double likelihood_cxy = likelihoodsFatherConstantPart_i_c_x
                                       * (*pxy_c_x)[y]
                                       * (*likelihoodsFather_node_i_c)[y];
               pairProbabilities(x, y) += likelihood_cxy; // Sum over all rate classes.
               for (size_t t = 0; t < nbTypes; ++t)
               {
-                subsCounts[x][y][t] += likelihood_cxy * (*nxy_c)[t][x][y];
+                subsCounts[x][y][t] += likelihood_cxy * (*nxy_c)[t](x, y);
               }
             }
           }
@@ -959,22 +391,25 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
         }
       }
     }
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; i++)
+    // Now we just have to copy the substitutions into the result vector, by site pattern:
+    for (size_t i = 0; i < nbDistinctSites; ++i)
     {
-      for (size_t t = 0; t < nbTypes; t++)
+      for (size_t t = 0; t < nbTypes; ++t)
       {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t];
+        substitutions->getPatternNumberOfSubstitutions(l, i, t) = substitutionsForCurrentNode[i][t];
       }
     }
-  }
+
+    if (writer)
+      writer->writeBranch(l, *substitutions);
+  });
   if (verbose)
   {
     if (ApplicationTools::message)
       *ApplicationTools::message << " ";
     ApplicationTools::displayTaskDone();
   }
-  return substitutions;
+  return substitutions.release();
 }
 
 /**************************************************************************************************/
@@ -982,7 +417,9 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectorsNoAveragingMarginal(
   const DRTreeLikelihood& drtl,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  unsigned int nbThreads,
+  BinarySubstitutionMappingWriter* writer) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
@@ -995,7 +432,6 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   const DiscreteDistribution* rDist = drtl.getRateDistribution();
   const Alphabet*             alpha = sequences->getAlphabet();
 
-  size_t nbSites         = sequences->getNumberOfSites();
   size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
   size_t nbStates        = alpha->getSize();
   size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
@@ -1005,8 +441,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   nodes.pop_back(); // Remove root node.
   size_t nbNodes = nodes.size();
 
+  checkWriter_(writer, nbNodes, rootPatternLinks->size(), nbTypes, "computeSubstitutionVectorsNoAveragingMarginal");
+
   // We create a new ProbabilisticSubstitutionMapping object:
-  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
+  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, *rootPatternLinks, nbDistinctSites);
 
   // Compute the whole likelihood of the tree according to the specified model:
 
@@ -1024,7 +462,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   if (verbose)
     ApplicationTools::displayTask("Compute substitution vectors", true);
 
-  for (size_t l = 0; l < nbNodes; l++)
+  MappingWorker<SubstitutionCount>::mapBranches(nbNodes, substitutionCount, nbThreads, verbose, [&](size_t l, MappingWorker<SubstitutionCount>& worker)
   {
     const Node* currentNode = nodes[l];
 
@@ -1032,12 +470,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 
     double d = currentNode->getDistanceToFather();
 
-    vector<size_t> nodeStates = ancestors[currentNode->getId()]; // These are not 'true' ancestors ;)
-    vector<size_t> fatherStates = ancestors[father->getId()];
+    vector<size_t> nodeStates = ancestors.at(currentNode->getId()); // These are not 'true' ancestors ;)
+    vector<size_t> fatherStates = ancestors.at(father->getId());
 
     // For each node,
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
     VVdouble substitutionsForCurrentNode(nbDistinctSites);
     for (size_t i = 0; i < nbDistinctSites; ++i)
     {
@@ -1053,13 +489,13 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     while (mit->hasNext())
     {
       TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(bmd->getSubstitutionModel());
+      worker.setSubstitutionModel(bmd->getSubstitutionModel());
       // compute all nxy first:
       VVVdouble nxyt(nbTypes);
       for (size_t t = 0; t < nbTypes; ++t)
       {
         nxyt[t].resize(nbStates);
-        Matrix<double>* nxy = substitutionCount.getAllNumbersOfSubstitutions(d, t + 1);
+        Matrix<double>* nxy = worker.getObject().getAllNumbersOfSubstitutions(d, t + 1);
         for (size_t x = 0; x < nbStates; ++x)
         {
           nxyt[t][x].resize(nbStates);
@@ -1090,15 +526,18 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       }
     }
 
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; i++)
+    // Now we just have to copy the substitutions into the result vector, by site pattern:
+    for (size_t i = 0; i < nbDistinctSites; ++i)
     {
-      for (size_t t = 0; t < nbTypes; t++)
+      for (size_t t = 0; t < nbTypes; ++t)
       {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t];
+        substitutions->getPatternNumberOfSubstitutions(l, i, t) = substitutionsForCurrentNode[i][t];
       }
     }
-  }
+
+    if (writer)
+      writer->writeBranch(l, *substitutions);
+  });
   if (verbose)
   {
     if (ApplicationTools::message)
@@ -1113,7 +552,9 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectorsMarginal(
   const DRTreeLikelihood& drtl,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  unsigned int nbThreads,
+  BinarySubstitutionMappingWriter* writer) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
@@ -1125,7 +566,6 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   const SiteContainer*    sequences = drtl.getData();
   const DiscreteDistribution* rDist = drtl.getRateDistribution();
 
-  size_t nbSites         = sequences->getNumberOfSites();
   size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
   size_t nbStates        = sequences->getAlphabet()->getSize();
   size_t nbClasses       = rDist->getNumberOfCategories();
@@ -1136,8 +576,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   nodes.pop_back(); // Remove root node.
   size_t nbNodes = nodes.size();
 
+  checkWriter_(writer, nbNodes, rootPatternLinks->size(), nbTypes, "computeSubstitutionVectorsMarginal");
+
   // We create a new ProbabilisticSubstitutionMapping object:
-  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
+  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, *rootPatternLinks, nbDistinctSites);
 
   // Compute the whole likelihood of the tree according to the specified model:
 
@@ -1148,7 +590,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   if (verbose)
     ApplicationTools::displayTask("Compute marginal node-pairs likelihoods", true);
 
-  for (size_t l = 0; l < nbNodes; l++)
+  MappingWorker<SubstitutionCount>::mapBranches(nbNodes, substitutionCount, nbThreads, verbose, [&](size_t l, MappingWorker<SubstitutionCount>& worker)
   {
     const Node* currentNode = nodes[l];
 
@@ -1157,8 +599,6 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     double d = currentNode->getDistanceToFather();
 
     // For each node,
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
     VVdouble substitutionsForCurrentNode(nbDistinctSites);
     for (size_t i = 0; i < nbDistinctSites; ++i)
     {
@@ -1175,31 +615,15 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     while (mit->hasNext())
     {
       TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(bmd->getSubstitutionModel());
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
+      worker.setSubstitutionModel(bmd->getSubstitutionModel());
+      // compute all nxy first, for all rate classes at once:
+      vector<double> lengths(nbClasses);
       for (size_t c = 0; c < nbClasses; ++c)
       {
-        VVVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          nxy_c_t->resize(nbStates);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
+        lengths[c] = d * rcRates[c];
       }
+      vector< vector< RowMatrix<double> > > nxy;
+      worker.getObject().getAllNumbersOfSubstitutionsForEachLength(lengths, nxy);
 
       // Now loop over sites:
       unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
@@ -1212,7 +636,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
         {
           Vdouble* probsNode_i_c   = &(*probsNode_i)[c];
           Vdouble* probsFather_i_c = &(*probsFather_i)[c];
-          VVVdouble* nxy_c = &nxy[c];
+          const vector< RowMatrix<double> >* nxy_c = &nxy[c];
           for (size_t x = 0; x < nbStates; ++x)
           {
             for (size_t y = 0; y < nbStates; ++y)
@@ -1221,7 +645,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               // Now the vector computation:
               for (size_t t = 0; t < nbTypes; ++t)
               {
-                substitutionsForCurrentNode[i][t] += prob_cxy * (*nxy_c)[t][x][y];
+                substitutionsForCurrentNode[i][t] += prob_cxy * (*nxy_c)[t](x, y);
                 //                                   <------>   <--------------->
                 // Posterior probability                 |                |
                 // for site i and rate class c *         |                |
@@ -1235,15 +659,18 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       }
     }
 
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
+    // Now we just have to copy the substitutions into the result vector, by site pattern:
+    for (size_t i = 0; i < nbDistinctSites; ++i)
     {
       for (size_t t = 0; t < nbTypes; ++t)
       {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t];
+        substitutions->getPatternNumberOfSubstitutions(l, i, t) = substitutionsForCurrentNode[i][t];
       }
     }
-  }
+
+    if (writer)
+      writer->writeBranch(l, *substitutions);
+  });
   if (verbose)
   {
     if (ApplicationTools::message)
@@ -1416,80 +843,108 @@ vector<double> SubstitutionMappingTools::computeSumForSite(const SubstitutionMap
 
 /**************************************************************************************************/
 
-vector< vector<double> > SubstitutionMappingTools::getCountsPerBranch(
-  DRTreeLikelihood& drtl,
+vector< vector<double> > SubstitutionMappingTools::sumCountsPerBranch_(
+  const DRTreeLikelihood& drtl,
   const vector<int>& ids,
-  SubstitutionModel* model,
-  const SubstitutionRegister& reg,
+  size_t nbTypes,
   double threshold,
-  bool verbose)
+  bool verbose,
+  const function<void (const BranchSink_&)>& mapper)
 {
-  SubstitutionRegister* reg2 = reg.clone();
+  if (!drtl.isInitialized())
+    throw Exception("SubstitutionMappingTools::computeCountsPerBranch(). Likelihood object is not initialized.");
 
-  unique_ptr<SubstitutionCount> count(new UniformizationSubstitutionCount(model, reg2));
+  vector< vector<double> > counts(ids.size(), vector<double>(nbTypes, 0));
+  if (ids.size() == 0)
+    return counts;
 
-  unique_ptr<ProbabilisticSubstitutionMapping> mapping(SubstitutionMappingTools::computeSubstitutionVectors(drtl, ids, *count, false));
+  const TreeTemplate<Node> tree(drtl.getTree());
+  vector<const Node*> nodes = tree.getNodes();
+  nodes.pop_back(); // Remove root node.
+  for (size_t k = 0; k < ids.size(); ++k)
+  {
+    tree.getNode(ids[k]); // Throws if the node is not in the tree.
+    if (ids[k] == tree.getRootId())
+      throw NodeNotFoundException("SubstitutionMappingTools::computeCountsPerBranch(). No branch leads to the root node.", ids[k]);
+  }
 
-  vector< vector<double> > counts(ids.size());
-  size_t nbSites = mapping->getNumberOfSites();
-  size_t nbTypes = mapping->getNumberOfSubstitutionTypes();
+  // Position of each branch in the output, or ids.size() if it is not counted.
+  // A branch given several times is counted at its first position, and copied to the others afterwards:
+  vector<size_t> positions(nodes.size(), ids.size());
+  for (size_t j = 0; j < nodes.size(); ++j)
+  {
+    if (VectorTools::contains(ids, nodes[j]->getId()))
+      positions[j] = VectorTools::which(ids, nodes[j]->getId());
+  }
 
-  for (size_t k = 0; k < ids.size(); ++k)
+  // Each pattern is weighted by the number of sites it stands for, whatever the weights used for the likelihood:
+  const vector<size_t>& rootPatternLinks = drtl.getLikelihoodData()->getRootArrayPositions();
+  size_t nbSites = rootPatternLinks.size();
+  vector<size_t> weights(drtl.getLikelihoodData()->getNumberOfDistinctSites(), 0);
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    weights[rootPatternLinks[i]]++;
+  }
+  vector<size_t> nbIgnored(ids.size(), 0);
+  vector<unsigned char> errors(ids.size(), 0);
+
+  // Counts of each pattern are weighted and summed as soon as a branch is mapped:
+  mapper([&](size_t l, const VVdouble* patternCounts)
   {
-    vector<double> countsf(nbTypes, 0);
-    vector<double> tmp(nbTypes, 0);
-    size_t nbIgnored = 0;
-    bool error = false;
-    for (size_t i = 0; !error && i < nbSites; ++i)
+    size_t k = positions[l];
+    if (!patternCounts || k == ids.size())
+      return;
+    vector<double>& countsk = counts[k];
+    for (size_t i = 0; i < patternCounts->size(); ++i)
     {
+      const vector<double>& tmp = (*patternCounts)[i];
       double s = 0;
       for (size_t t = 0; t < nbTypes; ++t)
       {
-        tmp[t] = (*mapping)(mapping->getNodeIndex(ids[k]), i, t);
-        error = std::isnan(tmp[t]);
-        if (error)
-          goto ERROR;
+        if (std::isnan(tmp[t]))
+        {
+          // We do nothing. This happens for small branches.
+          errors[k] = 1;
+          countsk.assign(nbTypes, 0);
+          return;
+        }
         s += tmp[t];
       }
-      if (threshold >= 0)
+      if (threshold >= 0 && s > threshold)
       {
-        if (s <= threshold)
-          countsf += tmp;
-        else
-        {
-          nbIgnored++;
-        }
+        nbIgnored[k] += weights[i];
       }
       else
       {
-        countsf += tmp;
+        for (size_t t = 0; t < nbTypes; ++t)
+        {
+          countsk[t] += static_cast<double>(weights[i]) * tmp[t];
+        }
       }
     }
+  });
 
-ERROR:
-    if (error)
-    {
-      // We do nothing. This happens for small branches.
-      if (verbose)
-        ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", counts could not be computed.");
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        countsf[t] = 0;
-      }
-    }
-    else
+  for (size_t k = 0; k < ids.size(); ++k)
+  {
+    size_t first = VectorTools::which(ids, ids[k]);
+    if (first != k)
     {
-      if (nbIgnored > 0)
-      {
-        if (verbose)
-          ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", " + TextTools::toString(nbIgnored) + " sites (" + TextTools::toString(ceil(static_cast<double>(nbIgnored * 100) / static_cast<double>(nbSites))) + "%) have been ignored because they are presumably saturated.");
-      }
+      counts[k]    = counts[first];
+      nbIgnored[k] = nbIgnored[first];
+      errors[k]    = errors[first];
     }
+  }
 
-    counts[k].resize(countsf.size());
-    for (size_t j = 0; j < countsf.size(); ++j)
+  if (verbose)
+  {
+    for (size_t k = 0; k < ids.size(); ++k)
     {
-      counts[k][j] = countsf[j];
+      if (VectorTools::which(ids, ids[k]) != k)
+        continue; // Already reported.
+      if (errors[k])
+        ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", counts could not be computed.");
+      else if (nbIgnored[k] > 0)
+        ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", " + TextTools::toString(nbIgnored[k]) + " sites (" + TextTools::toString(ceil(static_cast<double>(nbIgnored[k] * 100) / static_cast<double>(nbSites))) + "%) have been ignored because they are presumably saturated.");
     }
   }
 
@@ -1498,84 +953,120 @@ ERROR:
 
 /**************************************************************************************************/
 
+vector< vector<double> > SubstitutionMappingTools::computeCountsPerBranch(
+  const DRTreeLikelihood& drtl,
+  const vector<int>& ids,
+  SubstitutionCount& substitutionCount,
+  double threshold,
+  bool verbose,
+  unsigned int nbThreads) throw (Exception)
+{
+  if (!drtl.isInitialized())
+    throw Exception("SubstitutionMappingTools::computeCountsPerBranch(). Likelihood object is not initialized.");
+  if (ids.size() == 0)
+    return vector< vector<double> >();
+
+  BranchJointLikelihoods joint(drtl, ids);
+  return computeCountsPerBranch(joint, ids, substitutionCount, threshold, verbose, nbThreads);
+}
+
+/**************************************************************************************************/
+
+vector< vector<double> > SubstitutionMappingTools::computeCountsPerBranch(
+  const DRTreeLikelihood& drtl,
+  const SubstitutionModelSet& modelSet,
+  const vector<int>& ids,
+  SubstitutionCount& substitutionCount,
+  double threshold,
+  bool verbose,
+  unsigned int nbThreads) throw (Exception)
+{
+  if (!drtl.isInitialized())
+    throw Exception("SubstitutionMappingTools::computeCountsPerBranch(). Likelihood object is not initialized.");
+  if (ids.size() == 0)
+    return vector< vector<double> >();
+
+  BranchJointLikelihoods joint(drtl, ids);
+  return computeCountsPerBranch(joint, modelSet, ids, substitutionCount, threshold, verbose, nbThreads);
+}
+
+/**************************************************************************************************/
+
+vector< vector<double> > SubstitutionMappingTools::computeCountsPerBranch(
+  const BranchJointLikelihoods& joint,
+  const vector<int>& ids,
+  SubstitutionCount& substitutionCount,
+  double threshold,
+  bool verbose,
+  unsigned int nbThreads) throw (Exception)
+{
+  for (size_t k = 0; k < ids.size(); ++k)
+  {
+    if (!joint.isComputed(joint.getBranchIndex(ids[k])))
+      throw Exception("SubstitutionMappingTools::computeCountsPerBranch(). Joint likelihoods were not computed for branch " + TextTools::toString(ids[k]) + ".");
+  }
+  return sumCountsPerBranch_(joint.getLikelihood(), ids, substitutionCount.getNumberOfSubstitutionTypes(), threshold, verbose,
+                             [&](const BranchSink_& sink)
+  {
+    mapPatterns_(joint, 0, ids, substitutionCount, false, nbThreads, sink);
+  });
+}
+
+/**************************************************************************************************/
+
+vector< vector<double> > SubstitutionMappingTools::computeCountsPerBranch(
+  const BranchJointLikelihoods& joint,
+  const SubstitutionModelSet& modelSet,
+  const vector<int>& ids,
+  SubstitutionCount& substitutionCount,
+  double threshold,
+  bool verbose,
+  unsigned int nbThreads) throw (Exception)
+{
+  for (size_t k = 0; k < ids.size(); ++k)
+  {
+    if (!joint.isComputed(joint.getBranchIndex(ids[k])))
+      throw Exception("SubstitutionMappingTools::computeCountsPerBranch(). Joint likelihoods were not computed for branch " + TextTools::toString(ids[k]) + ".");
+  }
+  return sumCountsPerBranch_(joint.getLikelihood(), ids, substitutionCount.getNumberOfSubstitutionTypes(), threshold, verbose,
+                             [&](const BranchSink_& sink)
+  {
+    mapPatterns_(joint, &modelSet, ids, substitutionCount, false, nbThreads, sink);
+  });
+}
+
+/**************************************************************************************************/
+
 vector< vector<double> > SubstitutionMappingTools::getCountsPerBranch(
   DRTreeLikelihood& drtl,
   const vector<int>& ids,
-  const SubstitutionModelSet& modelSet,
+  SubstitutionModel* model,
   const SubstitutionRegister& reg,
   double threshold,
   bool verbose)
 {
   SubstitutionRegister* reg2 = reg.clone();
 
-  unique_ptr<SubstitutionCount> count(new UniformizationSubstitutionCount(modelSet.getSubstitutionModel(0), reg2));
-
-  unique_ptr<ProbabilisticSubstitutionMapping> mapping(SubstitutionMappingTools::computeSubstitutionVectors(drtl, modelSet, ids, *count, false));
+  unique_ptr<SubstitutionCount> count(new UniformizationSubstitutionCount(model, reg2));
 
-  vector< vector<double> > counts(ids.size());
-  size_t nbSites = mapping->getNumberOfSites();
-  size_t nbTypes = mapping->getNumberOfSubstitutionTypes();
+  return computeCountsPerBranch(drtl, ids, *count, threshold, verbose);
+}
 
-  for (size_t k = 0; k < ids.size(); ++k)
-  {
-    vector<double> countsf(nbTypes, 0);
-    vector<double> tmp(nbTypes, 0);
-    size_t nbIgnored = 0;
-    bool error = false;
-    for (size_t i = 0; !error && i < nbSites; ++i)
-    {
-      double s = 0;
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        tmp[t] = (*mapping)(mapping->getNodeIndex(ids[k]), i, t);
-        error = std::isnan(tmp[t]);
-        if (error)
-          goto ERROR;
-        s += tmp[t];
-      }
-      if (threshold >= 0)
-      {
-        if (s <= threshold)
-          countsf += tmp;
-        else
-        {
-          nbIgnored++;
-        }
-      }
-      else
-      {
-        countsf += tmp;
-      }
-    }
+/**************************************************************************************************/
 
-ERROR:
-    if (error)
-    {
-      // We do nothing. This happens for small branches.
-      if (verbose)
-        ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", counts could not be computed.");
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        countsf[t] = 0;
-      }
-    }
-    else
-    {
-      if (nbIgnored > 0)
-      {
-        if (verbose)
-          ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", " + TextTools::toString(nbIgnored) + " sites (" + TextTools::toString(ceil(static_cast<double>(nbIgnored * 100) / static_cast<double>(nbSites))) + "%) have been ignored because they are presumably saturated.");
-      }
-    }
+vector< vector<double> > SubstitutionMappingTools::getCountsPerBranch(
+  DRTreeLikelihood& drtl,
+  const vector<int>& ids,
+  const SubstitutionModelSet& modelSet,
+  const SubstitutionRegister& reg,
+  double threshold,
+  bool verbose)
+{
+  SubstitutionRegister* reg2 = reg.clone();
 
-    counts[k].resize(countsf.size());
-    for (size_t j = 0; j < countsf.size(); ++j)
-    {
-      counts[k][j] = countsf[j];
-    }
-  }
+  unique_ptr<SubstitutionCount> count(new UniformizationSubstitutionCount(modelSet.getSubstitutionModel(0), reg2));
 
-  return counts;
+  return computeCountsPerBranch(drtl, modelSet, ids, *count, threshold, verbose);
 }
 
 /**************************************************************************************************/
@@ -1586,10 +1077,27 @@ vector< vector<double> > SubstitutionMappingTools::getNormalizationsPerBranch(
   const SubstitutionModel* nullModel,
   const SubstitutionRegister& reg,
   bool verbose)
+{
+  if (ids.size() == 0)
+    return vector< vector<double> >();
+
+  // The joint likelihoods are shared by the mappings of all types:
+  BranchJointLikelihoods joint(drtl, ids);
+  return computeNormalizationsPerBranch_(joint, ids, nullModel, reg, verbose);
+}
+
+/**************************************************************************************************/
+
+vector< vector<double> > SubstitutionMappingTools::computeNormalizationsPerBranch_(
+  const BranchJointLikelihoods& joint,
+  const vector<int>& ids,
+  const SubstitutionModel* nullModel,
+  const SubstitutionRegister& reg,
+  bool verbose)
 {
   size_t nbTypes = reg.getNumberOfSubstitutionTypes();
   size_t nbStates = nullModel->getAlphabet()->getSize();
-  size_t nbSites = drtl.getNumberOfSites();
+  size_t nbSites = joint.getLikelihood().getNumberOfSites();
   vector<int> supportedStates = nullModel->getAlphabetStates();
 
   // compute the AlphabetIndex for each substitutionType
@@ -1628,14 +1136,15 @@ vector< vector<double> > SubstitutionMappingTools::getNormalizationsPerBranch(
   {
     unique_ptr<Reward> reward(new DecompositionReward(nullModel, &usai[nbt]));
 
-    unique_ptr<ProbabilisticRewardMapping> mapping(RewardMappingTools::computeRewardVectors(drtl, ids, *reward, false));
+    unique_ptr<ProbabilisticRewardMapping> mapping(RewardMappingTools::computeRewardVectors(joint, ids, *reward, false));
 
     for (size_t k = 0; k < ids.size(); ++k)
     {
+      size_t branchIndex = mapping->getNodeIndex(ids[k]);
       double s = 0;
       for (size_t i = 0; i < nbSites; ++i)
       {
-        double tmp = (*mapping)(k, i);
+        double tmp = (*mapping)(branchIndex, i);
         if (std::isnan(tmp))
         {
           if (verbose)
@@ -1661,10 +1170,27 @@ vector< vector<double> > SubstitutionMappingTools::getNormalizationsPerBranch(
   const SubstitutionModelSet* nullModelSet,
   const SubstitutionRegister& reg,
   bool verbose)
+{
+  if (ids.size() == 0)
+    return vector< vector<double> >();
+
+  // The joint likelihoods are shared by the mappings of all models and types:
+  BranchJointLikelihoods joint(drtl, ids);
+  return computeNormalizationsPerBranch_(joint, ids, nullModelSet, reg, verbose);
+}
+
+/**************************************************************************************************/
+
+vector< vector<double> > SubstitutionMappingTools::computeNormalizationsPerBranch_(
+  const BranchJointLikelihoods& joint,
+  const vector<int>& ids,
+  const SubstitutionModelSet* nullModelSet,
+  const SubstitutionRegister& reg,
+  bool verbose)
 {
   size_t nbTypes = reg.getNumberOfSubstitutionTypes();
   size_t nbStates = nullModelSet->getAlphabet()->getSize();
-  size_t nbSites = drtl.getNumberOfSites();
+  size_t nbSites = joint.getLikelihood().getNumberOfSites();
   size_t nbModels = nullModelSet->getNumberOfModels();
 
   // compute the AlphabetIndex for each substitutionType
@@ -1711,7 +1237,7 @@ vector< vector<double> > SubstitutionMappingTools::getNormalizationsPerBranch(
       {
         unique_ptr<Reward> reward(new DecompositionReward(nullModelSet->getSubstitutionModel(nbm), &usai[nbt]));
         
-        unique_ptr<ProbabilisticRewardMapping> mapping(RewardMappingTools::computeRewardVectors(drtl, mids, *reward, false));
+        unique_ptr<ProbabilisticRewardMapping> mapping(RewardMappingTools::computeRewardVectors(joint, mids, *reward, false));
         
         for (size_t k = 0; k < mids.size(); k++)
         {
@@ -1754,8 +1280,11 @@ vector< vector<double> > SubstitutionMappingTools::getNormalizedCountsPerBranch(
   vector< vector<double> > counts;
   vector< vector<double> > factors;
 
-  counts = getCountsPerBranch(drtl, ids, model, reg, -1, verbose);
-  factors = getNormalizationsPerBranch(drtl, ids, nullModel, reg, verbose);
+  // The joint likelihoods are shared by the counts and the normalizations:
+  BranchJointLikelihoods joint(drtl, ids);
+  unique_ptr<SubstitutionCount> count(new UniformizationSubstitutionCount(model, reg.clone()));
+  counts = computeCountsPerBranch(joint, ids, *count, -1, verbose);
+  factors = computeNormalizationsPerBranch_(joint, ids, nullModel, reg, verbose);
 
   size_t nbTypes = counts[0].size();
 
@@ -1797,8 +1326,11 @@ vector< vector<double> > SubstitutionMappingTools::getNormalizedCountsPerBranch(
   vector< vector<double> > counts;
   vector< vector<double> > factors;
 
-  counts = getCountsPerBranch(drtl, ids, modelSet->getSubstitutionModel(0), reg, -1, verbose);
-  factors = getNormalizationsPerBranch(drtl, ids, nullModelSet, reg, verbose);
+  // The joint likelihoods are shared by the counts and the normalizations:
+  BranchJointLikelihoods joint(drtl, ids);
+  unique_ptr<SubstitutionCount> count(new UniformizationSubstitutionCount(modelSet->getSubstitutionModel(0), reg.clone()));
+  counts = computeCountsPerBranch(joint, ids, *count, -1, verbose);
+  factors = computeNormalizationsPerBranch_(joint, ids, nullModelSet, reg, verbose);
 
   size_t nbTypes = counts[0].size();
 
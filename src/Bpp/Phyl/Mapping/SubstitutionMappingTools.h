@@ -43,8 +43,13 @@
 #include "ProbabilisticSubstitutionMapping.h"
 #include "SubstitutionCount.h"
 #include "OneJumpSubstitutionCount.h"
+#include "BinarySubstitutionMapping.h"
+#include "BranchJointLikelihoods.h"
 #include "../Likelihood/DRTreeLikelihood.h"
 
+// From the STL:
+#include <functional>
+
 namespace bpp
 {
 /**
@@ -58,6 +63,15 @@ namespace bpp
  * A model-based approach for detecting coevolving positions in a molecule.
  * Mol Biol Evol. 2005 Sep;22(9):1919-28. Epub 2005 Jun 8.
  *
+ * Branches are mapped independently, and may be distributed on several threads.
+ * Each thread then uses its own copy of the SubstitutionCount object and of the substitution models,
+ * as these cache intermediate results.
+ *
+ * The joint likelihoods of the states at both ends of each branch do not depend on the substitution count.
+ * When several mappings are computed from the same likelihood object, they can be gathered once with a
+ * BranchJointLikelihoods object, and given to computeSubstitutionVectors and computeCountsPerBranch
+ * (and to RewardMappingTools::computeRewardVectors).
+ *
  * @author Julien Dutheil
  */
 class SubstitutionMappingTools
@@ -74,16 +88,18 @@ public:
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The SubstitutionCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception)
+    bool verbose = true,
+    unsigned int nbThreads = 1) throw (Exception)
   {
     std::vector<int> nodeIds;
-    return computeSubstitutionVectors(drtl, nodeIds, substitutionCount, verbose);
+    return computeSubstitutionVectors(drtl, nodeIds, substitutionCount, verbose, nbThreads);
   }
 
   /**
@@ -96,6 +112,10 @@ public:
    *                          on all nodes.
    * @param substitutionCount The SubstitutionCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
+   * @param writer            If not null, each branch is written with this object as soon as it is mapped.
+   *                          The writer must have been created for the tree and the data of the likelihood object,
+   *                          with the number of types of the substitution count.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
@@ -103,14 +123,55 @@ public:
     const DRTreeLikelihood& drtl,
     const std::vector<int>& nodeIds,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    unsigned int nbThreads = 1,
+    BinarySubstitutionMappingWriter* writer = 0) throw (Exception);
 
+  /**
+   * @brief Compute the substitutions vectors with the models of a SubstitutionModelSet.
+   *
+   * The model of each branch is taken from 'modelSet' instead of the likelihood object.
+   * Other parameters are as in the previous method.
+   */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
     const DRTreeLikelihood& drtl,
     const SubstitutionModelSet& modelSet,
     const std::vector<int>& nodeIds,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    unsigned int nbThreads = 1,
+    BinarySubstitutionMappingWriter* writer = 0) throw (Exception);
+
+  /**
+   * @brief Compute the substitutions vectors from precomputed joint likelihoods.
+   *
+   * @param joint             The joint likelihoods of the branches.
+   * @param nodeIds           The Ids of the nodes the substitutions are counted on,
+   *                          among the branches computed in 'joint'. If empty, count substitutions
+   *                          on all branches computed in 'joint'.
+   * @param substitutionCount The SubstitutionCount to use.
+   * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
+   * @param writer            If not null, each branch is written with this object as soon as it is mapped.
+   * @return A vector of substitutions vectors (one for each site).
+   * @throw Exception If an error occured during the mapping.
+   */
+  static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
+    const BranchJointLikelihoods& joint,
+    const std::vector<int>& nodeIds,
+    SubstitutionCount& substitutionCount,
+    bool verbose = true,
+    unsigned int nbThreads = 1,
+    BinarySubstitutionMappingWriter* writer = 0) throw (Exception);
+
+  static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
+    const BranchJointLikelihoods& joint,
+    const SubstitutionModelSet& modelSet,
+    const std::vector<int>& nodeIds,
+    SubstitutionCount& substitutionCount,
+    bool verbose = true,
+    unsigned int nbThreads = 1,
+    BinarySubstitutionMappingWriter* writer = 0) throw (Exception);
 
   /**
    * @brief Compute the substitutions vectors for a particular dataset using the
@@ -129,13 +190,17 @@ public:
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The substitutionsCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
+   * @param writer            If not null, each branch is written with this object as soon as it is mapped.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectorsNoAveraging(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    unsigned int nbThreads = 1,
+    BinarySubstitutionMappingWriter* writer = 0) throw (Exception);
 
 
   /**
@@ -153,13 +218,17 @@ public:
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The substitutionsCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
+   * @param writer            If not null, each branch is written with this object as soon as it is mapped.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectorsNoAveragingMarginal(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    unsigned int nbThreads = 1,
+    BinarySubstitutionMappingWriter* writer = 0) throw (Exception);
 
 
   /**
@@ -174,13 +243,17 @@ public:
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The substitutionsCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
+   * @param writer            If not null, each branch is written with this object as soon as it is mapped.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectorsMarginal(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    unsigned int nbThreads = 1,
+    BinarySubstitutionMappingWriter* writer = 0) throw (Exception);
 
 
   /**
@@ -209,6 +282,8 @@ public:
    * Only one type of substitution can be output at a time.
    * @param out           The output stream where to write the vectors.
    * @throw IOException If an output error happens.
+   *
+   * @see BinarySubstitutionMappingWriter for a compact binary format with all types.
    */
   static void writeToStream(
     const ProbabilisticSubstitutionMapping& substitutions,
@@ -281,9 +356,77 @@ public:
   static std::vector<double> computeSumForSite(const SubstitutionMapping& smap, size_t siteIndex);
 
 
+  /**
+   * @brief Compute the total number of substitutions on each branch, for each type.
+   *
+   * The numbers of each distinct site pattern are weighted by the number of sites with this pattern,
+   * and summed as soon as a branch is mapped, so that the mapping of all sites is never stored.
+   *
+   * @param drtl              A DRTreeLikelihood object.
+   * @param ids               The ids of the nodes of the branches to map. A branch given several times is mapped once.
+   * @param substitutionCount The SubstitutionCount to use.
+   * @param threshold         Value above which the total number of substitutions of a site is considered saturated,
+   *                          and the site is ignored (default: -1 means no threshold).
+   * @param verbose           Display progress messages.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
+   * @return A vector of substitutions vectors (one per branch per type).
+   * Counts are set to 0 on branches where they could not be computed.
+   * @throw Exception If the likelihood object is not initialized.
+   * @throw NodeNotFoundException If an id is not in the tree, or is the one of the root node.
+   */
+  static std::vector< std::vector<double> > computeCountsPerBranch(
+    const DRTreeLikelihood& drtl,
+    const std::vector<int>& ids,
+    SubstitutionCount& substitutionCount,
+    double threshold = -1,
+    bool verbose = true,
+    unsigned int nbThreads = 1) throw (Exception);
+
+  static std::vector< std::vector<double> > computeCountsPerBranch(
+    const DRTreeLikelihood& drtl,
+    const SubstitutionModelSet& modelSet,
+    const std::vector<int>& ids,
+    SubstitutionCount& substitutionCount,
+    double threshold = -1,
+    bool verbose = true,
+    unsigned int nbThreads = 1) throw (Exception);
+
+  /**
+   * @brief Compute the total number of substitutions on each branch, for each type, from precomputed joint likelihoods.
+   *
+   * @param joint             The joint likelihoods of the branches, which must have been computed for all branches in 'ids'.
+   * @param ids               The ids of the nodes of the branches to map. A branch given several times is mapped once.
+   * @param substitutionCount The SubstitutionCount to use.
+   * @param threshold         Value above which the total number of substitutions of a site is considered saturated,
+   *                          and the site is ignored (default: -1 means no threshold).
+   * @param verbose           Display progress messages.
+   * @param nbThreads         The number of threads to use (0 to use the number of available cores).
+   * @return A vector of substitutions vectors (one per branch per type).
+   * @throw Exception If a branch has not been computed in 'joint'.
+   * @throw NodeNotFoundException If an id is not in the tree, or is the one of the root node.
+   */
+  static std::vector< std::vector<double> > computeCountsPerBranch(
+    const BranchJointLikelihoods& joint,
+    const std::vector<int>& ids,
+    SubstitutionCount& substitutionCount,
+    double threshold = -1,
+    bool verbose = true,
+    unsigned int nbThreads = 1) throw (Exception);
+
+  static std::vector< std::vector<double> > computeCountsPerBranch(
+    const BranchJointLikelihoods& joint,
+    const SubstitutionModelSet& modelSet,
+    const std::vector<int>& ids,
+    SubstitutionCount& substitutionCount,
+    double threshold = -1,
+    bool verbose = true,
+    unsigned int nbThreads = 1) throw (Exception);
+
   /**
    * @brief Returns the counts on each branch.
    *
+   * Counts are summed over site patterns with computeCountsPerBranch.
+   *
    * @param drtl              A DRTreeLikelihood object.
    * @param ids               The numbers of the nodes of the tree
    * @param model             The model on which the SubstitutionCount is built
@@ -463,6 +606,78 @@ public:
     const std::vector<int>& ids,
     SubstitutionModel* model,
     const SubstitutionRegister& reg);
+
+private:
+  /**
+   * @brief Check that a writer matches the mapping it is given.
+   *
+   * @param writer     The writer, which may be null.
+   * @param nbBranches The number of branches of the mapping.
+   * @param nbSites    The number of sites of the mapping.
+   * @param nbTypes    The number of substitution types of the mapping.
+   * @param method     The name of the calling method, for the error message.
+   * @throw Exception If the writer does not match.
+   */
+  static void checkWriter_(
+    const BinarySubstitutionMappingWriter* writer,
+    size_t nbBranches,
+    size_t nbSites,
+    size_t nbTypes,
+    const std::string& method) throw (Exception);
+
+  /**
+   * @brief Function receiving the mapping of a branch.
+   *
+   * It is called with the index of the branch and the numbers of substitutions for each distinct site pattern and type,
+   * or with a null pointer if the branch is not mapped. It may be called concurrently for distinct branches.
+   */
+  typedef std::function<void (size_t, const std::vector< std::vector<double> >*)> BranchSink_;
+
+  /**
+   * @brief Compute the substitution numbers of each site pattern, and give them branch by branch to a sink.
+   *
+   * This is the core of computeSubstitutionVectors, which does not store the mapping itself.
+   *
+   * @param joint    The joint likelihoods of the branches.
+   * @param modelSet If not null, the model of each branch is taken from this set instead of the likelihood object.
+   * @param nodeIds  The ids of the nodes of the branches to map, among the computed ones (all if empty).
+   */
+  static void mapPatterns_(
+    const BranchJointLikelihoods& joint,
+    const SubstitutionModelSet* modelSet,
+    const std::vector<int>& nodeIds,
+    SubstitutionCount& substitutionCount,
+    bool verbose,
+    unsigned int nbThreads,
+    const BranchSink_& sink) throw (Exception);
+
+  /**
+   * @brief Compute the normalizations of each branch, from precomputed joint likelihoods.
+   */
+  static std::vector< std::vector<double> > computeNormalizationsPerBranch_(
+    const BranchJointLikelihoods& joint,
+    const std::vector<int>& ids,
+    const SubstitutionModel* nullModel,
+    const SubstitutionRegister& reg,
+    bool verbose);
+
+  static std::vector< std::vector<double> > computeNormalizationsPerBranch_(
+    const BranchJointLikelihoods& joint,
+    const std::vector<int>& ids,
+    const SubstitutionModelSet* nullModelSet,
+    const SubstitutionRegister& reg,
+    bool verbose);
+
+  /**
+   * @brief Sum the substitution numbers of each branch over all sites, as they are mapped.
+   */
+  static std::vector< std::vector<double> > sumCountsPerBranch_(
+    const DRTreeLikelihood& drtl,
+    const std::vector<int>& ids,
+    size_t nbTypes,
+    double threshold,
+    bool verbose,
+    const std::function<void (const BranchSink_&)>& mapper);
 };
 } // end of namespace bpp.
 
@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "Bpp/Numeric/Matrix/MatrixTools.h"
 #include "Bpp/Numeric/NumTools.h"
 #include <vector>
+#include <algorithm>
 
 using namespace bpp;
 using namespace std;
@@ -54,11 +55,11 @@ UniformizationSubstitutionCount::UniformizationSubstitutionCount(const Substitut
   model_(model),
   nbStates_(model->getNumberOfStates()),
   bMatrices_(reg->getNumberOfSubstitutionTypes()),
+  jumpMatrix_(),
   power_(),
   s_(reg->getNumberOfSubstitutionTypes()),
   miu_(0),
-  counts_(reg->getNumberOfSubstitutionTypes()),
-  currentLength_(1.)
+  counts_()
 {
   //Check compatiblity between model and substitution register:
   if (model->getAlphabet()->getAlphabetType() != reg->getAlphabet()->getAlphabetType())
@@ -77,7 +78,8 @@ UniformizationSubstitutionCount::UniformizationSubstitutionCount(const Substitut
   
   if (miu_>10000)
     throw Exception("UniformizationSubstitutionCount::UniformizationSubstitutionCount The maximum diagonal values of generator is above 10000. Abort, chose another mapping method");
-      
+
+  initJumpMatrices_();
 }        
 
 /******************************************************************************/
@@ -86,7 +88,6 @@ void UniformizationSubstitutionCount::resetBMatrices_()
 {
   size_t nbTypes = register_->getNumberOfSubstitutionTypes();
   bMatrices_.resize(nbTypes);
-  counts_.resize(nbTypes);
   s_.resize(nbTypes);
 }
 
@@ -96,7 +97,6 @@ void UniformizationSubstitutionCount::initBMatrices_()
   //Re-initialize all B matrices according to substitution register.
   for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i) {
     bMatrices_[i].resize(nbStates_, nbStates_);
-    counts_[i].resize(nbStates_, nbStates_);
   }
 }
 
@@ -117,57 +117,130 @@ void UniformizationSubstitutionCount::fillBMatrices_()
 
 /******************************************************************************/
 
-void UniformizationSubstitutionCount::computeCounts_(double length) const
+void UniformizationSubstitutionCount::initJumpMatrices_()
 {
-  double lam = miu_ * length;
   RowMatrix<double> I;
   MatrixTools::getId(nbStates_, I);
-  RowMatrix<double> R(model_->getGenerator());
-  MatrixTools::scale(R, 1. / miu_);
-  MatrixTools::add(R, I);
-  
-  //compute the stopping point
-  //use the tail of Poisson distribution
-  //can be approximated by 4 + 6 * sqrt(lam) + lam
-  size_t nMax = static_cast<size_t>(ceil(4 + 6 * sqrt(lam) + lam));
+  jumpMatrix_ = RowMatrix<double>(model_->getGenerator());
+  MatrixTools::scale(jumpMatrix_, 1. / miu_);
+  MatrixTools::add(jumpMatrix_, I);
+
+  power_.resize(1);
+  power_[0] = I;
+  size_t nbTypes = register_->getNumberOfSubstitutionTypes();
+  s_.resize(nbTypes);
+  for (size_t i = 0; i < nbTypes; ++i) {
+    s_[i].resize(1);
+    MatrixTools::mult(bMatrices_[i], power_[0], s_[i][0]);
+  }
+}
+
+/******************************************************************************/
+
+void UniformizationSubstitutionCount::extendJumpMatrices_(size_t nMax) const
+{
+  size_t n = power_.size();
+  if (n > nMax)
+    return;
 
   //compute the powers of R
   power_.resize(nMax + 1);
-  power_[0] = I;
-  for (size_t i = 1; i < nMax + 1; ++i)
-    MatrixTools::mult(power_[i - 1], R, power_[i]);
+  for (size_t l = n; l < nMax + 1; ++l)
+    MatrixTools::mult(power_[l - 1], jumpMatrix_, power_[l]);
 
-  for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i) {
+  RowMatrix<double> tmp(nbStates_, nbStates_);
+  for (size_t i = 0; i < s_.size(); ++i) {
     s_[i].resize(nMax + 1);
-    MatrixTools::mult(bMatrices_[i], power_[0], s_[i][0]);
-    RowMatrix<double> tmp(nbStates_, nbStates_);
-    for (size_t l = 1; l < nMax + 1; ++l) {
-      MatrixTools::mult(R, s_[i][l - 1], s_[i][l]);
+    for (size_t l = n; l < nMax + 1; ++l) {
+      MatrixTools::mult(jumpMatrix_, s_[i][l - 1], s_[i][l]);
       MatrixTools::mult(bMatrices_[i], power_[l], tmp);
       MatrixTools::add(s_[i][l], tmp);
     }
-    MatrixTools::fill(counts_[i], 0);
-    for (size_t l = 0; l < nMax + 1; ++l) {
-      tmp = s_[i][l];
-      //double f = (pow(lam, static_cast<double>(l + 1)) * exp(-lam) / static_cast<double>(NumTools::fact(l + 1))) / miu_;
+  }
+}
+
+/******************************************************************************/
+
+void UniformizationSubstitutionCount::computeCounts_(double length, vector< RowMatrix<double> >& counts) const
+{
+  vector< vector< RowMatrix<double> > > countsForLength;
+  computeCountsForEachLength_(vector<double>(1, length), countsForLength);
+  counts.swap(countsForLength[0]);
+}
+
+/******************************************************************************/
+
+void UniformizationSubstitutionCount::computeCountsForEachLength_(const vector<double>& lengths, vector< vector< RowMatrix<double> > >& counts) const
+{
+  size_t nbLengths = lengths.size();
+  size_t nbTypes = register_->getNumberOfSubstitutionTypes();
+
+  //compute the stopping point of each length
+  //use the tail of Poisson distribution
+  //can be approximated by 4 + 6 * sqrt(lam) + lam
+  vector<size_t> nMax(nbLengths);
+  size_t nMaxAll = 0;
+  for (size_t m = 0; m < nbLengths; ++m) {
+    double lam = miu_ * lengths[m];
+    nMax[m] = static_cast<size_t>(ceil(4 + 6 * sqrt(lam) + lam));
+    nMaxAll = max(nMaxAll, nMax[m]);
+  }
+  extendJumpMatrices_(nMaxAll);
+
+  //Poisson weights, the only part depending on the length:
+  vector< vector<double> > f(nbLengths);
+  for (size_t m = 0; m < nbLengths; ++m) {
+    double lam = miu_ * lengths[m];
+    f[m].resize(nMax[m] + 1);
+    for (size_t l = 0; l < nMax[m] + 1; ++l) {
+      //f[l] = (pow(lam, static_cast<double>(l + 1)) * exp(-lam) / static_cast<double>(NumTools::fact(l + 1))) / miu_;
       double logF = static_cast<double>(l + 1) * log(lam) - lam - log(miu_) - NumTools::logFact(static_cast<double>(l + 1));
-      MatrixTools::scale(tmp, exp(logF));
-      MatrixTools::add(counts_[i], tmp);
+      f[m][l] = exp(logF);
+    }
+  }
+
+  counts.resize(nbLengths);
+  for (size_t m = 0; m < nbLengths; ++m) {
+    counts[m].resize(nbTypes);
+    for (size_t i = 0; i < nbTypes; ++i) {
+      counts[m][i].resize(nbStates_, nbStates_);
+      MatrixTools::fill(counts[m][i], 0);
+    }
+  }
+
+  //Each term of the series is length-independent, and is read once for all lengths:
+  for (size_t i = 0; i < nbTypes; ++i) {
+    for (size_t l = 0; l < nMaxAll + 1; ++l) {
+      const RowMatrix<double>& s_i_l = s_[i][l];
+      for (size_t m = 0; m < nbLengths; ++m) {
+        if (l > nMax[m])
+          continue;
+        double f_m_l = f[m][l];
+        RowMatrix<double>& counts_m_i = counts[m][i];
+        for (size_t j = 0; j < nbStates_; j++) {
+          for (size_t k = 0; k < nbStates_; k++) {
+            counts_m_i(j, k) += f_m_l * s_i_l(j, k);
+          }
+        }
+      }
     }
   }
 
   // Now we must divide by pijt and account for putative weights:
   vector<int> supportedStates = model_->getAlphabetStates();
-  RowMatrix<double> P = model_->getPij_t(length);
-  for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); i++) {
-    for (size_t j = 0; j < nbStates_; j++) {
-      for(size_t k = 0; k < nbStates_; k++) {
-        counts_[i](j, k) /= P(j, k);
-        if (std::isnan(counts_[i](j, k)) || counts_[i](j, k) < 0.)
-          counts_[i](j, k) = 0;
-        //Weights:
-        if (weights_)
-          counts_[i](j, k) *= weights_->getIndex(supportedStates[j], supportedStates[k]);
+  for (size_t m = 0; m < nbLengths; ++m) {
+    const Matrix<double>& P = model_->getPij_t(lengths[m]);
+    for (size_t i = 0; i < nbTypes; i++) {
+      RowMatrix<double>& counts_m_i = counts[m][i];
+      for (size_t j = 0; j < nbStates_; j++) {
+        for(size_t k = 0; k < nbStates_; k++) {
+          counts_m_i(j, k) /= P(j, k);
+          if (std::isnan(counts_m_i(j, k)) || counts_m_i(j, k) < 0.)
+            counts_m_i(j, k) = 0;
+          //Weights:
+          if (weights_)
+            counts_m_i(j, k) *= weights_->getIndex(supportedStates[j], supportedStates[k]);
+        }
       }
     }
   }
@@ -175,16 +248,52 @@ void UniformizationSubstitutionCount::computeCounts_(double length) const
 
 /******************************************************************************/
 
+const vector< RowMatrix<double> >& UniformizationSubstitutionCount::getCounts_(double length) const
+{
+  const vector< RowMatrix<double> >* counts = counts_.find(length);
+  if (counts)
+    return *counts;
+  computeCounts_(length, counts_.getFreeEntry());
+  return counts_.commit(length);
+}
+
+/******************************************************************************/
+
 Matrix<double>* UniformizationSubstitutionCount::getAllNumbersOfSubstitutions(double length, size_t type) const
 {
   if (length < 0)
     throw Exception("UniformizationSubstitutionCount::getAllNumbersOfSubstitutions. Negative branch length: " + TextTools::toString(length) + ".");
-  if (length != currentLength_)
-  {
-    computeCounts_(length);
-    currentLength_ = length;
+  return new RowMatrix<double>(getCounts_(length)[type - 1]);
+}
+
+/******************************************************************************/
+
+void UniformizationSubstitutionCount::getAllNumbersOfSubstitutionsForEachLength(const vector<double>& lengths, vector< vector< RowMatrix<double> > >& counts) const
+{
+  counts.resize(lengths.size());
+  //Lengths which are not in the cache are computed together:
+  vector<double> missingLengths;
+  for (size_t l = 0; l < lengths.size(); ++l) {
+    if (lengths[l] < 0)
+      throw Exception("UniformizationSubstitutionCount::getAllNumbersOfSubstitutionsForEachLength. Negative branch length: " + TextTools::toString(lengths[l]) + ".");
+    if (!counts_.find(lengths[l]) && find(missingLengths.begin(), missingLengths.end(), lengths[l]) == missingLengths.end())
+      missingLengths.push_back(lengths[l]);
+  }
+  vector< vector< RowMatrix<double> > > missingCounts;
+  if (missingLengths.size() > 0)
+    computeCountsForEachLength_(missingLengths, missingCounts);
+  for (size_t l = 0; l < lengths.size(); ++l) {
+    size_t m = static_cast<size_t>(find(missingLengths.begin(), missingLengths.end(), lengths[l]) - missingLengths.begin());
+    if (m < missingLengths.size())
+      counts[l] = missingCounts[m];
+    else
+      counts[l] = *counts_.find(lengths[l]);
+  }
+  //The cache may hold fewer lengths than requested, so that it is only filled once all counts are copied:
+  for (size_t m = 0; m < missingLengths.size(); ++m) {
+    counts_.getFreeEntry().swap(missingCounts[m]);
+    counts_.commit(missingLengths[m]);
   }
-  return new RowMatrix<double>(counts_[type - 1]);
 }
 
 /******************************************************************************/
@@ -193,12 +302,7 @@ double UniformizationSubstitutionCount::getNumberOfSubstitutions(size_t initialS
 {
   if (length < 0)
     throw Exception("UniformizationSubstitutionCount::getNumbersOfSubstitutions. Negative branch length: " + TextTools::toString(length) + ".");
-  if (length != currentLength_)
-  {
-    computeCounts_(length);
-    currentLength_ = length;
-  }
-  return counts_[type - 1](initialState, finalState);
+  return getCounts_(length)[type - 1](initialState, finalState);
 }
 
 /******************************************************************************/
@@ -207,14 +311,10 @@ std::vector<double> UniformizationSubstitutionCount::getNumberOfSubstitutionsFor
 {
   if (length < 0)
     throw Exception("UniformizationSubstitutionCount::getNumbersOfSubstitutions. Negative branch length: " + TextTools::toString(length) + ".");
-  if (length != currentLength_)
-  {
-    computeCounts_(length);
-    currentLength_ = length;
-  }
+  const vector< RowMatrix<double> >& counts = getCounts_(length);
   std::vector<double> v(getNumberOfSubstitutionTypes());
   for (unsigned int t = 0; t < getNumberOfSubstitutionTypes(); ++t) {
-    v[t] = counts_[t](initialState, finalState);
+    v[t] = counts[t](initialState, finalState);
   }
   return v;
 }
@@ -246,8 +346,10 @@ void UniformizationSubstitutionCount::setSubstitutionModel(const SubstitutionMod
   if (miu_ > 10000)
     throw Exception("UniformizationSubstitutionCount::setSubstitutionModel(). The maximum diagonal values of generator is above 10000. Abort, chose another mapping method.");
 
-  //Recompute counts:
-  computeCounts_(currentLength_);
+  initJumpMatrices_();
+
+  //Counts will be recomputed when needed:
+  counts_.clear();
 }
 
 /******************************************************************************/
@@ -261,10 +363,10 @@ void UniformizationSubstitutionCount::substitutionRegisterHasChanged() throw (Ex
   resetBMatrices_();
   initBMatrices_();
   fillBMatrices_();
+  initJumpMatrices_();
   
-  //Recompute counts:
-  if (currentLength_ > 0)
-    computeCounts_(currentLength_);
+  //Counts will be recomputed when needed:
+  counts_.clear();
 }
 
 /******************************************************************************/
@@ -277,9 +379,8 @@ void UniformizationSubstitutionCount::weightsHaveChanged() throw (Exception)
   //jdutheil on 25/07/14: not necessary if weights are only accounted for in the end.
   //fillBMatrices_();
   
-  //Recompute counts:
-  if (currentLength_ > 0)
-    computeCounts_(currentLength_);
+  //Counts will be recomputed when needed:
+  counts_.clear();
 }
 
 /******************************************************************************/
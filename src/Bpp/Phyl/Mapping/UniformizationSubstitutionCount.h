@@ -41,6 +41,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _UNIFORMIZATIONSUBSTITUTIONCOUNT_H_
 
 #include "WeightedSubstitutionCount.h"
+#include "LengthCache.h"
 
 #include <Bpp/Numeric/Matrix/Matrix.h>
 
@@ -52,6 +53,12 @@ namespace bpp
  *
  * The code is adapted from the original R code by Paula Tataru and Asger Hobolth.
  *
+ * The uniformized matrix R = I + Q / mu, its powers and the corresponding terms of each substitution type
+ * do not depend on the branch length. They are computed once for a given model and register,
+ * and extended when a longer branch requires more terms of the Poisson series.
+ * Only the Poisson weighting of these terms is then performed for each length.
+ * Counts are cached for the last branch lengths used (see LengthCache).
+ *
  * @author Julien Dutheil
  */
 class UniformizationSubstitutionCount:
@@ -62,11 +69,23 @@ class UniformizationSubstitutionCount:
     const SubstitutionModel* model_;
     size_t nbStates_;
     std::vector< RowMatrix<double> > bMatrices_;
+    /**
+     * @brief The uniformized matrix R = I + Q / miu_.
+     */
+    RowMatrix<double> jumpMatrix_;
+    /**
+     * @brief Powers of R computed so far.
+     */
     mutable std::vector< RowMatrix<double> > power_;
+    /**
+     * @brief Terms of the series for each substitution type, computed as many as powers of R.
+     */
     mutable std::vector < std::vector< RowMatrix<double> > > s_;
     double miu_;
-    mutable std::vector< RowMatrix<double> > counts_;
-    mutable double currentLength_;
+    /**
+     * @brief Counts for each type, for the last branch lengths used.
+     */
+    mutable LengthCache< std::vector< RowMatrix<double> > > counts_;
   
   public:
     UniformizationSubstitutionCount(const SubstitutionModel* model, SubstitutionRegister* reg, const AlphabetIndex2* weights = 0);
@@ -77,11 +96,11 @@ class UniformizationSubstitutionCount:
       model_(usc.model_),
       nbStates_(usc.nbStates_),
       bMatrices_(usc.bMatrices_),
+      jumpMatrix_(usc.jumpMatrix_),
       power_(usc.power_),
       s_(usc.s_),
       miu_(usc.miu_),
-      counts_(usc.counts_),
-      currentLength_(usc.currentLength_)
+      counts_(usc.counts_)
     {}        
     
     UniformizationSubstitutionCount& operator=(const UniformizationSubstitutionCount& usc)
@@ -91,11 +110,11 @@ class UniformizationSubstitutionCount:
       model_          = usc.model_;
       nbStates_       = usc.nbStates_;
       bMatrices_      = usc.bMatrices_;
+      jumpMatrix_     = usc.jumpMatrix_;
       power_          = usc.power_;
       s_              = usc.s_;
       miu_            = usc.miu_;
       counts_         = usc.counts_;
-      currentLength_  = usc.currentLength_;
       return *this;
     }        
     
@@ -109,11 +128,26 @@ public:
     Matrix<double>* getAllNumbersOfSubstitutions(double length, size_t type = 1) const;
     
     std::vector<double> getNumberOfSubstitutionsForEachType(size_t initialState, size_t finalState, double length) const;
+
+    void getAllNumbersOfSubstitutionsForEachLength(const std::vector<double>& lengths, std::vector< std::vector< RowMatrix<double> > >& counts) const;
    
     void setSubstitutionModel(const SubstitutionModel* model);
 
   protected:
-    void computeCounts_(double length) const;
+    /**
+     * @return The counts for each type for a given length, computed if they are not in the cache.
+     */
+    const std::vector< RowMatrix<double> >& getCounts_(double length) const;
+
+    void computeCounts_(double length, std::vector< RowMatrix<double> >& counts) const;
+
+    /**
+     * @brief Compute the counts of several lengths in a single pass over the powers of the jump matrix.
+     *
+     * @param lengths The branch lengths, which must not be negative.
+     * @param counts  [out] The counts as counts[l][t] for length l and type t.
+     */
+    void computeCountsForEachLength_(const std::vector<double>& lengths, std::vector< std::vector< RowMatrix<double> > >& counts) const;
     void substitutionRegisterHasChanged() throw (Exception);
     void weightsHaveChanged() throw (Exception);
 
@@ -122,6 +156,18 @@ public:
     void initBMatrices_();
     void fillBMatrices_();
 
+    /**
+     * @brief Compute the uniformized matrix, and reset its powers and the terms of the series.
+     *
+     * Must be called when the model or the register change.
+     */
+    void initJumpMatrices_();
+
+    /**
+     * @brief Compute the powers of the uniformized matrix and the terms of the series up to a given order, if needed.
+     */
+    void extendJumpMatrices_(size_t nMax) const;
+
 };
 
 } //end of namespace bpp.
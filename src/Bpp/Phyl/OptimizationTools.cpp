@@ -42,10 +42,12 @@
 #include "Likelihood/GlobalClockTreeLikelihoodFunctionWrapper.h"
 #include "NNISearchable.h"
 #include "NNITopologySearch.h"
+#include "SPRTopologySearch.h"
 #include "Io/Newick.h"
 
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/ParameterList.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
 #include <Bpp/Numeric/Function/BfgsMultiDimensions.h>
 #include <Bpp/Numeric/Function/ReparametrizationFunctionWrapper.h>
 #include <Bpp/Numeric/Function/ThreePointsNumericalDerivative.h>
@@ -638,6 +640,59 @@ DRTreeParsimonyScore* OptimizationTools::optimizeTreeNNI(
 
 /******************************************************************************/
 
+DRTreeParsimonyScore* OptimizationTools::optimizeTreeSPR(
+  DRTreeParsimonyScore* tp,
+  const std::string& algorithm,
+  unsigned int maxDistance,
+  unsigned int ratchetIterations,
+  double ratchetProportion,
+  unsigned int verbose)
+{
+  SPRTopologySearch topoSearch(*tp, algorithm, maxDistance, verbose > 0 ? verbose - 1 : 0);
+  topoSearch.search();
+  if (ratchetIterations == 0)
+    return tp;
+
+  DRTreeParsimonyScore* best = tp->clone();
+  unsigned int bestScore = best->getScore();
+  const vector<unsigned int> weights = tp->getWeights();
+  for (unsigned int i = 0; i < ratchetIterations; i++)
+  {
+    if (verbose > 0)
+      ApplicationTools::displayGauge(i, ratchetIterations - 1, '>');
+    // Perturbate weights:
+    vector<unsigned int> ratchetWeights = weights;
+    for (size_t j = 0; j < ratchetWeights.size(); j++)
+    {
+      if (RandomTools::giveRandomNumberBetweenZeroAndEntry(1.) < ratchetProportion)
+        ratchetWeights[j] *= 2;
+    }
+    tp->setWeights(ratchetWeights);
+    topoSearch.search();
+    // Restore weights:
+    tp->setWeights(weights);
+    topoSearch.search();
+    unsigned int score = tp->getScore();
+    if (score < bestScore)
+    {
+      delete best;
+      best = tp->clone();
+      bestScore = score;
+    }
+  }
+  if (verbose > 0)
+    ApplicationTools::displayTaskDone();
+  if (bestScore < tp->getScore())
+  {
+    delete tp;
+    return best;
+  }
+  delete best;
+  return tp;
+}
+
+/******************************************************************************/
+
 std::string OptimizationTools::DISTANCEMETHOD_INIT       = "init";
 std::string OptimizationTools::DISTANCEMETHOD_PAIRWISE   = "pairwise";
 std::string OptimizationTools::DISTANCEMETHOD_ITERATIONS = "iterations";
@@ -697,8 +752,12 @@ TreeTemplate<Node>* OptimizationTools::buildDistanceTree(
   }
   TreeTemplate<Node>* tree = NULL;
   TreeTemplate<Node>* previousTree = NULL;
-  bool test = true;
-  while (test)
+  // The likelihood object is kept from one iteration to the next:
+  unique_ptr<TransitionModel> model;
+  unique_ptr<DiscreteDistribution> rdist;
+  unique_ptr<DRHomogeneousTreeLikelihood> tl;
+  bool warmStart = estimationMethod.isWarmStart();
+  while (true)
   {
     // Compute matrice:
     if (verbose > 0)
@@ -718,6 +777,8 @@ TreeTemplate<Node>* OptimizationTools::buildDistanceTree(
       n3->setDistanceToFather((*matrix)(0,0) / 2.);
       n1->addSon(n2);
       n1->addSon(n3);
+      delete tree;
+      delete matrix;
       tree = new TreeTemplate<Node>(n1);
       break;
     }
@@ -730,47 +791,62 @@ TreeTemplate<Node>* OptimizationTools::buildDistanceTree(
     tree = dynamic_cast<TreeTemplate<Node>*>(reconstructionMethod.getTree());
     if (verbose > 0)
       ApplicationTools::displayTaskDone();
-    if (previousTree && verbose > 0)
+    if (previousTree)
     {
       int rf = TreeTools::robinsonFouldsDistance(*previousTree, *tree, false);
-      ApplicationTools::displayResult("Topo. distance with previous iteration", TextTools::toString(rf));
-      test = (rf == 0);
+      if (verbose > 0)
+        ApplicationTools::displayResult("Topo. distance with previous iteration", TextTools::toString(rf));
       delete previousTree;
+      if (rf == 0)
+        break;  // The topology does not change anymore.
     }
     if (param != DISTANCEMETHOD_ITERATIONS)
       break;  // Ends here.
 
     // Now, re-estimate parameters:
-    unique_ptr<TransitionModel> model(estimationMethod.getSubstitutionModel().clone());
-    unique_ptr<DiscreteDistribution> rdist(estimationMethod.getRateDistribution().clone());
-    DRHomogeneousTreeLikelihood tl(*tree,
-        *estimationMethod.getData(),
-        model.get(),
-        rdist.get(),
-        true, verbose > 1);
-    tl.initialize();
-    ParameterList parameters = tl.getParameters();
+    if (!tl.get())
+    {
+      model.reset(estimationMethod.getSubstitutionModel().clone());
+      rdist.reset(estimationMethod.getRateDistribution().clone());
+      tl.reset(new DRHomogeneousTreeLikelihood(*tree,
+            *estimationMethod.getData(),
+            model.get(),
+            rdist.get(),
+            true, verbose > 1));
+      tl->initialize();
+    }
+    else
+    {
+      // Compressed data and arrays are kept, only the topology changes:
+      tl->setTree(*tree);
+    }
+    ParameterList parameters = tl->getParameters();
     if (!optimizeBrLen)
     {
-      vector<string> vs = tl.getBranchLengthsParameters().getParameterNames();
+      vector<string> vs = tl->getBranchLengthsParameters().getParameterNames();
       parameters.deleteParameters(vs);
     }
     parameters.deleteParameters(parametersToIgnore.getParameterNames());
-    optimizeNumericalParameters(&tl, parameters, NULL, 0, tolerance, tlEvalMax, messenger, profiler, verbose > 0 ? verbose - 1 : 0);
+    optimizeNumericalParameters(tl.get(), parameters, NULL, 0, tolerance, tlEvalMax, messenger, profiler, verbose > 0 ? verbose - 1 : 0);
+    ParameterList modelParameters = tl->getSubstitutionModelParameters();
+    ParameterList rateParameters = tl->getRateDistributionParameters();
     if (verbose > 0)
     {
-      ParameterList tmp = tl.getSubstitutionModelParameters();
-      for (unsigned int i = 0; i < tmp.size(); i++)
+      for (unsigned int i = 0; i < modelParameters.size(); i++)
       {
-        ApplicationTools::displayResult(tmp[i].getName(), TextTools::toString(tmp[i].getValue()));
+        ApplicationTools::displayResult(modelParameters[i].getName(), TextTools::toString(modelParameters[i].getValue()));
       }
-      tmp = tl.getRateDistributionParameters();
-      for (unsigned int i = 0; i < tmp.size(); i++)
+      for (unsigned int i = 0; i < rateParameters.size(); i++)
       {
-        ApplicationTools::displayResult(tmp[i].getName(), TextTools::toString(tmp[i].getValue()));
+        ApplicationTools::displayResult(rateParameters[i].getName(), TextTools::toString(rateParameters[i].getValue()));
       }
     }
+    // Distances are re-estimated with the new parameters, starting from the current ones:
+    estimationMethod.matchParametersValues(modelParameters);
+    estimationMethod.matchParametersValues(rateParameters);
+    estimationMethod.setWarmStart(true);
   }
+  estimationMethod.setWarmStart(warmStart);
   return tree;
 }
 
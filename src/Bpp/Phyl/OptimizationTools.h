@@ -44,6 +44,7 @@
 #include "Likelihood/NNIHomogeneousTreeLikelihood.h"
 #include "Likelihood/ClockTreeLikelihood.h"
 #include "NNITopologySearch.h"
+#include "SPRTopologySearch.h"
 #include "Parsimony/DRTreeParsimonyScore.h"
 #include "TreeTemplate.h"
 #include "Distance/DistanceEstimation.h"
@@ -696,6 +697,36 @@ public:
     DRTreeParsimonyScore* tp,
     unsigned int verbose = 1);
 
+  /**
+   * @brief Optimize tree topology from a DRTreeParsimonyScore using SPR or TBR movements, and the parsimony ratchet.
+   *
+   * A SPR (or TBR) search is first performed.
+   * Then, for each ratchet iteration (Nixon 1999), the weights of a random subset of sites are increased,
+   * a search is performed with these weights, the original weights are restored and a new search is performed.
+   * The best tree found is kept.
+   * As only weights are modified, the compressed data are shared by all iterations.
+   *
+   * @param tp                 A pointer toward the DRTreeParsimonyScore object to optimize.
+   * @param algorithm          The type of movements to use (SPRTopologySearch::SPR or SPRTopologySearch::TBR).
+   * @param maxDistance        The maximum distance of the movements (0 for no limit).
+   * @param ratchetIterations  The number of ratchet iterations (0 for a simple search).
+   * @param ratchetProportion  The probability for each site pattern to be upweighted during ratchet iterations.
+   * @param verbose            The verbose level.
+   * @return A pointer toward the final parsimony score object.
+   * If a better tree is found during a ratchet iteration, the input object is deleted and a new one is returned.
+   * You hence should write something like
+   * @code
+   * tp = OptimizationTools::optimizeTreeSPR(tp, ...);
+   * @endcode
+   */
+  static DRTreeParsimonyScore* optimizeTreeSPR(
+    DRTreeParsimonyScore* tp,
+    const std::string& algorithm   = SPRTopologySearch::SPR,
+    unsigned int maxDistance       = 0,
+    unsigned int ratchetIterations = 0,
+    double ratchetProportion       = 0.25,
+    unsigned int verbose           = 1);
+
   /**
    * @brief Estimate a distance matrix using maximum likelihood.
    *
@@ -704,6 +735,7 @@ public:
    * Twoe options are provideed here:
    * - DISTANCEMETHOD_INIT (default) keep parameters to there initial value,
    * - DISTANCEMETHOD_PAIRWISE estimated parameters in a pairwise manner, which is standard but not that satisfying...
+   *   Each pair starts from the initial values of the parameters (see DistanceEstimation).
    *
    * @param estimationMethod The distance estimation object to use.
    * @param parametersToIgnore A list of parameters to ignore while optimizing parameters.
@@ -726,11 +758,17 @@ public:
    * Three options are provideed here:
    * - DISTANCEMETHOD_INIT (default) keep parameters to there initial value,
    * - DISTANCEMETHOD_PAIRWISE estimated parameters in a pairwise manner, which is standard but not that satisfying...
+   *   Each pair starts from the initial values of the parameters (see DistanceEstimation).
    * - DISTANCEMETHOD_ITERATIONS uses Ninio et al's iterative algorithm, which uses Maximum Likelihood to estimate these parameters, and then update the distance matrix.
    * Ninio M, Privman E, Pupko T, Friedman N.
    * Phylogeny reconstruction: increasing the accuracy of pairwise distance estimation using Bayesian inference of evolutionary rates.
    * Bioinformatics. 2007 Jan 15;23(2):e136-41.
    *
+   * With DISTANCEMETHOD_ITERATIONS, the procedure stops when the topology does not change anymore.
+   * The same likelihood object is used for all iterations and only rebound to the new tree,
+   * and the estimated parameters are passed to the estimation method, where distances are then optimized
+   * starting from the previous matrix.
+   *
    * @param estimationMethod The distance estimation object to use.
    * @param reconstructionMethod The tree reconstruction object to use.
    * @param parametersToIgnore A list of parameters to ignore while optimizing parameters.
@@ -0,0 +1,135 @@
+//
+// File: ParallelTools.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 14:20 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "ParallelTools.h"
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/******************************************************************************/
+
+size_t ParallelTools::getNumberOfWorkers(size_t nbTasks, unsigned int nbThreads)
+{
+  if (nbThreads == 0)
+    nbThreads = max(thread::hardware_concurrency(), 1u);
+  return max(min(static_cast<size_t>(nbThreads), nbTasks), static_cast<size_t>(1));
+}
+
+/******************************************************************************/
+
+void ParallelTools::parallelFor(
+  size_t nbTasks,
+  unsigned int nbThreads,
+  const function<void (size_t, size_t)>& task)
+{
+  size_t nbWorkers = getNumberOfWorkers(nbTasks, nbThreads);
+  if (nbWorkers == 1)
+  {
+    for (size_t i = 0; i < nbTasks; i++)
+    {
+      task(i, 0);
+    }
+    return;
+  }
+
+  atomic<size_t> next(0);
+  vector<exception_ptr> errors(nbWorkers);
+  auto work = [&](size_t w)
+  {
+    try
+    {
+      for (size_t i = next++; i < nbTasks; i = next++)
+      {
+        task(i, w);
+      }
+    }
+    catch (...)
+    {
+      errors[w] = current_exception();
+      next = nbTasks;
+    }
+  };
+  {
+    // Joins the started workers on every exit, so that none of them is
+    // destroyed while still joinable if a later thread fails to start.
+    struct JoinGuard
+    {
+      vector<thread>& threads;
+      ~JoinGuard()
+      {
+        for (size_t w = 0; w < threads.size(); w++)
+        {
+          if (threads[w].joinable())
+            threads[w].join();
+        }
+      }
+    };
+    vector<thread> threads;
+    threads.reserve(nbWorkers);
+    JoinGuard guard = { threads };
+    try
+    {
+      for (size_t w = 0; w < nbWorkers; w++)
+      {
+        threads.push_back(thread(work, w));
+      }
+    }
+    catch (...)
+    {
+      next = nbTasks;
+      throw;
+    }
+  }
+  for (size_t w = 0; w < nbWorkers; w++)
+  {
+    if (errors[w])
+      rethrow_exception(errors[w]);
+  }
+}
+
+/******************************************************************************/
+
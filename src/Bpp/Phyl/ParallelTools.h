@@ -0,0 +1,85 @@
+//
+// File: ParallelTools.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 14:20 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _PARALLELTOOLS_H_
+#define _PARALLELTOOLS_H_
+
+// From the STL:
+#include <cstddef>
+#include <functional>
+
+namespace bpp
+{
+/**
+ * @brief Run independent tasks on a pool of threads.
+ *
+ * Tasks are distributed dynamically: each worker takes the next task as soon as it is done with the previous one.
+ * Each worker runs on its own thread, and is given an index, so that objects indexed by worker can be used without locking.
+ * With a single worker, tasks are run in order, in the calling thread.
+ */
+class ParallelTools
+{
+public:
+  /**
+   * @return The number of workers used to run a number of tasks: at least one, and at most one per task.
+   *
+   * @param nbTasks   The number of tasks.
+   * @param nbThreads The number of threads to use (0 to use the number of available cores).
+   */
+  static size_t getNumberOfWorkers(size_t nbTasks, unsigned int nbThreads);
+
+  /**
+   * @brief Run tasks 0 to nbTasks - 1.
+   *
+   * If a task throws an exception, remaining tasks are not started.
+   * Once all threads are done, the exception of the worker with the lowest index is rethrown.
+   *
+   * @param nbTasks   The number of tasks.
+   * @param nbThreads The number of threads to use (0 to use the number of available cores).
+   * @param task      The function running a task, given its index and the index of the worker,
+   *                  between 0 and getNumberOfWorkers(nbTasks, nbThreads) - 1.
+   */
+  static void parallelFor(
+    size_t nbTasks,
+    unsigned int nbThreads,
+    const std::function<void (size_t, size_t)>& task);
+};
+} // end of namespace bpp.
+
+#endif // _PARALLELTOOLS_H_
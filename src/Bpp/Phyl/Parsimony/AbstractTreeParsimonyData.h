@@ -43,6 +43,9 @@
 
 #include "TreeParsimonyData.h"
 
+#include <Bpp/Exceptions.h>
+#include <Bpp/Text/TextTools.h>
+
 namespace bpp
 {
 /**
@@ -106,6 +109,23 @@ public:
     return rootWeights_[pos];
   }
 
+  const std::vector<unsigned int>& getWeights() const { return rootWeights_; }
+
+  /**
+   * @brief Set the weights of the array positions.
+   *
+   * This can be used to reweight sites without recompressing the data set, e.g. for bootstrap or parsimony ratchet.
+   *
+   * @param weights The new weights, one per array position.
+   * @throw Exception If the number of weights does not match the number of array positions.
+   */
+  void setWeights(const std::vector<unsigned int>& weights) throw (Exception)
+  {
+    if (weights.size() != rootWeights_.size())
+      throw Exception("AbstractTreeParsimonyData::setWeights. Wrong number of weights: " + TextTools::toString(weights.size()) + ", expected " + TextTools::toString(rootWeights_.size()) + ".");
+    rootWeights_ = weights;
+  }
+
   const TreeTemplate<Node>* getTree() const { return tree_; }
 
 protected:
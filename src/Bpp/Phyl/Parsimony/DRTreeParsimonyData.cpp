@@ -58,6 +58,7 @@ DRTreeParsimonyData::DRTreeParsimonyData(const DRTreeParsimonyData& data) :
   shrunkData_(0),
   nbSites_(data.nbSites_),
   nbStates_(data.nbStates_),
+  nbWords_(data.nbWords_),
   nbDistinctSites_(data.nbDistinctSites_)
 {
   if (data.shrunkData_)
@@ -82,6 +83,7 @@ DRTreeParsimonyData& DRTreeParsimonyData::operator=(const DRTreeParsimonyData& d
     shrunkData_ = 0;
   nbSites_         = data.nbSites_;
   nbStates_        = data.nbStates_;
+  nbWords_         = data.nbWords_;
   nbDistinctSites_ = data.nbDistinctSites_;
   return *this;
 }
@@ -90,6 +92,7 @@ DRTreeParsimonyData& DRTreeParsimonyData::operator=(const DRTreeParsimonyData& d
 void DRTreeParsimonyData::init(const SiteContainer& sites, const StateMap& stateMap) throw (Exception)
 {
   nbStates_         = stateMap.getNumberOfModelStates();
+  nbWords_          = getNumberOfWords(nbStates_);
   nbSites_          = sites.getNumberOfSites();
   SitePatterns pattern(&sites);
   shrunkData_       = pattern.getSites();
@@ -104,7 +107,41 @@ void DRTreeParsimonyData::init(const SiteContainer& sites, const StateMap& state
   delete sequences;
 
   // Now initialize root arrays:
-  rootBitsets_.resize(nbDistinctSites_);
+  rootBitsets_.resize(nbDistinctSites_ * nbWords_);
+  rootScores_.resize(nbDistinctSites_);
+}
+
+/******************************************************************************/
+void DRTreeParsimonyData::init(const DRTreeParsimonyData& data) throw (Exception)
+{
+  nbStates_         = data.nbStates_;
+  nbWords_          = data.nbWords_;
+  nbSites_          = data.nbSites_;
+  rootWeights_      = data.rootWeights_;
+  rootPatternLinks_ = data.rootPatternLinks_;
+  nbDistinctSites_  = data.nbDistinctSites_;
+  if (shrunkData_) delete shrunkData_;
+  shrunkData_       = 0;
+
+  // Copy leaf arrays:
+  leafData_.clear();
+  vector<const Node*> leaves = getTreeP_()->getLeaves();
+  for (size_t i = 0; i < leaves.size(); i++)
+  {
+    map<int, DRTreeParsimonyLeafData>::const_iterator it = data.leafData_.find(leaves[i]->getId());
+    if (it == data.leafData_.end())
+      throw Exception("DRTreeParsimonyData::init(data). Leaf not found in data: " + leaves[i]->getName() + ".");
+    DRTreeParsimonyLeafData* leafData = &leafData_[leaves[i]->getId()];
+    leafData->setNode(leaves[i]);
+    leafData->getBitsetsArray() = it->second.getBitsetsArray();
+  }
+
+  // Init node arrays:
+  nodeData_.clear();
+  reInit();
+
+  // Now initialize root arrays:
+  rootBitsets_.resize(nbDistinctSites_ * nbWords_);
   rootScores_.resize(nbDistinctSites_);
 }
 
@@ -123,25 +160,33 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
     {
       throw SequenceNotFoundException("DRTreeParsimonyData:init(node, sites). Leaf name in tree not found in site container: ", (node->getName()));
     }
-    DRTreeParsimonyLeafData* leafData    = &leafData_[node->getId()];
-    vector<Bitset>* leafData_bitsets     = &leafData->getBitsetsArray();
+    DRTreeParsimonyLeafData* leafData        = &leafData_[node->getId()];
+    vector<ParsimonyWord>* leafData_bitsets  = &leafData->getBitsetsArray();
     leafData->setNode(node);
 
-    leafData_bitsets->resize(nbDistinctSites_);
+    leafData_bitsets->assign(nbDistinctSites_ * nbWords_, 0);
+
+    // Alphabet states corresponding to each model state:
+    vector<int> alphabetStates(nbStates_);
+    for (size_t s = 0; s < nbStates_; s++)
+    {
+      alphabetStates[s] = stateMap.getAlphabetStateAsInt(s);
+    }
 
-    for (unsigned int i = 0; i < nbDistinctSites_; i++)
+    const size_t wordSize = 8 * sizeof(ParsimonyWord);
+    for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      Bitset* leafData_bitsets_i = &(*leafData_bitsets)[i];
-      for (unsigned int s = 0; s < nbStates_; s++)
+      ParsimonyWord* leafData_bitsets_i = &(*leafData_bitsets)[i * nbWords_];
+      // Leaves bitset are set to 1 if the char correspond to the site in the sequence,
+      // otherwise value set to 0:
+      int state = seq->getValue(i);
+      vector<int> states = alphabet->getAlias(state);
+      for (size_t s = 0; s < nbStates_; s++)
       {
-        // Leaves bitset are set to 1 if the char correspond to the site in the sequence,
-        // otherwise value set to 0:
-        int state = seq->getValue(i);
-        vector<int> states = alphabet->getAlias(state);
         for (size_t j = 0; j < states.size(); j++)
         {
-          if (stateMap.getAlphabetStateAsInt(s) == states[j])
-            (*leafData_bitsets_i)[s].flip();
+          if (alphabetStates[s] == states[j])
+            leafData_bitsets_i[s / wordSize] |= static_cast<ParsimonyWord>(1) << (s % wordSize);
         }
       }
     }
@@ -157,10 +202,10 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
-      vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
+      vector<ParsimonyWord>* neighborData_bitsets = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
+      vector<unsigned int>* neighborData_scores   = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
 
-      neighborData_bitsets->resize(nbDistinctSites_);
+      neighborData_bitsets->resize(nbDistinctSites_ * nbWords_);
       neighborData_scores->resize(nbDistinctSites_);
     }
   }
@@ -198,10 +243,10 @@ void DRTreeParsimonyData::reInit(const Node* node) throw (Exception)
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
-      vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
+      vector<ParsimonyWord>* neighborData_bitsets = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
+      vector<unsigned int>* neighborData_scores   = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
 
-      neighborData_bitsets->resize(nbDistinctSites_);
+      neighborData_bitsets->resize(nbDistinctSites_ * nbWords_);
       neighborData_scores->resize(nbDistinctSites_);
     }
   }
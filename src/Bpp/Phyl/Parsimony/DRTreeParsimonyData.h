@@ -48,11 +48,19 @@
 #include <Bpp/Seq/Container/SiteContainer.h>
 
 // From the STL:
-#include <bitset>
+#include <cstdint>
 
 namespace bpp
 {
-typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
+/**
+ * @brief Machine word used to store the state sets.
+ *
+ * A set of states is coded with one bit per state, and stored for each site on
+ * as many consecutive words as needed: state @f$s@f$ is bit @f$s \bmod 64@f$ of word @f$\lfloor s / 64\rfloor@f$.
+ * Nucleotides, proteins (with gaps) and codons therefore all fit in a single word,
+ * while larger state spaces (words alphabets for instance) use several words per site.
+ */
+typedef uint64_t ParsimonyWord;
 
 /**
  * @brief Parsimony data structure for a node.
@@ -60,7 +68,7 @@ typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
  * This class is for use with the DRTreeParsimonyData class.
  *
  * Store for each neighbor node
- * - a vector of bitsets,
+ * - a vector of bitsets, coded as DRTreeParsimonyData::getNumberOfWords() words per site,
  * - a vector of score for the corresponding subtree.
  *
  * @see DRTreeParsimonyData
@@ -69,7 +77,7 @@ class DRTreeParsimonyNodeData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::map<int, std::vector<Bitset> > nodeBitsets_;
+  mutable std::map<int, std::vector<ParsimonyWord> > nodeBitsets_;
   mutable std::map<int, std::vector<unsigned int> > nodeScores_;
   const Node* node_;
 
@@ -101,11 +109,11 @@ public:
 
   void setNode(const Node* node) { node_ = node; }
 
-  std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId)
+  std::vector<ParsimonyWord>& getBitsetsArrayForNeighbor(int neighborId)
   {
     return nodeBitsets_[neighborId];
   }
-  const std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId) const
+  const std::vector<ParsimonyWord>& getBitsetsArrayForNeighbor(int neighborId) const
   {
     return nodeBitsets_[neighborId];
   }
@@ -143,7 +151,7 @@ class DRTreeParsimonyLeafData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::vector<Bitset> leafBitsets_;
+  mutable std::vector<ParsimonyWord> leafBitsets_;
   const Node* leaf_;
 
 public:
@@ -171,11 +179,11 @@ public:
   const Node* getNode() const { return leaf_; }
   void setNode(const Node* node) { leaf_ = node; }
 
-  std::vector<Bitset>& getBitsetsArray()
+  std::vector<ParsimonyWord>& getBitsetsArray()
   {
     return leafBitsets_;
   }
-  const std::vector<Bitset>& getBitsetsArray() const
+  const std::vector<ParsimonyWord>& getBitsetsArray() const
   {
     return leafBitsets_;
   }
@@ -185,6 +193,8 @@ public:
  * @brief Parsimony data structure for double-recursive (DR) algorithm.
  *
  * States are coded using bitsets for faster computing (@see AbstractTreeParsimonyData).
+ * There is no limit on the number of states: each site is coded on getNumberOfWords() ParsimonyWord,
+ * stored contiguously so that all sites of a node fit in a single array.
  * For each inner node in the tree, we store a DRTreeParsimonyNodeData object in nodeData_.
  * For each leaf node in the tree, we store a DRTreeParsimonyLeafData object in leafData_.
  *
@@ -198,11 +208,12 @@ class DRTreeParsimonyData :
 private:
   mutable std::map<int, DRTreeParsimonyNodeData> nodeData_;
   mutable std::map<int, DRTreeParsimonyLeafData> leafData_;
-  mutable std::vector<Bitset> rootBitsets_;
+  mutable std::vector<ParsimonyWord> rootBitsets_;
   mutable std::vector<unsigned int> rootScores_;
   SiteContainer* shrunkData_;
   size_t nbSites_;
   size_t nbStates_;
+  size_t nbWords_;
   size_t nbDistinctSites_;
 
 public:
@@ -215,6 +226,7 @@ public:
     shrunkData_(0),
     nbSites_(0),
     nbStates_(0),
+    nbWords_(0),
     nbDistinctSites_(0)
   {}
 
@@ -269,11 +281,11 @@ public:
     return leafData_[nodeId];
   }
 
-  std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId)
+  std::vector<ParsimonyWord>& getBitsetsArray(int nodeId, int neighborId)
   {
     return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
   }
-  const std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId) const
+  const std::vector<ParsimonyWord>& getBitsetsArray(int nodeId, int neighborId) const
   {
     return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
   }
@@ -292,9 +304,9 @@ public:
     return currentPosition;
   }
 
-  std::vector<Bitset>& getRootBitsets() { return rootBitsets_; }
-  const std::vector<Bitset>& getRootBitsets() const { return rootBitsets_; }
-  const Bitset& getRootBitset(size_t i) const { return rootBitsets_[i]; }
+  std::vector<ParsimonyWord>& getRootBitsets() { return rootBitsets_; }
+  const std::vector<ParsimonyWord>& getRootBitsets() const { return rootBitsets_; }
+  const ParsimonyWord* getRootBitset(size_t i) const { return &rootBitsets_[i * nbWords_]; }
 
   std::vector<unsigned int>& getRootScores() { return rootScores_; }
   const std::vector<unsigned int>& getRootScores() const { return rootScores_; }
@@ -304,7 +316,36 @@ public:
   size_t getNumberOfSites() const { return nbSites_; }
   size_t getNumberOfStates() const { return nbStates_; }
 
+  /**
+   * @return The number of ParsimonyWord used to code the set of states of one site.
+   */
+  size_t getNumberOfWords() const { return nbWords_; }
+
+  /**
+   * @return The number of ParsimonyWord needed to code a set of nbStates states.
+   * @param nbStates The number of states.
+   */
+  static size_t getNumberOfWords(size_t nbStates)
+  {
+    return (nbStates + 8 * sizeof(ParsimonyWord) - 1) / (8 * sizeof(ParsimonyWord));
+  }
+
   void init(const SiteContainer& sites, const StateMap& stateMap) throw (Exception);
+
+  /**
+   * @brief Initialize from the compressed data of another object.
+   *
+   * Site patterns, weights and leaf arrays are copied from 'data', without compressing the alignment again.
+   * The leaves of the tree associated to this object must be a subset of the leaves of the tree associated to 'data',
+   * with the same ids. This allows to score several trees with the same site patterns,
+   * for instance partial trees during stepwise addition.
+   * The shrunk alignment is not copied.
+   *
+   * @param data The data object to initialize from.
+   * @throw Exception If a leaf is not found in 'data'.
+   */
+  void init(const DRTreeParsimonyData& data) throw (Exception);
+
   void reInit() throw (Exception);
 
 protected:
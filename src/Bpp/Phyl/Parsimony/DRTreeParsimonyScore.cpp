@@ -44,6 +44,9 @@
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/VectorTools.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
@@ -129,43 +132,61 @@ void DRTreeParsimonyScore::computeScores()
 }
 
 void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
+{
+  computeArraysPostorder_(*parsimonyData_, node);
+}
+
+void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
+{
+  computeArraysPreorder_(*parsimonyData_, node);
+}
+
+void DRTreeParsimonyScore::computeArrays(DRTreeParsimonyData& data)
+{
+  const Node* root = data.getTree()->getRootNode();
+  computeArraysPostorder_(data, root);
+  computeArraysPreorder_(data, root);
+  computeScoresForNode(
+    data.getNodeData(root->getId()),
+    data.getRootBitsets(),
+    data.getRootScores());
+}
+
+void DRTreeParsimonyScore::computeArraysPostorder_(DRTreeParsimonyData& data, const Node* node)
 {
   if (node->isLeaf()) return;
-  DRTreeParsimonyNodeData* pData = &parsimonyData_->getNodeData(node->getId());
+  DRTreeParsimonyNodeData* pData = &data.getNodeData(node->getId());
   for (unsigned int k = 0; k < node->getNumberOfSons(); k++)
   {
     const Node* son = node->getSon(k);
-    computeScoresPostorder(son);
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(son->getId());
-    vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(son->getId());
+    computeArraysPostorder_(data, son);
+    vector<ParsimonyWord>* bitsets = &pData->getBitsetsArrayForNeighbor(son->getId());
+    vector<unsigned int>* scores   = &pData->getScoresArrayForNeighbor(son->getId());
     if (son->isLeaf())
     {
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(son->getId()).getBitsetsArray();
-      for (unsigned int i = 0; i < sonBitsets->size(); i++)
-      {
-        (*bitsets)[i] = (*sonBitsets)[i];
-        (*scores)[i]  = 0;
-      }
+      const vector<ParsimonyWord>* sonBitsets = &data.getLeafData(son->getId()).getBitsetsArray();
+      bitsets->assign(sonBitsets->begin(), sonBitsets->end());
+      scores->assign(scores->size(), 0);
     }
     else
     {
       computeScoresPostorderForNode(
-        parsimonyData_->getNodeData(son->getId()),
+        data.getNodeData(son->getId()),
         *bitsets,
         *scores);
     }
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, vector<Bitset>& rBitsets, vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, vector<ParsimonyWord>& rBitsets, vector<unsigned int>& rScores)
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   const Node* source = node->getFather();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
+  vector< const vector<ParsimonyWord>*> iBitsets;
   vector< const vector<unsigned int>*> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -180,29 +201,26 @@ void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNo
   computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
 }
 
-void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
+void DRTreeParsimonyScore::computeArraysPreorder_(DRTreeParsimonyData& data, const Node* node)
 {
   if (node->getNumberOfSons() == 0) return;
-  DRTreeParsimonyNodeData* pData = &parsimonyData_->getNodeData(node->getId());
+  DRTreeParsimonyNodeData* pData = &data.getNodeData(node->getId());
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(father->getId());
-    vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(father->getId());
+    vector<ParsimonyWord>* bitsets = &pData->getBitsetsArrayForNeighbor(father->getId());
+    vector<unsigned int>* scores   = &pData->getScoresArrayForNeighbor(father->getId());
     if (father->isLeaf())
     { // Means that the tree is rooted by a leaf... dunno if we must allow that! Let it be for now.
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(father->getId()).getBitsetsArray();
-      for (unsigned int i = 0; i < sonBitsets->size(); i++)
-      {
-        (*bitsets)[i] = (*sonBitsets)[i];
-        (*scores)[i]  = 0;
-      }
+      const vector<ParsimonyWord>* sonBitsets = &data.getLeafData(father->getId()).getBitsetsArray();
+      bitsets->assign(sonBitsets->begin(), sonBitsets->end());
+      scores->assign(scores->size(), 0);
     }
     else
     {
       computeScoresPreorderForNode(
-        parsimonyData_->getNodeData(father->getId()),
+        data.getNodeData(father->getId()),
         node,
         *bitsets,
         *scores);
@@ -211,17 +229,17 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   // Recurse call:
   for (unsigned int k = 0; k < node->getNumberOfSons(); k++)
   {
-    computeScoresPreorder(node->getSon(k));
+    computeArraysPreorder_(data, node->getSon(k));
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, std::vector<ParsimonyWord>& rBitsets, std::vector<unsigned int>& rScores)
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
+  vector< const vector<ParsimonyWord>*> iBitsets;
   vector< const vector<unsigned int>*> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -236,13 +254,13 @@ void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNod
   computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
 }
 
-void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, std::vector<ParsimonyWord>& rBitsets, std::vector<unsigned int>& rScores)
 {
   const Node* node = pData.getNode();
   size_t nbNeighbors = node->degree();
   vector<const Node*> neighbors = node->getNeighbors();
   // First initialize the vectors fro input:
-  vector< const vector<Bitset>*> iBitsets(nbNeighbors);
+  vector< const vector<ParsimonyWord>*> iBitsets(nbNeighbors);
   vector< const vector<unsigned int>*> iScores(nbNeighbors);
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -273,39 +291,74 @@ unsigned int DRTreeParsimonyScore::getScoreForSite(size_t site) const
 
 /******************************************************************************/
 void DRTreeParsimonyScore::computeScoresFromArrays(
-  const vector< const vector<Bitset>*>& iBitsets,
+  const vector< const vector<ParsimonyWord>*>& iBitsets,
   const vector< const vector<unsigned int>*>& iScores,
-  vector<Bitset>& oBitsets,
+  vector<ParsimonyWord>& oBitsets,
   vector<unsigned int>& oScores)
 {
-  size_t nbPos  = oBitsets.size();
+  size_t nbPos  = oScores.size();
   size_t nbNodes = iBitsets.size();
   if (iScores.size() != nbNodes)
     throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have the same length.");
   if (nbNodes < 1)
     throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have a size >= 1.");
-  const vector<Bitset>* bitsets0 = iBitsets[0];
-  const vector<unsigned int>* scores0 = iScores[0];
-  for (size_t i = 0; i < nbPos; i++)
+  if (nbPos == 0) return;
+  size_t nbWords = oBitsets.size() / nbPos;
+  oBitsets = *iBitsets[0];
+  oScores  = *iScores[0];
+  for (size_t k = 1; k < nbNodes; k++)
   {
-    oBitsets[i] = (*bitsets0)[i];
-    oScores[i]  = (*scores0)[i];
+    const ParsimonyWord* bitsetsk = &(*iBitsets[k])[0];
+    const unsigned int* scoresk = &(*iScores[k])[0];
+    switch (nbWords)
+    {
+    case 1:
+      computeFitchStep_<1>(bitsetsk, scoresk, &oBitsets[0], &oScores[0], nbPos, nbWords);
+      break;
+    case 2:
+      computeFitchStep_<2>(bitsetsk, scoresk, &oBitsets[0], &oScores[0], nbPos, nbWords);
+      break;
+    default:
+      computeFitchStep_<0>(bitsetsk, scoresk, &oBitsets[0], &oScores[0], nbPos, nbWords);
+    }
   }
-  for (size_t k = 1; k < nbNodes; k++)
+}
+
+template<size_t NW>
+void DRTreeParsimonyScore::computeFitchStep_(
+  const ParsimonyWord* iBitsets,
+  const unsigned int* iScores,
+  ParsimonyWord* oBitsets,
+  unsigned int* oScores,
+  size_t nbPos,
+  size_t nbWords)
+{
+  const size_t nw = (NW > 0 ? NW : nbWords);
+  for (size_t i = 0; i < nbPos; i++)
   {
-    const vector<Bitset>* bitsetsk = iBitsets[k];
-    const vector<unsigned int>* scoresk = iScores[k];
-    for (unsigned int i = 0; i < nbPos; i++)
+    ParsimonyWord inter = 0;
+    for (size_t w = 0; w < nw; w++)
     {
-      Bitset bs = oBitsets[i] & (*bitsetsk)[i];
-      oScores[i] += (*scoresk)[i];
-      if (bs == 0)
+      inter |= oBitsets[w] & iBitsets[w];
+    }
+    oScores[i] += iScores[i];
+    if (inter == 0)
+    {
+      for (size_t w = 0; w < nw; w++)
+      {
+        oBitsets[w] |= iBitsets[w];
+      }
+      oScores[i] += 1;
+    }
+    else
+    {
+      for (size_t w = 0; w < nw; w++)
       {
-        bs = oBitsets[i] | (*bitsetsk)[i];
-        oScores[i] += 1;
+        oBitsets[w] &= iBitsets[w];
       }
-      oBitsets[i] = bs;
     }
+    oBitsets += nw;
+    iBitsets += nw;
   }
 }
 
@@ -325,11 +378,11 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
 
   // Retrieving arrays of interest:
   const DRTreeParsimonyNodeData* parentData = &parsimonyData_->getNodeData(parent->getId());
-  const vector<Bitset>* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
+  const vector<ParsimonyWord>* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
   const vector<unsigned int>* sonScores  = &parentData->getScoresArrayForNeighbor(son->getId());
   vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
   size_t nbParentNeighbors = parentNeighbors.size();
-  vector< const vector<Bitset>*> parentBitsets(nbParentNeighbors);
+  vector< const vector<ParsimonyWord>*> parentBitsets(nbParentNeighbors);
   vector< const vector<unsigned int>*> parentScores(nbParentNeighbors);
   for (unsigned int k = 0; k < nbParentNeighbors; k++)
   {
@@ -339,11 +392,11 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
   }
 
   const DRTreeParsimonyNodeData* grandFatherData = &parsimonyData_->getNodeData(grandFather->getId());
-  const vector<Bitset>* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
+  const vector<ParsimonyWord>* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
   const vector<unsigned int>* uncleScores  = &grandFatherData->getScoresArrayForNeighbor(uncle->getId());
   vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
   size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
-  vector< const vector<Bitset>*> grandFatherBitsets(nbGrandFatherNeighbors);
+  vector< const vector<ParsimonyWord>*> grandFatherBitsets(nbGrandFatherNeighbors);
   vector< const vector<unsigned int>*> grandFatherScores(nbGrandFatherNeighbors);
   for (unsigned int k = 0; k < nbGrandFatherNeighbors; k++)
   {
@@ -356,7 +409,7 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
   grandFatherBitsets.push_back(sonBitsets);
   grandFatherScores.push_back(sonScores);
   // Init arrays:
-  vector<Bitset> gfBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
+  vector<ParsimonyWord> gfBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
   vector<unsigned int> gfScores(sonScores->size());
   // Fill arrays:
   computeScoresFromArrays(grandFatherBitsets, grandFatherScores, gfBitsets, gfScores);
@@ -367,7 +420,7 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
   parentBitsets.push_back(&gfBitsets);
   parentScores.push_back(&gfScores);
   // Init arrays:
-  vector<Bitset> pBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
+  vector<ParsimonyWord> pBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
   vector<unsigned int> pScores(sonScores->size());
   // Fill arrays:
   computeScoresFromArrays(parentBitsets, parentScores, pBitsets, pScores);
@@ -402,4 +455,348 @@ void DRTreeParsimonyScore::doNNI(int nodeId) throw (NodeException)
 }
 
 /******************************************************************************/
+void DRTreeParsimonyScore::computeSetFromArrays_(
+  const vector<const vector<ParsimonyWord>*>& iBitsets,
+  vector<ParsimonyWord>& oBitsets) const
+{
+  size_t nbWords = parsimonyData_->getNumberOfWords();
+  oBitsets = *iBitsets[0];
+  if (nbDistinctSites_ == 0) return;
+  for (size_t k = 1; k < iBitsets.size(); k++)
+  {
+    const ParsimonyWord* bitsetsk = &(*iBitsets[k])[0];
+    ParsimonyWord* obitsets = &oBitsets[0];
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+    {
+      ParsimonyWord inter = 0;
+      for (size_t w = 0; w < nbWords; w++)
+      {
+        inter |= obitsets[w] & bitsetsk[w];
+      }
+      if (inter == 0)
+      {
+        for (size_t w = 0; w < nbWords; w++)
+        {
+          obitsets[w] |= bitsetsk[w];
+        }
+      }
+      else
+      {
+        for (size_t w = 0; w < nbWords; w++)
+        {
+          obitsets[w] &= bitsetsk[w];
+        }
+      }
+      obitsets += nbWords;
+      bitsetsk += nbWords;
+    }
+  }
+}
+
+/******************************************************************************/
+unsigned int DRTreeParsimonyScore::getJoinCost_(
+  const vector<ParsimonyWord>& bitsets1,
+  const vector<ParsimonyWord>& bitsets2) const
+{
+  if (nbDistinctSites_ == 0) return 0;
+  size_t nbWords = parsimonyData_->getNumberOfWords();
+  const ParsimonyWord* b1 = &bitsets1[0];
+  const ParsimonyWord* b2 = &bitsets2[0];
+  unsigned int cost = 0;
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    ParsimonyWord inter = 0;
+    for (size_t w = 0; w < nbWords; w++)
+    {
+      inter |= b1[w] & b2[w];
+    }
+    if (inter == 0)
+      cost += parsimonyData_->getWeight(i);
+    b1 += nbWords;
+    b2 += nbWords;
+  }
+  return cost;
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::computeBranchSets_(
+  const Node* node,
+  const Node* from,
+  const vector<ParsimonyWord>& towardSet,
+  unsigned int distance,
+  unsigned int maxDistance,
+  const vector< vector<ParsimonyWord> >* subtreeSets,
+  vector<int>& branchIds,
+  vector< vector<ParsimonyWord> >& branchSets,
+  vector< vector<unsigned int> >& costs) const
+{
+  if (node->isLeaf()) return;
+  if (maxDistance > 0 && distance >= maxDistance) return;
+  const DRTreeParsimonyNodeData* nodeData = &parsimonyData_->getNodeData(node->getId());
+  vector<const Node*> neighbors = node->getNeighbors();
+  for (size_t k = 0; k < neighbors.size(); k++)
+  {
+    const Node* neighbor = neighbors[k];
+    if (neighbor == from) continue;
+    // Set of the region beyond 'node', as seen from 'neighbor':
+    vector< const vector<ParsimonyWord>*> iBitsets;
+    iBitsets.push_back(&towardSet);
+    for (size_t l = 0; l < neighbors.size(); l++)
+    {
+      if (l != k && neighbors[l] != from)
+        iBitsets.push_back(&nodeData->getBitsetsArrayForNeighbor(neighbors[l]->getId()));
+    }
+    vector<ParsimonyWord> bitsets;
+    computeSetFromArrays_(iBitsets, bitsets);
+
+    // Set of a virtual node on the branch:
+    iBitsets.resize(2);
+    iBitsets[0] = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
+    iBitsets[1] = &bitsets;
+    vector<ParsimonyWord> branchBitsets;
+    computeSetFromArrays_(iBitsets, branchBitsets);
+
+    branchIds.push_back(neighbor->getFather() == node ? neighbor->getId() : node->getId());
+    if (subtreeSets)
+    {
+      vector<unsigned int> branchCosts(subtreeSets->size());
+      for (size_t j = 0; j < subtreeSets->size(); j++)
+      {
+        branchCosts[j] = getJoinCost_(branchBitsets, (*subtreeSets)[j]);
+      }
+      costs.push_back(branchCosts);
+    }
+    else
+    {
+      branchSets.push_back(branchBitsets);
+    }
+
+    // Recursive call:
+    computeBranchSets_(neighbor, node, bitsets, distance + 1, maxDistance, subtreeSets, branchIds, branchSets, costs);
+  }
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::getPruneNeighbors_(const Node* node, const Node*& neighbor1, const Node*& neighbor2) const throw (NodeException)
+{
+  if (!node->hasFather()) throw NodePException("DRTreeParsimonyScore::getPruneNeighbors_(). Node must not be the root node.", node);
+  const Node* father = node->getFather();
+  if (father->degree() != 3) throw NodePException("DRTreeParsimonyScore::getPruneNeighbors_(). Father node must have exactly three neighbors.", father);
+  vector<const Node*> neighbors = TreeTemplateTools::getRemainingNeighbors(father, node, node);
+  neighbor1 = neighbors[0];
+  neighbor2 = neighbors[1];
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::testSPRs(
+  int nodeId,
+  unsigned int maxDistance,
+  vector<int>& regraftIds,
+  vector<double>& diffs) const throw (NodeException)
+{
+  vector<int> subtreeIds;
+  testRegrafts_(nodeId, maxDistance, false, subtreeIds, regraftIds, diffs);
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::testTBRs(
+  int nodeId,
+  unsigned int maxDistance,
+  vector<int>& subtreeIds,
+  vector<int>& regraftIds,
+  vector<double>& diffs) const throw (NodeException)
+{
+  testRegrafts_(nodeId, maxDistance, true, subtreeIds, regraftIds, diffs);
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::testRegrafts_(
+  int nodeId,
+  unsigned int maxDistance,
+  bool reroot,
+  vector<int>& subtreeIds,
+  vector<int>& regraftIds,
+  vector<double>& diffs) const throw (NodeException)
+{
+  subtreeIds.clear();
+  regraftIds.clear();
+  diffs.clear();
+  const Node* node = getTreeP_()->getNode(nodeId);
+  const Node* neighbor1;
+  const Node* neighbor2;
+  getPruneNeighbors_(node, neighbor1, neighbor2);
+  const Node* father = node->getFather();
+  const DRTreeParsimonyNodeData* fatherData = &parsimonyData_->getNodeData(father->getId());
+
+  // Sets of the pruned subtree, for each of its rooting:
+  vector< vector<ParsimonyWord> > subtreeSets(1, fatherData->getBitsetsArrayForNeighbor(nodeId));
+  vector<int> subtreeRootIds(1, nodeId);
+  vector< vector<unsigned int> > costs;
+  if (reroot && node->getNumberOfSons() == 2)
+  {
+    const DRTreeParsimonyNodeData* nodeData = &parsimonyData_->getNodeData(nodeId);
+    const Node* son1 = node->getSon(0);
+    const Node* son2 = node->getSon(1);
+    computeBranchSets_(son1, node, nodeData->getBitsetsArrayForNeighbor(son2->getId()), 0, maxDistance, 0, subtreeRootIds, subtreeSets, costs);
+    computeBranchSets_(son2, node, nodeData->getBitsetsArrayForNeighbor(son1->getId()), 0, maxDistance, 0, subtreeRootIds, subtreeSets, costs);
+  }
+
+  // Original position, where the branches leading to the two neighbors are merged:
+  vector< const vector<ParsimonyWord>*> iBitsets(2);
+  iBitsets[0] = &fatherData->getBitsetsArrayForNeighbor(neighbor1->getId());
+  iBitsets[1] = &fatherData->getBitsetsArrayForNeighbor(neighbor2->getId());
+  vector<ParsimonyWord> originalBitsets;
+  computeSetFromArrays_(iBitsets, originalBitsets);
+  unsigned int originalCost = getJoinCost_(originalBitsets, subtreeSets[0]);
+  // Rerooting the subtree without moving it:
+  for (size_t j = 1; j < subtreeSets.size(); j++)
+  {
+    subtreeIds.push_back(subtreeRootIds[j]);
+    regraftIds.push_back(father->getId());
+    diffs.push_back((double)getJoinCost_(originalBitsets, subtreeSets[j]) - (double)originalCost);
+  }
+
+  // All other positions in the remaining tree:
+  vector<int> branchIds;
+  vector< vector<ParsimonyWord> > branchSets;
+  computeBranchSets_(neighbor1, father, *iBitsets[1], 0, maxDistance, &subtreeSets, branchIds, branchSets, costs);
+  computeBranchSets_(neighbor2, father, *iBitsets[0], 0, maxDistance, &subtreeSets, branchIds, branchSets, costs);
+  for (size_t i = 0; i < branchIds.size(); i++)
+  {
+    for (size_t j = 0; j < subtreeSets.size(); j++)
+    {
+      subtreeIds.push_back(subtreeRootIds[j]);
+      regraftIds.push_back(branchIds[i]);
+      diffs.push_back((double)costs[i][j] - (double)originalCost);
+    }
+  }
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::doSPR(int nodeId, int regraftId) throw (NodeException)
+{
+  doTBR(nodeId, nodeId, regraftId);
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::doTBR(int nodeId, int subtreeId, int regraftId) throw (NodeException)
+{
+  Node* node = getTreeP_()->getNode(nodeId);
+  const Node* cNeighbor1;
+  const Node* cNeighbor2;
+  getPruneNeighbors_(node, cNeighbor1, cNeighbor2);
+  Node* father = node->getFather();
+
+  // Check the regraft position:
+  Node* regraft = getTreeP_()->getNode(regraftId);
+  Node* regraftFather = 0;
+  if (regraft != father)
+  {
+    if (!regraft->hasFather()) throw NodePException("DRTreeParsimonyScore::doTBR(). Regraft node must not be the root node.", regraft);
+    regraftFather = regraft->getFather();
+    if (regraftFather == father) throw NodePException("DRTreeParsimonyScore::doTBR(). Regraft branch must not be adjacent to the pruned node.", regraft);
+    for (const Node* n = regraft; n->hasFather(); n = n->getFather())
+    {
+      if (n == node) throw NodePException("DRTreeParsimonyScore::doTBR(). Regraft node must not belong to the pruned subtree.", regraft);
+    }
+  }
+
+  // Reroot the subtree if needed:
+  if (subtreeId != nodeId)
+    rerootSubtree_(node, getTreeP_()->getNode(subtreeId));
+
+  if (!regraftFather) return;
+
+  // Prune:
+  if (!father->hasFather())
+  {
+    // The father node is the root, so we move the root to one of its neighbors:
+    Node* newRoot = 0;
+    for (size_t i = 0; i < father->getNumberOfSons() && !newRoot; i++)
+    {
+      if (father->getSon(i) != node && !father->getSon(i)->isLeaf())
+        newRoot = father->getSon(i);
+    }
+    if (!newRoot) throw NodePException("DRTreeParsimonyScore::doTBR(). Could not reroot the tree.", father);
+    getTreeP_()->rootAt(newRoot);
+  }
+  Node* grandFather = father->getFather();
+  Node* brother = father->getSon(father->getSon(0) == node ? 1 : 0);
+  grandFather->removeSon(father);
+  father->removeSon(brother);
+  grandFather->addSon(brother);
+  if (brother->hasDistanceToFather() && father->hasDistanceToFather())
+    brother->setDistanceToFather(brother->getDistanceToFather() + father->getDistanceToFather());
+
+  // Regraft:
+  if (regraft->getFather() != regraftFather)
+  {
+    // The branch has been reversed when rerooting.
+    Node* tmp = regraft;
+    regraft = regraftFather;
+    regraftFather = tmp;
+  }
+  regraftFather->removeSon(regraft);
+  regraftFather->addSon(father);
+  father->addSon(regraft);
+  if (regraft->hasDistanceToFather())
+  {
+    double d = regraft->getDistanceToFather() / 2.;
+    regraft->setDistanceToFather(d);
+    father->setDistanceToFather(d);
+  }
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::rerootSubtree_(Node* subtreeRoot, Node* node) throw (NodeException)
+{
+  if (subtreeRoot->getNumberOfSons() != 2) throw NodePException("DRTreeParsimonyScore::rerootSubtree_(). Subtree root must have exactly two sons.", subtreeRoot);
+  if (!node->hasFather() || node->getFather() == subtreeRoot) throw NodePException("DRTreeParsimonyScore::rerootSubtree_(). Invalid rerooting node.", node);
+  // Path from the subtree root to the father of the new rooting node:
+  vector<Node*> path;
+  for (Node* n = node->getFather(); n != subtreeRoot; n = n->getFather())
+  {
+    if (!n->hasFather()) throw NodePException("DRTreeParsimonyScore::rerootSubtree_(). Rerooting node must belong to the subtree.", node);
+    path.push_back(n);
+  }
+  reverse(path.begin(), path.end());
+
+  // Remove the subtree root, and merge its two branches:
+  Node* other = subtreeRoot->getSon(subtreeRoot->getSon(0) == path[0] ? 1 : 0);
+  subtreeRoot->removeSon(path[0]);
+  subtreeRoot->removeSon(other);
+  path[0]->addSon(other);
+  if (other->hasDistanceToFather() && path[0]->hasDistanceToFather())
+    other->setDistanceToFather(other->getDistanceToFather() + path[0]->getDistanceToFather());
+  path[0]->deleteDistanceToFather();
+
+  // Reverse the path:
+  for (size_t i = 0; i + 1 < path.size(); i++)
+  {
+    if (path[i + 1]->hasDistanceToFather())
+      path[i]->setDistanceToFather(path[i + 1]->getDistanceToFather());
+    else
+      path[i]->deleteDistanceToFather();
+    path[i]->removeSon(path[i + 1]);
+    path[i + 1]->addSon(path[i]);
+  }
+
+  // Insert the subtree root on the new branch:
+  Node* last = path.back();
+  last->removeSon(node);
+  subtreeRoot->addSon(node);
+  subtreeRoot->addSon(last);
+  if (node->hasDistanceToFather())
+  {
+    double d = node->getDistanceToFather() / 2.;
+    node->setDistanceToFather(d);
+    last->setDistanceToFather(d);
+  }
+  else
+  {
+    last->deleteDistanceToFather();
+  }
+}
+
+/******************************************************************************/
 
@@ -43,6 +43,7 @@
 #include "AbstractTreeParsimonyScore.h"
 #include "DRTreeParsimonyData.h"
 #include "../NNISearchable.h"
+#include "../SPRSearchable.h"
 #include "../TreeTools.h"
 
 namespace bpp
@@ -51,10 +52,19 @@ namespace bpp
  * @brief Double recursive implementation of interface TreeParsimonyScore.
  *
  * Uses a DRTreeParsimonyData object for data storage.
+ * Any number of states is supported (codons included).
+ * The Fitch step is compiled for a fixed number of words per site when the states fit in one
+ * (nucleotides, proteins, codons) or two words, and falls back to a generic loop otherwise.
+ *
+ * Topology can be optimized with NNI, SPR and TBR movements.
+ * SPR and TBR movements of a subtree are all evaluated at once from the directional arrays:
+ * after a single traversal of the remaining tree, the cost of each regraft position is obtained in
+ * O(number of distinct sites × number of words).
  */
 class DRTreeParsimonyScore :
   public AbstractTreeParsimonyScore,
-  public virtual NNISearchable
+  public virtual NNISearchable,
+  public virtual SPRSearchable
 {
 private:
   DRTreeParsimonyData* parsimonyData_;
@@ -106,6 +116,25 @@ public:
   unsigned int getScore() const;
   unsigned int getScoreForSite(size_t site) const;
 
+  /**
+   * @return The weight of each distinct site pattern.
+   */
+  const std::vector<unsigned int>& getWeights() const { return parsimonyData_->getWeights(); }
+
+  /**
+   * @brief Set the weight of each distinct site pattern.
+   *
+   * Scores are weighted sums over patterns, so that no recomputation is needed.
+   * This is typically used for resampling or reweighting sites (bootstrap, parsimony ratchet).
+   *
+   * @param weights The new weights, one per distinct site pattern.
+   * @throw Exception If the number of weights does not match the number of distinct sites.
+   */
+  void setWeights(const std::vector<unsigned int>& weights) throw (Exception)
+  {
+    parsimonyData_->setWeights(weights);
+  }
+
   /**
    * @brief Compute bitsets and scores for each site for a node, in postorder.
    *
@@ -115,7 +144,7 @@ public:
    */
   static void computeScoresPostorderForNode(
     const DRTreeParsimonyNodeData& pData,
-    std::vector<Bitset>& rBitsets,
+    std::vector<ParsimonyWord>& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -129,7 +158,7 @@ public:
   static void computeScoresPreorderForNode(
     const DRTreeParsimonyNodeData& pData,
     const Node* source,
-    std::vector<Bitset>& rBitsets,
+    std::vector<ParsimonyWord>& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -140,7 +169,7 @@ public:
    * @param rScores  The score array where to write the resulting scores.
    */
   static void computeScoresForNode(
-    const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets,
+    const DRTreeParsimonyNodeData& pData, std::vector<ParsimonyWord>& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -150,17 +179,50 @@ public:
    * Depending on what is passed as input, it may computes scroes fo a subtree
    * or the whole tree.
    *
+   * The number of words per site is deduced from the sizes of the output arrays.
+   *
    * @param iBitsets The vector of bitset arrays to use.
    * @param iScores  The vector of score arrays to use.
    * @param oBitsets The bitset array where to store the resulting bitsets.
    * @param oScores  The score array where to write the resulting scores.
    */
   static void computeScoresFromArrays(
-    const std::vector<const std::vector<Bitset>*>& iBitsets,
+    const std::vector<const std::vector<ParsimonyWord>*>& iBitsets,
     const std::vector<const std::vector<unsigned int>*>& iScores,
-    std::vector<Bitset>& oBitsets,
+    std::vector<ParsimonyWord>& oBitsets,
     std::vector<unsigned int>& oScores);
 
+  /**
+   * @brief Compute all directional arrays and root arrays of a data object.
+   *
+   * This allows to score a tree without building a DRTreeParsimonyScore object,
+   * for instance with a data object initialized from the compressed data of another one
+   * (see DRTreeParsimonyData::init(const DRTreeParsimonyData&)).
+   *
+   * @param data The data object to compute, associated to the tree to score.
+   */
+  static void computeArrays(DRTreeParsimonyData& data);
+
+private:
+  static void computeArraysPostorder_(DRTreeParsimonyData& data, const Node* node);
+  static void computeArraysPreorder_(DRTreeParsimonyData& data, const Node* node);
+
+  /**
+   * @brief Fitch step: combine one array of bitsets and scores into the output arrays.
+   *
+   * NW is the number of words per site, or 0 if it is only known at run time (nbWords).
+   */
+  template<size_t NW>
+  static void computeFitchStep_(
+    const ParsimonyWord* iBitsets,
+    const unsigned int* iScores,
+    ParsimonyWord* oBitsets,
+    unsigned int* oScores,
+    size_t nbPos,
+    size_t nbWords);
+
+public:
+
   /**
    * @name Thee NNISearchable interface.
    *
@@ -183,6 +245,96 @@ public:
 
   void topologyChangeSuccessful(const TopologyChangeEvent& event) {}
   /**@} */
+
+  /**
+   * @name The SPRSearchable interface.
+   *
+   * Bifurcation is assumed for the father of the pruned node, and for the pruned node itself in the case of TBR.
+   *
+   * @{
+   */
+  void testSPRs(
+    int nodeId,
+    unsigned int maxDistance,
+    std::vector<int>& regraftIds,
+    std::vector<double>& diffs) const throw (NodeException);
+
+  void testTBRs(
+    int nodeId,
+    unsigned int maxDistance,
+    std::vector<int>& subtreeIds,
+    std::vector<int>& regraftIds,
+    std::vector<double>& diffs) const throw (NodeException);
+
+  void doSPR(int nodeId, int regraftId) throw (NodeException);
+
+  void doTBR(int nodeId, int subtreeId, int regraftId) throw (NodeException);
+  /**@} */
+
+private:
+  /**
+   * @brief Score variations of all regraft positions of a subtree, and optionally of all its rerootings.
+   */
+  void testRegrafts_(
+    int nodeId,
+    unsigned int maxDistance,
+    bool reroot,
+    std::vector<int>& subtreeIds,
+    std::vector<int>& regraftIds,
+    std::vector<double>& diffs) const throw (NodeException);
+
+  /**
+   * @brief Fitch sets of all branches of a region of the tree, as seen after pruning.
+   *
+   * Branches are visited from 'node', going away from 'from'.
+   * The branch set is the one of a virtual node placed on the branch.
+   * If subtreeSets is not null, the cost of joining each of these sets to each branch is computed
+   * and stored in 'costs', otherwise the branch sets are stored in 'branchSets'.
+   *
+   * @param node        The current node.
+   * @param from        The neighbor of 'node' in the direction of the pruned region.
+   * @param towardSet   The set of the region beyond 'node' in the direction of 'from', pruned region excluded.
+   * @param distance    The distance of the current node to the pruning point.
+   * @param maxDistance The maximum distance to consider (0 for no limit).
+   * @param subtreeSets The sets to join to each branch, if any.
+   * @param branchIds   [out] The ids of the lower node of each branch.
+   * @param branchSets  [out] The set of each branch, if subtreeSets is null.
+   * @param costs       [out] The joining costs for each branch, if subtreeSets is not null.
+   */
+  void computeBranchSets_(
+    const Node* node,
+    const Node* from,
+    const std::vector<ParsimonyWord>& towardSet,
+    unsigned int distance,
+    unsigned int maxDistance,
+    const std::vector< std::vector<ParsimonyWord> >* subtreeSets,
+    std::vector<int>& branchIds,
+    std::vector< std::vector<ParsimonyWord> >& branchSets,
+    std::vector< std::vector<unsigned int> >& costs) const;
+
+  /**
+   * @brief Fitch combination of arrays, discarding the scores.
+   */
+  void computeSetFromArrays_(
+    const std::vector<const std::vector<ParsimonyWord>*>& iBitsets,
+    std::vector<ParsimonyWord>& oBitsets) const;
+
+  /**
+   * @return The weighted number of sites for which the two sets do not intersect.
+   */
+  unsigned int getJoinCost_(
+    const std::vector<ParsimonyWord>& bitsets1,
+    const std::vector<ParsimonyWord>& bitsets2) const;
+
+  /**
+   * @brief Get the two neighbors of the father of the pruned node, and check that the movement is valid.
+   */
+  void getPruneNeighbors_(const Node* node, const Node*& neighbor1, const Node*& neighbor2) const throw (NodeException);
+
+  /**
+   * @brief Reroot the subtree defined by a node, on the branch above a given node of this subtree.
+   */
+  static void rerootSubtree_(Node* subtreeRoot, Node* node) throw (NodeException);
 };
 } // end of namespace bpp.
 
@@ -0,0 +1,192 @@
+//
+// File: DRTreeSankoffParsimonyData.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 10:12 2026
+// From file: DRTreeParsimonyData.cpp
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "DRTreeSankoffParsimonyData.h"
+#include "../SitePatterns.h"
+
+// From SeqLib:
+#include <Bpp/Seq/Container/AlignedSequenceContainer.h>
+
+// From the STL:
+#include <limits>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+void DRTreeSankoffParsimonyData::init(const SiteContainer& sites, const StateMap& stateMap) throw (Exception)
+{
+  nbStates_         = stateMap.getNumberOfModelStates();
+  nbSites_          = sites.getNumberOfSites();
+  SitePatterns pattern(&sites);
+  unique_ptr<SiteContainer> shrunkData(pattern.getSites());
+  rootWeights_      = pattern.getWeights();
+  rootPatternLinks_ = pattern.getIndices();
+  nbDistinctSites_  = shrunkData->getNumberOfSites();
+
+  // Init data:
+  // Clone data for more efficiency on sequences access:
+  AlignedSequenceContainer sequences(*shrunkData);
+  init(getTreeP_()->getRootNode(), sequences, stateMap);
+
+  // Now initialize root arrays:
+  rootCosts_.resize(nbDistinctSites_ * nbStates_);
+  rootScores_.resize(nbDistinctSites_);
+}
+
+/******************************************************************************/
+void DRTreeSankoffParsimonyData::init(const Node* node, const SiteContainer& sites, const StateMap& stateMap) throw (Exception)
+{
+  const Alphabet* alphabet = sites.getAlphabet();
+  if (node->isLeaf())
+  {
+    const Sequence* seq;
+    try
+    {
+      seq = &sites.getSequence(node->getName());
+    }
+    catch (SequenceNotFoundException& snfe)
+    {
+      throw SequenceNotFoundException("DRTreeSankoffParsimonyData:init(node, sites). Leaf name in tree not found in site container: ", (node->getName()));
+    }
+    DRTreeSankoffParsimonyLeafData* leafData = &leafData_[node->getId()];
+    vector<double>* leafData_costs           = &leafData->getCostsArray();
+    leafData->setNode(node);
+
+    // States not compatible with the observed character have an infinite cost:
+    leafData_costs->assign(nbDistinctSites_ * nbStates_, numeric_limits<double>::infinity());
+
+    vector<int> alphabetStates(nbStates_);
+    for (size_t s = 0; s < nbStates_; s++)
+    {
+      alphabetStates[s] = stateMap.getAlphabetStateAsInt(s);
+    }
+
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+    {
+      double* leafData_costs_i = &(*leafData_costs)[i * nbStates_];
+      int state = seq->getValue(i);
+      vector<int> states = alphabet->getAlias(state);
+      bool found = false;
+      for (size_t s = 0; s < nbStates_; s++)
+      {
+        for (size_t j = 0; j < states.size(); j++)
+        {
+          if (alphabetStates[s] == states[j])
+          {
+            leafData_costs_i[s] = 0.;
+            found = true;
+          }
+        }
+      }
+      // Characters not in the state map (e.g. gaps when they are not considered as a state) are treated as unknown:
+      if (!found)
+      {
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          leafData_costs_i[s] = 0.;
+        }
+      }
+    }
+  }
+  else
+  {
+    DRTreeSankoffParsimonyNodeData* nodeData = &nodeData_[node->getId()];
+    nodeData->setNode(node);
+    nodeData->eraseNeighborArrays();
+
+    int nbSons = static_cast<int>(node->getNumberOfSons());
+
+    for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
+    {
+      const Node* neighbor = (*node)[n];
+      nodeData->getCostsArrayForNeighbor(neighbor->getId()).resize(nbDistinctSites_ * nbStates_);
+    }
+  }
+
+  // We initialize each son node:
+  size_t nbSonNodes = node->getNumberOfSons();
+  for (unsigned int l = 0; l < nbSonNodes; l++)
+  {
+    // For each son node,
+    init(node->getSon(l), sites, stateMap);
+  }
+}
+
+/******************************************************************************/
+void DRTreeSankoffParsimonyData::reInit() throw (Exception)
+{
+  reInit(getTreeP_()->getRootNode());
+}
+
+/******************************************************************************/
+void DRTreeSankoffParsimonyData::reInit(const Node* node) throw (Exception)
+{
+  if (node->isLeaf())
+  {
+    return;
+  }
+  else
+  {
+    DRTreeSankoffParsimonyNodeData* nodeData = &nodeData_[node->getId()];
+    nodeData->setNode(node);
+    nodeData->eraseNeighborArrays();
+
+    int nbSons = static_cast<int>(node->getNumberOfSons());
+
+    for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
+    {
+      const Node* neighbor = (*node)[n];
+      nodeData->getCostsArrayForNeighbor(neighbor->getId()).resize(nbDistinctSites_ * nbStates_);
+    }
+  }
+
+  // We initialize each son node:
+  size_t nbSonNodes = node->getNumberOfSons();
+  for (unsigned int l = 0; l < nbSonNodes; l++)
+  {
+    // For each son node,
+    reInit(node->getSon(l));
+  }
+}
+
+/******************************************************************************/
+
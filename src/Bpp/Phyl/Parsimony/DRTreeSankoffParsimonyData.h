@@ -0,0 +1,315 @@
+//
+// File: DRTreeSankoffParsimonyData.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 10:12 2026
+// From file DRTreeParsimonyData.h
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _DRTREESANKOFFPARSIMONYDATA_H_
+#define _DRTREESANKOFFPARSIMONYDATA_H_
+
+#include "AbstractTreeParsimonyData.h"
+#include "../Model/StateMap.h"
+
+// From SeqLib
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From the STL:
+#include <map>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Weighted parsimony data structure for a node.
+ *
+ * This class is for use with the DRTreeSankoffParsimonyData class.
+ *
+ * Store for each neighbor node a vector of conditional costs, that is
+ * for each site and each state the minimum cost of the subtree defined by the neighbor,
+ * given that the neighbor is in this state.
+ * Costs are stored site by site, with getNumberOfStates() consecutive values per site.
+ *
+ * @see DRTreeSankoffParsimonyData
+ */
+class DRTreeSankoffParsimonyNodeData :
+  public TreeParsimonyNodeData
+{
+private:
+  mutable std::map<int, std::vector<double> > nodeCosts_;
+  const Node* node_;
+
+public:
+  DRTreeSankoffParsimonyNodeData() :
+    nodeCosts_(),
+    node_(0)
+  {}
+
+  DRTreeSankoffParsimonyNodeData(const DRTreeSankoffParsimonyNodeData& tpnd) :
+    nodeCosts_(tpnd.nodeCosts_),
+    node_(tpnd.node_)
+  {}
+
+  DRTreeSankoffParsimonyNodeData& operator=(const DRTreeSankoffParsimonyNodeData& tpnd)
+  {
+    nodeCosts_ = tpnd.nodeCosts_;
+    node_      = tpnd.node_;
+    return *this;
+  }
+
+  DRTreeSankoffParsimonyNodeData* clone() const { return new DRTreeSankoffParsimonyNodeData(*this); }
+
+public:
+  const Node* getNode() const { return node_; }
+
+  void setNode(const Node* node) { node_ = node; }
+
+  std::vector<double>& getCostsArrayForNeighbor(int neighborId)
+  {
+    return nodeCosts_[neighborId];
+  }
+  const std::vector<double>& getCostsArrayForNeighbor(int neighborId) const
+  {
+    return nodeCosts_[neighborId];
+  }
+
+  bool isNeighbor(int neighborId) const
+  {
+    return nodeCosts_.find(neighborId) != nodeCosts_.end();
+  }
+
+  void eraseNeighborArrays()
+  {
+    nodeCosts_.erase(nodeCosts_.begin(), nodeCosts_.end());
+  }
+};
+
+/**
+ * @brief Weighted parsimony data structure for a leaf.
+ *
+ * This class is for use with the DRTreeSankoffParsimonyData class.
+ *
+ * Store the vector of conditional costs associated to a leaf:
+ * 0 for states compatible with the observed character, infinity otherwise.
+ *
+ * @see DRTreeSankoffParsimonyData
+ */
+class DRTreeSankoffParsimonyLeafData :
+  public TreeParsimonyNodeData
+{
+private:
+  mutable std::vector<double> leafCosts_;
+  const Node* leaf_;
+
+public:
+  DRTreeSankoffParsimonyLeafData() :
+    leafCosts_(),
+    leaf_(0)
+  {}
+
+  DRTreeSankoffParsimonyLeafData(const DRTreeSankoffParsimonyLeafData& tpld) :
+    leafCosts_(tpld.leafCosts_),
+    leaf_(tpld.leaf_)
+  {}
+
+  DRTreeSankoffParsimonyLeafData& operator=(const DRTreeSankoffParsimonyLeafData& tpld)
+  {
+    leafCosts_ = tpld.leafCosts_;
+    leaf_      = tpld.leaf_;
+    return *this;
+  }
+
+  DRTreeSankoffParsimonyLeafData* clone() const { return new DRTreeSankoffParsimonyLeafData(*this); }
+
+public:
+  const Node* getNode() const { return leaf_; }
+  void setNode(const Node* node) { leaf_ = node; }
+
+  std::vector<double>& getCostsArray()
+  {
+    return leafCosts_;
+  }
+  const std::vector<double>& getCostsArray() const
+  {
+    return leafCosts_;
+  }
+};
+
+/**
+ * @brief Weighted parsimony data structure for double-recursive (DR) algorithm.
+ *
+ * This is the Sankoff counterpart of DRTreeParsimonyData: the same double-recursive layout is used,
+ * but sets of states are replaced by vectors of conditional costs.
+ * For each inner node in the tree, we store a DRTreeSankoffParsimonyNodeData object in nodeData_.
+ * For each leaf node in the tree, we store a DRTreeSankoffParsimonyLeafData object in leafData_.
+ *
+ * The dataset is first compressed, removing all identical sites.
+ * The corresponding positions are stored in rootPatternLinks_, inherited from AbstractTreeParsimonyData.
+ */
+class DRTreeSankoffParsimonyData :
+  public AbstractTreeParsimonyData
+{
+private:
+  mutable std::map<int, DRTreeSankoffParsimonyNodeData> nodeData_;
+  mutable std::map<int, DRTreeSankoffParsimonyLeafData> leafData_;
+  mutable std::vector<double> rootCosts_;
+  mutable std::vector<double> rootScores_;
+  size_t nbSites_;
+  size_t nbStates_;
+  size_t nbDistinctSites_;
+
+public:
+  DRTreeSankoffParsimonyData(const TreeTemplate<Node>* tree) :
+    AbstractTreeParsimonyData(tree),
+    nodeData_(),
+    leafData_(),
+    rootCosts_(),
+    rootScores_(),
+    nbSites_(0),
+    nbStates_(0),
+    nbDistinctSites_(0)
+  {}
+
+  DRTreeSankoffParsimonyData(const DRTreeSankoffParsimonyData& data) :
+    AbstractTreeParsimonyData(data),
+    nodeData_(data.nodeData_),
+    leafData_(data.leafData_),
+    rootCosts_(data.rootCosts_),
+    rootScores_(data.rootScores_),
+    nbSites_(data.nbSites_),
+    nbStates_(data.nbStates_),
+    nbDistinctSites_(data.nbDistinctSites_)
+  {}
+
+  DRTreeSankoffParsimonyData& operator=(const DRTreeSankoffParsimonyData& data)
+  {
+    AbstractTreeParsimonyData::operator=(data);
+    nodeData_        = data.nodeData_;
+    leafData_        = data.leafData_;
+    rootCosts_       = data.rootCosts_;
+    rootScores_      = data.rootScores_;
+    nbSites_         = data.nbSites_;
+    nbStates_        = data.nbStates_;
+    nbDistinctSites_ = data.nbDistinctSites_;
+    return *this;
+  }
+
+  virtual ~DRTreeSankoffParsimonyData() {}
+
+  DRTreeSankoffParsimonyData* clone() const { return new DRTreeSankoffParsimonyData(*this); }
+
+public:
+  /**
+   * @brief Set the tree associated to the data.
+   *
+   * All node data will be actualized accordingly by calling the setNode() method on the corresponding nodes.
+   * @warning: the old tree and the new tree must be two clones! And particularly, they have to share the
+   * same topology and nodes id.
+   *
+   * @param tree The tree to be associated to this data.
+   */
+  void setTree(const TreeTemplate<Node>* tree)
+  {
+    AbstractTreeParsimonyData::setTreeP_(tree);
+    for (std::map<int, DRTreeSankoffParsimonyNodeData>::iterator it = nodeData_.begin(); it != nodeData_.end(); it++)
+    {
+      int id = it->second.getNode()->getId();
+      it->second.setNode(tree_->getNode(id));
+    }
+    for (std::map<int, DRTreeSankoffParsimonyLeafData>::iterator it = leafData_.begin(); it != leafData_.end(); it++)
+    {
+      int id = it->second.getNode()->getId();
+      it->second.setNode(tree_->getNode(id));
+    }
+  }
+
+  DRTreeSankoffParsimonyNodeData& getNodeData(int nodeId)
+  {
+    return nodeData_[nodeId];
+  }
+  const DRTreeSankoffParsimonyNodeData& getNodeData(int nodeId) const
+  {
+    return nodeData_[nodeId];
+  }
+
+  DRTreeSankoffParsimonyLeafData& getLeafData(int nodeId)
+  {
+    return leafData_[nodeId];
+  }
+  const DRTreeSankoffParsimonyLeafData& getLeafData(int nodeId) const
+  {
+    return leafData_[nodeId];
+  }
+
+  std::vector<double>& getCostsArray(int nodeId, int neighborId)
+  {
+    return nodeData_[nodeId].getCostsArrayForNeighbor(neighborId);
+  }
+  const std::vector<double>& getCostsArray(int nodeId, int neighborId) const
+  {
+    return nodeData_[nodeId].getCostsArrayForNeighbor(neighborId);
+  }
+
+  size_t getArrayPosition(int parentId, int sonId, size_t currentPosition) const
+  {
+    return currentPosition;
+  }
+
+  /**
+   * @return The conditional costs of the whole tree, for each distinct site and each state of the root node.
+   */
+  std::vector<double>& getRootCosts() { return rootCosts_; }
+  const std::vector<double>& getRootCosts() const { return rootCosts_; }
+
+  std::vector<double>& getRootScores() { return rootScores_; }
+  const std::vector<double>& getRootScores() const { return rootScores_; }
+  double getRootScore(size_t i) const { return rootScores_[i]; }
+
+  size_t getNumberOfDistinctSites() const { return nbDistinctSites_; }
+  size_t getNumberOfSites() const { return nbSites_; }
+  size_t getNumberOfStates() const { return nbStates_; }
+
+  void init(const SiteContainer& sites, const StateMap& stateMap) throw (Exception);
+  void reInit() throw (Exception);
+
+protected:
+  void init(const Node* node, const SiteContainer& sites, const StateMap& stateMap) throw (Exception);
+  void reInit(const Node* node) throw (Exception);
+};
+} // end of namespace bpp.
+
+#endif // _DRTREESANKOFFPARSIMONYDATA_H_
+
@@ -0,0 +1,453 @@
+//
+// File: DRTreeSankoffParsimonyScore.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 10:35 2026
+// From file: DRTreeParsimonyScore.cpp
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "DRTreeSankoffParsimonyScore.h"
+#include "../TreeTemplateTools.h" // Needed for NNIs
+
+#include <Bpp/App/ApplicationTools.h>
+
+// From the STL:
+#include <cmath>
+#include <limits>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+DRTreeSankoffParsimonyScore::DRTreeSankoffParsimonyScore(
+  const Tree& tree,
+  const SiteContainer& data,
+  const Matrix<double>& costs,
+  bool verbose,
+  bool includeGaps)
+throw (Exception) :
+  AbstractTreeParsimonyScore(tree, data, verbose, includeGaps),
+  parsimonyData_(new DRTreeSankoffParsimonyData(getTreeP_())),
+  nbDistinctSites_(),
+  nbStates_(),
+  costsT_()
+{
+  init_(data, costs, verbose);
+}
+
+DRTreeSankoffParsimonyScore::DRTreeSankoffParsimonyScore(
+  const Tree& tree,
+  const SiteContainer& data,
+  const Matrix<double>& costs,
+  const StateMap* statesMap,
+  bool verbose)
+throw (Exception) :
+  AbstractTreeParsimonyScore(tree, data, statesMap, verbose),
+  parsimonyData_(new DRTreeSankoffParsimonyData(getTreeP_())),
+  nbDistinctSites_(),
+  nbStates_(),
+  costsT_()
+{
+  init_(data, costs, verbose);
+}
+
+void DRTreeSankoffParsimonyScore::init_(const SiteContainer& data, const Matrix<double>& costs, bool verbose)
+{
+  nbStates_ = getStateMap().getNumberOfModelStates();
+  if (costs.getNumberOfRows() != nbStates_ || costs.getNumberOfColumns() != nbStates_)
+    throw Exception("DRTreeSankoffParsimonyScore::init_. The cost matrix must be a square matrix with " + TextTools::toString(nbStates_) + " rows.");
+  costsT_.resize(nbStates_ * nbStates_);
+  for (size_t i = 0; i < nbStates_; i++)
+  {
+    for (size_t j = 0; j < nbStates_; j++)
+    {
+      costsT_[j * nbStates_ + i] = costs(i, j);
+    }
+  }
+
+  if (verbose)
+    ApplicationTools::displayTask("Initializing data structure");
+  parsimonyData_->init(data, getStateMap());
+  nbDistinctSites_ = parsimonyData_->getNumberOfDistinctSites();
+  computeScores();
+  if (verbose)
+    ApplicationTools::displayTaskDone();
+  if (verbose)
+    ApplicationTools::displayResult("Number of distinct sites",
+                                    TextTools::toString(nbDistinctSites_));
+}
+
+/******************************************************************************/
+
+DRTreeSankoffParsimonyScore::DRTreeSankoffParsimonyScore(const DRTreeSankoffParsimonyScore& tp) :
+  AbstractTreeParsimonyScore(tp),
+  parsimonyData_(dynamic_cast<DRTreeSankoffParsimonyData*>(tp.parsimonyData_->clone())),
+  nbDistinctSites_(tp.nbDistinctSites_),
+  nbStates_(tp.nbStates_),
+  costsT_(tp.costsT_)
+{
+  parsimonyData_->setTree(getTreeP_());
+}
+
+/******************************************************************************/
+
+DRTreeSankoffParsimonyScore& DRTreeSankoffParsimonyScore::operator=(const DRTreeSankoffParsimonyScore& tp)
+{
+  AbstractTreeParsimonyScore::operator=(tp);
+  delete parsimonyData_;
+  parsimonyData_ = dynamic_cast<DRTreeSankoffParsimonyData*>(tp.parsimonyData_->clone());
+  parsimonyData_->setTree(getTreeP_());
+  nbDistinctSites_ = tp.nbDistinctSites_;
+  nbStates_        = tp.nbStates_;
+  costsT_          = tp.costsT_;
+  return *this;
+}
+
+/******************************************************************************/
+
+DRTreeSankoffParsimonyScore::~DRTreeSankoffParsimonyScore()
+{
+  delete parsimonyData_;
+}
+
+/******************************************************************************/
+void DRTreeSankoffParsimonyScore::computeScores()
+{
+  computeScoresPostorder(getTreeP_()->getRootNode());
+  computeScoresPreorder(getTreeP_()->getRootNode());
+  computeCostsForNode(
+    parsimonyData_->getNodeData(getTree().getRootId()),
+    0,
+    parsimonyData_->getRootCosts());
+  computeScoresFromCosts(
+    parsimonyData_->getRootCosts(),
+    parsimonyData_->getRootScores());
+}
+
+void DRTreeSankoffParsimonyScore::computeScoresPostorder(const Node* node)
+{
+  if (node->isLeaf()) return;
+  DRTreeSankoffParsimonyNodeData* pData = &parsimonyData_->getNodeData(node->getId());
+  for (unsigned int k = 0; k < node->getNumberOfSons(); k++)
+  {
+    const Node* son = node->getSon(k);
+    computeScoresPostorder(son);
+    vector<double>* costs = &pData->getCostsArrayForNeighbor(son->getId());
+    if (son->isLeaf())
+    {
+      // son has no NodeData associated, must use LeafData instead
+      const vector<double>* sonCosts = &parsimonyData_->getLeafData(son->getId()).getCostsArray();
+      costs->assign(sonCosts->begin(), sonCosts->end());
+    }
+    else
+    {
+      computeCostsForNode(
+        parsimonyData_->getNodeData(son->getId()),
+        node,
+        *costs);
+    }
+  }
+}
+
+void DRTreeSankoffParsimonyScore::computeScoresPreorder(const Node* node)
+{
+  if (node->getNumberOfSons() == 0) return;
+  DRTreeSankoffParsimonyNodeData* pData = &parsimonyData_->getNodeData(node->getId());
+  if (node->hasFather())
+  {
+    const Node* father = node->getFather();
+    vector<double>* costs = &pData->getCostsArrayForNeighbor(father->getId());
+    if (father->isLeaf())
+    { // Means that the tree is rooted by a leaf.
+      // father has no NodeData associated, must use LeafData instead
+      const vector<double>* fatherCosts = &parsimonyData_->getLeafData(father->getId()).getCostsArray();
+      costs->assign(fatherCosts->begin(), fatherCosts->end());
+    }
+    else
+    {
+      computeCostsForNode(
+        parsimonyData_->getNodeData(father->getId()),
+        node,
+        *costs);
+    }
+  }
+  // Recurse call:
+  for (unsigned int k = 0; k < node->getNumberOfSons(); k++)
+  {
+    computeScoresPreorder(node->getSon(k));
+  }
+}
+
+void DRTreeSankoffParsimonyScore::computeCostsForNode(const DRTreeSankoffParsimonyNodeData& pData, const Node* source, vector<double>& rCosts) const
+{
+  // First initialize the vectors from input:
+  const Node* node = pData.getNode();
+  vector<const Node*> neighbors = node->getNeighbors();
+  size_t nbNeighbors = node->degree();
+  vector< const vector<double>*> iCosts;
+  for (unsigned int k = 0; k < nbNeighbors; k++)
+  {
+    const Node* n = neighbors[k];
+    if (n != source)
+    {
+      iCosts.push_back(&pData.getCostsArrayForNeighbor(n->getId()));
+    }
+  }
+  // Then call the general method on these arrays:
+  computeCostsFromArrays(iCosts, rCosts);
+}
+
+/******************************************************************************/
+void DRTreeSankoffParsimonyScore::computeCostsFromArrays(
+  const vector< const vector<double>*>& iCosts,
+  vector<double>& oCosts) const
+{
+  size_t nbNodes = iCosts.size();
+  if (nbNodes < 1)
+    throw Exception("DRTreeSankoffParsimonyScore::computeCostsFromArrays(); Error, input arrays must have a size >= 1.");
+  const size_t n = nbStates_;
+  const size_t nbPos = oCosts.size() / n;
+  const double inf = numeric_limits<double>::infinity();
+  const double* costsT = &costsT_[0];
+
+  vector<double> tmpCosts(n);
+  double* tmp = &tmpCosts[0];
+  for (size_t i = 0; i < nbPos; i++)
+  {
+    double* o = &oCosts[i * n];
+    for (size_t s = 0; s < n; s++)
+    {
+      o[s] = 0.;
+    }
+    for (size_t k = 0; k < nbNodes; k++)
+    {
+      // Min-plus product of the cost matrix with the conditional costs of neighbor k:
+      const double* c = &(*iCosts[k])[i * n];
+      for (size_t s = 0; s < n; s++)
+      {
+        tmp[s] = inf;
+      }
+      for (size_t j = 0; j < n; j++)
+      {
+        const double cj = c[j];
+        if (cj == inf) continue; // Typically the case for most states of a leaf.
+        const double* row = costsT + j * n;
+        for (size_t s = 0; s < n; s++)
+        {
+          double v = row[s] + cj;
+          tmp[s] = (v < tmp[s] ? v : tmp[s]);
+        }
+      }
+      for (size_t s = 0; s < n; s++)
+      {
+        o[s] += tmp[s];
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+void DRTreeSankoffParsimonyScore::computeScoresFromCosts(
+  const vector<double>& costs,
+  vector<double>& scores) const
+{
+  const size_t n = nbStates_;
+  for (size_t i = 0; i < scores.size(); i++)
+  {
+    const double* c = &costs[i * n];
+    double m = c[0];
+    for (size_t s = 1; s < n; s++)
+    {
+      m = (c[s] < m ? c[s] : m);
+    }
+    scores[i] = m;
+  }
+}
+
+/******************************************************************************/
+double DRTreeSankoffParsimonyScore::getWeightedScore() const
+{
+  double score = 0;
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    score += parsimonyData_->getRootScore(i) * parsimonyData_->getWeight(i);
+  }
+  return score;
+}
+
+/******************************************************************************/
+double DRTreeSankoffParsimonyScore::getWeightedScoreForSite(size_t site) const
+{
+  return parsimonyData_->getRootScore(parsimonyData_->getRootArrayPosition(site));
+}
+
+/******************************************************************************/
+unsigned int DRTreeSankoffParsimonyScore::getScore() const
+{
+  return static_cast<unsigned int>(floor(getWeightedScore() + 0.5));
+}
+
+/******************************************************************************/
+unsigned int DRTreeSankoffParsimonyScore::getScoreForSite(size_t site) const
+{
+  return static_cast<unsigned int>(floor(getWeightedScoreForSite(site) + 0.5));
+}
+
+/******************************************************************************/
+vector<double> DRTreeSankoffParsimonyScore::getRootCostsForSite(size_t site) const
+{
+  size_t pos = parsimonyData_->getRootArrayPosition(site);
+  const vector<double>& rootCosts = parsimonyData_->getRootCosts();
+  return vector<double>(rootCosts.begin() + static_cast<ptrdiff_t>(pos * nbStates_),
+                        rootCosts.begin() + static_cast<ptrdiff_t>((pos + 1) * nbStates_));
+}
+
+/******************************************************************************/
+RowMatrix<double> DRTreeSankoffParsimonyScore::getCostMatrix(const SubstitutionRegister& reg, const vector<double>& typeCosts) throw (Exception)
+{
+  if (!reg.getSubstitutionModel())
+    throw Exception("DRTreeSankoffParsimonyScore::getCostMatrix. The register has no substitution model attached.");
+  if (typeCosts.size() != reg.getNumberOfSubstitutionTypes())
+    throw Exception("DRTreeSankoffParsimonyScore::getCostMatrix. There should be one cost per substitution type.");
+  size_t n = reg.getSubstitutionModel()->getNumberOfStates();
+  RowMatrix<double> costs(n, n);
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      size_t t = reg.getType(i, j);
+      costs(i, j) = (t == 0 ? 0. : typeCosts[t - 1]);
+    }
+  }
+  return costs;
+}
+
+/******************************************************************************/
+RowMatrix<double> DRTreeSankoffParsimonyScore::getCostMatrix(const AlphabetIndex2& index, const StateMap& stateMap)
+{
+  size_t n = stateMap.getNumberOfModelStates();
+  RowMatrix<double> costs(n, n);
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      costs(i, j) = (i == j ? 0. : index.getIndex(stateMap.getAlphabetStateAsInt(i), stateMap.getAlphabetStateAsInt(j)));
+    }
+  }
+  return costs;
+}
+
+/******************************************************************************/
+double DRTreeSankoffParsimonyScore::testNNI(int nodeId) const throw (NodeException)
+{
+  const Node* son = getTreeP_()->getNode(nodeId);
+  if (!son->hasFather()) throw NodePException("DRTreeSankoffParsimonyScore::testNNI(). Node 'son' must not be the root node.", son);
+  const Node* parent = son->getFather();
+  if (!parent->hasFather()) throw NodePException("DRTreeSankoffParsimonyScore::testNNI(). Node 'parent' must not be the root node.", parent);
+  const Node* grandFather = parent->getFather();
+  // From here: Bifurcation assumed.
+  // In case of multifurcation, an arbitrary uncle is chosen.
+  // If we are at root node with a trifurcation, this does not matter, since 2 NNI are possible (see doc of the NNISearchable interface).
+  size_t parentPosition = grandFather->getSonPosition(parent);
+  const Node* uncle = grandFather->getSon(parentPosition > 1 ? parentPosition - 1 : 1 - parentPosition);
+
+  // Retrieving arrays of interest:
+  const DRTreeSankoffParsimonyNodeData* parentData = &parsimonyData_->getNodeData(parent->getId());
+  const vector<double>* sonCosts = &parentData->getCostsArrayForNeighbor(son->getId());
+  vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
+  size_t nbParentNeighbors = parentNeighbors.size();
+  vector< const vector<double>*> parentCosts(nbParentNeighbors);
+  for (unsigned int k = 0; k < nbParentNeighbors; k++)
+  {
+    const Node* n = parentNeighbors[k]; // This neighbor
+    parentCosts[k] = &parentData->getCostsArrayForNeighbor(n->getId());
+  }
+
+  const DRTreeSankoffParsimonyNodeData* grandFatherData = &parsimonyData_->getNodeData(grandFather->getId());
+  const vector<double>* uncleCosts = &grandFatherData->getCostsArrayForNeighbor(uncle->getId());
+  vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
+  size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
+  vector< const vector<double>*> grandFatherCosts(nbGrandFatherNeighbors);
+  for (unsigned int k = 0; k < nbGrandFatherNeighbors; k++)
+  {
+    const Node* n = grandFatherNeighbors[k]; // This neighbor
+    grandFatherCosts[k] = &grandFatherData->getCostsArrayForNeighbor(n->getId());
+  }
+
+  // Compute arrays for grand-father node:
+  grandFatherCosts.push_back(sonCosts);
+  vector<double> gfCosts(sonCosts->size()); // All arrays supposed to have the same size!
+  computeCostsFromArrays(grandFatherCosts, gfCosts);
+
+  // Now computes arrays for parent node:
+  parentCosts.push_back(uncleCosts);
+  parentCosts.push_back(&gfCosts);
+  vector<double> pCosts(sonCosts->size());
+  computeCostsFromArrays(parentCosts, pCosts);
+
+  // Final computation:
+  vector<double> pScores(nbDistinctSites_);
+  computeScoresFromCosts(pCosts, pScores);
+  double score = 0;
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    score += pScores[i] * parsimonyData_->getWeight(i);
+  }
+  return score - getWeightedScore();
+}
+
+/******************************************************************************/
+void DRTreeSankoffParsimonyScore::doNNI(int nodeId) throw (NodeException)
+{
+  Node* son = getTreeP_()->getNode(nodeId);
+  if (!son->hasFather()) throw NodePException("DRTreeSankoffParsimonyScore::doNNI(). Node 'son' must not be the root node.", son);
+  Node* parent = son->getFather();
+  if (!parent->hasFather()) throw NodePException("DRTreeSankoffParsimonyScore::doNNI(). Node 'parent' must not be the root node.", parent);
+  Node* grandFather = parent->getFather();
+  // From here: Bifurcation assumed.
+  // In case of multifurcation, an arbitrary uncle is chosen.
+  // If we are at root node with a trifurcation, this does not matter, since 2 NNI are possible (see doc of the NNISearchable interface).
+  size_t parentPosition = grandFather->getSonPosition(parent);
+  Node* uncle = grandFather->getSon(parentPosition > 1 ? parentPosition - 1 : 1 - parentPosition);
+  // Swap nodes:
+  parent->removeSon(son);
+  grandFather->removeSon(uncle);
+  parent->addSon(uncle);
+  grandFather->addSon(son);
+}
+
+/******************************************************************************/
+
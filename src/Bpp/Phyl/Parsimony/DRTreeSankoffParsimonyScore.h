@@ -0,0 +1,255 @@
+//
+// File: DRTreeSankoffParsimonyScore.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 10:35 2026
+// From file DRTreeParsimonyScore.h
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _DRTREESANKOFFPARSIMONYSCORE_H_
+#define _DRTREESANKOFFPARSIMONYSCORE_H_
+
+#include "AbstractTreeParsimonyScore.h"
+#include "DRTreeSankoffParsimonyData.h"
+#include "../NNISearchable.h"
+#include "../Mapping/SubstitutionRegister.h"
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+
+// From SeqLib:
+#include <Bpp/Seq/AlphabetIndex/AlphabetIndex2.h>
+
+namespace bpp
+{
+/**
+ * @brief Double recursive implementation of weighted (Sankoff) parsimony.
+ *
+ * Each change from state @f$i@f$ to state @f$j@f$ is charged @f$c_{i,j}@f$, as given by a cost matrix
+ * indexed by the states of the StateMap used.
+ * The cost matrix can be built from a SubstitutionRegister, with a cost for each type of substitution,
+ * or from an AlphabetIndex2 object (see the getCostMatrix() static methods).
+ *
+ * The same double-recursive scheme as DRTreeParsimonyScore is used, with conditional costs arrays
+ * instead of bitsets (see DRTreeSankoffParsimonyData), so that NNI movements are evaluated incrementally.
+ * The min-plus products are performed with the state of the father in the innermost loop, on a transposed
+ * copy of the cost matrix, so that they can be vectorized by the compiler.
+ *
+ * As the TreeParsimonyScore interface works with integer scores, getScore() and getScoreForSite()
+ * return the rounded weighted scores. Use getWeightedScore() and getWeightedScoreForSite() to get the exact values.
+ */
+class DRTreeSankoffParsimonyScore :
+  public AbstractTreeParsimonyScore,
+  public virtual NNISearchable
+{
+private:
+  DRTreeSankoffParsimonyData* parsimonyData_;
+  size_t nbDistinctSites_;
+  size_t nbStates_;
+  /**
+   * @brief The transposed cost matrix, stored by row: element @f$(j, i)@f$ is the cost of a change from @f$i@f$ to @f$j@f$.
+   */
+  std::vector<double> costsT_;
+
+public:
+  /**
+   * @brief Build a new weighted parsimony score object.
+   *
+   * @param tree        The tree to use.
+   * @param data        The alignment to use.
+   * @param costs       The square cost matrix, with as many rows as states in the canonical state map of the alphabet.
+   * @param verbose     Tell if some info should be displayed.
+   * @param includeGaps Tell if gaps should be considered as a state.
+   */
+  DRTreeSankoffParsimonyScore(
+    const Tree& tree,
+    const SiteContainer& data,
+    const Matrix<double>& costs,
+    bool verbose = true,
+    bool includeGaps = false)
+  throw (Exception);
+
+  /**
+   * @brief Build a new weighted parsimony score object.
+   *
+   * @param tree      The tree to use.
+   * @param data      The alignment to use.
+   * @param costs     The square cost matrix, with as many rows as states in statesMap.
+   * @param statesMap The state map to use.
+   * @param verbose   Tell if some info should be displayed.
+   */
+  DRTreeSankoffParsimonyScore(
+    const Tree& tree,
+    const SiteContainer& data,
+    const Matrix<double>& costs,
+    const StateMap* statesMap,
+    bool verbose = true)
+  throw (Exception);
+
+  DRTreeSankoffParsimonyScore(const DRTreeSankoffParsimonyScore& tp);
+
+  DRTreeSankoffParsimonyScore& operator=(const DRTreeSankoffParsimonyScore& tp);
+
+  virtual ~DRTreeSankoffParsimonyScore();
+
+  DRTreeSankoffParsimonyScore* clone() const { return new DRTreeSankoffParsimonyScore(*this); }
+
+private:
+  void init_(const SiteContainer& data, const Matrix<double>& costs, bool verbose);
+
+protected:
+  /**
+   * @brief Compute all scores.
+   *
+   * Call the computeScoresPreorder and computeScoresPostorder methods, and then initialize rootCosts_ and rootScores_.
+   */
+  virtual void computeScores();
+  /**
+   * @brief Compute scores (preorder algorithm).
+   */
+  virtual void computeScoresPreorder(const Node*);
+  /**
+   * @brief Compute scores (postorder algorithm).
+   */
+  virtual void computeScoresPostorder(const Node*);
+
+  /**
+   * @brief Compute the conditional costs of a node, from the arrays of all its neighbors but 'source'.
+   *
+   * @param pData  The node data to use.
+   * @param source The node where we are coming from, or 0 if all neighbors should be used.
+   * @param rCosts The array where to store the resulting conditional costs.
+   */
+  void computeCostsForNode(
+    const DRTreeSankoffParsimonyNodeData& pData,
+    const Node* source,
+    std::vector<double>& rCosts) const;
+
+  /**
+   * @brief Compute the conditional costs of a node from the conditional costs of its neighbors.
+   *
+   * For each site and each state @f$i@f$ of the node, compute
+   * @f[
+   * C(i) = \sum_k \min_j \left(c_{i,j} + C_k(j)\right)
+   * @f]
+   *
+   * @param iCosts The vector of conditional costs arrays of the neighbors.
+   * @param oCosts The array where to store the resulting conditional costs.
+   */
+  void computeCostsFromArrays(
+    const std::vector<const std::vector<double>*>& iCosts,
+    std::vector<double>& oCosts) const;
+
+  /**
+   * @brief Compute the score of each site from the conditional costs of the whole tree.
+   *
+   * @param costs  The conditional costs of the whole tree.
+   * @param scores The array where to store the score of each site.
+   */
+  void computeScoresFromCosts(
+    const std::vector<double>& costs,
+    std::vector<double>& scores) const;
+
+public:
+  unsigned int getScore() const;
+  unsigned int getScoreForSite(size_t site) const;
+
+  /**
+   * @return The weighted parsimony score of the tree.
+   */
+  double getWeightedScore() const;
+
+  /**
+   * @return The weighted parsimony score of the tree for a given site.
+   * @param site The site index.
+   */
+  double getWeightedScoreForSite(size_t site) const;
+
+  /**
+   * @return The conditional costs of the whole tree for a given site, for each state of the root node.
+   * This can be used for ancestral state reconstruction.
+   * @param site The site index.
+   */
+  std::vector<double> getRootCostsForSite(size_t site) const;
+
+  /**
+   * @brief Build a cost matrix from a substitution register.
+   *
+   * A change from state @f$i@f$ to state @f$j@f$ is charged typeCosts[t - 1],
+   * where @f$t > 0@f$ is the type of the substitution in the register, and 0 if @f$t = 0@f$.
+   * States of the register must match the ones of the state map used for computing the score.
+   *
+   * @param reg       The substitution register.
+   * @param typeCosts The cost of each substitution type.
+   * @return A new cost matrix.
+   */
+  static RowMatrix<double> getCostMatrix(const SubstitutionRegister& reg, const std::vector<double>& typeCosts) throw (Exception);
+
+  /**
+   * @brief Build a cost matrix from an alphabet index.
+   *
+   * A change from state @f$i@f$ to state @f$j \neq i@f$ is charged index(i, j), while diagonal elements are set to 0.
+   *
+   * @param index    The alphabet index to use.
+   * @param stateMap The state map used for computing the score.
+   * @return A new cost matrix.
+   */
+  static RowMatrix<double> getCostMatrix(const AlphabetIndex2& index, const StateMap& stateMap);
+
+  /**
+   * @name Thee NNISearchable interface.
+   *
+   * @{
+   */
+  double getTopologyValue() const throw (Exception) { return getWeightedScore(); }
+
+  double testNNI(int nodeId) const throw (NodeException);
+
+  void doNNI(int nodeId) throw (NodeException);
+
+  const Tree& getTopology() const { return getTree(); }
+
+  void topologyChangeTested(const TopologyChangeEvent& event)
+  {
+    parsimonyData_->reInit();
+    computeScores();
+  }
+
+  void topologyChangeSuccessful(const TopologyChangeEvent& event) {}
+  /**@} */
+};
+} // end of namespace bpp.
+
+#endif // _DRTREESANKOFFPARSIMONYSCORE_H_
+
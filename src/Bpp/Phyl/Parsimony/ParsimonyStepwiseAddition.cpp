@@ -0,0 +1,369 @@
+//
+// File: ParsimonyStepwiseAddition.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 15:10 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "ParsimonyStepwiseAddition.h"
+#include "DRTreeParsimonyScore.h"
+#include "../ParallelTools.h"
+
+#include <Bpp/Text/TextTools.h>
+
+// From the STL:
+#include <algorithm>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+ParsimonyStepwiseAddition::ParsimonyStepwiseAddition(const SiteContainer& data, bool includeGaps) throw (Exception) :
+  starTree_(0),
+  data_(0),
+  statesMap_(new CanonicalStateMap(data.getAlphabet(), includeGaps)),
+  names_(),
+  leafBitsets_()
+{
+  init_(data);
+}
+
+ParsimonyStepwiseAddition::ParsimonyStepwiseAddition(const SiteContainer& data, const StateMap* statesMap) throw (Exception) :
+  starTree_(0),
+  data_(0),
+  statesMap_(statesMap->clone()),
+  names_(),
+  leafBitsets_()
+{
+  init_(data);
+}
+
+void ParsimonyStepwiseAddition::init_(const SiteContainer& data) throw (Exception)
+{
+  names_ = data.getSequencesNames();
+  if (names_.size() < 3)
+    throw Exception("ParsimonyStepwiseAddition. At least three sequences are needed.");
+
+  // The data are compressed once, on a star tree with all taxa:
+  Node* root = new Node(static_cast<int>(names_.size()));
+  for (size_t i = 0; i < names_.size(); i++)
+  {
+    root->addSon(new Node(static_cast<int>(i), names_[i]));
+  }
+  starTree_ = new TreeTemplate<Node>(root);
+  data_ = new DRTreeParsimonyData(starTree_);
+  data_->init(data, *statesMap_);
+
+  leafBitsets_.resize(names_.size());
+  for (size_t i = 0; i < names_.size(); i++)
+  {
+    leafBitsets_[i] = &data_->getLeafData(static_cast<int>(i)).getBitsetsArray();
+  }
+}
+
+/******************************************************************************/
+
+ParsimonyStepwiseAddition::ParsimonyStepwiseAddition(const ParsimonyStepwiseAddition& psa) :
+  starTree_(psa.starTree_->clone()),
+  data_(psa.data_->clone()),
+  statesMap_(psa.statesMap_->clone()),
+  names_(psa.names_),
+  leafBitsets_(psa.leafBitsets_.size())
+{
+  data_->setTree(starTree_);
+  for (size_t i = 0; i < names_.size(); i++)
+  {
+    leafBitsets_[i] = &data_->getLeafData(static_cast<int>(i)).getBitsetsArray();
+  }
+}
+
+ParsimonyStepwiseAddition& ParsimonyStepwiseAddition::operator=(const ParsimonyStepwiseAddition& psa)
+{
+  delete data_;
+  delete starTree_;
+  delete statesMap_;
+  starTree_  = psa.starTree_->clone();
+  data_      = psa.data_->clone();
+  statesMap_ = psa.statesMap_->clone();
+  names_     = psa.names_;
+  data_->setTree(starTree_);
+  leafBitsets_.resize(names_.size());
+  for (size_t i = 0; i < names_.size(); i++)
+  {
+    leafBitsets_[i] = &data_->getLeafData(static_cast<int>(i)).getBitsetsArray();
+  }
+  return *this;
+}
+
+ParsimonyStepwiseAddition::~ParsimonyStepwiseAddition()
+{
+  delete data_;
+  delete starTree_;
+  delete statesMap_;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* ParsimonyStepwiseAddition::buildTree(unsigned int seed, unsigned int& score) const
+{
+  seed_seq seq = { seed, 0u };
+  mt19937 generator(seq);
+  return buildTree_(generator, score);
+}
+
+/******************************************************************************/
+
+vector<TreeTemplate<Node>*> ParsimonyStepwiseAddition::buildTrees(
+  unsigned int nbReplicates,
+  unsigned int nbBest,
+  unsigned int nbThreads,
+  unsigned int seed,
+  vector<unsigned int>* scores) const throw (Exception)
+{
+  vector<TreeTemplate<Node>*> trees(nbReplicates, 0);
+  vector<unsigned int> treeScores(nbReplicates, 0);
+
+  // Replicates are distributed dynamically, each one with its own generator:
+  try
+  {
+    ParallelTools::parallelFor(nbReplicates, nbThreads, [&](size_t r, size_t)
+    {
+      seed_seq seq = { seed, static_cast<unsigned int>(r) };
+      mt19937 generator(seq);
+      trees[r] = buildTree_(generator, treeScores[r]);
+    });
+  }
+  catch (...)
+  {
+    for (size_t r = 0; r < trees.size(); r++)
+    {
+      delete trees[r];
+    }
+    throw;
+  }
+
+  // Keep the best trees:
+  vector<size_t> index(nbReplicates);
+  for (size_t r = 0; r < nbReplicates; r++)
+  {
+    index[r] = r;
+  }
+  stable_sort(index.begin(), index.end(), [&treeScores](size_t i, size_t j) { return treeScores[i] < treeScores[j]; });
+  size_t nbKept = min(static_cast<size_t>(nbBest), index.size());
+  vector<TreeTemplate<Node>*> best(nbKept);
+  if (scores)
+    scores->resize(nbKept);
+  for (size_t r = 0; r < index.size(); r++)
+  {
+    if (r < nbKept)
+    {
+      best[r] = trees[index[r]];
+      if (scores)
+        (*scores)[r] = treeScores[index[r]];
+    }
+    else
+    {
+      delete trees[index[r]];
+    }
+  }
+  return best;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* ParsimonyStepwiseAddition::buildTree_(mt19937& generator, unsigned int& score) const
+{
+  size_t nbLeaves = names_.size();
+  vector<int> order(nbLeaves);
+  for (size_t i = 0; i < nbLeaves; i++)
+  {
+    order[i] = static_cast<int>(i);
+  }
+  shuffle(order.begin(), order.end(), generator);
+
+  // Start with three taxa:
+  int nextId = static_cast<int>(nbLeaves);
+  Node* root = new Node(nextId++);
+  for (size_t k = 0; k < 3; k++)
+  {
+    root->addSon(new Node(order[k], names_[static_cast<size_t>(order[k])]));
+  }
+  TreeTemplate<Node>* tree = new TreeTemplate<Node>(root);
+  DRTreeParsimonyData data(tree);
+  data.init(*data_);
+  DRTreeParsimonyScore::computeArrays(data);
+
+  size_t nbDistinctSites = data.getNumberOfDistinctSites();
+  size_t nbWords = data.getNumberOfWords();
+  vector<ParsimonyWord> upBitsets;
+  vector<unsigned int> upScores(nbDistinctSites);
+  for (size_t k = 3; k < nbLeaves; k++)
+  {
+    const vector<ParsimonyWord>& leafBitsets = *leafBitsets_[static_cast<size_t>(order[k])];
+    // Find the best branch:
+    vector<Node*> nodes = tree->getNodes();
+    Node* best = 0;
+    unsigned int bestCost = 0;
+    unsigned int nbTies = 0;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+      Node* node = nodes[i];
+      if (!node->hasFather()) continue;
+      const Node* father = node->getFather();
+      const DRTreeParsimonyNodeData& fatherData = data.getNodeData(father->getId());
+      const vector<ParsimonyWord>& downBitsets = fatherData.getBitsetsArrayForNeighbor(node->getId());
+      unsigned int cost;
+      if (node->isLeaf())
+      {
+        upBitsets.resize(downBitsets.size());
+        DRTreeParsimonyScore::computeScoresPreorderForNode(fatherData, node, upBitsets, upScores);
+        cost = getInsertionCost_(downBitsets, upBitsets, leafBitsets);
+      }
+      else
+      {
+        cost = getInsertionCost_(downBitsets, data.getNodeData(node->getId()).getBitsetsArrayForNeighbor(father->getId()), leafBitsets);
+      }
+      if (!best || cost < bestCost)
+      {
+        best     = node;
+        bestCost = cost;
+        nbTies   = 1;
+      }
+      else if (cost == bestCost)
+      {
+        // Ties are broken at random:
+        nbTies++;
+        if (uniform_int_distribution<unsigned int>(0, nbTies - 1)(generator) == 0)
+          best = node;
+      }
+    }
+
+    // Insert the new taxon:
+    Node* father = best->getFather();
+    Node* inner = new Node(nextId++);
+    Node* leaf = new Node(order[k], names_[static_cast<size_t>(order[k])]);
+    father->removeSon(best);
+    father->addSon(inner);
+    inner->addSon(best);
+    inner->addSon(leaf);
+
+    // The arrays of the new nodes are taken from the branch they are inserted on, and from the leaf:
+    DRTreeParsimonyLeafData& leafData = data.getLeafData(leaf->getId());
+    leafData.setNode(leaf);
+    leafData.getBitsetsArray() = leafBitsets;
+    DRTreeParsimonyNodeData& fatherData = data.getNodeData(father->getId());
+    DRTreeParsimonyNodeData& innerData = data.getNodeData(inner->getId());
+    innerData.setNode(inner);
+    innerData.getBitsetsArrayForNeighbor(best->getId()).swap(fatherData.getBitsetsArrayForNeighbor(best->getId()));
+    innerData.getScoresArrayForNeighbor(best->getId()).swap(fatherData.getScoresArrayForNeighbor(best->getId()));
+    innerData.getBitsetsArrayForNeighbor(leaf->getId()) = leafBitsets;
+    innerData.getScoresArrayForNeighbor(leaf->getId()).assign(nbDistinctSites, 0);
+
+    // In postorder, only the arrays on the path from the new taxon to the root change:
+    for (const Node* node = inner; node->hasFather(); node = node->getFather())
+    {
+      DRTreeParsimonyNodeData& pData = data.getNodeData(node->getFather()->getId());
+      vector<ParsimonyWord>& bitsets = pData.getBitsetsArrayForNeighbor(node->getId());
+      vector<unsigned int>& scores   = pData.getScoresArrayForNeighbor(node->getId());
+      bitsets.resize(nbDistinctSites * nbWords);
+      scores.resize(nbDistinctSites);
+      DRTreeParsimonyScore::computeScoresPostorderForNode(data.getNodeData(node->getId()), bitsets, scores);
+    }
+
+    // Arrays toward the root now include the new taxon for all branches off this path.
+    // They are recomputed from the root, nodes being listed in postorder,
+    // and only if another taxon is to be inserted:
+    if (k + 1 < nbLeaves)
+    {
+      nodes = tree->getNodes();
+      for (size_t i = nodes.size(); i > 0; i--)
+      {
+        const Node* node = nodes[i - 1];
+        if (!node->hasFather() || node->isLeaf()) continue;
+        int fatherId = node->getFather()->getId();
+        DRTreeParsimonyNodeData& pData = data.getNodeData(node->getId());
+        vector<ParsimonyWord>& bitsets = pData.getBitsetsArrayForNeighbor(fatherId);
+        vector<unsigned int>& scores   = pData.getScoresArrayForNeighbor(fatherId);
+        bitsets.resize(nbDistinctSites * nbWords);
+        scores.resize(nbDistinctSites);
+        DRTreeParsimonyScore::computeScoresPreorderForNode(data.getNodeData(fatherId), node, bitsets, scores);
+      }
+    }
+  }
+
+  DRTreeParsimonyScore::computeScoresForNode(data.getNodeData(root->getId()), data.getRootBitsets(), data.getRootScores());
+  score = 0;
+  for (size_t i = 0; i < nbDistinctSites; i++)
+  {
+    score += data.getRootScore(i) * data.getWeight(i);
+  }
+  return tree;
+}
+
+/******************************************************************************/
+
+unsigned int ParsimonyStepwiseAddition::getInsertionCost_(
+  const vector<ParsimonyWord>& bitsets1,
+  const vector<ParsimonyWord>& bitsets2,
+  const vector<ParsimonyWord>& leafBitsets) const
+{
+  size_t nbDistinctSites = data_->getNumberOfDistinctSites();
+  size_t nbWords = data_->getNumberOfWords();
+  unsigned int cost = 0;
+  for (size_t i = 0; i < nbDistinctSites; i++)
+  {
+    const ParsimonyWord* b1 = &bitsets1[i * nbWords];
+    const ParsimonyWord* b2 = &bitsets2[i * nbWords];
+    const ParsimonyWord* l  = &leafBitsets[i * nbWords];
+    // Fitch set of the branch:
+    ParsimonyWord inter = 0;
+    for (size_t w = 0; w < nbWords; w++)
+    {
+      inter |= b1[w] & b2[w];
+    }
+    ParsimonyWord join = 0;
+    for (size_t w = 0; w < nbWords; w++)
+    {
+      join |= (inter != 0 ? b1[w] & b2[w] : b1[w] | b2[w]) & l[w];
+    }
+    if (join == 0)
+      cost += data_->getWeight(i);
+  }
+  return cost;
+}
+
+/******************************************************************************/
+
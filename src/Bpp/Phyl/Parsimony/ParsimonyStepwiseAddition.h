@@ -0,0 +1,156 @@
+//
+// File: ParsimonyStepwiseAddition.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 15:10 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _PARSIMONYSTEPWISEADDITION_H_
+#define _PARSIMONYSTEPWISEADDITION_H_
+
+#include "DRTreeParsimonyData.h"
+#include "../TreeTemplate.h"
+#include "../Model/StateMap.h"
+
+// From SeqLib:
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <random>
+
+namespace bpp
+{
+/**
+ * @brief Build starting trees by randomized stepwise addition under parsimony.
+ *
+ * Taxa are added in random order, each one on the branch that minimizes the parsimony score
+ * of the partial tree (ties are broken at random).
+ * The alignment is compressed once: all partial trees share its site patterns and leaf arrays
+ * (see DRTreeParsimonyData::init(const DRTreeParsimonyData&)).
+ * The insertion cost of a taxon on all branches is computed from the directional arrays of the partial tree,
+ * in O(number of distinct sites × number of words) per branch.
+ * After each insertion, arrays are updated in place: the postorder ones on the path to the root only,
+ * and the preorder ones in a single pass over the inner nodes, without initializing the data again.
+ *
+ * Several replicates can be built in parallel. Each replicate uses its own random number generator,
+ * seeded from the global seed and the replicate index, so that results do not depend on the number of threads.
+ *
+ * Trees are unrooted, without branch lengths.
+ */
+class ParsimonyStepwiseAddition
+{
+private:
+  TreeTemplate<Node>* starTree_;
+  DRTreeParsimonyData* data_;
+  StateMap* statesMap_;
+  std::vector<std::string> names_;
+  std::vector<const std::vector<ParsimonyWord>*> leafBitsets_;
+
+public:
+  /**
+   * @param data        The alignment to use.
+   * @param includeGaps Tell if gaps should be considered as a state.
+   * @throw Exception If the alignment has less than three sequences.
+   */
+  ParsimonyStepwiseAddition(const SiteContainer& data, bool includeGaps = false) throw (Exception);
+
+  /**
+   * @param data      The alignment to use.
+   * @param statesMap The state map to use.
+   * @throw Exception If the alignment has less than three sequences.
+   */
+  ParsimonyStepwiseAddition(const SiteContainer& data, const StateMap* statesMap) throw (Exception);
+
+  ParsimonyStepwiseAddition(const ParsimonyStepwiseAddition& psa);
+
+  ParsimonyStepwiseAddition& operator=(const ParsimonyStepwiseAddition& psa);
+
+  virtual ~ParsimonyStepwiseAddition();
+
+private:
+  void init_(const SiteContainer& data) throw (Exception);
+
+public:
+  /**
+   * @brief Build one tree.
+   *
+   * The generator is seeded with (seed, 0), so that the tree is the first replicate of buildTrees() with the same seed.
+   *
+   * @param seed  The seed of the random number generator.
+   * @param score [out] The parsimony score of the tree.
+   * @return A new tree.
+   */
+  TreeTemplate<Node>* buildTree(unsigned int seed, unsigned int& score) const;
+
+  /**
+   * @brief Build several trees in parallel, and keep the best ones.
+   *
+   * Replicate r uses its own generator, seeded with (seed, r), so that the results do not depend on the number of threads.
+   *
+   * @param nbReplicates The number of trees to build.
+   * @param nbBest       The number of trees to keep.
+   * @param nbThreads    The number of threads to use (0 to use the number of available cores).
+   * @param seed         The global seed.
+   * @param scores       [out] If not null, the parsimony score of each tree returned.
+   * @return The nbBest best trees, sorted by increasing score. Trees are owned by the caller.
+   */
+  std::vector<TreeTemplate<Node>*> buildTrees(
+    unsigned int nbReplicates,
+    unsigned int nbBest = 1,
+    unsigned int nbThreads = 0,
+    unsigned int seed = 0,
+    std::vector<unsigned int>* scores = 0) const throw (Exception);
+
+private:
+  TreeTemplate<Node>* buildTree_(std::mt19937& generator, unsigned int& score) const;
+
+  /**
+   * @return The weighted number of sites for which the Fitch set of a branch does not intersect the set of a leaf.
+   *
+   * @param bitsets1 The set of the branch in one direction.
+   * @param bitsets2 The set of the branch in the other direction.
+   * @param leafBitsets The set of the leaf.
+   */
+  unsigned int getInsertionCost_(
+    const std::vector<ParsimonyWord>& bitsets1,
+    const std::vector<ParsimonyWord>& bitsets2,
+    const std::vector<ParsimonyWord>& leafBitsets) const;
+};
+} // end of namespace bpp.
+
+#endif // _PARSIMONYSTEPWISEADDITION_H_
+
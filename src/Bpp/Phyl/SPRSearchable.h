@@ -0,0 +1,131 @@
+//
+// File: SPRSearchable.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 14:02 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _SPRSEARCHABLE_H_
+#define _SPRSEARCHABLE_H_
+
+#include "NNISearchable.h"
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Interface for Subtree Pruning and Regrafting (SPR) and Tree Bisection and Reconnection (TBR) algorithms.
+ *
+ * Movements are defined on the rooted representation of an unrooted, bifurcating tree:
+ * - the pruned subtree is the clade defined by a node P, which is detached together with its father F;
+ * - the remaining tree is then reconnected at a regraft branch, defined by its lower node.
+ *   The two branches adjacent to F (other than the one leading to P) are merged when F is removed,
+ *   so that they do not define valid regraft positions. The original position is denoted by the id of F.
+ * - in the case of TBR movements, the pruned subtree is first rerooted on one of its branches, defined by its lower node.
+ *   The original rooting of the subtree is denoted by the id of P.
+ *
+ * As NNI are particular SPR movements, this interface extends the NNISearchable interface.
+ * Node ids are preserved by all movements.
+ */
+class SPRSearchable :
+  public virtual NNISearchable
+{
+public:
+  SPRSearchable() {}
+  virtual ~SPRSearchable() {}
+
+  virtual SPRSearchable* clone() const = 0;
+
+public:
+  /**
+   * @brief Send the score variation of all SPR movements of a subtree, without performing them.
+   *
+   * Variations must be negative if the new topology is better.
+   *
+   * @param nodeId      The id of the node defining the subtree to prune.
+   * @param maxDistance The maximum number of branches between the original and the regraft positions (0 for no limit).
+   * @param regraftIds  [out] The ids of the lower nodes of the regraft branches.
+   * @param diffs       [out] The corresponding score variations.
+   * @throw NodeException If the node does not define a valid SPR movement.
+   */
+  virtual void testSPRs(
+    int nodeId,
+    unsigned int maxDistance,
+    std::vector<int>& regraftIds,
+    std::vector<double>& diffs) const throw (NodeException) = 0;
+
+  /**
+   * @brief Send the score variation of all TBR movements of a subtree, without performing them.
+   *
+   * @param nodeId      The id of the node defining the subtree to prune.
+   * @param maxDistance The maximum number of branches between the original and the new positions (0 for no limit),
+   * in the subtree and in the remaining tree.
+   * @param subtreeIds  [out] The ids of the lower nodes of the branches where the subtree is rerooted.
+   * @param regraftIds  [out] The ids of the lower nodes of the regraft branches.
+   * @param diffs       [out] The corresponding score variations.
+   * @throw NodeException If the node does not define a valid TBR movement.
+   */
+  virtual void testTBRs(
+    int nodeId,
+    unsigned int maxDistance,
+    std::vector<int>& subtreeIds,
+    std::vector<int>& regraftIds,
+    std::vector<double>& diffs) const throw (NodeException) = 0;
+
+  /**
+   * @brief Perform a SPR movement.
+   *
+   * @param nodeId    The id of the node defining the subtree to prune.
+   * @param regraftId The id of the lower node of the regraft branch.
+   * @throw NodeException If the nodes do not define a valid SPR movement.
+   */
+  virtual void doSPR(int nodeId, int regraftId) throw (NodeException) = 0;
+
+  /**
+   * @brief Perform a TBR movement.
+   *
+   * @param nodeId    The id of the node defining the subtree to prune.
+   * @param subtreeId The id of the lower node of the branch where the subtree is rerooted.
+   * @param regraftId The id of the lower node of the regraft branch.
+   * @throw NodeException If the nodes do not define a valid TBR movement.
+   */
+  virtual void doTBR(int nodeId, int subtreeId, int regraftId) throw (NodeException) = 0;
+};
+} // end of namespace bpp.
+
+#endif // _SPRSEARCHABLE_H_
+
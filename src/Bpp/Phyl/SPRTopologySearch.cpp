@@ -0,0 +1,119 @@
+//
+// File: SPRTopologySearch.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 14:20 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "SPRTopologySearch.h"
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Numeric/VectorTools.h>
+
+using namespace bpp;
+using namespace std;
+
+const string SPRTopologySearch::SPR = "SPR";
+const string SPRTopologySearch::TBR = "TBR";
+
+void SPRTopologySearch::notifyAllPerformed(const TopologyChangeEvent& event)
+{
+  searchableTree_->topologyChangePerformed(event);
+  for (size_t i = 0; i < topoListeners_.size(); i++)
+  {
+    topoListeners_[i]->topologyChangePerformed(event);
+  }
+}
+
+void SPRTopologySearch::search() throw (Exception)
+{
+  if (algorithm_ != SPR && algorithm_ != TBR)
+    throw Exception("Unknown SPR algorithm: " + algorithm_ + ".\n");
+  bool test = true;
+  do
+  {
+    test = false;
+    // Node ids are preserved by the movements, but not the rooting:
+    vector<int> ids = searchableTree_->getTopology().getNodesId();
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+      int nodeId = ids[i];
+      if (!searchableTree_->getTopology().hasFather(nodeId))
+        continue;
+
+      vector<int> subtreeIds;
+      vector<int> regraftIds;
+      vector<double> diffs;
+      try
+      {
+        if (algorithm_ == TBR)
+          searchableTree_->testTBRs(nodeId, maxDistance_, subtreeIds, regraftIds, diffs);
+        else
+          searchableTree_->testSPRs(nodeId, maxDistance_, regraftIds, diffs);
+      }
+      catch (NodeException& ne)
+      {
+        // This node does not define any valid movement (for instance because of a multifurcation).
+        continue;
+      }
+      if (diffs.size() == 0)
+        continue;
+
+      size_t best = VectorTools::whichMin(diffs);
+      if (diffs[best] < 0.)
+      { // Good movement found...
+        if (verbose_ >= 2)
+        {
+          ApplicationTools::displayResult("   Moving node " + TextTools::toString(nodeId)
+                                          + " to " + TextTools::toString(regraftIds[best]),
+                                          TextTools::toString(diffs[best]));
+        }
+        if (algorithm_ == TBR)
+          searchableTree_->doTBR(nodeId, subtreeIds[best], regraftIds[best]);
+        else
+          searchableTree_->doSPR(nodeId, regraftIds[best]);
+        // Notify:
+        notifyAllPerformed(TopologyChangeEvent());
+        test = true;
+
+        if (verbose_ >= 1)
+          ApplicationTools::displayResult("   Current value", TextTools::toString(searchableTree_->getTopologyValue(), 10));
+      }
+    }
+  }
+  while (test);
+}
+
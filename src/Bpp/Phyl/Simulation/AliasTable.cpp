@@ -0,0 +1,111 @@
+//
+// File: AliasTable.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 15:05 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "AliasTable.h"
+
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+void AliasTable::setProbabilities(const vector<double>& probs) throw (Exception)
+{
+  size_t n = probs.size();
+  if (n == 0)
+    throw Exception("AliasTable::setProbabilities. Empty distribution.");
+  double sum = 0;
+  size_t iMax = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (probs[i] > 0) sum += probs[i];
+    if (probs[i] > probs[iMax]) iMax = i;
+  }
+  if (!(sum > 0))
+    throw Exception("AliasTable::setProbabilities. Probabilities sum to " + TextTools::toString(sum) + ".");
+
+  // Scale probabilities so that their mean is one:
+  prob_.resize(n);
+  alias_.resize(n);
+  vector<size_t> small, large;
+  small.reserve(n);
+  large.reserve(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    prob_[i] = (probs[i] > 0 ? probs[i] * static_cast<double>(n) / sum : 0.);
+    alias_[i] = i;
+    if (prob_[i] < 1.)
+      small.push_back(i);
+    else
+      large.push_back(i);
+  }
+
+  // Each small column is completed by a large one:
+  while (!small.empty() && !large.empty())
+  {
+    size_t s = small.back();
+    small.pop_back();
+    size_t l = large.back();
+    alias_[s] = l;
+    prob_[l] -= 1. - prob_[s];
+    if (prob_[l] < 1.)
+    {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+
+  // Remaining columns are full, up to rounding errors:
+  for (size_t i = 0; i < large.size(); i++)
+  {
+    prob_[large[i]] = 1.;
+  }
+  for (size_t i = 0; i < small.size(); i++)
+  {
+    // Categories with a null probability must never be drawn:
+    if (prob_[small[i]] > 0)
+      prob_[small[i]] = 1.;
+    else
+      alias_[small[i]] = iMax;
+  }
+}
+
+/******************************************************************************/
+
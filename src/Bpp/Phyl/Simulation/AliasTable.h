@@ -0,0 +1,132 @@
+//
+// File: AliasTable.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 15:05 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _ALIASTABLE_H_
+#define _ALIASTABLE_H_
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Sample from a discrete distribution in constant time.
+ *
+ * This class implements the alias method of Walker, with the construction algorithm of Vose:
+ * the table is built in O(n), after what each draw only needs one uniform random number
+ * and one comparison, whatever the number of categories.
+ * This is much faster than scanning the cumulative distribution when drawing many values
+ * from the same distribution, for instance codon states in sequence simulations.
+ *
+ * Vose M.D.
+ * A linear algorithm for generating random numbers with a given distribution.
+ * IEEE Transactions on Software Engineering. 1991;17(9):972-975.
+ */
+class AliasTable
+{
+  private:
+    std::vector<double> prob_;
+    std::vector<size_t> alias_;
+
+  public:
+    AliasTable() : prob_(), alias_() {}
+
+    /**
+     * @param probs The probabilities of each category. They do not have to sum to one,
+     * and negative values (for instance due to numerical errors) are considered as zero.
+     * @throw Exception If the distribution is empty or sums to zero.
+     */
+    AliasTable(const std::vector<double>& probs) throw (Exception) :
+      prob_(), alias_()
+    {
+      setProbabilities(probs);
+    }
+
+    virtual ~AliasTable() {}
+
+  public:
+    /**
+     * @brief (Re)build the table for a new distribution.
+     *
+     * @param probs The probabilities of each category, see constructor.
+     * @throw Exception If the distribution is empty or sums to zero.
+     */
+    void setProbabilities(const std::vector<double>& probs) throw (Exception);
+
+    /**
+     * @return The number of categories.
+     */
+    size_t size() const { return prob_.size(); }
+
+    /**
+     * @brief Draw a category using a given uniform random number.
+     *
+     * The integer part of u * size() gives the column, and its fractional part is used
+     * to choose between the column and its alias.
+     *
+     * @param u A number uniformly drawn in [0, 1).
+     * @return The index of the category.
+     */
+    size_t draw(double u) const
+    {
+      double x = u * static_cast<double>(prob_.size());
+      size_t i = static_cast<size_t>(x);
+      if (i >= prob_.size()) i = prob_.size() - 1; // Rounding.
+      return (x - static_cast<double>(i) < prob_[i]) ? i : alias_[i];
+    }
+
+    /**
+     * @brief Draw a category using the default random generator.
+     *
+     * @return The index of the category.
+     */
+    size_t draw() const
+    {
+      return draw(RandomTools::giveRandomNumberBetweenZeroAndEntry(1.));
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_ALIASTABLE_H_
+
@@ -41,6 +41,7 @@
 
 #include "NonHomogeneousSequenceSimulator.h"
 #include "../Model/SubstitutionModelSetTools.h"
+#include "../ParallelTools.h"
 
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/VectorTools.h>
@@ -49,11 +50,20 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+// From the STL:
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
 using namespace bpp;
 using namespace std;
 
 /******************************************************************************/
 
+const size_t NonHomogeneousSequenceSimulator::SITES_PER_STREAM = 1000;
+
+/******************************************************************************/
+
 NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   const SubstitutionModelSet* modelSet,
   const DiscreteDistribution* rate,
@@ -71,7 +81,8 @@ NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   nbClasses_(rate_->getNumberOfCategories()),
   nbStates_(modelSet_->getNumberOfStates()),
   continuousRates_(false),
-  outputInternalSequences_(false)
+  outputInternalSequences_(false),
+  rootFreqs_()
 {
   if (!modelSet->isFullySetUpFor(*tree))
     throw Exception("NonHomogeneousSequenceSimulator(constructor). Model set is not fully specified.");
@@ -97,7 +108,8 @@ NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   nbClasses_(rate_->getNumberOfCategories()),
   nbStates_(model->getNumberOfStates()),
   continuousRates_(false),
-  outputInternalSequences_(false)
+  outputInternalSequences_(false),
+  rootFreqs_()
 {
   FixedFrequenciesSet* fSet = new FixedFrequenciesSet(model->getStateMap().clone(), model->getFrequencies());
   fSet->setNamespace("anc.");
@@ -130,31 +142,37 @@ void NonHomogeneousSequenceSimulator::init()
       seqNames_[i] = leaves_[i]->getName();
     }
   }
-  // Initialize cumulative pxy:
+  // Initialize alias tables:
+  rootFreqs_.setProbabilities(modelSet_->getRootFrequencies());
   nodes.pop_back(); // remove root
   nbNodes_ = nodes.size();
 
+  vector<double> pxy(nbStates_);
+  map<const TransitionModel*, shared_ptr<const JumpChain> > jumpChains;
   for (size_t i = 0; i < nodes.size(); i++)
   {
     SNode* node = nodes[i];
-    node->getInfos().model = modelSet_->getModelForNode(node->getId());
+    const TransitionModel* model = modelSet_->getModelForNode(node->getId());
+    node->getInfos().model = model;
+    // Jump chains are shared by all branches with the same model:
+    if (jumpChains.find(model) == jumpChains.end())
+      jumpChains[model] = buildJumpChain_(model);
+    node->getInfos().jumpChain = jumpChains[model];
     double d = node->getDistanceToFather();
-    VVVdouble* cumpxy_node_ = &node->getInfos().cumpxy;
-    cumpxy_node_->resize(nbClasses_);
+    vector< vector<AliasTable> >* pxy_node_ = &node->getInfos().pxy;
+    pxy_node_->resize(nbClasses_);
     for (size_t c = 0; c < nbClasses_; c++)
     {
-      VVdouble* cumpxy_node_c_ = &(*cumpxy_node_)[c];
-      cumpxy_node_c_->resize(nbStates_);
+      vector<AliasTable>* pxy_node_c_ = &(*pxy_node_)[c];
+      pxy_node_c_->resize(nbStates_);
       RowMatrix<double> P = node->getInfos().model->getPij_t(d * rate_->getCategory(c));
       for (size_t x = 0; x < nbStates_; x++)
       {
-        Vdouble* cumpxy_node_c_x_ = &(*cumpxy_node_c_)[x];
-        cumpxy_node_c_x_->resize(nbStates_);
-        (*cumpxy_node_c_x_)[0] = P(x, 0);
-        for (size_t y = 1; y < nbStates_; y++)
+        for (size_t y = 0; y < nbStates_; y++)
         {
-          (*cumpxy_node_c_x_)[y] = (*cumpxy_node_c_x_)[y - 1] + P(x, y);
+          pxy[y] = P(x, y);
         }
+        (*pxy_node_c_)[x].setProbabilities(pxy);
       }
     }
   }
@@ -162,22 +180,134 @@ void NonHomogeneousSequenceSimulator::init()
 
 /******************************************************************************/
 
-Site* NonHomogeneousSequenceSimulator::simulateSite() const
+shared_ptr<const JumpChain> NonHomogeneousSequenceSimulator::buildJumpChain_(const TransitionModel* model)
 {
-  // Draw an initial state randomly according to equilibrum frequencies:
-  size_t initialStateIndex = 0;
-  double r = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  double cumprob = 0;
-  vector<double> freqs = modelSet_->getRootFrequencies();
-  for (size_t i = 0; i < nbStates_; i++)
+  const SubstitutionModel* subModel = dynamic_cast<const SubstitutionModel*>(model);
+  if (!subModel)
+    return shared_ptr<const JumpChain>();
+  const Matrix<double>& generator = subModel->getGenerator();
+  size_t n = generator.getNumberOfRows();
+  double rate = subModel->getRate();
+  double mu = 0;
+  for (size_t x = 0; x < n; x++)
   {
-    cumprob += freqs[i];
-    if (r <= cumprob)
+    mu = max(mu, -rate * generator(x, x));
+  }
+  if (!(mu > 0))
+    return shared_ptr<const JumpChain>();
+
+  // Jump matrix R = I + Q / mu:
+  vector< vector<double> > r(n, vector<double>(n));
+  shared_ptr<JumpChain> chain(new JumpChain());
+  chain->rate = mu;
+  chain->jumps.resize(n);
+  for (size_t x = 0; x < n; x++)
+  {
+    for (size_t y = 0; y < n; y++)
     {
-      initialStateIndex = i;
-      break;
+      r[x][y] = max(0., (x == y ? 1. : 0.) + rate * generator(x, y) / mu);
     }
+    chain->jumps[x].setProbabilities(r[x]);
   }
+
+  // Check P(t) = sum_k Poisson(k; mu t) R^k against the transition probabilities of the model,
+  // for all initial states and several values of mu t.
+  // This rejects models whose transition probabilities are not exp(Q t), such as mixtures.
+  double times[3] = { 0.1, 1., 4. };
+  vector< vector<double> > v(n, vector<double>(n)), w(n, vector<double>(n)), p(n, vector<double>(n));
+  for (size_t i = 0; i < 3; i++)
+  {
+    const Matrix<double>& pijt = model->getPij_t(times[i] / mu);
+    for (size_t x = 0; x < n; x++)
+    {
+      fill(v[x].begin(), v[x].end(), 0.);
+      fill(p[x].begin(), p[x].end(), 0.);
+      v[x][x] = 1.;
+    }
+    // Sum the series until the remaining Poisson mass is negligible:
+    double poisson = exp(-times[i]);
+    double cumPoisson = 0;
+    for (size_t k = 0; cumPoisson < 1. - 1e-12 && k < 200; k++)
+    {
+      for (size_t x = 0; x < n; x++)
+      {
+        for (size_t y = 0; y < n; y++)
+        {
+          p[x][y] += poisson * v[x][y];
+        }
+      }
+      cumPoisson += poisson;
+      for (size_t x = 0; x < n; x++)
+      {
+        fill(w[x].begin(), w[x].end(), 0.);
+        for (size_t z = 0; z < n; z++)
+        {
+          if (v[x][z] == 0.) continue;
+          for (size_t y = 0; y < n; y++)
+          {
+            w[x][y] += v[x][z] * r[z][y];
+          }
+        }
+      }
+      v.swap(w);
+      poisson *= times[i] / static_cast<double>(k + 1);
+    }
+    for (size_t x = 0; x < n; x++)
+    {
+      for (size_t y = 0; y < n; y++)
+      {
+        if (abs(p[x][y] - pijt(x, y)) > 1e-6)
+          return shared_ptr<const JumpChain>();
+      }
+    }
+  }
+  return chain;
+}
+
+/******************************************************************************/
+
+template<class Uniform>
+size_t NonHomogeneousSequenceSimulator::evolve_(
+    const JumpChain* chain,
+    const TransitionModel* model,
+    size_t initialStateIndex,
+    double length,
+    Uniform& uniform) const
+{
+  if (!chain)
+    return evolve(model, initialStateIndex, length, uniform());
+
+  // Draw the number of jumps by inversion, in chunks of mean at most 100 so that exp(-lambda) does not underflow:
+  size_t state = initialStateIndex;
+  double lambda = chain->rate * length;
+  while (lambda > 0)
+  {
+    double l = min(lambda, 100.);
+    lambda -= l;
+    double u = uniform();
+    double p = exp(-l);
+    double cump = p;
+    size_t nbJumps = 0;
+    while (u >= cump && p > 0)
+    {
+      nbJumps++;
+      p *= l / static_cast<double>(nbJumps);
+      cump += p;
+    }
+    for (size_t k = 0; k < nbJumps; k++)
+    {
+      state = chain->jumps[state].draw(uniform());
+    }
+  }
+  return state;
+}
+
+/******************************************************************************/
+
+Site* NonHomogeneousSequenceSimulator::simulateSite() const
+{
+  // Draw an initial state randomly according to equilibrum frequencies:
+  size_t initialStateIndex = rootFreqs_.draw();
   return simulateSite(initialStateIndex);
 }
 
@@ -284,19 +414,7 @@ Site* NonHomogeneousSequenceSimulator::simulateSite(size_t ancestralStateIndex,
 Site* NonHomogeneousSequenceSimulator::simulateSite(double rate) const
 {
   // Draw an initial state randomly according to equilibrum frequencies:
-  size_t ancestralStateIndex = 0;
-  double r = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  double cumprob = 0;
-  vector<double> freqs = modelSet_->getRootFrequencies();
-  for (size_t i = 0; i < nbStates_; i++)
-  {
-    cumprob += freqs[i];
-    if (r <= cumprob)
-    {
-      ancestralStateIndex = i;
-      break;
-    }
-  }
+  size_t ancestralStateIndex = rootFreqs_.draw();
   // Make this state evolve:
   return simulateSite(ancestralStateIndex, rate);
 }
@@ -308,18 +426,7 @@ SiteContainer* NonHomogeneousSequenceSimulator::simulate(size_t numberOfSites) c
   vector<size_t> ancestralStateIndices(numberOfSites, 0);
   for (size_t j = 0; j < numberOfSites; j++)
   {
-    double r = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-    double cumprob = 0;
-    vector<double> freqs = modelSet_->getRootFrequencies();
-    for (size_t i = 0; i < nbStates_; i++)
-    {
-      cumprob += freqs[i];
-      if (r <= cumprob)
-      {
-        ancestralStateIndices[j] = i;
-        break;
-      }
-    }
+    ancestralStateIndices[j] = rootFreqs_.draw();
   }
   if (continuousRates_)
   {
@@ -352,22 +459,242 @@ SiteContainer* NonHomogeneousSequenceSimulator::simulate(size_t numberOfSites) c
 
 /******************************************************************************/
 
-RASiteSimulationResult* NonHomogeneousSequenceSimulator::dSimulateSite() const
+SiteContainer* NonHomogeneousSequenceSimulator::simulate(size_t numberOfSites, uint64_t seed, unsigned int nbThreads) const
 {
-  // Draw an initial state randomly according to equilibrum frequencies:
-  size_t ancestralStateIndex = 0;
-  double r = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  double cumprob = 0;
-  vector<double> freqs = modelSet_->getRootFrequencies();
-  for (size_t i = 0; i < nbStates_; i++)
+  return simulate_(numberOfSites, 0, seed, nbThreads);
+}
+
+/******************************************************************************/
+
+SiteContainer* NonHomogeneousSequenceSimulator::simulateSites(const vector<double>& rates, uint64_t seed, unsigned int nbThreads) const
+{
+  return simulate_(rates.size(), &rates, seed, nbThreads);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief Nodes, output sequences and buffers of each thread used by parallel simulations.
+ */
+class NonHomogeneousSequenceSimulator::ParallelSimulation_
+{
+  public:
+    class Workspace
+    {
+      public:
+        // Models and rate distribution compute values on the fly with continuous rates, and are not shared:
+        unique_ptr<SubstitutionModelSet> modelSet;
+        unique_ptr<DiscreteDistribution> rateDist;
+        vector<const TransitionModel*> models;
+        vector< vector<size_t> > states;
+        vector<size_t> rateClasses;
+        vector<double> siteRates;
+
+      public:
+        Workspace() : modelSet(), rateDist(), models(), states(), rateClasses(), siteRates() {}
+    };
+
+  public:
+    // Nodes are sorted so that fathers come before their sons, starting with the root:
+    vector<SNode*> nodes;
+    vector<size_t> fathers;
+    vector<size_t> outputIndices;
+    vector<const TransitionModel*> outputModels;
+    vector<Workspace> workspaces;
+
+  public:
+    ParallelSimulation_(const NonHomogeneousSequenceSimulator& simulator, size_t nbWorkers) :
+      nodes(simulator.tree_.getNodes()),
+      fathers(),
+      outputIndices(),
+      outputModels(),
+      workspaces(nbWorkers)
+    {
+      vector<SNode*> outputNodes = (simulator.outputInternalSequences_ ? nodes : simulator.leaves_);
+      reverse(nodes.begin(), nodes.end());
+      map<const SNode*, size_t> indices;
+      for (size_t k = 0; k < nodes.size(); k++)
+      {
+        indices[nodes[k]] = k;
+      }
+      fathers.resize(nodes.size(), 0);
+      for (size_t k = 1; k < nodes.size(); k++)
+      {
+        fathers[k] = indices[nodes[k]->getFather()];
+      }
+      outputIndices.resize(outputNodes.size());
+      outputModels.resize(outputNodes.size());
+      for (size_t i = 0; i < outputNodes.size(); i++)
+      {
+        outputIndices[i] = indices[outputNodes[i]];
+        // The root has no model, we take the one of its son:
+        outputModels[i] = (outputNodes[i]->hasFather() ? outputNodes[i] : outputNodes[i]->getSon(0))->getInfos().model;
+      }
+    }
+};
+
+/******************************************************************************/
+
+size_t NonHomogeneousSequenceSimulator::getNumberOfWorkers_(unsigned int nbThreads, size_t numberOfSites)
+{
+  size_t nbBlocks = (numberOfSites + SITES_PER_STREAM - 1) / SITES_PER_STREAM;
+  return ParallelTools::getNumberOfWorkers(nbBlocks, nbThreads);
+}
+
+/******************************************************************************/
+
+SiteContainer* NonHomogeneousSequenceSimulator::simulate_(
+  size_t numberOfSites,
+  const vector<double>* rates,
+  uint64_t seed,
+  unsigned int nbThreads) const
+{
+  ParallelSimulation_ simulation(*this, getNumberOfWorkers_(nbThreads, numberOfSites));
+  size_t nbSeqs = simulation.outputIndices.size();
+  vector< vector<int> > contents(nbSeqs, vector<int>(numberOfSites));
+  simulateBlocks_(simulation, 0, numberOfSites, rates, seed, contents);
+
+  AlignedSequenceContainer* sites = new AlignedSequenceContainer(alphabet_);
+  for (size_t i = 0; i < nbSeqs; i++)
+  {
+    sites->addSequence(BasicSequence(seqNames_[i], contents[i], alphabet_), false);
+    vector<int>().swap(contents[i]); // Free memory as we go.
+  }
+  return sites;
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::simulate(
+  size_t numberOfSites,
+  SequenceSimulationSink& sink,
+  uint64_t seed,
+  unsigned int nbThreads) const
+{
+  size_t nbWorkers = getNumberOfWorkers_(nbThreads, numberOfSites);
+  ParallelSimulation_ simulation(*this, nbWorkers);
+  size_t nbSeqs = simulation.outputIndices.size();
+  // Each round gives one stream to each thread:
+  size_t sitesPerRound = nbWorkers * SITES_PER_STREAM;
+  vector< vector<int> > contents(nbSeqs, vector<int>(min(sitesPerRound, numberOfSites)));
+  sink.begin(seqNames_, alphabet_, numberOfSites);
+  for (size_t firstSite = 0; firstSite < numberOfSites; firstSite += sitesPerRound)
   {
-    cumprob += freqs[i];
-    if (r <= cumprob)
+    size_t n = min(sitesPerRound, numberOfSites - firstSite);
+    for (size_t i = 0; i < nbSeqs; i++)
     {
-      ancestralStateIndex = i;
-      break;
+      contents[i].resize(n);
     }
+    simulateBlocks_(simulation, firstSite, n, 0, seed, contents);
+    sink.addBlock(contents, firstSite);
   }
+  sink.end();
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::simulateBlocks_(
+  ParallelSimulation_& simulation,
+  size_t firstSite,
+  size_t numberOfSites,
+  const vector<double>* rates,
+  uint64_t seed,
+  vector< vector<int> >& contents) const
+{
+  const vector<SNode*>& nodes = simulation.nodes;
+  const vector<size_t>& fathers = simulation.fathers;
+  size_t nbAllNodes = nodes.size();
+  size_t nbSeqs = simulation.outputIndices.size();
+  size_t nbWorkers = simulation.workspaces.size();
+  size_t firstBlock = firstSite / SITES_PER_STREAM;
+  size_t nbBlocks = (numberOfSites + SITES_PER_STREAM - 1) / SITES_PER_STREAM;
+  bool continuous = (rates != 0 || continuousRates_);
+  size_t nCat = rate_->getNumberOfCategories();
+
+  ParallelTools::parallelFor(nbBlocks, static_cast<unsigned int>(nbWorkers), [&](size_t b, size_t t)
+  {
+    ParallelSimulation_::Workspace& ws = simulation.workspaces[t];
+    if (ws.states.size() == 0)
+    {
+      if (continuous)
+      {
+        ws.modelSet.reset(modelSet_->clone());
+        ws.rateDist.reset(rate_->clone());
+        ws.models.resize(nbAllNodes, 0);
+        for (size_t k = 1; k < nbAllNodes; k++)
+        {
+          ws.models[k] = ws.modelSet->getModelForNode(nodes[k]->getId());
+        }
+      }
+      ws.states.resize(nbAllNodes, vector<size_t>(SITES_PER_STREAM));
+      ws.rateClasses.resize(SITES_PER_STREAM);
+      ws.siteRates.resize(SITES_PER_STREAM);
+    }
+    vector< vector<size_t> >& states = ws.states;
+    PhiloxGenerator rng(seed, firstBlock + b);
+    auto uniform = [&rng]() { return rng.nextDouble(); };
+    size_t begin = b * SITES_PER_STREAM;
+    size_t n = min(SITES_PER_STREAM, numberOfSites - begin);
+
+    // Root states and rates:
+    for (size_t j = 0; j < n; j++)
+    {
+      states[0][j] = rootFreqs_.draw(rng.nextDouble());
+    }
+    for (size_t j = 0; j < n; j++)
+    {
+      if (rates)
+        ws.siteRates[j] = (*rates)[firstSite + begin + j];
+      else if (continuousRates_)
+        ws.siteRates[j] = ws.rateDist->qProb(rng.nextDouble());
+      else
+        ws.rateClasses[j] = min(static_cast<size_t>(rng.nextDouble() * static_cast<double>(nCat)), nCat - 1);
+    }
+
+    // Evolve along each branch:
+    for (size_t k = 1; k < nbAllNodes; k++)
+    {
+      const vector<size_t>& fatherStates = states[fathers[k]];
+      vector<size_t>& nodeStates = states[k];
+      if (continuous)
+      {
+        double d = nodes[k]->getDistanceToFather();
+        const JumpChain* chain = nodes[k]->getInfos().jumpChain.get();
+        for (size_t j = 0; j < n; j++)
+        {
+          nodeStates[j] = evolve_(chain, ws.models[k], fatherStates[j], d * ws.siteRates[j], uniform);
+        }
+      }
+      else
+      {
+        const vector< vector<AliasTable> >& pxy = nodes[k]->getInfos().pxy;
+        for (size_t j = 0; j < n; j++)
+        {
+          nodeStates[j] = pxy[ws.rateClasses[j]][fatherStates[j]].draw(rng.nextDouble());
+        }
+      }
+    }
+
+    // Copy the block to the output sequences:
+    for (size_t i = 0; i < nbSeqs; i++)
+    {
+      const vector<size_t>& seqStates = states[simulation.outputIndices[i]];
+      const TransitionModel* model = simulation.outputModels[i];
+      vector<int>& content = contents[i];
+      for (size_t j = 0; j < n; j++)
+      {
+        content[begin + j] = model->getAlphabetStateAsInt(seqStates[j]);
+      }
+    }
+  });
+}
+
+/******************************************************************************/
+
+RASiteSimulationResult* NonHomogeneousSequenceSimulator::dSimulateSite() const
+{
+  // Draw an initial state randomly according to equilibrum frequencies:
+  size_t ancestralStateIndex = rootFreqs_.draw();
 
   return dSimulateSite(ancestralStateIndex);
 }
@@ -412,19 +739,7 @@ RASiteSimulationResult* NonHomogeneousSequenceSimulator::dSimulateSite(size_t an
 RASiteSimulationResult* NonHomogeneousSequenceSimulator::dSimulateSite(double rate) const
 {
   // Draw an initial state randomly according to equilibrum frequencies:
-  size_t ancestralStateIndex = 0;
-  double r = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  double cumprob = 0;
-  vector<double> freqs = modelSet_->getRootFrequencies();
-  for (size_t i = 0; i < nbStates_; i++)
-  {
-    cumprob += freqs[i];
-    if (r <= cumprob)
-    {
-      ancestralStateIndex = i;
-      break;
-    }
-  }
+  size_t ancestralStateIndex = rootFreqs_.draw();
   return dSimulateSite(ancestralStateIndex, rate);
 }
 
@@ -432,30 +747,31 @@ RASiteSimulationResult* NonHomogeneousSequenceSimulator::dSimulateSite(double ra
 
 size_t NonHomogeneousSequenceSimulator::evolve(const SNode* node, size_t initialStateIndex, size_t rateClass) const
 {
-  const Vdouble* cumpxy_node_c_x_ = &node->getInfos().cumpxy[rateClass][initialStateIndex];
-  double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  for (size_t y = 0; y < nbStates_; y++)
-  {
-    if (rand < (*cumpxy_node_c_x_)[y]) return y;
-  }
-  throw Exception("HomogeneousSequenceSimulator::evolve. The impossible happened! rand = " + TextTools::toString(rand) + ".");
+  return node->getInfos().pxy[rateClass][initialStateIndex].draw();
 }
 
 /******************************************************************************/
 
 size_t NonHomogeneousSequenceSimulator::evolve(const SNode* node, size_t initialStateIndex, double rate) const
 {
+  auto uniform = []() { return RandomTools::giveRandomNumberBetweenZeroAndEntry(1.); };
+  return evolve_(node->getInfos().jumpChain.get(), node->getInfos().model, initialStateIndex, rate * node->getDistanceToFather(), uniform);
+}
+
+/******************************************************************************/
+
+size_t NonHomogeneousSequenceSimulator::evolve(const TransitionModel* model, size_t initialStateIndex, double length, double u) const
+{
+  // Compute the transition probabilities once, rather than for each final state:
+  const Matrix<double>& pijt = model->getPij_t(length);
   double cumpxy = 0;
-  double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  double l = rate * node->getDistanceToFather();
-  const TransitionModel* model = node->getInfos().model;
   for (size_t y = 0; y < nbStates_; y++)
   {
-    cumpxy += model->Pij_t(initialStateIndex, y, l);
-    if (rand < cumpxy) return y;
+    cumpxy += pijt(initialStateIndex, y);
+    if (u < cumpxy) return y;
   }
-  MatrixTools::print(model->getPij_t(l));
-  throw Exception("HomogeneousSequenceSimulator::evolve. The impossible happened! rand = " + TextTools::toString(rand) + ".");
+  MatrixTools::print(pijt);
+  throw Exception("HomogeneousSequenceSimulator::evolve. The impossible happened! rand = " + TextTools::toString(u) + ".");
 }
 
 /******************************************************************************/
@@ -466,19 +782,10 @@ void NonHomogeneousSequenceSimulator::multipleEvolve(
     const vector<size_t>& rateClasses,
     std::vector<size_t>& finalStateIndices) const
 {
-  const VVVdouble* cumpxy_node_ = &node->getInfos().cumpxy;
+  const vector< vector<AliasTable> >* pxy_node_ = &node->getInfos().pxy;
   for (size_t i = 0; i < initialStateIndices.size(); i++)
   {
-    const Vdouble* cumpxy_node_c_x_ = &(*cumpxy_node_)[rateClasses[i]][initialStateIndices[i]];
-    double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-    for (size_t y = 0; y < nbStates_; y++)
-    {
-      if (rand < (*cumpxy_node_c_x_)[y])
-      {
-        finalStateIndices[i] = y;
-        break;
-      }
-    }
+    finalStateIndices[i] = (*pxy_node_)[rateClasses[i]][initialStateIndices[i]].draw();
   }
 }
 
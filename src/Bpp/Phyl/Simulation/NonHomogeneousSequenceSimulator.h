@@ -43,6 +43,9 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "DetailedSiteSimulator.h"
 #include "SequenceSimulator.h"
+#include "AliasTable.h"
+#include "PhiloxGenerator.h"
+#include "SequenceSimulationSink.h"
 #include "../TreeTemplate.h"
 #include "../NodeTemplate.h"
 #include "../Model/SubstitutionModel.h"
@@ -57,6 +60,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 // From the STL:
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "../Model/SubstitutionModelSet.h"
@@ -64,23 +68,58 @@ knowledge of the CeCILL license and that you accept its terms.
 namespace bpp
 {
 
+/**
+ * @brief Jump chain of a substitution model, used to simulate along branches of any length by uniformization.
+ *
+ * Substitutions are dominated by a Poisson process of rate mu, the largest exit rate of the generator Q.
+ * At each event of this process, the state jumps according to the matrix I + Q / mu,
+ * which may leave it unchanged.
+ * The state at the end of a branch of length t is therefore drawn using a Poisson number of jumps,
+ * each of which takes a constant time, without computing exp(Q t).
+ */
+class JumpChain
+{
+  public:
+    /**
+     * @brief Rate of the Poisson process of jumps, per unit of branch length.
+     */
+    double rate;
+    /**
+     * @brief Distribution of the state after a jump, for each state.
+     */
+    std::vector<AliasTable> jumps;
+
+  public:
+    JumpChain(): rate(0), jumps() {}
+};
+
 class SimData
 {
   public:
     size_t state;
     std::vector<size_t> states;
-    VVVdouble cumpxy;
+    /**
+     * @brief Transition probabilities for the branch leading to this node,
+     * as one alias table per rate class and initial state.
+     */
+    std::vector< std::vector<AliasTable> > pxy;
+    /**
+     * @brief Jump chain of the model of the branch, shared by all branches with the same model,
+     * or 0 if the model does not support uniformization.
+     */
+    std::shared_ptr<const JumpChain> jumpChain;
     const TransitionModel* model;
 
   public:
-    SimData(): state(), states(), cumpxy(), model(0) {}
-    SimData(const SimData& sd): state(sd.state), states(sd.states), cumpxy(), model(sd.model) {}
+    SimData(): state(), states(), pxy(), jumpChain(), model(0) {}
+    SimData(const SimData& sd): state(sd.state), states(sd.states), pxy(sd.pxy), jumpChain(sd.jumpChain), model(sd.model) {}
     SimData& operator=(const SimData& sd)
     {
-      state  = sd.state;
-      states = sd.states;
-      cumpxy = sd.cumpxy;
-      model  = sd.model;
+      state     = sd.state;
+      states    = sd.states;
+      pxy       = sd.pxy;
+      jumpChain = sd.jumpChain;
+      model     = sd.model;
       return *this;
     }
 };
@@ -91,11 +130,29 @@ typedef NodeTemplate<SimData> SNode;
  * @brief Site and sequences simulation under non-homogeneous models.
  *
  * Rate across sites variation is supported, using a DiscreteDistribution object or by specifying explicitely the rate of the sites to simulate.
+ *
+ * Transition probabilities for each branch and rate class, together with root frequencies,
+ * are stored as alias tables when the simulator is built, so that drawing a state takes a constant time
+ * whatever the number of states of the model.
+ * They are not updated if the parameters of the models change afterwards.
+ *
+ * When the rate of each site is drawn from a continuous distribution or given explicitly,
+ * transition probabilities cannot be precomputed. States are then drawn by uniformization
+ * (see JumpChain), which only requires the generator of the model.
+ * Models for which the transition probabilities are not the exponential of the generator
+ * (for instance mixtures) are detected when the simulator is built,
+ * and fall back to computing the transition probabilities once per draw.
  */
 class NonHomogeneousSequenceSimulator:
   public DetailedSiteSimulator,
   public virtual SequenceSimulator
 {
+  public:
+    /**
+     * @brief Number of sites simulated with each stream of random numbers in parallel simulations.
+     */
+    static const size_t SITES_PER_STREAM;
+
   private:
     const SubstitutionModelSet* modelSet_;
     const Alphabet            * alphabet_;
@@ -122,6 +179,9 @@ class NonHomogeneousSequenceSimulator:
     // Should we ouptut internal sequences as well?
     bool outputInternalSequences_;
 
+    // Root frequencies:
+    AliasTable rootFreqs_;
+
     /**
      * @name Stores intermediate results.
      *
@@ -160,7 +220,8 @@ class NonHomogeneousSequenceSimulator:
       nbClasses_      (nhss.nbClasses_),
       nbStates_       (nhss.nbStates_),
       continuousRates_(nhss.continuousRates_),
-      outputInternalSequences_(nhss.outputInternalSequences_)
+      outputInternalSequences_(nhss.outputInternalSequences_),
+      rootFreqs_      (nhss.rootFreqs_)
     {}
 
     NonHomogeneousSequenceSimulator& operator=(const NonHomogeneousSequenceSimulator& nhss)
@@ -179,6 +240,7 @@ class NonHomogeneousSequenceSimulator:
       nbStates_        = nhss.nbStates_;
       continuousRates_ = nhss.continuousRates_;
       outputInternalSequences_ = nhss.outputInternalSequences_;
+      rootFreqs_       = nhss.rootFreqs_;
       return *this;
     }
 
@@ -232,6 +294,54 @@ class NonHomogeneousSequenceSimulator:
     SiteContainer* simulate(size_t numberOfSites) const;
     /** @} */
 
+    /**
+     * @name Parallel and reproducible simulations.
+     *
+     * Sites are simulated by blocks of SITES_PER_STREAM sites, each block using its own stream
+     * of a counter-based random generator (PhiloxGenerator), defined by the seed and the index of the block.
+     * Blocks are distributed among threads, and the results only depend on the seed, not on the number of threads.
+     * The global random generator of RandomTools is not used.
+     *
+     * With continuous rates, each thread uses its own copy of the models.
+     *
+     * @{
+     */
+
+    /**
+     * @brief Simulate sites, with rates drawn from the rate distribution.
+     *
+     * @param numberOfSites The number of sites to simulate.
+     * @param seed          The seed of the random streams.
+     * @param nbThreads     The number of threads to use (0 to use the number of available cores).
+     * @return A container with all simulated sequences.
+     */
+    SiteContainer* simulate(size_t numberOfSites, uint64_t seed, unsigned int nbThreads = 0) const;
+
+    /**
+     * @brief Simulate sites knowing their rate.
+     *
+     * @param rates     The rates to use, one for each site to simulate.
+     * @param seed      The seed of the random streams.
+     * @param nbThreads The number of threads to use (0 to use the number of available cores).
+     * @return A container with all simulated sequences.
+     */
+    SiteContainer* simulateSites(const std::vector<double>& rates, uint64_t seed, unsigned int nbThreads = 0) const;
+
+    /**
+     * @brief Simulate sites and send them to a sink, block by block.
+     *
+     * Only one block of sites per thread is stored at a time, so that the memory used does not depend
+     * on the number of sites. Results are identical to the ones of simulate(size_t, uint64_t, unsigned int)
+     * with the same seed.
+     *
+     * @param numberOfSites The number of sites to simulate.
+     * @param sink          The object receiving the simulated blocks.
+     * @param seed          The seed of the random streams.
+     * @param nbThreads     The number of threads to use (0 to use the number of available cores).
+     */
+    void simulate(size_t numberOfSites, SequenceSimulationSink& sink, uint64_t seed, unsigned int nbThreads = 0) const;
+    /** @} */
+
     /**
      * @name SiteSimulator and SequenceSimulator interface
      *
@@ -293,7 +403,8 @@ class NonHomogeneousSequenceSimulator:
     /**
      * @brief Evolve from an initial state along a branch, knowing the evolutionary rate class.
      *
-     * This method is fast since all pijt have been computed in the constructor of the class.
+     * This method is fast since all pijt have been computed in the constructor of the class,
+     * and stored as alias tables.
      * This method is used for the implementation of the SiteSimulator interface.
      */
     size_t evolve(const SNode* node, size_t initialStateIndex, size_t rateClass) const;
@@ -301,11 +412,26 @@ class NonHomogeneousSequenceSimulator:
     /**
      * @brief Evolve from an initial state along a branch, knowing the evolutionary rate.
      *
-     * This method is slower than the previous one since exponential terms must be computed.
+     * This method is slower than the previous one since the number of jumps along the branch must be drawn
+     * (see JumpChain).
      * This method is used for the implementation of the SiteSimulator interface.
      */
     size_t evolve(const SNode* node, size_t initialStateIndex, double rate) const;
 
+    /**
+     * @brief Evolve from an initial state along a branch of a given length, using a given random number.
+     *
+     * Transition probabilities are computed for each call: this method is only used for models
+     * which do not support uniformization.
+     *
+     * @param model             The model of the branch.
+     * @param initialStateIndex The initial state.
+     * @param length            The length of the branch, multiplied by the rate of the site.
+     * @param u                 A number uniformly drawn in [0, 1).
+     * @return The final state.
+     */
+    size_t evolve(const TransitionModel* model, size_t initialStateIndex, double length, double u) const;
+
     /**
      * @brief The same as the evolve(initialState, rateClass) function, but for several sites at a time.
      *
@@ -348,6 +474,66 @@ class NonHomogeneousSequenceSimulator:
     void dEvolveInternal(SNode * node, double rate, RASiteSimulationResult & rassr) const;
     /** @} */
 
+  private:
+    class ParallelSimulation_;
+
+    /**
+     * @brief Build the jump chain of a model.
+     *
+     * The jump chain is checked against the transition probabilities of the model.
+     *
+     * @param model The model to use.
+     * @return The jump chain, or 0 if the model is not a substitution model,
+     * or if its transition probabilities are not the exponential of its generator.
+     */
+    static std::shared_ptr<const JumpChain> buildJumpChain_(const TransitionModel* model);
+
+    /**
+     * @brief Evolve from an initial state along a branch of a given length.
+     *
+     * @param chain             The jump chain of the branch, or 0 to compute transition probabilities.
+     * @param model             The model of the branch.
+     * @param initialStateIndex The initial state.
+     * @param length            The length of the branch, multiplied by the rate of the site.
+     * @param uniform           A source of numbers uniformly drawn in [0, 1).
+     * @return The final state.
+     */
+    template<class Uniform>
+    size_t evolve_(const JumpChain* chain, const TransitionModel* model, size_t initialStateIndex, double length, Uniform& uniform) const;
+
+    /**
+     * @return The number of threads to use for a parallel simulation.
+     */
+    static size_t getNumberOfWorkers_(unsigned int nbThreads, size_t numberOfSites);
+
+    /**
+     * @brief Parallel simulation, see simulate(size_t, uint64_t, unsigned int).
+     *
+     * @param numberOfSites The number of sites to simulate.
+     * @param rates         The rates of all sites, or 0 to draw them.
+     * @param seed          The seed of the random streams.
+     * @param nbThreads     The number of threads to use (0 to use the number of available cores).
+     */
+    SiteContainer* simulate_(size_t numberOfSites, const std::vector<double>* rates, uint64_t seed, unsigned int nbThreads) const;
+
+    /**
+     * @brief Simulate consecutive blocks of sites in parallel.
+     *
+     * @param simulation    The nodes and buffers to use.
+     * @param firstSite     The position of the first site, a multiple of SITES_PER_STREAM.
+     * @param numberOfSites The number of sites to simulate.
+     * @param rates         The rates of all sites of the alignment, or 0 to draw them.
+     * @param seed          The seed of the random streams.
+     * @param contents      [out] The states of each output sequence, for the simulated sites only.
+     */
+    void simulateBlocks_(
+        ParallelSimulation_& simulation,
+        size_t firstSite,
+        size_t numberOfSites,
+        const std::vector<double>* rates,
+        uint64_t seed,
+        std::vector< std::vector<int> >& contents) const;
+
 };
 
 } //end of namespace bpp.
@@ -0,0 +1,129 @@
+//
+// File: PhiloxGenerator.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 15:40 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _PHILOXGENERATOR_H_
+#define _PHILOXGENERATOR_H_
+
+// From the STL:
+#include <cstdint>
+#include <cstddef>
+
+namespace bpp
+{
+
+/**
+ * @brief Counter-based random number generator (Philox4x32-10).
+ *
+ * The n-th output of the generator is a function of the key (the seed), the stream index and n only,
+ * so that independent streams can be created for each block of a computation
+ * and give the same results whatever the order in which blocks are processed,
+ * or the number of threads used.
+ * Each generator holds its own state and is not shared between threads.
+ *
+ * Salmon J.K., Moraes M.A., Dror R.O. and Shaw D.E.
+ * Parallel random numbers: as easy as 1, 2, 3.
+ * Proceedings of the International Conference for High Performance Computing, Networking, Storage and Analysis (SC11). 2011.
+ */
+class PhiloxGenerator
+{
+  private:
+    uint32_t key_[2];
+    uint32_t counter_[4];
+    uint32_t output_[4];
+    size_t position_;
+
+  public:
+    /**
+     * @param seed   The key of the generator.
+     * @param stream The index of the stream.
+     */
+    PhiloxGenerator(uint64_t seed, uint64_t stream = 0) :
+      key_(), counter_(), output_(), position_(4)
+    {
+      key_[0]     = static_cast<uint32_t>(seed);
+      key_[1]     = static_cast<uint32_t>(seed >> 32);
+      counter_[2] = static_cast<uint32_t>(stream);
+      counter_[3] = static_cast<uint32_t>(stream >> 32);
+    }
+
+  public:
+    /**
+     * @brief Move to a given block of four outputs in the stream.
+     *
+     * The next output is the first one of this block.
+     *
+     * @param block The index of the block, which is also the first 64 bits of the counter.
+     */
+    void setBlock(uint64_t block)
+    {
+      counter_[0] = static_cast<uint32_t>(block);
+      counter_[1] = static_cast<uint32_t>(block >> 32);
+      position_   = 4;
+    }
+
+    /**
+     * @return The next 32 random bits.
+     */
+    uint32_t nextInt()
+    {
+      if (position_ == 4) generate_();
+      return output_[position_++];
+    }
+
+    /**
+     * @return A number uniformly drawn in [0, 1), with 53 random bits.
+     */
+    double nextDouble()
+    {
+      uint64_t a = nextInt() >> 5;
+      uint64_t b = nextInt() >> 6;
+      return (static_cast<double>(a) * 67108864. + static_cast<double>(b)) * (1. / 9007199254740992.);
+    }
+
+  private:
+    /**
+     * @brief Compute the next four outputs and increment the counter.
+     */
+    void generate_();
+};
+
+} //end of namespace bpp.
+
+#endif //_PHILOXGENERATOR_H_
+
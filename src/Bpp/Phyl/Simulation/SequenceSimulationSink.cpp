@@ -0,0 +1,207 @@
+//
+// File: SequenceSimulationSink.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 16:20 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "SequenceSimulationSink.h"
+
+#include <Bpp/Text/TextTools.h>
+
+// From the STL:
+#include <algorithm>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+FastaSimulationSink::FastaSimulationSink(const string& path, unsigned int charsPerLine) throw (Exception) :
+  path_(path),
+  charsPerLine_(charsPerLine),
+  output_(),
+  alphabet_(0),
+  length_(0),
+  offsets_()
+{
+  if (charsPerLine_ == 0)
+    throw Exception("FastaSimulationSink. The number of characters per line must be positive.");
+}
+
+/******************************************************************************/
+
+void FastaSimulationSink::begin(const vector<string>& names, const Alphabet* alphabet, size_t numberOfSites) throw (Exception)
+{
+  output_.open(path_.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!output_)
+    throw Exception("FastaSimulationSink::begin. Can't open file " + path_ + ".");
+  alphabet_ = alphabet;
+  length_ = numberOfSites * alphabet_->getStateCodingSize();
+  // Sequences are followed by a new line after each full line and after the last one:
+  size_t bodySize = length_ + (length_ + charsPerLine_ - 1) / charsPerLine_;
+  offsets_.resize(names.size());
+  streamoff offset = 0;
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    output_.seekp(offset);
+    output_ << ">" << names[i] << "\n";
+    offsets_[i] = offset + static_cast<streamoff>(names[i].size() + 2);
+    offset = offsets_[i] + static_cast<streamoff>(bodySize);
+  }
+  if (!output_)
+    throw Exception("FastaSimulationSink::begin. Error while writing file " + path_ + ".");
+}
+
+/******************************************************************************/
+
+void FastaSimulationSink::addBlock(const vector< vector<int> >& block, size_t firstSite) throw (Exception)
+{
+  if (block.size() != offsets_.size())
+    throw Exception("FastaSimulationSink::addBlock. Wrong number of sequences in block.");
+  size_t width = alphabet_->getStateCodingSize();
+  size_t p0 = firstSite * width;
+  string text;
+  for (size_t i = 0; i < block.size(); i++)
+  {
+    text.clear();
+    size_t p = p0;
+    for (size_t j = 0; j < block[i].size(); j++)
+    {
+      string c = alphabet_->intToChar(block[i][j]);
+      for (size_t k = 0; k < c.size(); k++)
+      {
+        text += c[k];
+        p++;
+        if (p % charsPerLine_ == 0 || p == length_)
+          text += '\n';
+      }
+    }
+    if (p > length_)
+      throw Exception("FastaSimulationSink::addBlock. Block exceeds the length of the sequences.");
+    output_.seekp(offsets_[i] + static_cast<streamoff>(p0 + p0 / charsPerLine_));
+    output_.write(text.data(), static_cast<streamsize>(text.size()));
+  }
+  if (!output_)
+    throw Exception("FastaSimulationSink::addBlock. Error while writing file " + path_ + ".");
+}
+
+/******************************************************************************/
+
+void FastaSimulationSink::end() throw (Exception)
+{
+  output_.close();
+  if (output_.fail())
+    throw Exception("FastaSimulationSink::end. Error while closing file " + path_ + ".");
+}
+
+/******************************************************************************/
+
+PhylipSimulationSink::PhylipSimulationSink(const string& path, bool extendedNames, unsigned int charsPerLine) throw (Exception) :
+  path_(path),
+  extendedNames_(extendedNames),
+  charsPerLine_(charsPerLine),
+  output_(),
+  alphabet_(0),
+  names_(),
+  firstBlock_(true)
+{
+  if (charsPerLine_ == 0)
+    throw Exception("PhylipSimulationSink. The number of characters per line must be positive.");
+}
+
+/******************************************************************************/
+
+void PhylipSimulationSink::begin(const vector<string>& names, const Alphabet* alphabet, size_t numberOfSites) throw (Exception)
+{
+  output_.open(path_.c_str(), ios::out | ios::trunc);
+  if (!output_)
+    throw Exception("PhylipSimulationSink::begin. Can't open file " + path_ + ".");
+  alphabet_ = alphabet;
+  names_.resize(names.size());
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    if (extendedNames_)
+      names_[i] = names[i] + "  ";
+    else
+      names_[i] = TextTools::resizeRight(names[i], 10, ' ');
+  }
+  output_ << names.size() << " " << numberOfSites * alphabet_->getStateCodingSize() << endl;
+  firstBlock_ = true;
+}
+
+/******************************************************************************/
+
+void PhylipSimulationSink::addBlock(const vector< vector<int> >& block, size_t firstSite) throw (Exception)
+{
+  if (block.size() != names_.size())
+    throw Exception("PhylipSimulationSink::addBlock. Wrong number of sequences in block.");
+  if (block.size() == 0)
+    return;
+  size_t width = alphabet_->getStateCodingSize();
+  size_t sitesPerLine = max(static_cast<size_t>(charsPerLine_) / width, static_cast<size_t>(1));
+  size_t nbSites = block[0].size();
+  for (size_t j0 = 0; j0 < nbSites; j0 += sitesPerLine)
+  {
+    size_t j1 = min(j0 + sitesPerLine, nbSites);
+    if (!firstBlock_)
+      output_ << "\n";
+    for (size_t i = 0; i < block.size(); i++)
+    {
+      if (firstBlock_)
+        output_ << names_[i];
+      for (size_t j = j0; j < j1; j++)
+      {
+        output_ << alphabet_->intToChar(block[i][j]);
+      }
+      output_ << "\n";
+    }
+    firstBlock_ = false;
+  }
+  if (!output_)
+    throw Exception("PhylipSimulationSink::addBlock. Error while writing file " + path_ + ".");
+}
+
+/******************************************************************************/
+
+void PhylipSimulationSink::end() throw (Exception)
+{
+  output_.close();
+  if (output_.fail())
+    throw Exception("PhylipSimulationSink::end. Error while closing file " + path_ + ".");
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,173 @@
+//
+// File: SequenceSimulationSink.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 16:20 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _SEQUENCESIMULATIONSINK_H_
+#define _SEQUENCESIMULATIONSINK_H_
+
+#include <Bpp/Exceptions.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/Alphabet/Alphabet.h>
+
+// From the STL:
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Receive simulated sequences block by block.
+ *
+ * Simulators using this interface only store one block of sites at a time,
+ * so that the memory needed does not depend on the length of the simulated alignment.
+ * Blocks are sent in order, and together cover all sites.
+ *
+ * @see NonHomogeneousSequenceSimulator::simulate(size_t, SequenceSimulationSink&, uint64_t, unsigned int)
+ */
+class SequenceSimulationSink
+{
+  public:
+    SequenceSimulationSink() {}
+    virtual ~SequenceSimulationSink() {}
+
+  public:
+    /**
+     * @brief Called once, before the first block.
+     *
+     * @param names         The names of the sequences.
+     * @param alphabet      The alphabet of the sequences.
+     * @param numberOfSites The total number of sites that will be sent.
+     */
+    virtual void begin(const std::vector<std::string>& names, const Alphabet* alphabet, size_t numberOfSites) throw (Exception) = 0;
+
+    /**
+     * @brief Receive a block of sites.
+     *
+     * @param block     The content of each sequence for the sites of this block, as alphabet states.
+     * All vectors have the same size, the number of sites in the block.
+     * @param firstSite The position of the first site of the block in the alignment.
+     */
+    virtual void addBlock(const std::vector< std::vector<int> >& block, size_t firstSite) throw (Exception) = 0;
+
+    /**
+     * @brief Called once, after the last block.
+     */
+    virtual void end() throw (Exception) = 0;
+};
+
+/**
+ * @brief Write simulated sequences to a file in Fasta format.
+ *
+ * As all sequences have the same length, the position of each character in the file is known in advance,
+ * and each block is written directly at its final place.
+ */
+class FastaSimulationSink :
+  public SequenceSimulationSink
+{
+  private:
+    std::string path_;
+    unsigned int charsPerLine_;
+    std::ofstream output_;
+    const Alphabet* alphabet_;
+    size_t length_;
+    std::vector<std::streamoff> offsets_;
+
+  public:
+    /**
+     * @param path         The file to write.
+     * @param charsPerLine The number of characters per line.
+     */
+    FastaSimulationSink(const std::string& path, unsigned int charsPerLine = 60) throw (Exception);
+
+    virtual ~FastaSimulationSink() {}
+
+  private:
+    FastaSimulationSink(const FastaSimulationSink&);
+    FastaSimulationSink& operator=(const FastaSimulationSink&);
+
+  public:
+    void begin(const std::vector<std::string>& names, const Alphabet* alphabet, size_t numberOfSites) throw (Exception);
+    void addBlock(const std::vector< std::vector<int> >& block, size_t firstSite) throw (Exception);
+    void end() throw (Exception);
+};
+
+/**
+ * @brief Write simulated sequences to a file in interleaved Phylip format.
+ *
+ * Each block is written as one or several interleaved blocks of lines.
+ */
+class PhylipSimulationSink :
+  public SequenceSimulationSink
+{
+  private:
+    std::string path_;
+    bool extendedNames_;
+    unsigned int charsPerLine_;
+    std::ofstream output_;
+    const Alphabet* alphabet_;
+    std::vector<std::string> names_;
+    bool firstBlock_;
+
+  public:
+    /**
+     * @param path          The file to write.
+     * @param extendedNames If true, names are followed by two spaces and can be of any length,
+     * otherwise they are truncated or padded to 10 characters.
+     * @param charsPerLine  The maximum number of characters of sequences per line.
+     */
+    PhylipSimulationSink(const std::string& path, bool extendedNames = true, unsigned int charsPerLine = 60) throw (Exception);
+
+    virtual ~PhylipSimulationSink() {}
+
+  private:
+    PhylipSimulationSink(const PhylipSimulationSink&);
+    PhylipSimulationSink& operator=(const PhylipSimulationSink&);
+
+  public:
+    void begin(const std::vector<std::string>& names, const Alphabet* alphabet, size_t numberOfSites) throw (Exception);
+    void addBlock(const std::vector< std::vector<int> >& block, size_t firstSite) throw (Exception);
+    void end() throw (Exception);
+};
+
+} //end of namespace bpp.
+
+#endif //_SEQUENCESIMULATIONSINK_H_
+
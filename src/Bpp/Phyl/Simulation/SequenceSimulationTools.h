@@ -41,6 +41,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _SEQUENCESIMULATIONTOOLS_H_
 
 #include "SiteSimulator.h"
+#include "NonHomogeneousSequenceSimulator.h"
 
 //From Seqlib:
 #include <Bpp/Seq/Container/SiteContainer.h>
@@ -78,6 +79,24 @@ class SequenceSimulationTools
      */
     static SiteContainer* simulateSites(const SiteSimulator& simulator, const std::vector<double>& rates);
 
+    /**
+     * @brief Simulate a set of sites knowing their rate, in parallel.
+     *
+     * Sites are simulated by blocks, each with its own stream of random numbers,
+     * so that results only depend on the seed and not on the number of threads.
+     *
+     * @see NonHomogeneousSequenceSimulator::simulateSites
+     * @param simulator A NonHomogeneousSequenceSimulator object to use to simulate sites.
+     * @param rates     the rates to use, one for each site to simulate.
+     * @param seed      the seed of the random streams.
+     * @param nbThreads the number of threads to use (0 to use the number of available cores).
+     * @return          A container with all simulated sites.
+     */
+    static SiteContainer* simulateSites(const NonHomogeneousSequenceSimulator& simulator, const std::vector<double>& rates, uint64_t seed, unsigned int nbThreads = 0)
+    {
+      return simulator.simulateSites(rates, seed, nbThreads);
+    }
+
     /**
      * @brief Simulate a set of sites knowing their rate and ancestral state.
      *
@@ -0,0 +1,355 @@
+//
+// File: test_distance.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 16:40 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Distance/NeighborJoining.h>
+#include <Bpp/Phyl/Distance/NeighborJoiningMatrix.h>
+#include <Bpp/Phyl/Distance/BioNJ.h>
+#include <Bpp/Phyl/Distance/HierarchicalClustering.h>
+#include <Bpp/Phyl/Distance/PGMA.h>
+#include <Bpp/Phyl/Io/PhylipDistanceMatrixFormat.h>
+#include <Bpp/Phyl/Io/BinaryDistanceMatrixFormat.h>
+#include <Bpp/Phyl/Io/MappedDistanceMatrix.h>
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+
+using namespace bpp;
+using namespace std;
+
+bool testAdditive(AgglomerativeDistanceMethod& method, const DistanceMatrix& dist)
+{
+  method.setDistanceMatrix(dist);
+  method.computeTree();
+  TreeTemplate<Node>* tree = dynamic_cast<TreeTemplate<Node>*>(method.getTree());
+  DistanceMatrix* dist2 = TreeTemplateTools::getDistanceMatrix(*tree);
+  bool test = true;
+  for (size_t i = 0; i < dist.size(); ++i)
+  {
+    for (size_t j = 0; j < dist.size(); ++j)
+    {
+      if (abs((*dist2)(dist.getName(i), dist.getName(j)) - dist(i, j)) > 1e-6)
+        test = false;
+    }
+  }
+  cout << method.getName() << ": " << (test ? "ok" : "failed") << endl;
+  delete dist2;
+  delete tree;
+  return test;
+}
+
+double setClockLengths(Node* node)
+{
+  if (node->isLeaf())
+    return 0.;
+  vector<double> heights(node->getNumberOfSons());
+  for (size_t i = 0; i < heights.size(); ++i)
+    heights[i] = setClockLengths(node->getSon(i));
+  double height = *max_element(heights.begin(), heights.end()) + RandomTools::giveRandomNumberBetweenZeroAndEntry(1.0) + 0.01;
+  for (size_t i = 0; i < heights.size(); ++i)
+    node->getSon(i)->setDistanceToFather(height - heights[i]);
+  return height;
+}
+
+//Same methods, with the generic algorithm instead of the nearest-neighbor chain:
+class FullSearchClustering :
+  public HierarchicalClustering
+{
+public:
+  FullSearchClustering(const string& method) : HierarchicalClustering(method) {}
+  void computeTree() throw (Exception) { AbstractAgglomerativeDistanceMethod::computeTree(); }
+};
+
+class FullSearchPGMA :
+  public PGMA
+{
+public:
+  FullSearchPGMA(bool weighted) : PGMA(weighted) { setVerbose(false); }
+  void computeTree() throw (Exception) { AbstractAgglomerativeDistanceMethod::computeTree(); }
+};
+
+bool testSameTree(AgglomerativeDistanceMethod& method1, AgglomerativeDistanceMethod& method2, const DistanceMatrix& dist)
+{
+  method1.setDistanceMatrix(dist);
+  method1.computeTree();
+  method2.setDistanceMatrix(dist);
+  method2.computeTree();
+  TreeTemplate<Node>* tree1 = dynamic_cast<TreeTemplate<Node>*>(method1.getTree());
+  TreeTemplate<Node>* tree2 = dynamic_cast<TreeTemplate<Node>*>(method2.getTree());
+  DistanceMatrix* dist1 = TreeTemplateTools::getDistanceMatrix(*tree1);
+  DistanceMatrix* dist2 = TreeTemplateTools::getDistanceMatrix(*tree2);
+  bool test = true;
+  for (size_t i = 0; i < dist.size(); ++i)
+  {
+    for (size_t j = 0; j < dist.size(); ++j)
+    {
+      if (abs((*dist1)(dist.getName(i), dist.getName(j)) - (*dist2)(dist.getName(i), dist.getName(j))) > 1e-9)
+        test = false;
+    }
+  }
+  cout << method1.getName() << " (full search): " << (test ? "ok" : "failed") << endl;
+  delete dist1;
+  delete dist2;
+  delete tree1;
+  delete tree2;
+  return test;
+}
+
+bool equals(const DistanceMatrix& dist1, const DistanceMatrix& dist2, double tol)
+{
+  if (dist1.size() != dist2.size())
+    return false;
+  for (size_t i = 0; i < dist1.size(); ++i)
+  {
+    if (dist1.getName(i) != dist2.getName(i))
+      return false;
+    for (size_t j = 0; j < dist1.size(); ++j)
+    {
+      if (abs(dist1(i, j) - dist2(i, j)) > tol * (1. + abs(dist1(i, j))))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool testFormats(const DistanceMatrix& dist)
+{
+  PhylipDistanceMatrixFormat phylip(true);
+  phylip.write(dist, "test_distance.ph", true);
+  DistanceMatrix* dist2 = phylip.read("test_distance.ph");
+  bool test = equals(dist, *dist2, 1e-7);
+  delete dist2;
+  cout << "Phylip: " << (test ? "ok" : "failed") << endl;
+  remove("test_distance.ph");
+  if (!test) return false;
+
+  for (unsigned int k = 0; k < 2; ++k)
+  {
+    BinaryDistanceMatrixFormat binary(k == 1);
+    binary.write(dist, "test_distance.bin", true);
+    dist2 = binary.read("test_distance.bin");
+    test = equals(dist, *dist2, k == 1 ? 1e-6 : 0.);
+    delete dist2;
+    //Same matrix, accessed without loading:
+    MappedDistanceMatrix mapped("test_distance.bin");
+    NeighborJoining nj1(dist, false, false, false);
+    NeighborJoining nj2(false, false, false);
+    nj2.setMappedDistanceMatrix(mapped);
+    nj2.computeTree();
+    TreeTemplate<Node>* tree1 = nj1.getTree();
+    TreeTemplate<Node>* tree2 = nj2.getTree();
+    if (k == 0 && TreeTemplateTools::treeToParenthesis(*tree1) != TreeTemplateTools::treeToParenthesis(*tree2))
+      test = false;
+    delete tree1;
+    delete tree2;
+    cout << "Binary (" << (k == 1 ? "float" : "double") << "): " << (test ? "ok" : "failed") << endl;
+    remove("test_distance.bin");
+    if (!test) return false;
+  }
+
+  //Mapped writing:
+  {
+    vector<string> names(dist.size());
+    for (size_t i = 0; i < dist.size(); ++i)
+      names[i] = dist.getName(i);
+    MappedDistanceMatrix mapped("test_distance.bin", names);
+    for (size_t i = 0; i < dist.size(); ++i)
+      for (size_t j = 0; j < i; ++j)
+        mapped.setDistance(i, j, dist(i, j));
+  }
+  dist2 = BinaryDistanceMatrixFormat().read("test_distance.bin");
+  test = equals(dist, *dist2, 0.);
+  delete dist2;
+  cout << "Mapped: " << (test ? "ok" : "failed") << endl;
+  remove("test_distance.bin");
+  return test;
+}
+
+int main() {
+  //The random trees and noisy distances below are the same on every run:
+  RandomTools::setSeed(20261018);
+
+  //Get some leaf names:
+  vector<string> leaves(50);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+
+  //Distances on a tree are additive, and must be recovered exactly:
+  TreeTemplate<Node>* tree = TreeTemplateTools::getRandomTree(leaves, true);
+  vector<Node*> nodes = tree->getNodes();
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    if (nodes[i]->hasFather())
+      nodes[i]->setDistanceToFather(RandomTools::giveRandomNumberBetweenZeroAndEntry(1.0) + 0.01);
+  }
+  DistanceMatrix* dist = TreeTemplateTools::getDistanceMatrix(*tree);
+  NeighborJoining nj(false, false, false);
+  BioNJ bionj(false, false, false);
+  if (!testAdditive(nj, *dist) || !testAdditive(bionj, *dist))
+    return 1;
+
+  //Ultrametric distances are recovered by all reducible linkages:
+  setClockLengths(tree->getRootNode());
+  DistanceMatrix* distClock = TreeTemplateTools::getDistanceMatrix(*tree);
+  HierarchicalClustering single(HierarchicalClustering::SINGLE);
+  HierarchicalClustering complete(HierarchicalClustering::COMPLETE);
+  HierarchicalClustering average(HierarchicalClustering::AVERAGE);
+  PGMA upgma(false);
+  upgma.setVerbose(false);
+  PGMA wpgma(true);
+  wpgma.setVerbose(false);
+  if (!testAdditive(single, *distClock) || !testAdditive(complete, *distClock) || !testAdditive(average, *distClock)
+      || !testAdditive(upgma, *distClock) || !testAdditive(wpgma, *distClock))
+    return 1;
+  delete distClock;
+
+  //On a fixed, non-ultrametric matrix, the nearest-neighbor chain must give the same trees as the generic algorithm,
+  //and the median and centroid linkages, which are not reducible, must use the generic algorithm:
+  const double coordinates[8][2] = {
+    { 0., 0. }, { 1.3, 0.2 }, { 0.4, 2.1 }, { 3.7, 1.1 }, { 4.2, 3.9 }, { 2.2, 4.6 }, { 6.1, 0.7 }, { 5.3, 2.4 }
+  };
+  vector<string> points(8);
+  for (size_t i = 0; i < points.size(); ++i)
+    points[i] = "point" + TextTools::toString(i);
+  DistanceMatrix distFixed(points);
+  for (size_t i = 0; i < points.size(); ++i)
+    for (size_t j = 0; j < points.size(); ++j)
+      distFixed(i, j) = sqrt(pow(coordinates[i][0] - coordinates[j][0], 2.) + pow(coordinates[i][1] - coordinates[j][1], 2.));
+  vector<string> linkages;
+  linkages.push_back(HierarchicalClustering::SINGLE);
+  linkages.push_back(HierarchicalClustering::COMPLETE);
+  linkages.push_back(HierarchicalClustering::AVERAGE);
+  linkages.push_back(HierarchicalClustering::WARD);
+  linkages.push_back(HierarchicalClustering::MEDIAN);
+  linkages.push_back(HierarchicalClustering::CENTROID);
+  for (size_t k = 0; k < linkages.size(); ++k)
+  {
+    HierarchicalClustering clustering(linkages[k]);
+    FullSearchClustering fullSearch(linkages[k]);
+    if (!testSameTree(clustering, fullSearch, distFixed))
+      return 1;
+  }
+  for (unsigned int k = 0; k < 2; ++k)
+  {
+    PGMA pgma(k == 1);
+    pgma.setVerbose(false);
+    FullSearchPGMA fullSearch(k == 1);
+    if (!testSameTree(pgma, fullSearch, distFixed))
+      return 1;
+  }
+
+  //Noisy distances: the pruned search must select a best pair of a full scan.
+  size_t n = dist->size();
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t j = 0; j < i; ++j)
+    {
+      (*dist)(i, j) = (*dist)(j, i) = (*dist)(i, j) * (0.5 + RandomTools::giveRandomNumberBetweenZeroAndEntry(1.0));
+    }
+  }
+  //The working matrix overwrites its input:
+  DistanceMatrix workDist(*dist);
+  NeighborJoiningMatrix work(workDist);
+  vector<bool> active(n, true);
+  for (size_t r = n; r > 3; --r)
+  {
+    vector<double> sums(n, 0.);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; active[i] && j < n; ++j)
+        if (active[j]) sums[i] += (*dist)(i, j);
+    double critMax = -1e300;
+    for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = i + 1; active[i] && j < n; ++j)
+      {
+        if (!active[j]) continue;
+        double crit = sums[i] + sums[j] - static_cast<double>(r - 2) * (*dist)(i, j);
+        critMax = max(critMax, crit);
+      }
+    }
+    vector<size_t> pair = work.getBestPair();
+    for (size_t k = 0; k < n; ++k)
+    {
+      //Row sums are updated incrementally, and may only differ by rounding errors:
+      if (active[k] && abs(work.getSum(k) - sums[k]) > 1e-9 * (1. + abs(sums[k])))
+      {
+        cout << "Wrong row sum at step " << n - r << "." << endl;
+        return 1;
+      }
+    }
+    //Row sums are not exact, so near ties may be broken either way:
+    double crit = sums[pair[0]] + sums[pair[1]] - static_cast<double>(r - 2) * (*dist)(pair[0], pair[1]);
+    if (pair[0] == pair[1] || !active[pair[0]] || !active[pair[1]] || crit < critMax - 1e-9 * (1. + abs(critMax)))
+    {
+      cout << "Wrong pair selected at step " << n - r << "." << endl;
+      return 1;
+    }
+    vector<double> newDist(n, 0.);
+    for (size_t k = 0; k < n; ++k)
+    {
+      if (active[k] && k != pair[0] && k != pair[1])
+        newDist[k] = .5 * ((*dist)(pair[0], k) + (*dist)(pair[1], k) - (*dist)(pair[0], pair[1]));
+    }
+    work.agglomerate(pair, newDist);
+    active[pair[1]] = false;
+    for (size_t k = 0; k < n; ++k)
+    {
+      if (active[k] && k != pair[0])
+        (*dist)(pair[0], k) = (*dist)(k, pair[0]) = newDist[k];
+    }
+  }
+  cout << "Pruned search: ok" << endl;
+
+  delete dist;
+
+  //Input/output:
+  dist = TreeTemplateTools::getDistanceMatrix(*tree);
+  if (!testFormats(*dist))
+    return 1;
+
+  delete dist;
+  delete tree;
+  return 0;
+}
@@ -0,0 +1,192 @@
+//
+// File: test_distance_estimation.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 22:10 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Distance/DistanceEstimation.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool isClose(double x, double ref, double tol)
+{
+  return abs(x - ref) <= tol * max(1., abs(ref));
+}
+
+//The likelihood of a pair of sequences and its derivatives, computed from pair counts,
+//must match a plain sum over all sites, states and rate classes:
+bool testPairCounts(const SiteContainer& sites, SubstitutionModel& model, DiscreteDistribution& rdist)
+{
+  TwoTreeLikelihood lik("A", "B", sites, &model, &rdist, false);
+  lik.initialize();
+  lik.enableDerivatives(true);
+  const Sequence& seq1 = sites.getSequence("A");
+  const Sequence& seq2 = sites.getSequence("B");
+  size_t nbStates = model.getNumberOfStates();
+  size_t nbClasses = rdist.getNumberOfCategories();
+  double lengths[3] = { 0.01, 0.2, 1.5 };
+  for (size_t k = 0; k < 3; ++k)
+  {
+    double t = lengths[k];
+    lik.setParameterValue("BrLen", t);
+    vector< RowMatrix<double> > p(nbClasses), dp(nbClasses), d2p(nbClasses);
+    for (size_t c = 0; c < nbClasses; ++c)
+    {
+      double r = rdist.getCategory(c);
+      MatrixTools::copy(model.getPij_t(t * r), p[c]);
+      MatrixTools::copy(model.getdPij_dt(t * r), dp[c]);
+      MatrixTools::copy(model.getd2Pij_dt2(t * r), d2p[c]);
+      for (size_t x = 0; x < nbStates; ++x)
+      {
+        for (size_t y = 0; y < nbStates; ++y)
+        {
+          dp[c](x, y) *= r;
+          d2p[c](x, y) *= r * r;
+        }
+      }
+    }
+    double logL = 0, dLogL = 0, d2LogL = 0;
+    for (size_t i = 0; i < sites.getNumberOfSites(); ++i)
+    {
+      double l = 0, dl = 0, d2l = 0;
+      for (size_t c = 0; c < nbClasses; ++c)
+      {
+        for (size_t x = 0; x < nbStates; ++x)
+        {
+          double wx = rdist.getProbability(c) * model.freq(x) * model.getInitValue(x, seq1.getValue(i));
+          for (size_t y = 0; y < nbStates; ++y)
+          {
+            double w = wx * model.getInitValue(y, seq2.getValue(i));
+            l   += w * p[c](x, y);
+            dl  += w * dp[c](x, y);
+            d2l += w * d2p[c](x, y);
+          }
+        }
+      }
+      logL   += log(l);
+      dLogL  += dl / l;
+      d2LogL += d2l / l - (dl / l) * (dl / l);
+    }
+    cout << "Length " << t << ": " << lik.getLogLikelihood() << "/" << logL
+         << "\t" << -lik.getFirstOrderDerivative("BrLen") << "/" << dLogL
+         << "\t" << -lik.getSecondOrderDerivative("BrLen") << "/" << d2LogL << endl;
+    if (!isClose(lik.getLogLikelihood(), logL, 1e-9)
+        || !isClose(-lik.getFirstOrderDerivative("BrLen"), dLogL, 1e-7)
+        || !isClose(-lik.getSecondOrderDerivative("BrLen"), d2LogL, 1e-7))
+      return false;
+  }
+  return true;
+}
+
+//Matrices computed with one and several threads must be identical,
+//also when parameters are estimated for each pair:
+bool testThreads(const SiteContainer& sites, const SubstitutionModel& model, const DiscreteDistribution& rdist)
+{
+  DistanceEstimation serial(model.clone(), rdist.clone(), &sites, 0, false);
+  DistanceEstimation parallel(model.clone(), rdist.clone(), &sites, 0, false);
+  parallel.setNumberOfThreads(3);
+  for (size_t k = 0; k < 2; ++k)
+  {
+    if (k == 1)
+    {
+      serial.setAdditionalParameters(serial.getSubstitutionModel().getIndependentParameters().createSubList("T92.kappa"));
+      parallel.setAdditionalParameters(parallel.getSubstitutionModel().getIndependentParameters().createSubList("T92.kappa"));
+    }
+    serial.computeMatrix();
+    parallel.computeMatrix();
+    unique_ptr<DistanceMatrix> dist1(serial.getMatrix());
+    unique_ptr<DistanceMatrix> dist3(parallel.getMatrix());
+    for (size_t i = 0; i < dist1->size(); ++i)
+    {
+      for (size_t j = 0; j < dist1->size(); ++j)
+      {
+        if ((*dist1)(i, j) != (*dist3)(i, j))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+    unique_ptr<SubstitutionModel> model(new T92(alphabet, 3., 0.4));
+    unique_ptr<DiscreteDistribution> rdist(new GammaDiscreteRateDistribution(4, 0.5));
+    unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("((A:0.1, B:0.2):0.05, C:0.3, D:0.15);"));
+
+    //Simulate some data, with a few ambiguous characters:
+    HomogeneousSequenceSimulator simulator(model.get(), rdist.get(), tree.get());
+    unique_ptr<SiteContainer> simulated(simulator.simulate(500));
+    VectorSiteContainer sites(alphabet);
+    for (size_t i = 0; i < simulated->getNumberOfSequences(); ++i)
+    {
+      string seq = simulated->getSequence(i).toString();
+      for (size_t j = i; j < seq.size(); j += 37)
+        seq[j] = (j % 2 == 0 ? 'N' : 'R');
+      sites.addSequence(BasicSequence(simulated->getSequence(i).getName(), seq, alphabet));
+    }
+
+    if (!testPairCounts(sites, *model, *rdist))
+    {
+      cerr << "Pair-count likelihood differs from the per-site computation." << endl;
+      return 1;
+    }
+    if (!testThreads(sites, *model, *rdist))
+    {
+      cerr << "Distances depend on the number of threads." << endl;
+      return 1;
+    }
+  } catch (exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -46,7 +46,10 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
 #include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
 #include <Bpp/Phyl/OptimizationTools.h>
+#include <Bpp/Phyl/BootstrapTools.h>
+#include <Bpp/Phyl/TreeTools.h>
 #include <iostream>
+#include <random>
 
 using namespace bpp;
 using namespace std;
@@ -134,5 +137,57 @@ int main() {
     if (abs(d1sr - d1dr) > 0.000001) return 1;
   }
 
+  //Changing the tree of a likelihood object must give the same results as a new object.
+  //Swap B and C, keeping node ids:
+  tldr.setParameterValue("T92.kappa", 2.);
+  unique_ptr<TreeTemplate<Node> > tree2(tree->clone());
+  Node* nodeB = tree2->getNode("B");
+  Node* nodeC = tree2->getNode("C");
+  Node* fatherB = nodeB->getFather();
+  Node* root = tree2->getRootNode();
+  fatherB->removeSon(nodeB);
+  root->removeSon(nodeC);
+  fatherB->addSon(nodeC);
+  root->addSon(nodeB);
+  tldr.setTree(*tree2);
+  unique_ptr<SubstitutionModel> model2(model->clone());
+  unique_ptr<DiscreteDistribution> rdist2(rdist->clone());
+  DRHomogeneousTreeLikelihood tldr2(*tree2, sites, model2.get(), rdist2.get());
+  tldr2.initialize();
+  cout << "New tree:\t" << tldr.getValue() << "\t" << tldr2.getValue() << endl;
+  if (abs(tldr.getValue() - tldr2.getValue()) > 1e-9 * abs(tldr2.getValue())) return 1;
+  params = tldr2.getBranchLengthsParameters().getParameterNames();
+  for (vector<string>::iterator it = params.begin(); it != params.end(); ++it) {
+    if (abs(tldr.getFirstOrderDerivative(*it) - tldr2.getFirstOrderDerivative(*it)) > 0.000001) return 1;
+  }
+
+  //Bootstrap weights of the likelihood patterns must sum to the number of sites,
+  //and replicates must not depend on the number of threads:
+  NNIHomogeneousTreeLikelihood tlnni(*tree, sites, model.get(), rdist.get());
+  tlnni.initialize();
+  for (unsigned int r = 0; r < 3; ++r) {
+    seed_seq seq = { 5u, r };
+    mt19937 generator(seq);
+    vector<unsigned int> bsWeights = BootstrapTools::getBootstrapWeights(tlnni.getLikelihoodData()->getWeights(), generator);
+    unsigned int sum = 0;
+    for (size_t i = 0; i < bsWeights.size(); ++i)
+      sum += bsWeights[i];
+    if (sum != sites.getNumberOfSites()) {
+      cerr << "Bootstrap weights do not sum to the number of sites." << endl;
+      return 1;
+    }
+  }
+  vector<Tree*> bsTrees = BootstrapTools::bootstrapLikelihood(tlnni, tlnni.getParameters(), 3, true, 100, 100, 1000000, 2, 5, 0);
+  vector<Tree*> bsTreesSerial = BootstrapTools::bootstrapLikelihood(tlnni, tlnni.getParameters(), 3, true, 100, 100, 1000000, 1, 5, 0);
+  for (size_t i = 0; i < bsTrees.size(); ++i) {
+    bool same = (TreeTools::treeToParenthesis(*bsTrees[i]) == TreeTools::treeToParenthesis(*bsTreesSerial[i]));
+    delete bsTrees[i];
+    delete bsTreesSerial[i];
+    if (!same) {
+      cerr << "Likelihood bootstrap replicate " << i << " is not reproducible." << endl;
+      return 1;
+    }
+  }
+
   return 0;
 }
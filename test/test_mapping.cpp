@@ -57,12 +57,57 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Phyl/Mapping/NaiveSubstitutionCount.h>
 #include <Bpp/Phyl/Mapping/ProbabilisticSubstitutionMapping.h>
 #include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+#include <Bpp/Phyl/Mapping/BinarySubstitutionMapping.h>
+#include <Bpp/Phyl/Mapping/StochasticMapping.h>
+#include <Bpp/Phyl/Mapping/BranchJointLikelihoods.h>
+#include <Bpp/Phyl/Mapping/RewardMappingTools.h>
+#include <Bpp/Phyl/Mapping/BatchSubstitutionMapping.h>
+#include <Bpp/Seq/AlphabetIndex/UserAlphabetIndex1.h>
 #include <Bpp/Seq/AlphabetIndex/GranthamAAVolumeIndex.h>
+#include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <cstdio>
+#include <cmath>
 
 using namespace bpp;
 using namespace std;
 
+//Counts the updates of the model, each of which rebuilds the powers of the jump matrix:
+class CountingUniformizationSubstitutionCount:
+  public UniformizationSubstitutionCount
+{
+  public:
+    size_t nbModelUpdates;
+
+  public:
+    CountingUniformizationSubstitutionCount(const SubstitutionModel* model, SubstitutionRegister* reg) :
+      UniformizationSubstitutionCount(model, reg), nbModelUpdates(0) {}
+
+    CountingUniformizationSubstitutionCount* clone() const { return new CountingUniformizationSubstitutionCount(*this); }
+
+    void setSubstitutionModel(const SubstitutionModel* model)
+    {
+      nbModelUpdates++;
+      UniformizationSubstitutionCount::setSubstitutionModel(model);
+    }
+};
+
+//Tell if the mean of independent samples is within a given number of standard errors of its expectation:
+bool isWithinStandardErrors(const vector<double>& samples, double expected, double nbErrors)
+{
+  double size = static_cast<double>(samples.size());
+  double mean = 0;
+  for (size_t k = 0; k < samples.size(); ++k)
+    mean += samples[k] / size;
+  double var = 0;
+  for (size_t k = 0; k < samples.size(); ++k)
+    var += (samples[k] - mean) * (samples[k] - mean) / (size - 1.);
+  return abs(mean - expected) <= nbErrors * sqrt(var / size) + 1e-9 * abs(expected);
+}
+
 int main() {
   try {
   TreeTemplate<Node>* tree = TreeTemplateTools::parenthesisToTree("((A:0.001, B:0.002):0.008,C:0.01,D:0.02);");
@@ -162,6 +207,24 @@ int main() {
   ProbabilisticSubstitutionMapping* probMapDecDet = 
     SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountDecDet);
 
+  //Check that counts for several lengths are consistent with single-length counts:
+  vector<double> lengths(3);
+  lengths[0] = 0.1; lengths[1] = 0.5; lengths[2] = 0.1;
+  vector< vector< RowMatrix<double> > > counts;
+  sCountDecDet->getAllNumbersOfSubstitutionsForEachLength(lengths, counts);
+  for (size_t l = 0; l < lengths.size(); ++l) {
+    m = sCountDecDet->getAllNumbersOfSubstitutions(lengths[l], 1);
+    for (size_t x = 0; x < m->getNumberOfRows(); ++x) {
+      for (size_t y = 0; y < m->getNumberOfColumns(); ++y) {
+        if (abs((*m)(x, y) - counts[l][0](x, y)) > 1e-12) {
+          cerr << "Counts for several lengths differ from single-length counts." << endl;
+          return 1;
+        }
+      }
+    }
+    delete m;
+  }
+
   //Uniformization
   SubstitutionCount* sCountUniTot = new UniformizationSubstitutionCount(model, totReg);
   m = sCountUniTot->getAllNumbersOfSubstitutions(0.001,1);
@@ -171,6 +234,24 @@ int main() {
   ProbabilisticSubstitutionMapping* probMapUniTot = 
     SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniTot);  
 
+  //Lengths are computed in a single pass, and must match lengths computed one by one:
+  lengths.push_back(2.);
+  SubstitutionCount* sCountUniTotSingle = sCountUniTot->clone();
+  sCountUniTot->getAllNumbersOfSubstitutionsForEachLength(lengths, counts);
+  for (size_t l = 0; l < lengths.size(); ++l) {
+    m = sCountUniTotSingle->getAllNumbersOfSubstitutions(lengths[l], 1);
+    for (size_t x = 0; x < m->getNumberOfRows(); ++x) {
+      for (size_t y = 0; y < m->getNumberOfColumns(); ++y) {
+        if (abs((*m)(x, y) - counts[l][0](x, y)) > 1e-12) {
+          cerr << "Uniformization counts for several lengths differ from single-length counts." << endl;
+          return 1;
+        }
+      }
+    }
+    delete m;
+  }
+  delete sCountUniTotSingle;
+
   SubstitutionCount* sCountUniDet = new UniformizationSubstitutionCount(model, detReg);
   m = sCountUniDet->getAllNumbersOfSubstitutions(0.001,1);
   cout << "Detailed count, uniformization method, type 1:" << endl;
@@ -179,6 +260,263 @@ int main() {
   ProbabilisticSubstitutionMapping* probMapUniDet = 
     SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet);
 
+  //All branches share the same model, which must only be set once per mapping:
+  CountingUniformizationSubstitutionCount sCountUniCounting(model, detReg->clone());
+  for (unsigned int k = 0; k < 2; ++k) {
+    sCountUniCounting.nbModelUpdates = 0;
+    unique_ptr<ProbabilisticSubstitutionMapping> probMapUniCounting(
+      SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, sCountUniCounting));
+    if (sCountUniCounting.nbModelUpdates != 1) {
+      cerr << "The model of the count was set " << sCountUniCounting.nbModelUpdates << " times for " << ids.size() << " branches." << endl;
+      return 1;
+    }
+  }
+
+  //Check that a parallel mapping gives the same results, and write it in binary format as branches are mapped:
+  ofstream binOut("test_mapping.bsm", ios::out | ios::binary);
+  BinarySubstitutionMappingWriter binWriter(binOut, *tree, sites, sCountUniDet->getNumberOfSubstitutionTypes(), true);
+  ProbabilisticSubstitutionMapping* probMapUniDetPar = 
+    SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet, false, 4, &binWriter);
+  binOut.close();
+  if (!binWriter.isComplete()) {
+    cerr << "Some branches were not written." << endl;
+    return 1;
+  }
+  BinarySubstitutionMappingReader binReader("test_mapping.bsm");
+  ProbabilisticSubstitutionMapping probMapUniDetBin(*tree, sCountUniDet, 0);
+  binReader.fillMapping(probMapUniDetBin);
+  //Mappings are stored by site pattern, and expanded on the first non-constant access:
+  const ProbabilisticSubstitutionMapping probMapUniDetCompressed(*probMapUniDet);
+  if (!probMapUniDetCompressed.isCompressed()) {
+    cerr << "Mapping is not stored by site pattern." << endl;
+    return 1;
+  }
+  for (size_t j = 0; j < ids.size(); ++j) {
+    for (size_t i = 0; i < probMapUniDet->getNumberOfSites(); ++i) {
+      for (size_t t = 0; t < probMapUniDet->getNumberOfSubstitutionTypes(); ++t) {
+        if (abs((*probMapUniDet)(j, i, t) - (*probMapUniDetPar)(j, i, t)) > 1e-12) {
+          cerr << "Parallel mapping differs from serial mapping." << endl;
+          return 1;
+        }
+        if (probMapUniDetCompressed(j, i, t) != (*probMapUniDet)(j, i, t)) {
+          cerr << "Expanded mapping differs from compressed mapping." << endl;
+          return 1;
+        }
+        if (probMapUniDetBin(j, i, t) != (*probMapUniDetPar)(j, i, t)) {
+          cerr << "Binary mapping differs from written mapping." << endl;
+          return 1;
+        }
+      }
+    }
+  }
+  delete probMapUniDetPar;
+  remove("test_mapping.bsm");
+
+  //A header with counts larger than the file must be rejected before anything is allocated:
+  ofstream badOut("test_mapping.bsm", ios::out | ios::binary);
+  badOut << BinarySubstitutionMappingFormat::MAGIC;
+  unsigned char badHeader[32] = { 8 }; // Value size, then the numbers of branches, sites and types.
+  for (size_t k = 8; k < 32; ++k)
+    badHeader[k] = 0xFF;
+  badOut.write(reinterpret_cast<const char*>(badHeader), 32);
+  badOut.close();
+  try {
+    BinarySubstitutionMappingReader badReader("test_mapping.bsm");
+    cerr << "Corrupted binary mapping was not rejected." << endl;
+    return 1;
+  } catch (IOException& e) {}
+  remove("test_mapping.bsm");
+
+  //Check that per-branch counts summed over site patterns match the full mapping:
+  vector< vector<double> > countsPerBranch = SubstitutionMappingTools::computeCountsPerBranch(drhtl, ids, *sCountUniDet, -1, false, 2);
+  for (size_t j = 0; j < ids.size(); ++j) {
+    vector<double> sum = SubstitutionMappingTools::computeSumForBranch(*probMapUniDet, probMapUniDet->getNodeIndex(ids[j]));
+    for (size_t t = 0; t < sum.size(); ++t) {
+      if (abs(countsPerBranch[j][t] - sum[t]) > 1e-9 * max(1., abs(sum[t]))) {
+        cerr << "Counts per branch differ from the sum of the mapping." << endl;
+        return 1;
+      }
+    }
+  }
+
+  //A branch given twice is counted at both positions, and the root has no branch:
+  vector<int> twiceIds;
+  twiceIds.push_back(ids[1]);
+  twiceIds.push_back(ids[0]);
+  twiceIds.push_back(ids[1]);
+  vector< vector<double> > countsTwice = SubstitutionMappingTools::computeCountsPerBranch(drhtl, twiceIds, *sCountUniDet, -1, false);
+  if (countsTwice[0] != countsTwice[2] || abs(countsTwice[0][0] - countsPerBranch[1][0]) > 1e-12 * max(1., abs(countsPerBranch[1][0]))) {
+    cerr << "Counts of a branch given twice differ." << endl;
+    return 1;
+  }
+  try {
+    SubstitutionMappingTools::computeCountsPerBranch(drhtl, vector<int>(1, drhtl.getTree().getRootId()), *sCountUniDet, -1, false);
+    cerr << "Counts were computed for the root node." << endl;
+    return 1;
+  } catch (NodeNotFoundException& e) {}
+
+  //Check that joint likelihoods can be shared by several mappings, computed in parallel:
+  BranchJointLikelihoods joint(drhtl, ids);
+  vector< vector<double> > countsPerBranchJoint = SubstitutionMappingTools::computeCountsPerBranch(joint, ids, *sCountUniDet, -1, false, 2);
+  UserAlphabetIndex1 gcIndex(alphabet);
+  gcIndex.setIndex(1, 1.);
+  gcIndex.setIndex(2, 1.);
+  DecompositionReward gcReward(model, &gcIndex);
+  ProbabilisticRewardMapping* rewardMap = RewardMappingTools::computeRewardVectors(drhtl, ids, gcReward, false);
+  ProbabilisticRewardMapping* rewardMapJoint = RewardMappingTools::computeRewardVectors(joint, ids, gcReward, false, 2);
+  for (size_t j = 0; j < ids.size(); ++j) {
+    for (size_t t = 0; t < countsPerBranch[j].size(); ++t) {
+      if (abs(countsPerBranchJoint[j][t] - countsPerBranch[j][t]) > 1e-12 * max(1., abs(countsPerBranch[j][t]))) {
+        cerr << "Counts per branch differ when joint likelihoods are shared." << endl;
+        return 1;
+      }
+    }
+    size_t b = rewardMap->getNodeIndex(ids[j]);
+    for (size_t i = 0; i < rewardMap->getNumberOfSites(); ++i) {
+      if (abs((*rewardMap)(b, i) - (*rewardMapJoint)(b, i)) > 1e-12) {
+        cerr << "Parallel reward mapping differs from serial mapping." << endl;
+        return 1;
+      }
+    }
+  }
+
+  //Check both mappings against posterior expectations computed independently,
+  //by enumerating all ancestral states of the first sites:
+  size_t nbStates  = model->getNumberOfStates();
+  size_t nbClasses = rdist->getNumberOfCategories();
+  size_t nbTypes   = sCountUniDet->getNumberOfSubstitutionTypes();
+  vector<int> innerIds = tree->getInnerNodesId();
+  vector<int> leafIds  = tree->getLeavesId();
+  vector< vector< RowMatrix<double> > > refP(ids.size(), vector< RowMatrix<double> >(nbClasses));
+  vector< vector< vector< RowMatrix<double> > > > refN(ids.size(), vector< vector< RowMatrix<double> > >(nbClasses, vector< RowMatrix<double> >(nbTypes)));
+  vector< vector< RowMatrix<double> > > refR(ids.size(), vector< RowMatrix<double> >(nbClasses));
+  for (size_t j = 0; j < ids.size(); ++j) {
+    for (size_t c = 0; c < nbClasses; ++c) {
+      double d = tree->getDistanceToFather(ids[j]) * rdist->getCategory(c);
+      MatrixTools::copy(model->getPij_t(d), refP[j][c]);
+      for (size_t t = 0; t < nbTypes; ++t) {
+        unique_ptr< Matrix<double> > nxy(sCountUniDet->getAllNumbersOfSubstitutions(d, t + 1));
+        MatrixTools::copy(*nxy, refN[j][c][t]);
+      }
+      unique_ptr< Matrix<double> > rxy(gcReward.getAllRewards(d));
+      MatrixTools::copy(*rxy, refR[j][c]);
+    }
+  }
+  size_t nbCombinations = 1;
+  for (size_t k = 0; k < innerIds.size(); ++k)
+    nbCombinations *= nbStates;
+  map<int, size_t> states;
+  for (size_t i = 0; i < 100; ++i) {
+    for (size_t k = 0; k < leafIds.size(); ++k)
+      states[leafIds[k]] = static_cast<size_t>(sites.getSequence(tree->getNodeName(leafIds[k])).getValue(i));
+    double total = 0;
+    vector< vector<double> > refCounts(ids.size(), vector<double>(nbTypes, 0));
+    vector<double> refRewards(ids.size(), 0);
+    for (size_t c = 0; c < nbClasses; ++c) {
+      for (size_t comb = 0; comb < nbCombinations; ++comb) {
+        size_t code = comb;
+        for (size_t k = 0; k < innerIds.size(); ++k) {
+          states[innerIds[k]] = code % nbStates;
+          code /= nbStates;
+        }
+        double p = rdist->getProbability(c) * model->freq(states[tree->getRootId()]);
+        for (size_t j = 0; j < ids.size(); ++j)
+          p *= refP[j][c](states[tree->getFatherId(ids[j])], states[ids[j]]);
+        total += p;
+        for (size_t j = 0; j < ids.size(); ++j) {
+          size_t x = states[tree->getFatherId(ids[j])];
+          size_t y = states[ids[j]];
+          for (size_t t = 0; t < nbTypes; ++t)
+            refCounts[j][t] += p * refN[j][c][t](x, y);
+          refRewards[j] += p * refR[j][c](x, y);
+        }
+      }
+    }
+    for (size_t j = 0; j < ids.size(); ++j) {
+      for (size_t t = 0; t < nbTypes; ++t) {
+        double ref = refCounts[j][t] / total;
+        if (abs((*probMapUniDet)(probMapUniDet->getNodeIndex(ids[j]), i, t) - ref) > 1e-6 * max(1., abs(ref))) {
+          cerr << "Substitution mapping differs from the enumeration of ancestral states." << endl;
+          return 1;
+        }
+      }
+      double ref = refRewards[j] / total;
+      if (abs((*rewardMapJoint)(rewardMapJoint->getNodeIndex(ids[j]), i) - ref) > 1e-6 * max(1., abs(ref))) {
+        cerr << "Reward mapping differs from the enumeration of ancestral states." << endl;
+        return 1;
+      }
+    }
+  }
+  vector<double> gcTimes(ids.size());
+  for (size_t j = 0; j < ids.size(); ++j)
+    gcTimes[j] = RewardMappingTools::computeSumForBranch(*rewardMap, rewardMap->getNodeIndex(ids[j]));
+  delete rewardMap;
+  delete rewardMapJoint;
+
+  //Check that several alignments can be mapped in parallel with counts computed once:
+  BatchSubstitutionMapping batch(*tree, *model, *rdist, *sCountUniDet, false);
+  vector<const SiteContainer*> alignments(3, &sites);
+  vector<bool> mapped(alignments.size(), false);
+  bool batchOk = true;
+  batch.mapAlignments(alignments, [&](size_t k, const DRTreeLikelihood& lik, const ProbabilisticSubstitutionMapping& mapping) {
+    mapped[k] = true;
+    if (abs(lik.getValue() - drhtl.getValue()) > 1e-9 * abs(drhtl.getValue()))
+      batchOk = false;
+    for (size_t j = 0; j < ids.size(); ++j) {
+      vector<double> sum = SubstitutionMappingTools::computeSumForBranch(mapping, mapping.getNodeIndex(ids[j]));
+      for (size_t t = 0; t < sum.size(); ++t) {
+        if (abs(sum[t] - countsPerBranch[j][t]) > 1e-9 * max(1., abs(countsPerBranch[j][t])))
+          batchOk = false;
+      }
+    }
+  }, 2, false);
+  if (!batchOk || find(mapped.begin(), mapped.end(), false) != mapped.end()) {
+    cerr << "Batch mapping differs from single mapping." << endl;
+    return 1;
+  }
+
+  //Check that sampled histories agree with the expected counts and rewards, and do not depend on the number of threads:
+  size_t nbSamples = 20;
+  StochasticMapping stochMap(drhtl, *detReg);
+  stochMap.sample(nbSamples, 42, 2, false);
+  StochasticMapping stochMapSerial(drhtl, *detReg);
+  stochMapSerial.sample(nbSamples, 42, 1, false);
+  for (size_t j = 0; j < ids.size(); ++j) {
+    size_t b = stochMap.getBranchIndex(ids[j]);
+    double length = tree->getNode(ids[j])->getDistanceToFather();
+    vector<double> sampledCounts(nbSamples, 0.);
+    vector<double> sampledTimes(nbSamples, 0.);
+    for (size_t k = 0; k < nbSamples; ++k) {
+      double time = 0;
+      for (size_t x = 0; x < stochMap.getNumberOfStates(); ++x) {
+        time += stochMap.getDwellingTime(k, b, x);
+        sampledTimes[k] += gcIndex.getIndex(static_cast<int>(x)) * stochMap.getDwellingTime(k, b, x);
+      }
+      if (abs(time - static_cast<double>(n) * length) > 1e-6 * static_cast<double>(n) * length) {
+        cerr << "Dwelling times do not sum to the branch length." << endl;
+        return 1;
+      }
+      for (size_t t = 0; t < stochMap.getNumberOfSubstitutionTypes(); ++t) {
+        sampledCounts[k] += stochMap.getNumberOfSubstitutions(k, b, t);
+        if (stochMap.getNumberOfSubstitutions(k, b, t) != stochMapSerial.getNumberOfSubstitutions(k, b, t)) {
+          cerr << "Sampled histories depend on the number of threads." << endl;
+          return 1;
+        }
+      }
+    }
+    double expected = VectorTools::sum(countsPerBranch[j]);
+    cout << "Branch " << ids[j] << ": expected " << expected << " substitutions, sampled " << VectorTools::sum(stochMap.getMeanNumberOfSubstitutions(b))
+         << "; expected " << gcTimes[j] << " in G or C, sampled " << VectorTools::sum(sampledTimes) / static_cast<double>(nbSamples) << endl;
+    if (!isWithinStandardErrors(sampledCounts, expected, 4.)) {
+      cerr << "Sampled histories do not match the expected counts." << endl;
+      return 1;
+    }
+    if (!isWithinStandardErrors(sampledTimes, gcTimes[j], 4.)) {
+      cerr << "Sampled dwelling times do not match the reward mapping." << endl;
+      return 1;
+    }
+  }
+
   //Check saturation:
   cout << "checking saturation..." << endl;
   double td[] = {0.001, 0.01, 0.1, 1, 2, 3, 4, 10};
@@ -38,11 +38,22 @@ knowledge of the CeCILL license and that you accept its terms.
 */
 
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <Bpp/Seq/Io/Phylip.h>
 #include <Bpp/Phyl/Tree.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
 #include <Bpp/Phyl/Io/Newick.h>
 #include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
+#include <Bpp/Phyl/Parsimony/DRTreeSankoffParsimonyScore.h>
+#include <Bpp/Phyl/Parsimony/ParsimonyStepwiseAddition.h>
+#include <Bpp/Phyl/BootstrapTools.h>
+#include <Bpp/Phyl/OptimizationTools.h>
+#include <Bpp/Phyl/TreeTools.h>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <random>
 
 using namespace bpp;
 using namespace std;
@@ -59,7 +70,187 @@ int main() {
     cout << "Parsimony score: " << pars.getScore() << endl;
 
     if (pars.getScore() != 9) return 1;
-    
+
+    // Weighted parsimony with unit costs must give the same score:
+    size_t nbStates = pars.getStateMap().getNumberOfModelStates();
+    RowMatrix<double> costs(nbStates, nbStates);
+    for (size_t i = 0; i < nbStates; ++i)
+      for (size_t j = 0; j < nbStates; ++j)
+        costs(i, j) = (i == j ? 0. : 1.);
+    DRTreeSankoffParsimonyScore wpars(*tree, *sites, costs, true, true);
+
+    cout << "Weighted parsimony score: " << wpars.getWeightedScore() << endl;
+
+    if (wpars.getScore() != 9) return 1;
+
+    // Non-unit costs, transitions cost 1 and transversions 2.5. With the tree ((A,B),C,D), the four
+    // sites below need one transition (1), one transversion (2.5), one transversion and two transitions
+    // (4.5) and two transversions (5):
+    VectorSiteContainer costSites(&AlphabetTools::DNA_ALPHABET);
+    costSites.addSequence(BasicSequence("A", "AAAA", &AlphabetTools::DNA_ALPHABET));
+    costSites.addSequence(BasicSequence("B", "AAGC", &AlphabetTools::DNA_ALPHABET));
+    costSites.addSequence(BasicSequence("C", "GCCA", &AlphabetTools::DNA_ALPHABET));
+    costSites.addSequence(BasicSequence("D", "GCTC", &AlphabetTools::DNA_ALPHABET));
+    unique_ptr< TreeTemplate<Node> > costTree(TreeTemplateTools::parenthesisToTree("((A:1,B:1):1,C:1,D:1);"));
+    RowMatrix<double> tsTvCosts(4, 4);
+    for (size_t i = 0; i < 4; ++i)
+      for (size_t j = 0; j < 4; ++j)
+        tsTvCosts(i, j) = (i == j ? 0. : ((i + j) % 2 == 0 ? 1. : 2.5));
+    DRTreeSankoffParsimonyScore tsTvPars(*costTree, costSites, tsTvCosts, false);
+    cout << "Transition/transversion parsimony score: " << tsTvPars.getWeightedScore() << endl;
+    if (abs(tsTvPars.getWeightedScore() - 13.) > 1e-9) return 1;
+
+    // Incremental NNI scores must match the scores of the resulting trees:
+    DRTreeSankoffParsimonyScore tsTvExample(*tree, *sites, tsTvCosts, false);
+    vector<DRTreeSankoffParsimonyScore*> nniScores;
+    nniScores.push_back(&wpars);
+    nniScores.push_back(&tsTvExample);
+    for (size_t k = 0; k < nniScores.size(); ++k) {
+      vector<int> nniIds = nniScores[k]->getTopology().getInnerNodesId();
+      for (size_t i = 0; i < nniIds.size(); ++i) {
+        double diff;
+        try {
+          diff = nniScores[k]->testNNI(nniIds[i]);
+        } catch (NodeException& ne) {
+          continue;
+        }
+        unique_ptr<DRTreeSankoffParsimonyScore> nni(nniScores[k]->clone());
+        nni->doNNI(nniIds[i]);
+        nni->topologyChangeTested(TopologyChangeEvent());
+        DRTreeSankoffParsimonyScore fresh(nni->getTopology(), *sites, k == 0 ? costs : tsTvCosts, false, k == 0);
+        if (abs(nni->getWeightedScore() - nniScores[k]->getWeightedScore() - diff) > 1e-9
+            || abs(fresh.getWeightedScore() - nni->getWeightedScore()) > 1e-9) {
+          cerr << "Wrong NNI score for node " << nniIds[i] << endl;
+          return 1;
+        }
+      }
+    }
+
+    // Codons with gaps need more than 64 states. With the tree ((A,B),C,D), the four sites below
+    // need 1 (AB|CD), 2 (AC|BD), 3 (all different), 1 (gap in D) and 0 (unknown in D) changes:
+    CodonAlphabet codonAlphabet(&AlphabetTools::DNA_ALPHABET);
+    VectorSiteContainer codonSites(&codonAlphabet);
+    codonSites.addSequence(BasicSequence("A", "AAAAAAAAAAAAAAA", &codonAlphabet));
+    codonSites.addSequence(BasicSequence("B", "AAACCCCCCAAAAAA", &codonAlphabet));
+    codonSites.addSequence(BasicSequence("C", "CCCAAAGGGAAAAAA", &codonAlphabet));
+    codonSites.addSequence(BasicSequence("D", "CCCCCCTTT---NNN", &codonAlphabet));
+    unique_ptr< TreeTemplate<Node> > codonTree(TreeTemplateTools::parenthesisToTree("((A:1,B:1):1,C:1,D:1);"));
+    DRTreeParsimonyScore codonPars(*codonTree, codonSites, false, true);
+    cout << "Codon parsimony score: " << codonPars.getScore() << endl;
+    if (codonPars.getStateMap().getNumberOfModelStates() <= 64 || codonPars.getScore() != 7) return 1;
+
+    // Incremental SPR scores must match the scores of the resulting trees:
+    vector<int> ids = pars.getTopology().getNodesId();
+    for (size_t i = 0; i < ids.size(); ++i) {
+      if (!pars.getTopology().hasFather(ids[i])) continue;
+      vector<int> regraftIds;
+      vector<double> diffs;
+      try {
+        pars.testSPRs(ids[i], 0, regraftIds, diffs);
+      } catch (NodeException& ne) {
+        continue;
+      }
+      for (size_t j = 0; j < regraftIds.size(); ++j) {
+        unique_ptr<DRTreeParsimonyScore> spr(pars.clone());
+        spr->doSPR(ids[i], regraftIds[j]);
+        spr->topologyChangePerformed(TopologyChangeEvent());
+        if (static_cast<double>(spr->getScore()) != pars.getScore() + diffs[j]) {
+          cerr << "Wrong SPR score for node " << ids[i] << " regrafted to " << regraftIds[j] << endl;
+          return 1;
+        }
+      }
+    }
+
+    // Incremental TBR scores must match the scores of the resulting trees:
+    for (size_t i = 0; i < ids.size(); ++i) {
+      if (!pars.getTopology().hasFather(ids[i])) continue;
+      vector<int> subtreeIds;
+      vector<int> regraftIds;
+      vector<double> diffs;
+      try {
+        pars.testTBRs(ids[i], 0, subtreeIds, regraftIds, diffs);
+      } catch (NodeException& ne) {
+        continue;
+      }
+      for (size_t j = 0; j < regraftIds.size(); ++j) {
+        unique_ptr<DRTreeParsimonyScore> tbr(pars.clone());
+        tbr->doTBR(ids[i], subtreeIds[j], regraftIds[j]);
+        tbr->topologyChangePerformed(TopologyChangeEvent());
+        if (static_cast<double>(tbr->getScore()) != pars.getScore() + diffs[j]) {
+          cerr << "Wrong TBR score for node " << ids[i] << " rerooted at " << subtreeIds[j] << " and regrafted to " << regraftIds[j] << endl;
+          return 1;
+        }
+      }
+    }
+
+    // A TBR search never increases the score, and keeps all leaves:
+    vector<string> names = tree->getLeavesNames();
+    sort(names.begin(), names.end());
+    DRTreeParsimonyScore* tbrSearch = OptimizationTools::optimizeTreeSPR(pars.clone(), SPRTopologySearch::TBR, 0, 0, 0.25, 0);
+    cout << "TBR score: " << tbrSearch->getScore() << endl;
+    vector<string> tbrNames = tbrSearch->getTopology().getLeavesNames();
+    sort(tbrNames.begin(), tbrNames.end());
+    if (tbrSearch->getScore() > pars.getScore() || tbrNames != names) {
+      cerr << "TBR search increased the score or lost leaves." << endl;
+      return 1;
+    }
+    delete tbrSearch;
+
+    // Stepwise addition scores must match the scores of the resulting trees:
+    ParsimonyStepwiseAddition builder(*sites, true);
+    vector<unsigned int> scores;
+    vector<TreeTemplate<Node>*> starts = builder.buildTrees(8, 2, 2, 1, &scores);
+    for (size_t i = 0; i < starts.size(); ++i) {
+      DRTreeParsimonyScore spars(*starts[i], *sites, false, true);
+      cout << "Stepwise addition score: " << scores[i] << endl;
+      if (spars.getScore() != scores[i]) return 1;
+      delete starts[i];
+    }
+
+    // One tree is the first replicate with the same seed:
+    unsigned int oneScore;
+    TreeTemplate<Node>* one = builder.buildTree(3, oneScore);
+    starts = builder.buildTrees(1, 1, 1, 3, &scores);
+    if (oneScore != scores[0] || TreeTemplateTools::treeToParenthesis(*one) != TreeTemplateTools::treeToParenthesis(*starts[0])) {
+      cerr << "buildTree() and buildTrees() do not use the same seeds." << endl;
+      return 1;
+    }
+    delete one;
+    delete starts[0];
+
+    // Resampled weights must sum to the number of sites, and depend only on the seed:
+    for (unsigned int r = 0; r < 4; ++r) {
+      seed_seq seq1 = { 1u, r };
+      seed_seq seq2 = { 1u, r };
+      mt19937 generator1(seq1);
+      mt19937 generator2(seq2);
+      vector<unsigned int> bsWeights = BootstrapTools::getBootstrapWeights(pars.getWeights(), generator1);
+      unsigned int sum = 0;
+      for (size_t i = 0; i < bsWeights.size(); ++i)
+        sum += bsWeights[i];
+      if (sum != sites->getNumberOfSites()) {
+        cerr << "Bootstrap weights do not sum to the number of sites." << endl;
+        return 1;
+      }
+      if (BootstrapTools::getBootstrapWeights(pars.getWeights(), generator2) != bsWeights) {
+        cerr << "Bootstrap weights are not reproducible." << endl;
+        return 1;
+      }
+    }
+
+    // Bootstrap by reweighting patterns, the replicates must not depend on the number of threads:
+    vector<Tree*> bsTrees = BootstrapTools::bootstrapParsimony(pars, 4, SPRTopologySearch::SPR, 0, 2, 1, 0);
+    vector<Tree*> bsTreesSerial = BootstrapTools::bootstrapParsimony(pars, 4, SPRTopologySearch::SPR, 0, 1, 1, 0);
+    for (size_t i = 0; i < bsTrees.size(); ++i) {
+      if (bsTrees[i]->getNumberOfLeaves() != tree->getNumberOfLeaves()) return 1;
+      if (TreeTools::treeToParenthesis(*bsTrees[i]) != TreeTools::treeToParenthesis(*bsTreesSerial[i])) {
+        cerr << "Bootstrap replicate " << i << " is not reproducible." << endl;
+        return 1;
+      }
+      delete bsTrees[i];
+      delete bsTreesSerial[i];
+    }
+
   } catch (Exception& ex) {
     cerr << ex.what() << endl;
     return 1;
@@ -39,6 +39,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include <Bpp/Numeric/Matrix/MatrixTools.h>
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Io/Fasta.h>
 #include <Bpp/Phyl/TreeTemplate.h>
 #include <Bpp/Phyl/Model/Nucleotide/T92.h>
 #include <Bpp/Phyl/Model/FrequenciesSet/NucleotideFrequenciesSet.h>
@@ -46,14 +47,123 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
 #include <Bpp/Phyl/Model/SubstitutionModelSetTools.h>
 #include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Simulation/AliasTable.h>
+#include <Bpp/Phyl/Simulation/PhiloxGenerator.h>
 #include <Bpp/Phyl/Likelihood/RNonHomogeneousTreeLikelihood.h>
 #include <Bpp/Phyl/OptimizationTools.h>
 #include <iostream>
+#include <cmath>
+#include <cstdio>
 
 using namespace bpp;
 using namespace std;
 
+bool testAliasTable() {
+  vector<double> probs(5);
+  probs[0] = 0.1; probs[1] = 0.; probs[2] = 0.45; probs[3] = 0.05; probs[4] = 0.4;
+  AliasTable table(probs);
+  vector<unsigned int> counts(probs.size(), 0);
+  unsigned int n = 100000;
+  for (unsigned int i = 0; i < n; ++i) {
+    counts[table.draw()]++;
+  }
+  for (size_t i = 0; i < probs.size(); ++i) {
+    double f = static_cast<double>(counts[i]) / static_cast<double>(n);
+    cout << probs[i] << "\t" << f << endl;
+    if (abs(f - probs[i]) > 0.01)
+      return false;
+  }
+  return counts[1] == 0;
+}
+
+bool testPhilox() {
+  //Known-answer vectors of Philox4x32-10 (Random123), as counter, key and output:
+  uint32_t kat[3][10] = {
+    { 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+      0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+    { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+      0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+    { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
+      0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+  };
+  for (size_t i = 0; i < 3; ++i) {
+    uint64_t block  = (static_cast<uint64_t>(kat[i][1]) << 32) | kat[i][0];
+    uint64_t stream = (static_cast<uint64_t>(kat[i][3]) << 32) | kat[i][2];
+    uint64_t seed   = (static_cast<uint64_t>(kat[i][5]) << 32) | kat[i][4];
+    PhiloxGenerator generator(seed, stream);
+    generator.setBlock(block);
+    for (size_t j = 0; j < 4; ++j) {
+      if (generator.nextInt() != kat[i][6 + j])
+        return false;
+    }
+  }
+  return true;
+}
+
+bool testJumpChain() {
+  //Sites simulated with continuous rates evolve along the jump chain of the model,
+  //whose end states must follow the transition probabilities of the model:
+  NucleicAlphabet* alphabet = new DNA();
+  SubstitutionModel* model = new T92(alphabet, 3., 0.6);
+  GammaDiscreteRateDistribution gamma(4, 0.5);
+  double lengths[3] = { 0.05, 0.5, 2. };
+  size_t n = 20000;
+  bool ok = true;
+  for (size_t i = 0; i < 3; ++i) {
+    string length = TextTools::toString(lengths[i]);
+    unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("(A:" + length + ", B:" + length + ");"));
+    HomogeneousSequenceSimulator simulator(model, &gamma, tree.get());
+    for (size_t c = 0; c < gamma.getNumberOfCategories(); ++c) {
+      double rate = gamma.getCategory(c);
+      size_t x = (i + c) % 4;
+      vector<double> counts(4, 0.);
+      for (size_t k = 0; k < n; ++k) {
+        unique_ptr<Site> site(simulator.simulateSite(x, rate));
+        counts[static_cast<size_t>(site->getValue(0))]++;
+        counts[static_cast<size_t>(site->getValue(1))]++;
+      }
+      const Matrix<double>& pijt = model->getPij_t(lengths[i] * rate);
+      for (size_t y = 0; y < 4; ++y) {
+        double p = pijt(x, y);
+        double f = counts[y] / static_cast<double>(2 * n);
+        //Four standard errors, and some room for states that are (almost) never reached:
+        double tol = 4. * sqrt(p * (1. - p) / static_cast<double>(2 * n)) + 1e-4;
+        if (abs(f - p) > tol) {
+          cout << "Length " << lengths[i] << ", rate " << rate << ", " << x << "->" << y << ": " << f << " instead of " << p << endl;
+          ok = false;
+        }
+      }
+    }
+  }
+  delete model;
+  delete alphabet;
+  return ok;
+}
+
+bool testReproducibility(const NonHomogeneousSequenceSimulator& simulator) {
+  unique_ptr<SiteContainer> sites1(simulator.simulate(5500, 42, 1));
+  unique_ptr<SiteContainer> sites4(simulator.simulate(5500, 42, 4));
+  FastaSimulationSink sink("simulation.fasta", 70);
+  simulator.simulate(5500, sink, 42, 3);
+  unique_ptr<SequenceContainer> sites3(Fasta().readSequences("simulation.fasta", simulator.getAlphabet()));
+  remove("simulation.fasta");
+  for (size_t i = 0; i < sites1->getNumberOfSequences(); ++i) {
+    if (sites1->getSequence(i).toString() != sites4->getSequence(i).toString())
+      return false;
+    if (sites1->getSequence(i).toString() != sites3->getSequence(i).toString())
+      return false;
+  }
+  return true;
+}
+
 int main() {
+  if (!testAliasTable())
+    return 1;
+  if (!testPhilox())
+    return 1;
+  if (!testJumpChain())
+    return 1;
+
   TreeTemplate<Node>* tree = TreeTemplateTools::parenthesisToTree("((A:0.01, B:0.02):0.03,C:0.01,D:0.1);");
   vector<string> seqNames= tree->getLeavesNames();
   vector<int> ids = tree->getNodesId();
@@ -76,6 +186,8 @@ int main() {
     thetas.push_back(theta);
   }
   NonHomogeneousSequenceSimulator simulator(modelSet, rdist, tree);
+  if (!testReproducibility(simulator))
+    return 1;
 
   unsigned int n = 100000;
   OutputStream* profiler  = new StlOutputStream(new ofstream("profile.txt", ios::out));